@@ -0,0 +1,319 @@
+/**
+ * @file bench_bcm.cpp
+ * @brief Microbenchmarks for BCM hot paths (Google Benchmark)
+ *
+ * Benchmarks:
+ * - RX dispatch (route + handler) and each *_handle_cmd, valid and invalid
+ * - bcm_process() tick with an empty and a full RX queue
+ * - *_build_status_frame()
+ * - event_log_add() and a bulk event_log_read() of the full log
+ * - fault_manager_set()/clear() with every fault slot in use
+ *
+ * The BCM banner and log output are discarded; only benchmark results go
+ * to stdout. Track them with --benchmark_format=json or the bench_json
+ * target, which writes bcm_bench.json.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+extern "C" {
+#include "bcm.h"
+#include "bcm_log.h"
+#include "door_control.h"
+#include "lighting_control.h"
+#include "turn_signal.h"
+#include "fault_manager.h"
+#include "system_state.h"
+#include "can_interface.h"
+#include "can_ids.h"
+}
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+#define BENCH_COUNTERS      16U     /**< One frame per rolling counter value */
+
+typedef cmd_result_t (*bench_handler_t)(const can_frame_t *frame);
+
+typedef struct {
+    uint32_t        id;
+    uint8_t         dlc;
+    uint8_t         byte0;
+    uint8_t         byte1;
+    bench_handler_t handler;
+} bench_cmd_t;
+
+/** "msg" argument of the RX benchmarks */
+enum { BENCH_DOOR = 0, BENCH_LIGHTING, BENCH_TURN, BENCH_CMD_COUNT };
+
+/* Commands that keep the state unchanged after the first frame */
+static const bench_cmd_t g_cmds[BENCH_CMD_COUNT] = {
+    { CAN_ID_DOOR_CMD, DOOR_CMD_DLC, DOOR_CMD_LOCK_ALL, DOOR_ID_ALL,
+      door_control_handle_cmd },
+    { CAN_ID_LIGHTING_CMD, LIGHTING_CMD_DLC, HEADLIGHT_CMD_ON, INTERIOR_CMD_OFF,
+      lighting_control_handle_cmd },
+    { CAN_ID_TURN_SIGNAL_CMD, TURN_SIGNAL_CMD_DLC, TURN_CMD_LEFT_ON, 0x00,
+      turn_signal_handle_cmd },
+};
+
+/** Frames for counters 0..15; invalid frames carry a bad checksum */
+static void build_cmds(const bench_cmd_t *cmd, bool valid, can_frame_t *frames)
+{
+    for (uint8_t c = 0; c < BENCH_COUNTERS; c++) {
+        can_frame_t *frame = &frames[c];
+        can_frame_template_init(frame, cmd->id, cmd->dlc, CAN_CHECKSUM_SEED);
+        can_frame_put(frame, 0, cmd->byte0);
+        can_frame_put(frame, 1, cmd->byte1);
+        can_frame_put(frame, 2, CAN_BUILD_VER_CTR(CAN_SCHEMA_VERSION, c));
+        if (!valid) {
+            frame->data[cmd->dlc - 1U] ^= 0xFFU;
+        }
+    }
+}
+
+/** Throw away queued log messages so the ring never reports drops */
+static void discard_log(void)
+{
+    static FILE *null_out = fopen("/dev/null", "w");
+    if (null_out != NULL) {
+        (void)bcm_log_drain(null_out);
+    }
+}
+
+/** Fresh BCM with a started scheduler and empty queues */
+static void bench_reset(void)
+{
+    bcm_deinit();
+    (void)bcm_init(NULL);
+    (void)bcm_process(0);
+    
+    can_frame_t frames[CAN_TX_QUEUE_SIZE];
+    (void)can_stub_drain_tx(frames, CAN_TX_QUEUE_SIZE);
+    discard_log();
+}
+
+/*******************************************************************************
+ * RX Path
+ ******************************************************************************/
+
+/** One frame through can_recv_batch(), the dispatch table and the handler */
+static void BM_Dispatch(benchmark::State &state)
+{
+    can_frame_t frames[BENCH_COUNTERS];
+    build_cmds(&g_cmds[state.range(0)], state.range(1) != 0, frames);
+    bench_reset();
+    
+    /* Same timestamp every call, so no periodic task becomes due */
+    uint32_t i = 0;
+    for (auto _ : state) {
+        (void)can_stub_inject_rx(&frames[i++ & (BENCH_COUNTERS - 1U)]);
+        (void)bcm_process(0);
+    }
+    discard_log();
+}
+BENCHMARK(BM_Dispatch)
+    ->ArgNames({ "msg", "valid" })
+    ->ArgsProduct({ { BENCH_DOOR, BENCH_LIGHTING, BENCH_TURN }, { 1, 0 } });
+
+static void BM_HandleCmd(benchmark::State &state)
+{
+    const bench_cmd_t *cmd = &g_cmds[state.range(0)];
+    can_frame_t frames[BENCH_COUNTERS];
+    build_cmds(cmd, state.range(1) != 0, frames);
+    bench_reset();
+    
+    uint32_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cmd->handler(&frames[i++ & (BENCH_COUNTERS - 1U)]));
+    }
+    discard_log();
+}
+BENCHMARK(BM_HandleCmd)
+    ->ArgNames({ "msg", "valid" })
+    ->ArgsProduct({ { BENCH_DOOR, BENCH_LIGHTING, BENCH_TURN }, { 1, 0 } });
+
+/*******************************************************************************
+ * Tick
+ ******************************************************************************/
+
+/** bcm_process() every 10ms of virtual time; arg = RX frames per tick */
+static void BM_ProcessTick(benchmark::State &state)
+{
+    uint32_t rx_per_tick = (uint32_t)state.range(0);
+    can_frame_t cmds[BENCH_CMD_COUNT][BENCH_COUNTERS];
+    for (uint32_t m = 0; m < BENCH_CMD_COUNT; m++) {
+        build_cmds(&g_cmds[m], true, cmds[m]);
+    }
+    
+    /* Round-robin over the three command IDs, each with its own counter */
+    can_frame_t rx[CAN_RX_QUEUE_SIZE];
+    uint8_t counters[BENCH_CMD_COUNT] = { 0, 0, 0 };
+    can_frame_t tx[CAN_TX_QUEUE_SIZE];
+    bench_reset();
+    
+    uint32_t now_ms = 0;
+    for (auto _ : state) {
+        for (uint32_t f = 0; f < rx_per_tick; f++) {
+            uint32_t m = f % BENCH_CMD_COUNT;
+            rx[f] = cmds[m][counters[m]++ & (BENCH_COUNTERS - 1U)];
+        }
+        (void)can_stub_inject_rx_batch(rx, (uint8_t)rx_per_tick, NULL);
+        
+        now_ms += BCM_MAIN_CYCLE_TIME_MS;
+        (void)bcm_process(now_ms);
+        (void)can_stub_drain_tx(tx, CAN_TX_QUEUE_SIZE);
+    }
+    discard_log();
+    if (rx_per_tick > 0U) {
+        state.SetItemsProcessed((int64_t)state.iterations() * rx_per_tick);
+    }
+}
+BENCHMARK(BM_ProcessTick)->ArgName("rx")->Arg(0)->Arg(CAN_RX_QUEUE_SIZE);
+
+/*******************************************************************************
+ * Status Frames
+ ******************************************************************************/
+
+/** msg: 0 door, 1 lighting, 2 turn signal, 3 fault */
+static void BM_BuildStatus(benchmark::State &state)
+{
+    static void (*const builders[])(can_frame_t *) = {
+        door_control_build_status_frame,
+        lighting_control_build_status_frame,
+        turn_signal_build_status_frame,
+        fault_manager_build_status_frame,
+    };
+    void (*build)(can_frame_t *) = builders[state.range(0)];
+    can_frame_t frame;
+    bench_reset();
+    
+    for (auto _ : state) {
+        build(&frame);
+        benchmark::DoNotOptimize(frame);
+    }
+}
+BENCHMARK(BM_BuildStatus)->ArgName("msg")->DenseRange(0, 3);
+
+/*******************************************************************************
+ * Event Log and Faults
+ ******************************************************************************/
+
+static void BM_EventLogAdd(benchmark::State &state)
+{
+    const uint8_t data[4] = { 1, 2, 3, 4 };
+    bench_reset();
+    
+    for (auto _ : state) {
+        event_log_add(EVENT_CMD_RECEIVED, data);
+    }
+}
+BENCHMARK(BM_EventLogAdd);
+
+/** Bulk export of a full log, as diagnostic tooling pulls it */
+static void BM_EventLogRead(benchmark::State &state)
+{
+    const uint8_t data[4] = { 1, 2, 3, 4 };
+    static event_log_entry_t buf[EVENT_LOG_SIZE];
+    bench_reset();
+    for (uint32_t i = 0; i < EVENT_LOG_SIZE + EVENT_LOG_SIZE / 2U; i++) {
+        event_log_add(EVENT_CMD_RECEIVED, data); /* Wrapped: two spans */
+    }
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(event_log_read(0, buf, EVENT_LOG_SIZE, NULL));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * EVENT_LOG_SIZE);
+}
+BENCHMARK(BM_EventLogRead);
+
+/** Fill every fault slot with a distinct active code from 0x40 up */
+static void fill_faults(void)
+{
+    for (uint32_t i = 0; i < MAX_ACTIVE_FAULTS; i++) {
+        fault_manager_set((fault_code_t)(0x40U + i));
+    }
+}
+
+/** Re-set an active fault with all slots in use (healing timer restart) */
+static void BM_FaultSetActive(benchmark::State &state)
+{
+    bench_reset();
+    fill_faults();
+    
+    uint32_t i = 0;
+    for (auto _ : state) {
+        fault_manager_set((fault_code_t)(0x40U + (i++ % MAX_ACTIVE_FAULTS)));
+    }
+    discard_log();
+}
+BENCHMARK(BM_FaultSetActive);
+
+/** New fault with all slots in use: dropped */
+static void BM_FaultSetFull(benchmark::State &state)
+{
+    bench_reset();
+    fill_faults();
+    
+    for (auto _ : state) {
+        fault_manager_set(FAULT_CODE_INVALID_CMD);
+    }
+    discard_log();
+}
+BENCHMARK(BM_FaultSetFull);
+
+/** Clear one fault and set it again, keeping the table full */
+static void BM_FaultClearSet(benchmark::State &state)
+{
+    bench_reset();
+    fill_faults();
+    
+    uint32_t i = 0;
+    for (auto _ : state) {
+        fault_code_t code = (fault_code_t)(0x40U + (i++ % MAX_ACTIVE_FAULTS));
+        fault_manager_clear(code);
+        fault_manager_set(code);
+    }
+    discard_log();
+}
+BENCHMARK(BM_FaultClearSet);
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    /* Results keep the original stdout; module printf() output is dropped */
+    fflush(stdout);
+    int fd = dup(STDOUT_FILENO);
+    std::ofstream results;
+    std::streambuf *console = std::cout.rdbuf();
+    if (fd >= 0) {
+        results.open("/dev/fd/" + std::to_string(fd), std::ios::app); /* No truncation */
+    }
+    if (results.is_open() && freopen("/dev/null", "w", stdout) != NULL) {
+        std::cout.rdbuf(results.rdbuf());
+    }
+    
+    benchmark::Initialize(&argc, argv);
+    int status = 1;
+    if (!benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        benchmark::RunSpecifiedBenchmarks();
+        status = 0;
+    }
+    benchmark::Shutdown();
+    bcm_deinit();
+    
+    /* results is destroyed before std::cout */
+    std::cout.flush();
+    std::cout.rdbuf(console);
+    return status;
+}
@@ -58,6 +58,36 @@ extern "C" {
 /** Enable anti-pinch protection for windows */
 #define BCM_FEATURE_ANTI_PINCH          1
 
+/** Send status frames on state change, otherwise at the keep-alive rate */
+#ifndef BCM_FEATURE_SEND_ON_CHANGE
+#define BCM_FEATURE_SEND_ON_CHANGE      0
+#endif
+
+/** Measure task and RX drain execution times (bcm_timing.h) */
+#ifndef BCM_FEATURE_TASK_TIMING
+#define BCM_FEATURE_TASK_TIMING         0
+#endif
+
+/** Defer the 10ms task to the earliest module deadline (*_next_deadline()) */
+#ifndef BCM_FEATURE_TICKLESS
+#define BCM_FEATURE_TICKLESS            0
+#endif
+
+/** Send one BCM_AGGREGATE_STATUS CAN FD frame instead of 0x200-0x240 */
+#ifndef BCM_FEATURE_CAN_FD
+#define BCM_FEATURE_CAN_FD              0
+#endif
+
+/** Binary frame/event trace file (bcm_trace.h); needs a POSIX host */
+#ifndef BCM_FEATURE_TRACE
+#define BCM_FEATURE_TRACE               0
+#endif
+
+/** File-backed store flash (bcm_flash_file_open()); set on Linux hosts */
+#ifndef BCM_FEATURE_FLASH_FILE
+#define BCM_FEATURE_FLASH_FILE          0
+#endif
+
 /* =============================================================================
  * Door Control Configuration
  * ========================================================================== */
@@ -93,7 +123,7 @@ extern "C" {
 /** Follow-me-home lights duration in seconds */
 #define LIGHT_FOLLOW_ME_HOME_SEC        30U
 
-/** Interior light fade-out duration in milliseconds */
+/** Interior light fade duration in milliseconds (any brightness change) */
 #define LIGHT_INTERIOR_FADE_MS          2000U
 
 /** Interior light door-open timeout in seconds */
@@ -108,6 +138,9 @@ extern "C" {
 /** Maximum PWM duty cycle (0-255) */
 #define LIGHT_PWM_MAX_DUTY              255U
 
+/** Interior light gamma x10; tools/gamma_codegen.py builds the duty LUT */
+#define LIGHT_PWM_GAMMA_X10             22U
+
 /* =============================================================================
  * Turn Signal Configuration
  * ========================================================================== */
@@ -162,24 +195,91 @@ extern "C" {
  * CAN Communication Configuration
  * ========================================================================== */
 
-/** CAN transmit queue size */
+/** CAN transmit queue size (stub mode, power of two) */
 #define CAN_TX_QUEUE_SIZE               16U
 
-/** CAN receive queue size */
+/** Frames the TX scheduler holds while the TX queue or socket is full */
+#define CAN_TX_PENDING_SIZE             16U
+
+/** CAN FD transmit queue size (stub mode) */
+#define CAN_TX_FD_QUEUE_SIZE            4U
+
+/** CAN receive queue size (stub mode and SIL RX threads, power of two) */
 #define CAN_RX_QUEUE_SIZE               32U
 
+/** CAN interfaces per instance (body bus, gateway bus) */
+#define CAN_BUS_MAX                     2U
+
+/** IDs that can be routed to a bus other than bus 0 for transmission */
+#define CAN_TX_ROUTE_MAX                16U
+
+/** Maximum number of registered RX message handlers (<= CAN_RX_FILTER_MAX) */
+#define CAN_MAX_RX_HANDLERS             16U
+
 /** CAN message timeout in milliseconds */
 #define CAN_MSG_TIMEOUT_MS              100U
 
 /** BCM status broadcast period in milliseconds */
 #define CAN_BCM_STATUS_PERIOD_MS        100U
 
+/** Status keep-alive period with BCM_FEATURE_SEND_ON_CHANGE (multiple of 100ms) */
+#define CAN_STATUS_KEEPALIVE_PERIOD_MS  1000U
+
 /** BCM heartbeat period in milliseconds */
 #define CAN_HEARTBEAT_PERIOD_MS         1000U
 
 /** CAN bus-off recovery time in milliseconds */
 #define CAN_BUSOFF_RECOVERY_MS          500U
 
+/* =============================================================================
+ * Logging Configuration
+ * ========================================================================== */
+
+/** Compile-time log level: 0 none, 1 error, 2 warn, 3 info, 4 debug */
+#ifndef BCM_LOG_LEVEL
+#define BCM_LOG_LEVEL                   3
+#endif
+
+/** Deferred log ring entries (power of two), flushed by the 1000ms task */
+#define BCM_LOG_BUFFER_SIZE             128U
+
+/* =============================================================================
+ * Trace Configuration
+ * ========================================================================== */
+
+/** Default trace ring capacity in records (24 bytes each, power of two) */
+#define BCM_TRACE_DEFAULT_RECORDS       65536U
+
+/* =============================================================================
+ * Persistent Store Configuration
+ * ========================================================================== */
+
+/** Largest flash page the store can buffer (bytes, multiple of 8) */
+#define BCM_STORE_PAGE_MAX              4096U
+
+/** Events staged in RAM between page writes (8 bytes each) */
+#define BCM_STORE_STAGE_RECORDS         512U
+
+/** A partly filled page is written once its oldest event is this old */
+#define BCM_STORE_FLUSH_AGE_MS          10000U
+
+/** Recent events copied back into the event log at bcm_init() (at most EVENT_LOG_SIZE) */
+#define BCM_STORE_RESTORE_EVENTS        16U
+
+/** Default geometry of the file backend (bcm_flash_file_open()) */
+#define BCM_STORE_FILE_PAGE_SIZE        256U
+#define BCM_STORE_FILE_PAGE_COUNT       256U
+
+/* =============================================================================
+ * Scheduler Configuration
+ * ========================================================================== */
+
+/** Phase offsets (ms) so periodic TX tasks never share a millisecond */
+#define SCHED_OFFSET_10MS_MS            0U
+#define SCHED_OFFSET_STATUS_MS          2U
+#define SCHED_OFFSET_FAULT_STATUS_MS    4U
+#define SCHED_OFFSET_HEARTBEAT_MS       6U
+
 /* =============================================================================
  * Hardware Pin Assignments (Platform Specific)
  * ========================================================================== */
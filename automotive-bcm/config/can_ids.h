@@ -24,7 +24,9 @@ extern "C" {
  ******************************************************************************/
 
 #define CAN_BAUD_RATE               500000U
+#define CAN_FD_DATA_BAUD_RATE       2000000U /**< CAN FD data phase (bit rate switch) */
 #define CAN_MAX_DLC                 8U
+#define CAN_ID_COUNT                2048U   /**< Size of the 11-bit ID space */
 #define CAN_SCHEMA_VERSION          0x01U
 
 /* Rolling counter configuration */
@@ -52,6 +54,12 @@ extern "C" {
 #define CAN_ID_TURN_SIGNAL_STATUS   0x220U  /**< Turn signal state status */
 #define CAN_ID_FAULT_STATUS         0x230U  /**< Fault status */
 #define CAN_ID_BCM_HEARTBEAT        0x240U  /**< BCM heartbeat/alive */
+#define CAN_ID_BCM_TIMING           0x250U  /**< Task timing diagnostics */
+#define CAN_ID_BCM_AGGREGATE_STATUS 0x260U  /**< All status in one CAN FD frame */
+
+/* Status range: a newer frame supersedes a pending one of the same ID */
+#define CAN_ID_STATUS_FIRST         0x200U
+#define CAN_ID_STATUS_LAST          0x2FFU
 
 /*******************************************************************************
  * DOOR_CMD (0x100) - Door Lock/Unlock Command
@@ -253,7 +261,7 @@ typedef enum {
 
 /*******************************************************************************
  * LIGHTING_STATUS (0x210) - Lighting State Status
- * DLC: 6 bytes
+ * DLC: 7 bytes
  * TX Period: 100ms
  * 
  * Byte 0: Headlight State
@@ -271,12 +279,14 @@ typedef enum {
  * 
  * Byte 3: Last Command Result (same enum as door)
  * 
- * Byte 4: [7:4] Version, [3:0] Rolling Counter (0-15)
+ * Byte 4: Interior Light PWM Duty (0-LIGHT_PWM_MAX_DUTY, follows the fade)
  * 
- * Byte 5: Checksum (XOR of bytes 0-4 with seed 0xAA)
+ * Byte 5: [7:4] Version, [3:0] Rolling Counter (0-15)
+ * 
+ * Byte 6: Checksum (XOR of bytes 0-5 with seed 0xAA)
  ******************************************************************************/
 
-#define LIGHTING_STATUS_DLC         6U
+#define LIGHTING_STATUS_DLC         7U
 #define LIGHTING_STATUS_PERIOD_MS   100U
 
 /* Headlight state values */
@@ -296,8 +306,9 @@ typedef enum {
 #define LIGHTING_STATUS_BYTE_INTERIOR   1
 #define LIGHTING_STATUS_BYTE_AMBIENT    2
 #define LIGHTING_STATUS_BYTE_RESULT     3
-#define LIGHTING_STATUS_BYTE_VER_CTR    4
-#define LIGHTING_STATUS_BYTE_CHECKSUM   5
+#define LIGHTING_STATUS_BYTE_DUTY       4
+#define LIGHTING_STATUS_BYTE_VER_CTR    5
+#define LIGHTING_STATUS_BYTE_CHECKSUM   6
 
 /*******************************************************************************
  * TURN_SIGNAL_STATUS (0x220) - Turn Signal State Status
@@ -361,7 +372,7 @@ typedef enum {
  *   Bit 6 = Timeout fault
  *   Bit 7 = Reserved
  * 
- * Byte 1: Active Fault Flags 2 (reserved for expansion)
+ * Byte 1: Coalesced Fault Reports (repeats in the last 100ms, saturates 255)
  * 
  * Byte 2: Total Fault Count (0-255)
  * 
@@ -403,7 +414,7 @@ typedef enum {
 } fault_code_t;
 
 #define FAULT_STATUS_BYTE_FLAGS1        0
-#define FAULT_STATUS_BYTE_FLAGS2        1
+#define FAULT_STATUS_BYTE_REPEATS       1
 #define FAULT_STATUS_BYTE_COUNT         2
 #define FAULT_STATUS_BYTE_RECENT_CODE   3
 #define FAULT_STATUS_BYTE_TS_HIGH       4
@@ -445,6 +456,77 @@ typedef enum {
 #define HEARTBEAT_BYTE_VER_CTR          2
 #define HEARTBEAT_BYTE_CHECKSUM         3
 
+/*******************************************************************************
+ * BCM_TIMING (0x250) - Task Timing Diagnostics
+ * DLC: 8 bytes
+ * TX Period: 1000ms, one frame per slot (BCM_FEATURE_TASK_TIMING builds only)
+ * 
+ * Byte 0: Slot
+ *   0x00 = 10ms task
+ *   0x01 = 100ms task
+ *   0x02 = 500ms task
+ *   0x03 = 1000ms task
+ *   0x04 = RX drain
+ * 
+ * Byte 1: p50 execution time (time code)
+ * Byte 2: p99 execution time (time code)
+ * Byte 3: Max execution time (time code)
+ * Byte 4: Mean execution time (time code)
+ * 
+ * Byte 5: Late runs since init (tasks only, saturates at 255)
+ * 
+ * Byte 6: [7:4] Version, [3:0] Rolling Counter (0-15)
+ * 
+ * Byte 7: Checksum (XOR of bytes 0-6 with seed 0xAA)
+ * 
+ * Time code c (histogram bucket floor, within 25% of the value):
+ *   c < 4:   c ns
+ *   c >= 4:  (4 + c % 4) << (c / 4 - 1) ns
+ ******************************************************************************/
+
+#define BCM_TIMING_DLC                  8U
+
+#define TIMING_BYTE_SLOT                0
+#define TIMING_BYTE_P50                 1
+#define TIMING_BYTE_P99                 2
+#define TIMING_BYTE_MAX                 3
+#define TIMING_BYTE_MEAN                4
+#define TIMING_BYTE_LATE                5
+#define TIMING_BYTE_VER_CTR             6
+#define TIMING_BYTE_CHECKSUM            7
+
+/*******************************************************************************
+ * BCM_AGGREGATE_STATUS (0x260) - Consolidated Status (CAN FD)
+ * Length: 48 bytes, bit rate switch
+ * TX Period: 100ms (BCM_FEATURE_CAN_FD builds, replaces 0x200-0x240)
+ * 
+ * Byte 0: [7:4] Version, [3:0] Rolling Counter (0-15)
+ * 
+ * Bytes 1-6:   DOOR_STATUS payload
+ * Bytes 7-13:  LIGHTING_STATUS payload
+ * Bytes 14-19: TURN_SIGNAL_STATUS payload
+ * Bytes 20-27: FAULT_STATUS payload
+ * Bytes 28-31: BCM_HEARTBEAT payload
+ * Bytes 32-46: Reserved (0x00); 33 bytes is not a CAN FD length
+ * 
+ * Byte 47: Checksum (XOR of bytes 0-46 with seed 0xAA)
+ * 
+ * Each section is the classic frame's payload byte for byte, including its
+ * own ver/ctr and checksum, so the classic decoders apply to the sections.
+ ******************************************************************************/
+
+#define BCM_AGGREGATE_LEN               48U
+#define BCM_AGGREGATE_PERIOD_MS         100U
+
+#define AGG_BYTE_VER_CTR                0
+#define AGG_BYTE_DOOR                   1
+#define AGG_BYTE_LIGHTING               7
+#define AGG_BYTE_TURN                   14
+#define AGG_BYTE_FAULT                  20
+#define AGG_BYTE_HEARTBEAT              28
+#define AGG_BYTE_RESERVED               32
+#define AGG_BYTE_CHECKSUM               47
+
 /*******************************************************************************
  * Utility Macros
  ******************************************************************************/
@@ -474,6 +556,12 @@ static inline int can_validate_checksum(const uint8_t *data, uint8_t len, uint8_
     return (can_calculate_checksum(data, len) == received_checksum);
 }
 
+/** Rolling counter receive state for one RX message */
+typedef struct {
+    uint8_t     last;       /**< Last accepted counter value */
+    uint8_t     seen;       /**< Non-zero once a counter has been accepted */
+} can_rx_counter_t;
+
 /** Validate rolling counter: returns true if valid (expected = last + 1, with wrap) */
 static inline int can_validate_counter(uint8_t received, uint8_t last)
 {
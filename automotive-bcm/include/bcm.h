@@ -18,22 +18,69 @@ extern "C" {
 #include "system_state.h"
 #include "can_interface.h"
 
+/*******************************************************************************
+ * BCM Scheduler
+ ******************************************************************************/
+
+/** Periodic tasks in the scheduler table */
+typedef enum {
+    BCM_TASK_10MS = 0,      /**< State machine updates */
+    BCM_TASK_100MS,         /**< Door/lighting/turn status TX */
+    BCM_TASK_500MS,         /**< Fault status TX */
+    BCM_TASK_1000MS,        /**< Heartbeat, timeouts */
+    BCM_TASK_COUNT
+} bcm_task_id_t;
+
 /*******************************************************************************
  * BCM Initialization
  ******************************************************************************/
 
 /**
  * @brief Initialize BCM and all modules
- * @param can_ifname CAN interface name (e.g., "vcan0")
+ *
+ * With a persistent store open (bcm_store.h), restores the fault counters
+ * and recent events of earlier runs.
+ *
+ * Commands are accepted on every bus. Status frames go out on bus 0
+ * unless can_set_tx_route() sends their ID elsewhere.
+ *
+ * @param can_ifname CAN interface name (e.g., "vcan0"), or a comma-separated
+ *                   list with one name per bus ("can0,can1")
  * @return 0 on success, -1 on error
  */
 int bcm_init(const char *can_ifname);
 
 /**
  * @brief Deinitialize BCM and all modules
+ *
+ * Writes events still staged for the persistent store.
  */
 void bcm_deinit(void);
 
+/*******************************************************************************
+ * BCM Message Dispatch
+ ******************************************************************************/
+
+/** Handler for a received command frame */
+typedef cmd_result_t (*bcm_rx_handler_t)(const can_frame_t *frame);
+
+/**
+ * @brief Register a handler for an 11-bit RX message ID
+ *
+ * Frames are dispatched with a single lookup on the ID. Frames whose DLC
+ * differs from the registered one are rejected before the handler runs.
+ * Registering an ID again replaces its handler. bcm_init() clears the
+ * table and registers the door, lighting and turn signal commands.
+ * The CAN RX filter is updated to the registered IDs, so on SocketCAN
+ * all other traffic is dropped in the kernel.
+ *
+ * @param id 11-bit CAN ID
+ * @param dlc Expected data length code
+ * @param handler Handler function
+ * @return 0 on success, -1 if the ID is invalid or the table is full
+ */
+int bcm_register_rx_handler(uint32_t id, uint8_t dlc, bcm_rx_handler_t handler);
+
 /*******************************************************************************
  * BCM Processing
  ******************************************************************************/
@@ -41,7 +88,8 @@ void bcm_deinit(void);
 /**
  * @brief Main BCM processing loop iteration
  *
- * Polls CAN RX, routes messages, updates states, transmits status.
+ * Polls CAN RX, routes messages, then runs every periodic task whose
+ * deadline has been reached (see bcm_task_id_t).
  * Should be called continuously in main loop.
  *
  * @param current_ms Current system time in milliseconds
@@ -69,16 +117,57 @@ void bcm_process_10ms(uint32_t current_ms);
  */
 void bcm_process_100ms(uint32_t current_ms);
 
+/**
+ * @brief 500ms periodic task processing
+ *
+ * Called from bcm_process when 500ms has elapsed.
+ * Handles fault status transmission.
+ *
+ * @param current_ms Current system time
+ */
+void bcm_process_500ms(uint32_t current_ms);
+
 /**
  * @brief 1000ms periodic task processing
  *
  * Called from bcm_process when 1000ms has elapsed.
- * Handles heartbeat, timeouts, uptime updates.
+ * Handles heartbeat, timeouts, uptime updates and persistent store writes.
  *
  * @param current_ms Current system time
  */
 void bcm_process_1000ms(uint32_t current_ms);
 
+/**
+ * @brief Get the time at which the next periodic task falls due
+ *
+ * Lets an event-driven main loop sleep until there is work to do
+ * instead of calling bcm_process() at a fixed polling rate.
+ *
+ * @return Absolute time in milliseconds (same clock as bcm_process)
+ */
+uint32_t bcm_next_deadline_ms(void);
+
+/**
+ * @brief Get number of missed periods for a periodic task
+ *
+ * Incremented for every whole period a task fell behind because
+ * bcm_process() was called late.
+ *
+ * @param task Task ID
+ * @return Overrun count since bcm_init()
+ */
+uint32_t bcm_get_task_overruns(bcm_task_id_t task);
+
+/**
+ * @brief Get number of runs that started after their deadline
+ *
+ * Counts every late tick, including those late by less than a period.
+ *
+ * @param task Task ID
+ * @return Late run count since bcm_init()
+ */
+uint32_t bcm_get_task_late_runs(bcm_task_id_t task);
+
 /*******************************************************************************
  * BCM State
  ******************************************************************************/
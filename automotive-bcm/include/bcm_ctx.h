@@ -0,0 +1,179 @@
+/**
+ * @file bcm_ctx.h
+ * @brief BCM Instance Handles
+ *
+ * All per-ECU state - system state, RX dispatch table, scheduler, TX pool
+ * and the CAN backend - lives in a bcm_ctx_t, so one process can run
+ * many BCMs. The classic API (bcm_init(), bcm_process(), module handlers
+ * and getters, can_*()) works on the context bound to the calling thread,
+ * which is a built-in default instance unless bcm_ctx_bind() selected
+ * another one.
+ *
+ * The bcm_ctx_*() calls bind their context for the duration of the call,
+ * so different contexts can be processed on different threads at once.
+ * One context must only be used by one thread at a time. The log ring
+ * (bcm_log.h) and the trace file (bcm_trace.h) stay process-wide; open
+ * the trace only when a single thread drives the instances.
+ */
+
+#ifndef BCM_CTX_H
+#define BCM_CTX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "bcm.h"
+
+/** Opaque BCM instance */
+typedef struct bcm_ctx bcm_ctx_t;
+
+/** Opaque block of instances with a struct-of-arrays layout */
+typedef struct bcm_ctx_pool bcm_ctx_pool_t;
+
+/*******************************************************************************
+ * Instance Management
+ ******************************************************************************/
+
+/**
+ * @brief Allocate a new, uninitialized BCM instance
+ * @return Instance, or NULL if out of memory
+ */
+bcm_ctx_t *bcm_ctx_create(void);
+
+/**
+ * @brief Deinitialize and free an instance from bcm_ctx_create()
+ * @param ctx Instance (NULL, the default instance and pool members are ignored)
+ */
+void bcm_ctx_destroy(bcm_ctx_t *ctx);
+
+/**
+ * @brief Allocate count uninitialized instances as one struct-of-arrays pool
+ *
+ * Each block type (hot state, core, CAN backend, fault store, event log)
+ * is one array across all instances. A loop that steps instance 0..count-1
+ * then streams through the hot state instead of striding over whole
+ * instances. Members behave like bcm_ctx_create() instances.
+ *
+ * @param count Number of instances
+ * @return Pool, or NULL if count is 0 or out of memory
+ */
+bcm_ctx_pool_t *bcm_ctx_pool_create(uint32_t count);
+
+/**
+ * @brief Get a pool member
+ * @return Instance, or NULL if index is out of range
+ */
+bcm_ctx_t *bcm_ctx_pool_get(bcm_ctx_pool_t *pool, uint32_t index);
+
+/**
+ * @brief Deinitialize all members and free the pool
+ * @param pool Pool (NULL is ignored)
+ */
+void bcm_ctx_pool_destroy(bcm_ctx_pool_t *pool);
+
+/**
+ * @brief Get the built-in instance used by the classic API
+ */
+bcm_ctx_t *bcm_ctx_default(void);
+
+/**
+ * @brief Get the instance bound to the calling thread
+ */
+bcm_ctx_t *bcm_ctx_current(void);
+
+/**
+ * @brief Bind an instance to the calling thread
+ *
+ * Until the next bind, the classic API on this thread operates on ctx.
+ *
+ * @param ctx Instance, or NULL for the default instance
+ * @return Previously bound instance (pass back to restore it)
+ */
+bcm_ctx_t *bcm_ctx_bind(bcm_ctx_t *ctx);
+
+/*******************************************************************************
+ * Per-Instance Operations
+ ******************************************************************************/
+
+/**
+ * @brief bcm_init() on an instance
+ * @param ctx Instance
+ * @param can_ifname CAN interface name (ignored in stub mode)
+ * @return 0 on success, -1 on error
+ */
+int bcm_ctx_init(bcm_ctx_t *ctx, const char *can_ifname);
+
+/**
+ * @brief bcm_deinit() on an instance
+ * @param ctx Instance
+ */
+void bcm_ctx_deinit(bcm_ctx_t *ctx);
+
+/**
+ * @brief bcm_process() on an instance
+ * @param ctx Instance
+ * @param current_ms Current time of this instance in milliseconds
+ * @return 0 on success, -1 if ctx is NULL or not initialized
+ */
+int bcm_ctx_process(bcm_ctx_t *ctx, uint32_t current_ms);
+
+/**
+ * @brief bcm_register_rx_handler() on an instance
+ *
+ * The handler runs with ctx bound, so module functions it calls act on
+ * the same instance.
+ *
+ * @return 0 on success, -1 on error
+ */
+int bcm_ctx_register_rx_handler(bcm_ctx_t *ctx, uint32_t id, uint8_t dlc,
+                                bcm_rx_handler_t handler);
+
+/**
+ * @brief bcm_next_deadline_ms() of an instance
+ */
+uint32_t bcm_ctx_next_deadline_ms(bcm_ctx_t *ctx);
+
+/**
+ * @brief Read-only view of an instance's system state
+ *
+ * Live state, only consistent on the thread processing the instance.
+ */
+const system_state_t *bcm_ctx_state(const bcm_ctx_t *ctx);
+
+/**
+ * @brief sys_state_snapshot() of an instance, from any thread
+ * @param ctx Instance
+ * @param out Output state
+ * @return Number of publications so far, 0 if none or ctx is NULL
+ */
+uint32_t bcm_ctx_snapshot(bcm_ctx_t *ctx, system_state_t *out);
+
+#ifndef BCM_SIL
+
+/**
+ * @brief can_stub_inject_rx() into an instance's RX queue
+ * @return CAN_STATUS_OK on success
+ */
+can_status_t bcm_ctx_inject_rx(bcm_ctx_t *ctx, const can_frame_t *frame);
+
+/**
+ * @brief can_stub_drain_tx() from an instance's TX queue
+ * @return Number of frames removed
+ */
+uint8_t bcm_ctx_drain_tx(bcm_ctx_t *ctx, can_frame_t *frames, uint8_t max_frames);
+
+/**
+ * @brief can_stub_drain_tx_fd() from an instance's CAN FD TX queue
+ * @return Number of frames removed
+ */
+uint8_t bcm_ctx_drain_tx_fd(bcm_ctx_t *ctx, can_fd_frame_t *frames, uint8_t max_frames);
+
+#endif /* !BCM_SIL */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BCM_CTX_H */
@@ -0,0 +1,133 @@
+/**
+ * @file bcm_log.h
+ * @brief Logging Facade with Compile-Time Levels and Deferred Formatting
+ *
+ * BCM_LOG_ERROR/WARN/INFO/DEBUG compile to nothing above BCM_LOG_LEVEL
+ * (bcm_config.h, or -DBCM_LOG_LEVEL=<NONE|ERROR|WARN|INFO|DEBUG> in CMake).
+ * Enabled calls never format: they store the format string pointer and
+ * up to BCM_LOG_MAX_ARGS integer arguments in a lock-free ring, and
+ * bcm_log_flush() does the printf() later - from the 1000ms task, at
+ * init/deinit, or from a separate flusher thread. Any number of threads
+ * may log and flush concurrently.
+ *
+ * Rules for deferred calls: the format must be a string literal and every
+ * argument must be an integer type no wider than int (no %s, %f, %lu).
+ */
+
+#ifndef BCM_LOG_H
+#define BCM_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include "bcm_config.h"
+
+/*******************************************************************************
+ * Levels
+ ******************************************************************************/
+
+#define BCM_LOG_LEVEL_NONE      0
+#define BCM_LOG_LEVEL_ERROR     1
+#define BCM_LOG_LEVEL_WARN      2
+#define BCM_LOG_LEVEL_INFO      3
+#define BCM_LOG_LEVEL_DEBUG     4
+
+/** Integer arguments stored per deferred message */
+#define BCM_LOG_MAX_ARGS        3U
+
+#if defined(__GNUC__)
+#define BCM_LOG_FORMAT_CHECK    __attribute__((format(printf, 2, 3)))
+#else
+#define BCM_LOG_FORMAT_CHECK
+#endif
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+
+/* Number of arguments after the format (0..3); the trailing 0 keeps the
+ * variadic part of BCM_LOG_NARGS_ non-empty for -Wpedantic */
+#define BCM_LOG_NARGS(...)      BCM_LOG_NARGS_(__VA_ARGS__, 3, 2, 1, 0, 0)
+#define BCM_LOG_NARGS_(fmt, a1, a2, a3, n, ...) n
+
+#define BCM_LOG_DEFER(...)      bcm_log_defer(BCM_LOG_NARGS(__VA_ARGS__), __VA_ARGS__)
+
+/* Stripped calls still "use" their arguments, so log-only locals do not warn */
+#define BCM_LOG_STRIP(...)      ((void)sizeof(bcm_log_strip_(0, __VA_ARGS__)))
+
+#if BCM_LOG_LEVEL >= BCM_LOG_LEVEL_ERROR
+#define BCM_LOG_ERROR(...)      BCM_LOG_DEFER(__VA_ARGS__)
+#else
+#define BCM_LOG_ERROR(...)      BCM_LOG_STRIP(__VA_ARGS__)
+#endif
+
+#if BCM_LOG_LEVEL >= BCM_LOG_LEVEL_WARN
+#define BCM_LOG_WARN(...)       BCM_LOG_DEFER(__VA_ARGS__)
+#else
+#define BCM_LOG_WARN(...)       BCM_LOG_STRIP(__VA_ARGS__)
+#endif
+
+#if BCM_LOG_LEVEL >= BCM_LOG_LEVEL_INFO
+#define BCM_LOG_INFO(...)       BCM_LOG_DEFER(__VA_ARGS__)
+#else
+#define BCM_LOG_INFO(...)       BCM_LOG_STRIP(__VA_ARGS__)
+#endif
+
+#if BCM_LOG_LEVEL >= BCM_LOG_LEVEL_DEBUG
+#define BCM_LOG_DEBUG(...)      BCM_LOG_DEFER(__VA_ARGS__)
+#else
+#define BCM_LOG_DEBUG(...)      BCM_LOG_STRIP(__VA_ARGS__)
+#endif
+
+/**
+ * Immediate output for cold paths that need a %s argument (e.g. init).
+ * Pending deferred messages are flushed first to keep output in order.
+ */
+#define BCM_LOG_NOW(level, ...) \
+    do { \
+        if ((level) <= BCM_LOG_LEVEL) { \
+            bcm_log_flush(); \
+            printf(__VA_ARGS__); \
+        } \
+    } while (0)
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Queue a message for later formatting (use the BCM_LOG_* macros)
+ * @param nargs Number of integer arguments that follow fmt
+ * @param fmt Format string with static storage duration
+ */
+void bcm_log_defer(int nargs, const char *fmt, ...) BCM_LOG_FORMAT_CHECK;
+
+/**
+ * @brief Format and write all queued messages
+ * @param out Output stream
+ * @return Number of messages written
+ */
+uint32_t bcm_log_drain(FILE *out);
+
+/**
+ * @brief Format all queued messages to stdout
+ */
+void bcm_log_flush(void);
+
+/**
+ * @brief Get the number of messages dropped because the ring was full
+ * @return Drop count since the last drain (reset by bcm_log_drain)
+ */
+uint32_t bcm_log_dropped(void);
+
+/** Never called: only gives BCM_LOG_STRIP an unevaluated expression */
+int bcm_log_strip_(int unused, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BCM_LOG_H */
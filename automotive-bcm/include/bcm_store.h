@@ -0,0 +1,220 @@
+/**
+ * @file bcm_store.h
+ * @brief Persistent Fault/Event Store
+ *
+ * Keeps fault and event history across restarts in an append-only log on
+ * flash. The log is a ring of pages written strictly in order: a page is
+ * erased just before it is programmed, so every page is erased once per
+ * lap (wear leveling without a mapping table) and the oldest page is the
+ * one given up when the ring is full.
+ *
+ * Events are staged in RAM and written by the 1000ms task, one whole page
+ * per program operation. A partly filled page goes out once its oldest
+ * record is BCM_STORE_FLUSH_AGE_MS old, and at bcm_deinit().
+ *
+ * Each page header carries a checkpoint of the fault counters as of its
+ * write. Page sequence numbers grow by one along the ring, so
+ * bcm_store_open() finds the newest page by binary search in about
+ * log2(page_count) page reads, and bcm_init() restores the checkpoint and
+ * the newest BCM_STORE_RESTORE_EVENTS events from the last few pages.
+ * Boot time does not grow with the log. Restored events keep the
+ * timestamps (uptime) of the run that logged them.
+ *
+ * Page layout: one bcm_store_page_header_t, then `count` event_log_entry_t
+ * records, the rest 0xFF. The CRC covers the whole page with the crc field
+ * zeroed, so a torn write reads back like an erased page.
+ *
+ * One store per process, like the trace: open it before bcm_init() of the
+ * instance whose history it keeps. That bcm_init() claims the store for
+ * its instance until bcm_deinit(); events of other instances are ignored
+ * and their bcm_init() restores nothing.
+ */
+
+#ifndef BCM_STORE_H
+#define BCM_STORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "system_state.h"
+#include "bcm_config.h"
+
+/*******************************************************************************
+ * Page Format
+ ******************************************************************************/
+
+#define BCM_STORE_MAGIC         0x52545342U /**< "BSTR" little-endian */
+#define BCM_STORE_VERSION       1U
+
+/** Event types written to flash; command traffic would only wear it out */
+#define BCM_STORE_EVENT_MASK    ((uint16_t)(EVENT_MASK_ALL & ~EVENT_MASK(EVENT_CMD_RECEIVED)))
+
+/** Page header (32 bytes, little-endian) */
+typedef struct {
+    uint32_t    magic;              /**< BCM_STORE_MAGIC */
+    uint32_t    seq;                /**< Page sequence number, 1 for the first page */
+    uint32_t    crc;                /**< CRC-32 of the page with this field zero */
+    uint16_t    version;            /**< BCM_STORE_VERSION */
+    uint16_t    count;              /**< Records in this page */
+    /* Checkpoint as of this write */
+    uint32_t    events;             /**< Records stored before this page */
+    uint32_t    fault_recent_ms;    /**< fault_state_t.most_recent_time_ms */
+    uint8_t     fault_total;        /**< fault_state_t.total_count */
+    uint8_t     fault_recent_code;  /**< fault_state_t.most_recent_code */
+    uint8_t     reserved[6];
+} bcm_store_page_header_t;
+
+/*******************************************************************************
+ * Flash Device
+ ******************************************************************************/
+
+typedef struct bcm_flash bcm_flash_t;
+
+/**
+ * Page-erasable flash: erased bytes read 0xFF and an erased page is
+ * programmed once, as a whole. Callbacks return 0 on success, -1 on error.
+ */
+struct bcm_flash {
+    uint32_t    page_size;          /**< Bytes per page: multiple of 8, 64 to BCM_STORE_PAGE_MAX */
+    uint32_t    page_count;         /**< Pages in the store area, at least 2 */
+    int         (*read)(const bcm_flash_t *flash, uint32_t page, void *buf);
+    int         (*program)(const bcm_flash_t *flash, uint32_t page, const void *data);
+    int         (*erase)(const bcm_flash_t *flash, uint32_t page);
+    void        *dev;               /**< Driver data */
+};
+
+#if BCM_FEATURE_FLASH_FILE
+
+/**
+ * @brief Use a file as flash (SIL and host tools)
+ *
+ * The file is created if needed and grown to page_size * page_count;
+ * new pages read as erased. Each program is followed by fdatasync().
+ * Linux hosts only: elsewhere it fails and the close is a no-op.
+ *
+ * @param flash Output device
+ * @param path File path
+ * @param page_size Bytes per page (0 = BCM_STORE_FILE_PAGE_SIZE)
+ * @param page_count Number of pages (0 = BCM_STORE_FILE_PAGE_COUNT)
+ * @return 0 on success, -1 on error
+ */
+int bcm_flash_file_open(bcm_flash_t *flash, const char *path, uint32_t page_size,
+                        uint32_t page_count);
+
+/**
+ * @brief Close a device opened with bcm_flash_file_open()
+ */
+void bcm_flash_file_close(bcm_flash_t *flash);
+
+#else
+
+static inline int bcm_flash_file_open(bcm_flash_t *flash, const char *path,
+                                      uint32_t page_size, uint32_t page_count)
+{
+    (void)flash;
+    (void)path;
+    (void)page_size;
+    (void)page_count;
+    return -1;
+}
+
+static inline void bcm_flash_file_close(bcm_flash_t *flash)
+{
+    (void)flash;
+}
+
+#endif /* BCM_FEATURE_FLASH_FILE */
+
+/*******************************************************************************
+ * Store
+ ******************************************************************************/
+
+typedef struct {
+    uint32_t    pages_written;
+    uint32_t    erases;
+    uint32_t    write_errors;       /**< Failed erase/program; records stay staged */
+    uint32_t    records_dropped;    /**< Staging buffer full */
+    uint32_t    staged;             /**< Records waiting for a page write */
+    uint32_t    pages_read;         /**< Since bcm_store_open(): mount and restores */
+    uint32_t    events;             /**< Records on flash since the log was created */
+} bcm_store_stats_t;
+
+/**
+ * @brief Attach a flash device and locate the newest page
+ * @param flash Device; must stay valid until bcm_store_close()
+ * @return 0 on success, -1 if a store is open or the geometry is invalid
+ */
+int bcm_store_open(const bcm_flash_t *flash);
+
+/**
+ * @brief Write staged records (owner's checkpoint, if bound) and detach
+ */
+void bcm_store_close(void);
+
+/**
+ * @brief Check whether a store is attached
+ */
+bool bcm_store_is_open(void);
+
+/**
+ * @brief Stage an event for the next page write
+ *
+ * No-op without a store or when the bound instance does not own it.
+ *
+ * Called by event_log_add() before its mask and sampling, so the store
+ * keeps BCM_STORE_EVENT_MASK types whatever the RAM log filters.
+ *
+ * @param type Event type (event_type_t)
+ * @param data 3 bytes of event data, or NULL
+ */
+void bcm_store_event(uint8_t type, const uint8_t *data);
+
+/**
+ * @brief Write staged records in whole pages (1000ms task)
+ *
+ * A partly filled page is only written once its oldest record is
+ * BCM_STORE_FLUSH_AGE_MS old.
+ */
+void bcm_store_process(void);
+
+/**
+ * @brief Write every staged record now, the last page partly filled
+ * @return 0 on success (or nothing owned), -1 if a page write failed
+ */
+int bcm_store_sync(void);
+
+/**
+ * @brief Write staged records and give up ownership (bcm_deinit())
+ *
+ * The next bcm_init() on any instance claims the store again.
+ *
+ * @return 0 on success (or nothing owned), -1 if a page write failed
+ */
+int bcm_store_release(void);
+
+/**
+ * @brief Claim the store and restore its history (bcm_init())
+ *
+ * If no instance owns the store, the bound one becomes its owner: its
+ * fault total_count and most recent fault are set from the newest
+ * checkpoint and up to BCM_STORE_RESTORE_EVENTS events are appended to
+ * its event log.
+ *
+ * @return Number of events restored, 0 if another instance owns the store
+ */
+uint32_t bcm_store_restore(void);
+
+/**
+ * @brief Get store statistics
+ * @param stats Output
+ */
+void bcm_store_get_stats(bcm_store_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BCM_STORE_H */
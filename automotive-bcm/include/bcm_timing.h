@@ -0,0 +1,134 @@
+/**
+ * @file bcm_timing.h
+ * @brief Task Execution Time Instrumentation
+ *
+ * With BCM_FEATURE_TASK_TIMING (CMake -DBCM_TASK_TIMING=ON) the scheduler
+ * times each periodic task and the RX drain with CLOCK_MONOTONIC and keeps
+ * min/max/mean and a log-linear (HDR-style) histogram per slot. The 1000ms
+ * task publishes them in BCM_TIMING frames (can_ids.h). Without the
+ * feature the hooks compile to nothing and the getters report no data.
+ *
+ * Histogram buckets use the BCM_TIMING time code: four sub-buckets per
+ * power of two, so a bucket floor is within 25% of every value in it.
+ */
+
+#ifndef BCM_TIMING_H
+#define BCM_TIMING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bcm.h"
+#include "can_interface.h"
+#include "bcm_config.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/** Timing slots: BCM_TASK_* ids, then the RX drain */
+#define BCM_TIMING_RX_DRAIN     ((uint8_t)BCM_TASK_COUNT)
+#define BCM_TIMING_SLOT_COUNT   (BCM_TASK_COUNT + 1U)
+
+/** Codes 0..103 cover up to 2^26 ns (67ms); slower runs share the last */
+#define BCM_TIMING_BUCKETS      104U
+
+typedef struct {
+    uint32_t    runs;
+    uint32_t    min_ns;
+    uint32_t    max_ns;
+    uint64_t    total_ns;
+    uint32_t    hist[BCM_TIMING_BUCKETS];   /**< Runs per time code */
+} bcm_timing_stats_t;
+
+/*******************************************************************************
+ * Scheduler Hooks
+ ******************************************************************************/
+
+#if BCM_FEATURE_TASK_TIMING
+#define BCM_TIMING_BEGIN(var)       uint64_t var = bcm_timing_now_ns()
+#define BCM_TIMING_END(slot, var)   \
+    bcm_timing_record((slot), (uint32_t)(bcm_timing_now_ns() - (var)))
+#else
+#define BCM_TIMING_BEGIN(var)
+#define BCM_TIMING_END(slot, var)   ((void)0)
+#endif
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+/**
+ * @brief Time code of a duration (its histogram bucket)
+ * @param ns Duration in nanoseconds
+ * @return Time code, 0..123
+ */
+uint8_t bcm_timing_encode(uint32_t ns);
+
+/**
+ * @brief Lower bound of a time code's bucket
+ * @param code Time code
+ * @return Duration in nanoseconds (UINT32_MAX past the 32-bit range)
+ */
+uint32_t bcm_timing_decode(uint8_t code);
+
+/**
+ * @brief Monotonic clock in nanoseconds
+ */
+uint64_t bcm_timing_now_ns(void);
+
+/**
+ * @brief Record one run of a slot on the bound instance
+ *
+ * No-op without BCM_FEATURE_TASK_TIMING.
+ *
+ * @param slot BCM_TASK_* or BCM_TIMING_RX_DRAIN
+ * @param ns Execution time in nanoseconds
+ */
+void bcm_timing_record(uint8_t slot, uint32_t ns);
+
+/**
+ * @brief Copy a slot's statistics
+ * @param slot BCM_TASK_* or BCM_TIMING_RX_DRAIN
+ * @param stats Output statistics
+ * @return true on success, false if the slot is invalid or timing is disabled
+ */
+bool bcm_timing_get(uint8_t slot, bcm_timing_stats_t *stats);
+
+/**
+ * @brief Execution time at or below which pct percent of the runs finished
+ * @param slot BCM_TASK_* or BCM_TIMING_RX_DRAIN
+ * @param pct Percentile, 1..100
+ * @return Bucket floor in nanoseconds, 0 without data
+ */
+uint32_t bcm_timing_percentile_ns(uint8_t slot, uint8_t pct);
+
+/**
+ * @brief Mean execution time of a slot
+ * @return Nanoseconds, 0 without data
+ */
+uint32_t bcm_timing_mean_ns(uint8_t slot);
+
+/**
+ * @brief Clear all slots and the BCM_TIMING counter of the bound instance
+ */
+void bcm_timing_reset(void);
+
+/**
+ * @brief Build the BCM_TIMING frame of a slot
+ *
+ * Every call advances the rolling counter of the BCM_TIMING ID.
+ *
+ * @param slot BCM_TASK_* or BCM_TIMING_RX_DRAIN
+ * @param frame Output frame
+ */
+void bcm_timing_build_frame(uint8_t slot, can_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BCM_TIMING_H */
@@ -0,0 +1,150 @@
+/**
+ * @file bcm_trace.h
+ * @brief Binary Trace Ring for CAN Frames and Events
+ *
+ * Appends fixed-size records to a preallocated, memory-mapped file used
+ * as a ring buffer. Writing a record is a handful of stores into the
+ * mapping - no syscall, no formatting - so tracing can stay enabled
+ * during fault storms. The kernel writes dirty pages back on its own;
+ * bcm_trace_close() flushes whatever is left.
+ *
+ * File layout: one bcm_trace_header_t followed by `capacity` records.
+ * Record n lives in slot (n % capacity); `written` in the header counts
+ * every record ever appended, so a reader finds the oldest surviving
+ * record at slot (written % capacity) once the ring has wrapped.
+ * Decode with tools/bcm_trace_decode.py.
+ *
+ * Built with BCM_FEATURE_TRACE (Linux hosts). Otherwise the calls below
+ * are inline no-ops and bcm_trace_open() fails.
+ */
+
+#ifndef BCM_TRACE_H
+#define BCM_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "can_interface.h"
+#include "bcm_config.h"
+
+/*******************************************************************************
+ * File Format
+ ******************************************************************************/
+
+#define BCM_TRACE_MAGIC         0x43525442U /**< "BTRC" little-endian */
+#define BCM_TRACE_VERSION       1U
+
+/** Record kinds */
+typedef enum {
+    BCM_TRACE_RX    = 0,    /**< Received frame, result = cmd_result_t */
+    BCM_TRACE_TX    = 1,    /**< Transmitted frame */
+    BCM_TRACE_EVENT = 2     /**< Event log entry, id = event_type_t */
+} bcm_trace_kind_t;
+
+/** Result value for records without a handler result (TX, events, unknown ID) */
+#define BCM_TRACE_RESULT_NONE   0xFFU
+
+/** One trace record (24 bytes, little-endian) */
+typedef struct {
+    uint32_t    seq;            /**< 1-based sequence number, 0 = unused slot */
+    uint32_t    timestamp_ms;   /**< BCM uptime when recorded */
+    uint32_t    id;             /**< CAN ID, or event type */
+    uint8_t     kind;           /**< bcm_trace_kind_t */
+    uint8_t     dlc;            /**< Payload length */
+    uint8_t     result;         /**< cmd_result_t or BCM_TRACE_RESULT_NONE */
+    uint8_t     reserved;
+    uint8_t     data[CAN_FRAME_MAX_DLC];
+} bcm_trace_record_t;
+
+/** File header (64 bytes) */
+typedef struct {
+    uint32_t    magic;          /**< BCM_TRACE_MAGIC */
+    uint16_t    version;        /**< BCM_TRACE_VERSION */
+    uint16_t    record_size;    /**< sizeof(bcm_trace_record_t) */
+    uint32_t    capacity;       /**< Record slots, power of two */
+    uint32_t    reserved0;
+    uint64_t    written;        /**< Records appended since open */
+    uint8_t     reserved1[40];
+} bcm_trace_header_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+#if BCM_FEATURE_TRACE
+
+/**
+ * @brief Create (or truncate) a trace file and map it
+ * @param path File path
+ * @param records Ring capacity, rounded up to a power of two
+ *                (0 = BCM_TRACE_DEFAULT_RECORDS)
+ * @return 0 on success, -1 on error (tracing stays disabled)
+ */
+int bcm_trace_open(const char *path, uint32_t records);
+
+/**
+ * @brief Flush and unmap the trace file
+ */
+void bcm_trace_close(void);
+
+/**
+ * @brief Check whether a trace file is open
+ * @return true if records are being written
+ */
+bool bcm_trace_is_open(void);
+
+/**
+ * @brief Append a frame record (no-op when tracing is disabled)
+ * @param kind BCM_TRACE_RX or BCM_TRACE_TX
+ * @param frame Frame to record
+ * @param result Handler result for RX, BCM_TRACE_RESULT_NONE otherwise
+ */
+void bcm_trace_frame(bcm_trace_kind_t kind, const can_frame_t *frame, uint8_t result);
+
+/**
+ * @brief Append an event record (no-op when tracing is disabled)
+ * @param type Event type (event_type_t)
+ * @param data 4 bytes of event data, or NULL
+ */
+void bcm_trace_event(uint8_t type, const uint8_t *data);
+
+#else
+
+static inline int bcm_trace_open(const char *path, uint32_t records)
+{
+    (void)path;
+    (void)records;
+    return -1;
+}
+
+static inline void bcm_trace_close(void) {}
+
+static inline bool bcm_trace_is_open(void)
+{
+    return false;
+}
+
+static inline void bcm_trace_frame(bcm_trace_kind_t kind, const can_frame_t *frame,
+                                   uint8_t result)
+{
+    (void)kind;
+    (void)frame;
+    (void)result;
+}
+
+static inline void bcm_trace_event(uint8_t type, const uint8_t *data)
+{
+    (void)type;
+    (void)data;
+}
+
+#endif /* BCM_FEATURE_TRACE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BCM_TRACE_H */
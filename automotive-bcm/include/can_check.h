@@ -0,0 +1,107 @@
+/**
+ * @file can_check.h
+ * @brief Shared RX Frame Validation Kernel
+ *
+ * Validates received command frames against a message descriptor:
+ * DLC -> checksum -> rolling counter -> field ranges.
+ * Works on single frames or whole batches (trace replay, batched RX)
+ * and reports failures as per-frame flag bits.
+ */
+
+#ifndef CAN_CHECK_H
+#define CAN_CHECK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "can_interface.h"
+#include "can_ids.h"
+
+/*******************************************************************************
+ * Check Result Flags
+ ******************************************************************************/
+
+#define CAN_CHECK_OK            0x00U
+#define CAN_CHECK_BAD_DLC       0x01U   /**< Length differs from descriptor */
+#define CAN_CHECK_BAD_CHECKSUM  0x02U   /**< XOR checksum mismatch */
+#define CAN_CHECK_BAD_COUNTER   0x04U   /**< Rolling counter out of sequence */
+#define CAN_CHECK_BAD_FIELD     0x08U   /**< A field is outside its range */
+
+/*******************************************************************************
+ * Message Descriptors
+ ******************************************************************************/
+
+/** Range rule for one payload field: min <= (data[byte] & mask) <= max */
+typedef struct {
+    uint8_t     byte;
+    uint8_t     mask;
+    uint8_t     min;
+    uint8_t     max;
+} can_field_rule_t;
+
+/**
+ * RX message layout. The checksum is always the last byte (data[dlc - 1]).
+ */
+typedef struct {
+    uint8_t                 dlc;
+    uint8_t                 ver_ctr_byte;   /**< Byte holding version/counter */
+    uint8_t                 field_count;
+    const can_field_rule_t  *fields;
+} can_msg_desc_t;
+
+/*******************************************************************************
+ * Validation Functions
+ ******************************************************************************/
+
+/**
+ * @brief Verify checksums of a batch of frames
+ *
+ * Uses a 64-bit XOR fold per frame instead of a byte loop. Each frame is
+ * checked against its own DLC, with the checksum in the last byte.
+ *
+ * @param frames Frames to check
+ * @param count Number of frames (at most CAN_BATCH_MAX)
+ * @return Bitmask, bit i set if frame i has a bad checksum or DLC 0
+ */
+uint16_t can_check_checksums(const can_frame_t *frames, uint8_t count);
+
+/**
+ * @brief Validate a batch of frames of one message type
+ *
+ * Frames are checked in order; the counter state advances across the
+ * batch exactly as if the frames had been validated one by one. The
+ * counter is only checked and advanced when DLC and checksum are good.
+ * The first accepted counter after reset is taken as-is.
+ *
+ * @param desc Message descriptor
+ * @param frames Frames to validate
+ * @param count Number of frames (at most CAN_BATCH_MAX)
+ * @param counter Rolling counter state for this message (may be NULL to skip)
+ * @param flags Output: CAN_CHECK_* flags per frame (may be NULL)
+ * @return Bitmask, bit i set if frame i failed any check
+ */
+uint16_t can_check_batch(const can_msg_desc_t *desc, const can_frame_t *frames,
+                         uint8_t count, can_rx_counter_t *counter, uint8_t *flags);
+
+/**
+ * @brief Validate a single frame
+ * @return CAN_CHECK_* flags (CAN_CHECK_OK if valid)
+ */
+uint8_t can_check_frame(const can_msg_desc_t *desc, const can_frame_t *frame,
+                        can_rx_counter_t *counter);
+
+/**
+ * @brief Map check flags to a command result, by check order
+ * @param flags CAN_CHECK_* flags
+ * @return CMD_RESULT_OK if flags is CAN_CHECK_OK
+ */
+cmd_result_t can_check_to_result(uint8_t flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAN_CHECK_H */
@@ -5,6 +5,17 @@
  * Provides a platform-independent CAN interface.
  * - BCM_SIL=1: Uses Linux SocketCAN (vcan/can)
  * - BCM_SIL=0 or undefined: Uses stub in-memory queue
+ *
+ * Classic frames (can_frame_t) carry up to 8 bytes. CAN FD frames
+ * (can_fd_frame_t) carry up to 64 and are sent with can_send_fd().
+ *
+ * An instance can sit on up to CAN_BUS_MAX buses, one per interface
+ * given to can_init(). Each bus has its own socket or queues, TX
+ * scheduler, RX filter and statistics. Sends go to the bus the frame's ID
+ * is routed to (can_set_tx_route(), bus 0 by default). Calls without a
+ * bus argument act on every bus (init, deinit, filter, TX service, load
+ * window, reset); the can_bus_*() variants address one bus, and the
+ * remaining getters and stub helpers use bus 0.
  */
 
 #ifndef CAN_INTERFACE_H
@@ -16,19 +27,128 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 /*******************************************************************************
  * CAN Frame Structure
  ******************************************************************************/
 
 #define CAN_FRAME_MAX_DLC   8U
+#define CAN_BATCH_MAX       16U     /**< Max frames per batched RX/TX call */
+#define CAN_RX_FILTER_MAX   32U     /**< Max IDs in the RX acceptance filter */
 
+/*
+ * Layout matches SocketCAN struct can_frame (id, len, 3 pad bytes, data at
+ * offset 8) so batched I/O can hand frames to the kernel without conversion.
+ */
 typedef struct {
     uint32_t    id;                     /**< 11-bit standard CAN ID */
     uint8_t     dlc;                    /**< Data length code (0-8) */
+    uint8_t     reserved[3];            /**< Padding, keep zero */
     uint8_t     data[CAN_FRAME_MAX_DLC];/**< Frame payload */
 } can_frame_t;
 
+#define CAN_FD_MAX_LEN      64U     /**< CAN FD payload limit */
+#define CAN_FD_FLAG_BRS     0x01U   /**< Bit rate switch (SocketCAN CANFD_BRS) */
+#define CAN_FD_FLAG_ESI     0x02U   /**< Error state indicator (CANFD_ESI) */
+
+/*
+ * Layout matches SocketCAN struct canfd_frame (CANFD_MTU, 72 bytes). Valid
+ * lengths are 0-8, 12, 16, 20, 24, 32, 48 and 64 (see can_fd_len_round()).
+ */
+typedef struct {
+    uint32_t    id;                     /**< 11-bit standard CAN ID */
+    uint8_t     len;                    /**< Payload length in bytes */
+    uint8_t     flags;                  /**< CAN_FD_FLAG_* */
+    uint8_t     reserved[2];            /**< Padding, keep zero */
+    uint8_t     data[CAN_FD_MAX_LEN];   /**< Frame payload */
+} can_fd_frame_t;
+
+/*******************************************************************************
+ * CAN Frame Templates
+ ******************************************************************************/
+
+/**
+ * @brief Prepare a TX frame template
+ *
+ * Sets ID and DLC, zeroes the payload and seeds the checksum, which is
+ * kept in the last payload byte (data[dlc - 1]).
+ *
+ * @param frame Frame to initialize
+ * @param id CAN ID
+ * @param dlc Data length code (1-8)
+ * @param checksum_seed Checksum value of an all-zero payload
+ */
+static inline void can_frame_template_init(can_frame_t *frame, uint32_t id,
+                                           uint8_t dlc, uint8_t checksum_seed)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->id = id;
+    frame->dlc = dlc;
+    frame->data[dlc - 1U] = checksum_seed;
+}
+
+/**
+ * @brief Write one payload byte of a template-built frame
+ *
+ * The XOR checksum in the last byte is updated from the old and new value
+ * only; unchanged bytes cost a compare.
+ *
+ * @param frame Frame from can_frame_template_init()
+ * @param index Payload byte (must not be the checksum byte)
+ * @param value New value
+ */
+static inline void can_frame_put(can_frame_t *frame, uint8_t index, uint8_t value)
+{
+    uint8_t diff = (uint8_t)(frame->data[index] ^ value);
+    
+    if (diff != 0U) {
+        frame->data[index] = value;
+        frame->data[frame->dlc - 1U] ^= diff;
+    }
+}
+
+/**
+ * @brief Prepare a CAN FD TX frame template
+ *
+ * Same checksum convention as can_frame_template_init().
+ *
+ * @param frame Frame to initialize
+ * @param id CAN ID
+ * @param len Payload length (a valid CAN FD length, 1-64)
+ * @param flags CAN_FD_FLAG_* bits
+ * @param checksum_seed Checksum value of an all-zero payload
+ */
+static inline void can_fd_frame_template_init(can_fd_frame_t *frame, uint32_t id,
+                                              uint8_t len, uint8_t flags,
+                                              uint8_t checksum_seed)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->id = id;
+    frame->len = len;
+    frame->flags = flags;
+    frame->data[len - 1U] = checksum_seed;
+}
+
+/**
+ * @brief Write one payload byte of a template-built CAN FD frame
+ *
+ * Like can_frame_put(), the checksum in the last byte follows the change.
+ *
+ * @param frame Frame from can_fd_frame_template_init()
+ * @param index Payload byte (must not be the checksum byte)
+ * @param value New value
+ */
+static inline void can_fd_frame_put(can_fd_frame_t *frame, uint8_t index, uint8_t value)
+{
+    uint8_t diff = (uint8_t)(frame->data[index] ^ value);
+    
+    if (diff != 0U) {
+        frame->data[index] = value;
+        frame->data[frame->len - 1U] ^= diff;
+    }
+}
+
 /*******************************************************************************
  * CAN Interface Status
  ******************************************************************************/
@@ -47,29 +167,48 @@ typedef enum {
 
 /**
  * @brief Initialize CAN interface
- * @param ifname Interface name (e.g., "vcan0" for SocketCAN, ignored for stub)
- * @return CAN_STATUS_OK on success
+ *
+ * ifname may list several interfaces separated by commas
+ * ("can0,can1"); bus n is the n-th name. Stub mode opens one set of
+ * queues per name and otherwise ignores them. All TX routes are cleared.
+ *
+ * @param ifname Interface name(s) (e.g., "vcan0" for SocketCAN; NULL is one bus)
+ * @return CAN_STATUS_OK on success, CAN_STATUS_ERROR if a bus cannot be
+ *         opened or more than CAN_BUS_MAX names are given
  */
 can_status_t can_init(const char *ifname);
 
 /**
- * @brief Deinitialize CAN interface
+ * @brief Deinitialize CAN interface (all buses, RX threads joined)
  */
 void can_deinit(void);
 
 /**
  * @brief Check if CAN interface is initialized
- * @return true if initialized
+ * @return true if bus 0 is initialized
  */
 bool can_is_initialized(void);
 
 /**
  * @brief Send a CAN frame
  * @param frame Frame to send
- * @return CAN_STATUS_OK on success
+ * @return CAN_STATUS_OK if sent or scheduled (see can_send_batch())
  */
 can_status_t can_send(const can_frame_t *frame);
 
+/**
+ * @brief Send a CAN FD frame
+ *
+ * SocketCAN: needs an FD-capable interface (MTU CANFD_MTU); CAN_RAW_FD_FRAMES
+ * is enabled at can_init() in BCM_FEATURE_CAN_FD builds. Stub: the frame
+ * goes to a separate FD TX queue (can_stub_drain_tx_fd()).
+ *
+ * @param frame Frame to send, len a valid CAN FD length
+ * @return CAN_STATUS_OK on success, CAN_STATUS_ERROR if the length is not
+ *         valid or the interface cannot send CAN FD
+ */
+can_status_t can_send_fd(const can_fd_frame_t *frame);
+
 /**
  * @brief Receive a CAN frame (non-blocking)
  * @param frame Output frame buffer
@@ -77,12 +216,204 @@ can_status_t can_send(const can_frame_t *frame);
  */
 can_status_t can_recv(can_frame_t *frame);
 
+/**
+ * @brief Send several CAN frames in one call
+ *
+ * SocketCAN: one sendmmsg() per CAN_BATCH_MAX frames, sent directly from
+ * the caller's buffer. Frames must have a valid ID and DLC.
+ * Stub: frames are pushed into the TX queue in order.
+ *
+ * Frames the socket or TX queue cannot take right now, and every frame
+ * sent while older ones still wait, go to the TX scheduler: up to
+ * CAN_TX_PENDING_SIZE frames, released lowest ID first by the next send
+ * or can_tx_service(). A pending status frame (CAN_ID_STATUS_FIRST to
+ * CAN_ID_STATUS_LAST) is replaced by a newer one of the same ID.
+ *
+ * Each frame goes to the bus of its TX route. Consecutive frames of one
+ * bus are written together; every bus has its own scheduler, so a full
+ * bus does not hold back the others.
+ *
+ * @param frames Frames to send
+ * @param count Number of frames
+ * @param sent Output: number of frames sent or scheduled on all buses (may be NULL).
+ *             With TX routes these need not be the first `sent` frames; see
+ *             can_send_batch_accepted().
+ * @return CAN_STATUS_OK if all frames were sent or scheduled,
+ *         CAN_STATUS_BUFFER_FULL if a scheduler was full
+ */
+can_status_t can_send_batch(const can_frame_t *frames, uint8_t count, uint8_t *sent);
+
+/**
+ * @brief can_send_batch() that reports which frames were taken
+ *
+ * A full bus only refuses the frames routed to it, so with TX routes the
+ * accepted frames can be any subset of the batch.
+ *
+ * @param frames Frames to send
+ * @param count Number of frames
+ * @param accepted Output: one flag per frame, true if sent or scheduled
+ * @return As can_send_batch()
+ */
+can_status_t can_send_batch_accepted(const can_frame_t *frames, uint8_t count,
+                                     bool *accepted);
+
+/**
+ * @brief Retry the frames waiting in the TX schedulers of all buses
+ *
+ * Called at the start of every bcm_process(). SocketCAN: only tried when
+ * poll() reports the socket writable. Stub: when the TX queue has room.
+ *
+ * @return CAN_STATUS_OK if nothing is left pending, CAN_STATUS_BUFFER_FULL
+ *         if frames still wait
+ */
+can_status_t can_tx_service(void);
+
+/**
+ * @brief Get the number of frames waiting in the TX schedulers
+ * @return Pending frames of all buses
+ */
+uint8_t can_tx_pending(void);
+
+/**
+ * @brief Receive up to max_frames CAN frames (non-blocking)
+ *
+ * SocketCAN: one recvmmsg() call, at most CAN_BATCH_MAX frames, received
+ * directly into frames.
+ *
+ * @param frames Output frame buffer (max_frames entries)
+ * @param max_frames Capacity of frames
+ * @param count Output: number of frames received
+ * @return CAN_STATUS_OK if at least one frame received,
+ *         CAN_STATUS_NO_DATA if no frame available
+ */
+can_status_t can_recv_batch(can_frame_t *frames, uint8_t max_frames, uint8_t *count);
+
 /**
  * @brief Poll for received frames (called in main loop)
- * @return CAN_STATUS_OK if frame available, CAN_STATUS_NO_DATA otherwise
+ * @return CAN_STATUS_OK if frames are available (stub: on any bus),
+ *         CAN_STATUS_NO_DATA otherwise
  */
 can_status_t can_rx_poll(void);
 
+/**
+ * @brief Get a file descriptor that becomes readable when RX frames arrive
+ *
+ * Used by event-driven main loops (epoll/kqueue) to sleep until traffic.
+ *
+ * @return SocketCAN socket descriptor, or -1 if none (stub mode)
+ */
+int can_get_fd(void);
+
+/**
+ * @brief Restrict reception on every bus to an exact list of standard IDs
+ *
+ * SocketCAN: installed as CAN_RAW_FILTER so the kernel drops all other
+ * traffic before it is copied to userspace. Extended and RTR frames never
+ * match. Stub: the list is only recorded (see can_stub_get_rx_filter()).
+ *
+ * @param ids IDs to accept, or NULL to accept all traffic again
+ * @param count Number of IDs (0 with non-NULL ids accepts nothing)
+ * @return CAN_STATUS_OK on success, CAN_STATUS_ERROR if count exceeds
+ *         CAN_RX_FILTER_MAX or the kernel rejects the filter
+ */
+can_status_t can_set_rx_filter(const uint32_t *ids, uint8_t count);
+
+/*******************************************************************************
+ * Multiple Buses
+ ******************************************************************************/
+
+#define CAN_BUS_BODY        0U      /**< First interface: default TX bus */
+
+/**
+ * @brief Get the number of buses opened by can_init()
+ * @return 0 (not initialized) to CAN_BUS_MAX
+ */
+uint8_t can_bus_count(void);
+
+/**
+ * @brief Send frames of an ID on another bus
+ *
+ * Applies to can_send(), can_send_batch() and can_send_fd(). Routing an
+ * ID back to bus 0 removes its entry.
+ *
+ * @param id Standard CAN ID
+ * @param bus Bus index (below can_bus_count())
+ * @return CAN_STATUS_OK on success, CAN_STATUS_ERROR for an invalid ID or
+ *         bus, or if CAN_TX_ROUTE_MAX IDs are already routed
+ */
+can_status_t can_set_tx_route(uint32_t id, uint8_t bus);
+
+/**
+ * @brief Get the bus an ID is sent on
+ * @param id Standard CAN ID
+ * @return Bus index, CAN_BUS_BODY unless routed
+ */
+uint8_t can_get_tx_route(uint32_t id);
+
+/**
+ * @brief Receive up to max_frames CAN frames from one bus (non-blocking)
+ *
+ * Same as can_recv_batch() on the given bus. With an RX thread the frames
+ * come from its queue instead of the socket.
+ *
+ * @param bus Bus index
+ * @param frames Output frame buffer (max_frames entries)
+ * @param max_frames Capacity of frames
+ * @param count Output: number of frames received
+ * @return CAN_STATUS_OK if at least one frame received,
+ *         CAN_STATUS_NO_DATA if no frame available,
+ *         CAN_STATUS_NOT_INITIALIZED for a bus that is not open
+ */
+can_status_t can_bus_recv_batch(uint8_t bus, can_frame_t *frames, uint8_t max_frames,
+                                uint8_t *count);
+
+/**
+ * @brief Get the descriptor that becomes readable when a bus has RX frames
+ * @param bus Bus index
+ * @return Socket, or the RX thread's eventfd; -1 if none (stub mode)
+ */
+int can_bus_get_fd(uint8_t bus);
+
+/**
+ * @brief Get the descriptor that becomes writable when a bus can take frames
+ *
+ * Wait on it while can_tx_pending() is non-zero instead of polling
+ * can_tx_service(). Without RX threads it is the can_bus_get_fd() socket.
+ *
+ * @param bus Bus index
+ * @return Socket; -1 if none (stub mode)
+ */
+int can_bus_get_tx_fd(uint8_t bus);
+
+/**
+ * @brief Restrict reception on one bus (see can_set_rx_filter())
+ * @param bus Bus index
+ * @param ids IDs to accept, or NULL to accept all traffic again
+ * @param count Number of IDs
+ * @return CAN_STATUS_OK on success
+ */
+can_status_t can_bus_set_rx_filter(uint8_t bus, const uint32_t *ids, uint8_t count);
+
+#ifdef BCM_SIL
+
+/**
+ * @brief Give every bus its own RX thread
+ *
+ * Each thread sleeps in poll() on its socket and moves received frames
+ * into a lock-free queue of CAN_RX_QUEUE_SIZE frames, which
+ * can_bus_recv_batch() drains on the BCM thread. Socket reads of a busy
+ * bus then run beside the control loop, on another core; frames that do
+ * not fit count as rx_dropped. The threads only touch their bus's socket,
+ * queue and the rx_dropped/rx_errors counters, and stop in can_deinit().
+ * Call from the thread that runs the instance, after can_init().
+ *
+ * @return CAN_STATUS_OK on success, CAN_STATUS_ERROR if a thread could
+ *         not be started (buses already threaded keep running)
+ */
+can_status_t can_start_rx_threads(void);
+
+#endif /* BCM_SIL */
+
 /*******************************************************************************
  * Stub Interface Functions (for testing without SocketCAN)
  ******************************************************************************/
@@ -91,11 +422,29 @@ can_status_t can_rx_poll(void);
 
 /**
  * @brief Inject a frame into the RX queue (for testing)
+ *
+ * The RX queue is a lock-free single-producer/single-consumer ring: one
+ * thread or ISR may inject while the BCM loop receives, without a mutex.
+ *
  * @param frame Frame to inject
- * @return CAN_STATUS_OK on success
+ * @return CAN_STATUS_OK on success, CAN_STATUS_BUFFER_FULL if the queue is full
  */
 can_status_t can_stub_inject_rx(const can_frame_t *frame);
 
+/**
+ * @brief Inject several frames into the RX queue in one step
+ *
+ * Frames are published together; the consumer sees all or none of a
+ * call's accepted frames. Same single-producer rule as can_stub_inject_rx().
+ *
+ * @param frames Frames to inject
+ * @param count Number of frames
+ * @param injected Output: number of frames queued (may be NULL)
+ * @return CAN_STATUS_OK if all frames were queued, CAN_STATUS_BUFFER_FULL otherwise
+ */
+can_status_t can_stub_inject_rx_batch(const can_frame_t *frames, uint8_t count,
+                                      uint8_t *injected);
+
 /**
  * @brief Get last transmitted frame (for testing)
  * @param frame Output frame buffer
@@ -104,23 +453,119 @@ can_status_t can_stub_inject_rx(const can_frame_t *frame);
 can_status_t can_stub_get_last_tx(can_frame_t *frame);
 
 /**
- * @brief Clear all queues (for testing)
+ * @brief Remove transmitted frames from the TX queue, oldest first
+ *
+ * Frames still in the TX scheduler move up on the next send or
+ * can_tx_service(), not here, so any single consumer thread may drain.
+ *
+ * @param frames Output frame buffer
+ * @param max_frames Capacity of frames
+ * @return Number of frames removed
+ */
+uint8_t can_stub_drain_tx(can_frame_t *frames, uint8_t max_frames);
+
+/**
+ * @brief Inject frames into the RX queue of one bus (see can_stub_inject_rx_batch())
+ * @param bus Bus index
+ * @param frames Frames to inject
+ * @param count Number of frames
+ * @param injected Output: number of frames queued (may be NULL)
+ * @return CAN_STATUS_OK if all frames were queued, CAN_STATUS_BUFFER_FULL otherwise
+ */
+can_status_t can_stub_bus_inject_rx_batch(uint8_t bus, const can_frame_t *frames,
+                                          uint8_t count, uint8_t *injected);
+
+/**
+ * @brief Remove transmitted frames from the TX queue of one bus
+ * @param bus Bus index
+ * @param frames Output frame buffer
+ * @param max_frames Capacity of frames
+ * @return Number of frames removed
+ */
+uint8_t can_stub_bus_drain_tx(uint8_t bus, can_frame_t *frames, uint8_t max_frames);
+
+/**
+ * @brief Remove transmitted CAN FD frames from the FD TX queue, oldest first
+ *
+ * Unlike the classic TX ring, the FD queue must be drained from the thread
+ * that runs the instance.
+ *
+ * @param frames Output frame buffer
+ * @param max_frames Capacity of frames
+ * @return Number of frames removed
+ */
+uint8_t can_stub_drain_tx_fd(can_fd_frame_t *frames, uint8_t max_frames);
+
+/**
+ * @brief Clear all queues of all buses (for testing, not while a producer is running)
  */
 void can_stub_clear(void);
 
+/**
+ * @brief Get the RX filter last set with can_set_rx_filter() (for testing)
+ * @param ids Output ID buffer
+ * @param max_ids Capacity of ids
+ * @return Number of IDs in the filter, or -1 if all traffic is accepted
+ */
+int can_stub_get_rx_filter(uint32_t *ids, uint8_t max_ids);
+
 #endif /* !BCM_SIL */
 
 /*******************************************************************************
  * Debug/Statistics
  ******************************************************************************/
 
+/** Minimum bus load window; the 1000ms task closes one per run */
+#define CAN_BUS_LOAD_WINDOW_MS  1000U
+
+/** IDs tracked individually; power of two (open-addressing table) */
+#define CAN_STATS_ID_SLOTS      32U
+
 typedef struct {
     uint32_t    tx_count;
     uint32_t    rx_count;
-    uint32_t    tx_errors;
+    uint32_t    tx_errors;      /**< Frames not sent, including tx_dropped */
     uint32_t    rx_errors;
+    uint32_t    tx_dropped;     /**< Not queued: TX scheduler full (CAN_STATUS_BUFFER_FULL) */
+    uint32_t    tx_coalesced;   /**< Pending status frames replaced by a newer copy */
+    uint32_t    rx_dropped;     /**< Lost to a full RX queue (stub) or socket buffer (SIL) */
+    uint32_t    rx_unknown_id;  /**< No handler registered for the ID */
+    uint32_t    rx_bad_dlc;     /**< Length did not match registered DLC */
+    uint32_t    rx_rejected;    /**< Handler returned an error result */
+    uint32_t    id_overflow;    /**< Frames of IDs that found no per-ID slot */
+    uint32_t    bus_bits;       /**< Estimated bus bits of the last load window */
+    uint16_t    bus_load_x10;   /**< Bus load of the last window, 0.1% units */
 } can_stats_t;
 
+/** Traffic of one CAN ID */
+typedef struct {
+    uint32_t    id;
+    uint32_t    rx_count;
+    uint32_t    tx_count;
+    uint32_t    last_rx_ms;     /**< Uptime of the last RX (valid if rx_count > 0) */
+    uint32_t    last_tx_ms;     /**< Uptime of the last TX (valid if tx_count > 0) */
+} can_id_stats_t;
+
+/** Reasons a received frame was not accepted by the BCM core */
+typedef enum {
+    CAN_RX_UNKNOWN_ID = 0,
+    CAN_RX_BAD_DLC,
+    CAN_RX_REJECTED
+} can_rx_discard_t;
+
+/**
+ * @brief Count a received frame that the BCM core did not accept
+ * @param reason Why the frame was discarded
+ */
+void can_stats_rx_discard(can_rx_discard_t reason);
+
+/**
+ * @brief Count a discarded frame received on one bus
+ * @param bus Bus the frame came from
+ * @param reason Why the frame was discarded
+ */
+void can_bus_stats_rx_discard(uint8_t bus, can_rx_discard_t reason);
+
 /**
  * @brief Get CAN statistics
  * @param stats Output statistics structure
@@ -128,7 +573,86 @@ typedef struct {
 void can_get_stats(can_stats_t *stats);
 
 /**
- * @brief Reset CAN statistics
+ * @brief Get the CAN statistics of one bus
+ * @param bus Bus index
+ * @param stats Output statistics structure (zeroed for an invalid bus)
+ */
+void can_bus_get_stats(uint8_t bus, can_stats_t *stats);
+
+/**
+ * @brief Get the traffic counters of one CAN ID
+ * @param id CAN identifier
+ * @param stats Output statistics
+ * @return true if the ID has been seen since the last reset
+ */
+bool can_get_id_stats(uint32_t id, can_id_stats_t *stats);
+
+/**
+ * @brief Get the traffic counters of one CAN ID on one bus
+ * @param bus Bus index
+ * @param id CAN identifier
+ * @param stats Output statistics
+ * @return true if the ID has been seen on the bus since the last reset
+ */
+bool can_bus_get_id_stats(uint8_t bus, uint32_t id, can_id_stats_t *stats);
+
+/**
+ * @brief Get the traffic counters of every ID seen since the last reset
+ * @param stats Output buffer, in table order
+ * @param max_ids Capacity of stats
+ * @return Number of entries written
+ */
+uint8_t can_get_all_id_stats(can_id_stats_t *stats, uint8_t max_ids);
+
+/**
+ * @brief Frame time on the bus in bits, worst-case bit stuffing
+ *
+ * Classic CAN, 11-bit ID: 34 + 8*dlc stuffable bits (SOF to CRC) with up
+ * to one stuff bit per 4 after the first, plus 10 fixed bits (CRC
+ * delimiter, ACK, EOF) and the 3-bit interframe space.
+ *
+ * @param dlc Payload length (clamped to CAN_FRAME_MAX_DLC)
+ * @return Bits, 55 for DLC 0 up to 135 for DLC 8
+ */
+uint32_t can_frame_bits(uint8_t dlc);
+
+/**
+ * @brief Smallest valid CAN FD payload length that holds len bytes
+ * @param len Payload bytes needed
+ * @return len up to 8, else 12, 16, 20, 24, 32, 48 or 64 (also past 64)
+ */
+uint8_t can_fd_len_round(uint8_t len);
+
+/**
+ * @brief CAN FD frame time in nominal bit times, worst-case bit stuffing
+ *
+ * 11-bit ID: 17 arbitration bits with up to 4 stuff bits and 13 trailing
+ * bits (CRC delimiter, ACK, EOF, interframe space) at CAN_BAUD_RATE. The
+ * data phase (ESI, DLC, payload, stuff count, CRC-17/21 and its fixed
+ * stuff bits) runs at CAN_FD_DATA_BAUD_RATE with CAN_FD_FLAG_BRS and is
+ * scaled to nominal bit times.
+ *
+ * @param len Payload length (rounded up to a valid length)
+ * @param flags CAN_FD_FLAG_* of the frame
+ * @return Bits, 124 for 32 bytes with bit rate switch at 500k/2M
+ */
+uint32_t can_fd_frame_bits(uint8_t len, uint8_t flags);
+
+/**
+ * @brief Close the bus load window and open the next one
+ *
+ * Once at least CAN_BUS_LOAD_WINDOW_MS have passed, computes bus_load_x10
+ * from the bits of all frames sent and received in the window at
+ * CAN_BAUD_RATE; earlier calls leave the window open. The first call
+ * only opens it. Every bus has its own window. The BCM core calls it when
+ * its scheduler starts and from the 1000ms task.
+ *
+ * @param now_ms Current time in milliseconds
+ */
+void can_stats_sample_load(uint32_t now_ms);
+
+/**
+ * @brief Reset CAN statistics of all buses
  */
 void can_reset_stats(void);
 
@@ -42,6 +42,26 @@ void door_control_init(void);
  */
 cmd_result_t door_control_handle_cmd(const can_frame_t *frame);
 
+/**
+ * @brief Validate a batch of door command frames
+ *
+ * Runs the checks of door_control_handle_cmd() over the batch with
+ * can_check_batch(); the rolling counter advances frame by frame.
+ *
+ * @param frames Frames of ID CAN_ID_DOOR_CMD
+ * @param count Number of frames (at most CAN_BATCH_MAX)
+ * @param flags Output: CAN_CHECK_* flags per frame
+ */
+void door_control_check_cmds(const can_frame_t *frames, uint8_t count, uint8_t *flags);
+
+/**
+ * @brief Handle a door command frame checked by door_control_check_cmds()
+ * @param frame Received CAN frame
+ * @param flags Its CAN_CHECK_* flags
+ * @return cmd_result_t indicating success or error type
+ */
+cmd_result_t door_control_apply_cmd(const can_frame_t *frame, uint8_t flags);
+
 /**
  * @brief Periodic update (called from 10ms task)
  *
@@ -51,6 +71,16 @@ cmd_result_t door_control_handle_cmd(const can_frame_t *frame);
  */
 void door_control_update(uint32_t current_ms);
 
+/**
+ * @brief Earliest time door_control_update() has work to do
+ *
+ * A LOCKING or UNLOCKING door completes on the next update.
+ *
+ * @param now_ms Current time
+ * @return Absolute deadline (now_ms if due, now_ms + SYS_DEADLINE_IDLE_MS if idle)
+ */
+uint32_t door_control_next_deadline(uint32_t now_ms);
+
 /*******************************************************************************
  * Door Control Status
  ******************************************************************************/
@@ -61,6 +91,17 @@ void door_control_update(uint32_t current_ms);
  */
 void door_control_build_status_frame(can_frame_t *frame);
 
+/**
+ * @brief Refresh a door status frame in place
+ *
+ * Only bytes whose value changed are written and the checksum is updated
+ * incrementally. frame must already hold a door status frame, e.g. from
+ * door_control_build_status_frame() or a previous update.
+ *
+ * @param frame Frame to update
+ */
+void door_control_update_status_frame(can_frame_t *frame);
+
 /**
  * @brief Get lock state for a specific door
  * @param door_id Door ID (0-3)
@@ -17,6 +17,14 @@ extern "C" {
 #include <stdbool.h>
 #include "system_state.h"
 #include "can_interface.h"
+#include "can_check.h"
+
+/** Command modules, tags for fault_manager_report_cmd_check() */
+typedef enum {
+    FAULT_CMD_SOURCE_DOOR = 0,
+    FAULT_CMD_SOURCE_LIGHTING,
+    FAULT_CMD_SOURCE_TURN
+} fault_cmd_source_t;
 
 /*******************************************************************************
  * Fault Manager Initialization
@@ -32,13 +40,43 @@ void fault_manager_init(void);
  ******************************************************************************/
 
 /**
- * @brief Set a fault active
+ * @brief Set a fault active immediately (no debounce)
+ *
+ * For event-type faults such as a bad command frame. Setting an already
+ * active fault restarts its healing timer. When all MAX_ACTIVE_FAULTS
+ * slots hold active or pending faults, the new code is dropped.
+ *
  * @param code Fault code to set
  */
 void fault_manager_set(fault_code_t code);
 
 /**
- * @brief Clear a fault
+ * @brief Set a fault for a repeatable event and coalesce its reporting
+ *
+ * Same as fault_manager_set(), and also rate-limits logging: only the
+ * first report of a code in each FAULT_DEBOUNCE_TIME_MS window returns
+ * true. Later reports are counted per code and in the window total that
+ * fault_manager_update() publishes.
+ *
+ * @param code Fault code to set
+ * @return true if the caller should log this occurrence
+ */
+bool fault_manager_note(fault_code_t code);
+
+/**
+ * @brief Report the result of a periodic check (debounced)
+ *
+ * The fault goes active after failed reports have persisted for
+ * FAULT_DEBOUNCE_TIME_MS. A passing report before then restarts the
+ * debounce; once active, the fault heals in fault_manager_update().
+ *
+ * @param code Fault code being monitored
+ * @param failed true if the check failed this cycle
+ */
+void fault_manager_report(fault_code_t code, bool failed);
+
+/**
+ * @brief Clear a fault and its occurrence history
  * @param code Fault code to clear
  */
 void fault_manager_clear(fault_code_t code);
@@ -55,6 +93,27 @@ void fault_manager_clear_all(void);
  */
 bool fault_manager_is_active(fault_code_t code);
 
+/**
+ * @brief Get how many times a fault has gone active since it was cleared
+ * @param code Fault code
+ * @return Occurrence count (saturates at 255), 0 if unknown
+ */
+uint8_t fault_manager_get_occurrences(fault_code_t code);
+
+/**
+ * @brief Check if a fault reached FAULT_MAX_OCCURRENCES and no longer heals
+ * @param code Fault code
+ * @return true if the fault is latched until cleared
+ */
+bool fault_manager_is_permanent(fault_code_t code);
+
+/**
+ * @brief Get how many reports of a fault were coalesced (not logged)
+ * @param code Fault code
+ * @return Repeat count since the last clear (saturates at 65535)
+ */
+uint16_t fault_manager_get_repeats(fault_code_t code);
+
 /**
  * @brief Get number of active faults
  */
@@ -66,15 +125,43 @@ uint8_t fault_manager_get_count(void);
 uint8_t fault_manager_get_flags1(void);
 
 /**
- * @brief Get fault flags byte 2 (for CAN status)
+ * @brief Get reports coalesced in the last 100ms window (for CAN status)
  */
-uint8_t fault_manager_get_flags2(void);
+uint8_t fault_manager_get_repeat_rate(void);
 
 /**
  * @brief Get most recent fault code
  */
 fault_code_t fault_manager_get_most_recent(void);
 
+/**
+ * @brief Set the fault matching the first failed RX check
+ *
+ * DLC -> INVALID_LENGTH, checksum -> INVALID_CHECKSUM,
+ * counter -> INVALID_COUNTER, field -> INVALID_CMD.
+ *
+ * Goes through fault_manager_note(), so repeats are coalesced.
+ *
+ * @param flags CAN_CHECK_* flags from can_check_frame()
+ * @return true if the caller should log this rejection
+ */
+bool fault_manager_report_rx_check(uint8_t flags);
+
+/**
+ * @brief Report the check flags of a command frame and map them to a result
+ *
+ * Calls fault_manager_report_rx_check(); when it asks for a log, adds an
+ * EVENT_CMD_ERROR event and a warning tagged with the module. A flood of
+ * bad frames is therefore logged once per fault code and window.
+ *
+ * @param frame Checked frame
+ * @param flags CAN_CHECK_* flags from its check
+ * @param source Module that received it
+ * @return can_check_to_result(flags)
+ */
+cmd_result_t fault_manager_report_cmd_check(const can_frame_t *frame, uint8_t flags,
+                                            fault_cmd_source_t source);
+
 /*******************************************************************************
  * Fault Status Frame
  ******************************************************************************/
@@ -85,12 +172,28 @@ fault_code_t fault_manager_get_most_recent(void);
  */
 void fault_manager_build_status_frame(can_frame_t *frame);
 
+/**
+ * @brief Refresh a fault status frame in place
+ *
+ * Only bytes whose value changed are written and the checksum is updated
+ * incrementally. frame must already hold a fault status frame, e.g. from
+ * fault_manager_build_status_frame() or a previous update.
+ *
+ * @param frame Frame to update
+ */
+void fault_manager_update_status_frame(can_frame_t *frame);
+
 /*******************************************************************************
  * Periodic Processing
  ******************************************************************************/
 
 /**
- * @brief Periodic update (called from 100ms or 1000ms task)
+ * @brief Periodic update: heal quiet faults, expire stale debounces
+ *
+ * Called from the 100ms task. Also latches the coalesced report total
+ * for the status frame and starts a new window. Healing is skipped when
+ * FAULT_ENABLE_RECOVERY is 0.
+ *
  * @param current_ms Current time
  */
 void fault_manager_update(uint32_t current_ms);
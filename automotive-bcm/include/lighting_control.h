@@ -43,15 +43,47 @@ void lighting_control_init(void);
  */
 cmd_result_t lighting_control_handle_cmd(const can_frame_t *frame);
 
+/**
+ * @brief Validate a batch of lighting command frames
+ *
+ * Runs the checks of lighting_control_handle_cmd() over the batch with
+ * can_check_batch(); the rolling counter advances frame by frame.
+ *
+ * @param frames Frames of ID CAN_ID_LIGHTING_CMD
+ * @param count Number of frames (at most CAN_BATCH_MAX)
+ * @param flags Output: CAN_CHECK_* flags per frame
+ */
+void lighting_control_check_cmds(const can_frame_t *frames, uint8_t count, uint8_t *flags);
+
+/**
+ * @brief Handle a lighting command frame checked by lighting_control_check_cmds()
+ * @param frame Received CAN frame
+ * @param flags Its CAN_CHECK_* flags
+ * @return cmd_result_t indicating success or error type
+ */
+cmd_result_t lighting_control_apply_cmd(const can_frame_t *frame, uint8_t flags);
+
 /**
  * @brief Periodic update (called from 10ms task)
  *
- * Handles AUTO mode logic, timeouts.
+ * Handles AUTO mode logic, timeouts and the interior light fade.
  *
  * @param current_ms Current time
  */
 void lighting_control_update(uint32_t current_ms);
 
+/**
+ * @brief Earliest time lighting_control_update() has work to do
+ *
+ * Due while the headlight output has not settled or the interior light is
+ * fading and, in AUTO mode, once the ambient reading is older than the
+ * sensor timeout.
+ *
+ * @param now_ms Current time
+ * @return Absolute deadline (now_ms if due, now_ms + SYS_DEADLINE_IDLE_MS if idle)
+ */
+uint32_t lighting_control_next_deadline(uint32_t now_ms);
+
 /*******************************************************************************
  * Lighting Control Status
  ******************************************************************************/
@@ -62,6 +94,17 @@ void lighting_control_update(uint32_t current_ms);
  */
 void lighting_control_build_status_frame(can_frame_t *frame);
 
+/**
+ * @brief Refresh a lighting status frame in place
+ *
+ * Only bytes whose value changed are written and the checksum is updated
+ * incrementally. frame must already hold a lighting status frame, e.g. from
+ * lighting_control_build_status_frame() or a previous update.
+ *
+ * @param frame Frame to update
+ */
+void lighting_control_update_status_frame(can_frame_t *frame);
+
 /**
  * @brief Get current headlight mode
  */
@@ -82,6 +125,13 @@ bool lighting_control_headlights_on(void);
  */
 uint8_t lighting_control_get_interior_brightness(void);
 
+/**
+ * @brief Get interior light PWM duty (0-LIGHT_PWM_MAX_DUTY)
+ *
+ * Follows the fade towards the commanded brightness, gamma corrected.
+ */
+uint8_t lighting_control_get_interior_duty(void);
+
 /*******************************************************************************
  * Lighting Control Commands (for testing)
  ******************************************************************************/
@@ -4,6 +4,11 @@
  *
  * Central state repository for all BCM modules.
  * No dynamic allocation - all state is statically allocated.
+ *
+ * system_state_t is the hot block: everything the 10ms tick reads or
+ * writes, in fixed-width fields (enums are stored as uint8_t) so it fits
+ * one cache line. The fault store and the event log are separate cold
+ * blocks reached through sys_fault_get() and the event_log_*() calls.
  */
 
 #ifndef SYSTEM_STATE_H
@@ -16,15 +21,20 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 #include "can_ids.h"
+#include "bcm_config.h"
 
 /*******************************************************************************
  * Configuration
  ******************************************************************************/
 
 #define NUM_DOORS                   4U
-#define EVENT_LOG_SIZE              32U     /**< Ring buffer size for events */
+/** Event log capacity; power of two up to 65536 (CMake BCM_EVENT_LOG_SIZE) */
+#ifndef EVENT_LOG_SIZE
+#define EVENT_LOG_SIZE              32U
+#endif
 #define CMD_TIMEOUT_MS              5000U   /**< Command timeout in ms */
 #define TURN_SIGNAL_TIMEOUT_MS      30000U  /**< Turn signal auto-off timeout */
+#define SYS_STATE_HOT_SIZE          64U     /**< Cache line budget of system_state_t */
 
 /*******************************************************************************
  * Event Log Entry
@@ -41,13 +51,19 @@ typedef enum {
     EVENT_FAULT_CLEAR,
     EVENT_CMD_RECEIVED,
     EVENT_CMD_ERROR,
-    EVENT_STATE_CHANGE
+    EVENT_STATE_CHANGE,
+    EVENT_TYPE_COUNT
 } event_type_t;
 
+/** Bit of an event type in event_log_set_mask() */
+#define EVENT_MASK(type)            ((uint16_t)(1U << (type)))
+#define EVENT_MASK_ALL              ((uint16_t)((1U << EVENT_TYPE_COUNT) - 1U))
+
+/** Packed 8-byte record; the log stores the first 3 data bytes */
 typedef struct {
     uint32_t        timestamp_ms;   /**< Event timestamp */
-    event_type_t    type;           /**< Event type */
-    uint8_t         data[4];        /**< Event-specific data */
+    uint8_t         type;           /**< event_type_t */
+    uint8_t         data[3];        /**< Event-specific data */
 } event_log_entry_t;
 
 /*******************************************************************************
@@ -62,11 +78,11 @@ typedef enum {
 } door_lock_state_t;
 
 typedef struct {
-    door_lock_state_t   lock_state[NUM_DOORS];
-    bool                is_open[NUM_DOORS];
     uint32_t            last_cmd_time_ms;
-    uint8_t             last_counter;
-    cmd_result_t        last_result;
+    uint8_t             lock_state[NUM_DOORS];  /**< door_lock_state_t */
+    bool                is_open[NUM_DOORS];
+    can_rx_counter_t    rx_counter;
+    uint8_t             last_result;            /**< cmd_result_t */
 } door_state_t;
 
 /*******************************************************************************
@@ -80,18 +96,28 @@ typedef enum {
 } lighting_mode_state_t;
 
 typedef struct {
-    lighting_mode_state_t   headlight_mode;
-    headlight_state_t       headlight_output;   /**< Actual output state */
+    uint32_t                last_cmd_time_ms;
+    uint32_t                last_ambient_update_ms; /**< 0 = no sensor data yet */
+    uint8_t                 headlight_mode;     /**< lighting_mode_state_t */
+    uint8_t                 headlight_output;   /**< headlight_state_t, actual output */
     bool                    high_beam_active;
-    lighting_mode_state_t   interior_mode;
+    uint8_t                 interior_mode;      /**< lighting_mode_state_t */
     uint8_t                 interior_brightness; /**< 0-15 */
     bool                    interior_on;
     uint8_t                 ambient_light;      /**< Scaled 0-255 */
-    uint32_t                last_cmd_time_ms;
-    uint8_t                 last_counter;
-    cmd_result_t            last_result;
+    uint8_t                 last_result;        /**< cmd_result_t */
+    can_rx_counter_t        rx_counter;
+    uint8_t                 interior_duty;      /**< PWM output, 0-LIGHT_PWM_MAX_DUTY */
+    bool                    interior_fading;    /**< Fade ramp running */
 } lighting_state_t;
 
+/** Interior light fade ramp (cold), touched only while interior_fading */
+typedef struct {
+    uint16_t                level;              /**< Perceptual level, 8.8 fixed point */
+    uint16_t                target;             /**< Level at the end of the ramp, 8.8 */
+    uint16_t                step;               /**< Level change per 10ms run, 8.8 */
+} lighting_fade_t;
+
 /*******************************************************************************
  * Turn Signal Module State
  ******************************************************************************/
@@ -104,34 +130,52 @@ typedef enum {
 } turn_signal_mode_t;
 
 typedef struct {
-    turn_signal_mode_t  mode;
+    uint32_t            last_toggle_ms; /**< Last flash toggle time */
+    uint32_t            last_cmd_time_ms;
+    uint8_t             mode;           /**< turn_signal_mode_t */
     bool                left_output;    /**< Current flash state */
     bool                right_output;   /**< Current flash state */
     uint8_t             flash_count;    /**< Wrapping counter */
-    uint32_t            last_toggle_ms; /**< Last flash toggle time */
-    uint32_t            last_cmd_time_ms;
-    uint8_t             last_counter;
-    cmd_result_t        last_result;
+    uint8_t             last_result;    /**< cmd_result_t */
+    can_rx_counter_t    rx_counter;
 } turn_signal_state_t;
 
 /*******************************************************************************
  * Fault Manager State
  ******************************************************************************/
 
-#define MAX_ACTIVE_FAULTS           8U
+#define MAX_ACTIVE_FAULTS           BCM_MAX_FAULT_COUNT    /**< Slots, <= 32 */
+#define FAULT_CODE_COUNT            256U    /**< One-byte fault code space */
+
+/** fault_entry_t.flags */
+#define FAULT_ENTRY_ACTIVE          0x01U   /**< Qualified, reported on CAN */
+#define FAULT_ENTRY_PENDING         0x02U   /**< Failing, debounce running */
+#define FAULT_ENTRY_PERMANENT       0x04U   /**< FAULT_MAX_OCCURRENCES reached */
+#define FAULT_ENTRY_LOGGED          0x08U   /**< logged_ms holds a valid time */
 
 typedef struct {
-    fault_code_t    code;
-    uint32_t        timestamp_ms;
+    uint32_t        timestamp_ms;       /**< Last activation */
+    uint32_t        first_fail_ms;      /**< Start of the debounce window */
+    uint32_t        last_fail_ms;       /**< Last failed report (healing timer) */
+    uint32_t        logged_ms;          /**< Last coalesced report that was logged */
+    uint16_t        repeats;            /**< Coalesced reports since the last clear */
+    uint8_t         code;               /**< fault_code_t */
+    uint8_t         occurrences;        /**< Activations since the last clear */
+    uint8_t         flags;              /**< FAULT_ENTRY_* */
 } fault_entry_t;
 
 typedef struct {
     uint8_t         flags1;             /**< Active fault flags byte 1 */
-    uint8_t         flags2;             /**< Active fault flags byte 2 */
-    fault_entry_t   active_faults[MAX_ACTIVE_FAULTS];
+    uint8_t         repeat_rate;        /**< Reports coalesced in the last 100ms */
+    uint16_t        repeat_window;      /**< Reports coalesced so far this 100ms */
+    uint32_t        active_map[FAULT_CODE_COUNT / 32U]; /**< Bit per code */
+    uint8_t         slot_of[FAULT_CODE_COUNT];  /**< Code -> slot + 1, 0 = none */
+    uint32_t        used_slots;         /**< Bit per allocated slot */
+    uint32_t        live_slots;         /**< Bit per active or pending slot */
+    fault_entry_t   slots[MAX_ACTIVE_FAULTS];
     uint8_t         active_count;
     uint8_t         total_count;        /**< Historical count */
-    fault_code_t    most_recent_code;
+    uint8_t         most_recent_code;   /**< fault_code_t */
     uint32_t        most_recent_time_ms;
 } fault_state_t;
 
@@ -139,20 +183,47 @@ typedef struct {
  * Event Log Ring Buffer
  ******************************************************************************/
 
+/**
+ * Entry n of the log's history has sequence number n and lives in slot
+ * n % EVENT_LOG_SIZE; the newest EVENT_LOG_SIZE since the last clear are
+ * kept.
+ */
 typedef struct {
+    uint32_t            seq;            /**< Sequence number of the next entry */
+    uint32_t            first_seq;      /**< seq at the last clear */
+    uint16_t            type_mask;      /**< EVENT_MASK() of the logged types */
+    uint16_t            sample_every[EVENT_TYPE_COUNT]; /**< Keep 1 in N (0/1 = all) */
+    uint16_t            sample_count[EVENT_TYPE_COUNT];
     event_log_entry_t   entries[EVENT_LOG_SIZE];
-    uint8_t             head;           /**< Next write position */
-    uint8_t             count;          /**< Number of valid entries */
 } event_log_t;
 
 /*******************************************************************************
- * Complete System State
+ * Module State (cold block)
+ ******************************************************************************/
+
+/** Module state that only changes while an operation is in progress */
+typedef struct {
+    lighting_fade_t     lighting_fade;
+} sys_cold_state_t;
+
+/*******************************************************************************
+ * System State (hot block)
  ******************************************************************************/
 
+/** Status frames whose content changed since they were last sent */
+#define SYS_TX_DIRTY_DOOR       0x01U
+#define SYS_TX_DIRTY_LIGHTING   0x02U
+#define SYS_TX_DIRTY_TURN       0x04U
+#define SYS_TX_DIRTY_ALL        0x07U
+
+/** Offset from now returned by a *_next_deadline() query with nothing due */
+#define SYS_DEADLINE_IDLE_MS    0x40000000UL
+
+/** Hot per-tick state; at most SYS_STATE_HOT_SIZE bytes */
 typedef struct {
     /* BCM Core State */
-    bcm_state_t         bcm_state;
     uint32_t            uptime_ms;
+    uint8_t             bcm_state;          /**< bcm_state_t */
     uint8_t             uptime_minutes;     /**< Wrapping minutes counter */
     
     /* Rolling counters for TX messages */
@@ -161,21 +232,12 @@ typedef struct {
     uint8_t             tx_counter_turn;
     uint8_t             tx_counter_fault;
     uint8_t             tx_counter_heartbeat;
+    uint8_t             tx_dirty;           /**< SYS_TX_DIRTY_* pending changes */
     
     /* Module States */
     door_state_t        door;
     lighting_state_t    lighting;
     turn_signal_state_t turn_signal;
-    fault_state_t       fault;
-    
-    /* Event Log */
-    event_log_t         event_log;
-    
-    /* Timing for periodic tasks */
-    uint32_t            last_10ms_tick;
-    uint32_t            last_100ms_tick;
-    uint32_t            last_1000ms_tick;
-    
 } system_state_t;
 
 /*******************************************************************************
@@ -183,17 +245,37 @@ typedef struct {
  ******************************************************************************/
 
 /**
- * @brief Get pointer to global system state (read-only)
+ * @brief Get pointer to the system state of the bound BCM instance (read-only)
  */
 const system_state_t* sys_state_get(void);
 
 /**
- * @brief Get mutable pointer to global system state (internal use)
+ * @brief Get mutable pointer to the bound instance's system state (internal use)
  */
 system_state_t* sys_state_get_mut(void);
 
 /**
- * @brief Initialize system state to defaults
+ * @brief Get the bound instance's fault store (read-only)
+ */
+const fault_state_t* sys_fault_get(void);
+
+/**
+ * @brief Get the bound instance's fault store (internal use)
+ */
+fault_state_t* sys_fault_get_mut(void);
+
+/**
+ * @brief Get the bound instance's cold module state (read-only)
+ */
+const sys_cold_state_t* sys_cold_get(void);
+
+/**
+ * @brief Get the bound instance's cold module state (internal use)
+ */
+sys_cold_state_t* sys_cold_get_mut(void);
+
+/**
+ * @brief Initialize system state, cold state, fault store and event log
  */
 void sys_state_init(void);
 
@@ -203,14 +285,47 @@ void sys_state_init(void);
  */
 void sys_state_update_time(uint32_t current_ms);
 
+/**
+ * @brief Flag status frames for transmission after a state transition
+ * @param bits SYS_TX_DIRTY_* bits
+ */
+void sys_state_mark_tx_dirty(uint8_t bits);
+
+/**
+ * @brief Publish a copy of the bound instance's state for other threads
+ *
+ * bcm_init() and every bcm_process() call that ran a periodic task
+ * publish once at their end. Never waits: a sequence bump, a copy of
+ * sizeof(system_state_t) bytes and a second bump.
+ */
+void sys_state_publish(void);
+
+/**
+ * @brief Torn-free copy of the bound instance's last published state
+ *
+ * Safe on any thread while the instance keeps running; no lock is taken
+ * and the writer is never delayed. A read that overlaps a publication is
+ * retried. Use this, not sys_state_get(), from threads other than the one
+ * calling bcm_process().
+ *
+ * @param out Output state
+ * @return Number of publications so far, 0 if there was none (out zeroed)
+ */
+uint32_t sys_state_snapshot(system_state_t *out);
+
 /*******************************************************************************
  * Event Log Functions
  ******************************************************************************/
 
 /**
  * @brief Log an event
+ *
+ * Types left out by event_log_set_mask() or thinned by
+ * event_log_set_sampling() return before anything is stored or traced.
+ *
  * @param type Event type
- * @param data Event data (4 bytes, can be NULL)
+ * @param data Event data (4 bytes, can be NULL; the log keeps bytes 0-2,
+ *             the trace all 4)
  */
 void event_log_add(event_type_t type, const uint8_t *data);
 
@@ -220,12 +335,68 @@ void event_log_add(event_type_t type, const uint8_t *data);
  * @param entry Output entry
  * @return true if valid entry returned
  */
-bool event_log_get(uint8_t index, event_log_entry_t *entry);
+bool event_log_get(uint32_t index, event_log_entry_t *entry);
+
+/**
+ * @brief Append events as they are, e.g. history from the persistent store
+ *
+ * No mask, sampling, trace or store: the entries were logged before.
+ *
+ * @param entries Entries, oldest first
+ * @param count Number of entries
+ */
+void event_log_restore(const event_log_entry_t *entries, uint32_t count);
 
 /**
  * @brief Get number of events in log
  */
-uint8_t event_log_count(void);
+uint32_t event_log_count(void);
+
+/**
+ * @brief Sequence number the next event will get (events added since init)
+ */
+uint32_t event_log_seq(void);
+
+/**
+ * @brief Copy events with sequence numbers from since_seq on, oldest first
+ *
+ * Copies at most two contiguous spans of the ring. If since_seq is older
+ * than the oldest held entry, the copy starts there instead; the caller
+ * sees the gap as *next_seq - count > since_seq.
+ *
+ * @param since_seq First sequence number wanted (0 = everything held)
+ * @param buf Output entries
+ * @param max_entries Capacity of buf
+ * @param next_seq Output: since_seq for the following call (can be NULL)
+ * @return Number of entries copied
+ */
+uint32_t event_log_read(uint32_t since_seq, event_log_entry_t *buf,
+                        uint32_t max_entries, uint32_t *next_seq);
+
+/**
+ * @brief Select the event types that are logged
+ *
+ * Resets to EVENT_MASK_ALL on bcm_init().
+ *
+ * @param mask OR of EVENT_MASK() bits
+ */
+void event_log_set_mask(uint16_t mask);
+
+/**
+ * @brief Get the mask set with event_log_set_mask()
+ */
+uint16_t event_log_get_mask(void);
+
+/**
+ * @brief Log only the first and then every keep_one_in-th event of a type
+ *
+ * For high-rate types such as EVENT_CMD_RECEIVED. Resets to logging every
+ * event on bcm_init().
+ *
+ * @param type Event type
+ * @param keep_one_in Sampling divisor (0 and 1 log every event)
+ */
+void event_log_set_sampling(event_type_t type, uint16_t keep_one_in);
 
 /**
  * @brief Clear event log
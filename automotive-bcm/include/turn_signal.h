@@ -51,6 +51,26 @@ void turn_signal_init(void);
  */
 cmd_result_t turn_signal_handle_cmd(const can_frame_t *frame);
 
+/**
+ * @brief Validate a batch of turn signal command frames
+ *
+ * Runs the checks of turn_signal_handle_cmd() over the batch with
+ * can_check_batch(); the rolling counter advances frame by frame.
+ *
+ * @param frames Frames of ID CAN_ID_TURN_SIGNAL_CMD
+ * @param count Number of frames (at most CAN_BATCH_MAX)
+ * @param flags Output: CAN_CHECK_* flags per frame
+ */
+void turn_signal_check_cmds(const can_frame_t *frames, uint8_t count, uint8_t *flags);
+
+/**
+ * @brief Handle a turn signal command frame checked by turn_signal_check_cmds()
+ * @param frame Received CAN frame
+ * @param flags Its CAN_CHECK_* flags
+ * @return cmd_result_t indicating success or error type
+ */
+cmd_result_t turn_signal_apply_cmd(const can_frame_t *frame, uint8_t flags);
+
 /**
  * @brief Periodic update (called from 10ms task)
  *
@@ -60,6 +80,17 @@ cmd_result_t turn_signal_handle_cmd(const can_frame_t *frame);
  */
 void turn_signal_update(uint32_t current_ms);
 
+/**
+ * @brief Earliest time turn_signal_update() has work to do
+ *
+ * The next flash toggle while active; nothing once off with the outputs
+ * cleared.
+ *
+ * @param now_ms Current time
+ * @return Absolute deadline (now_ms if due, now_ms + SYS_DEADLINE_IDLE_MS if idle)
+ */
+uint32_t turn_signal_next_deadline(uint32_t now_ms);
+
 /**
  * @brief Check for timeout and auto-off
  *
@@ -80,6 +111,17 @@ void turn_signal_check_timeout(uint32_t current_ms);
  */
 void turn_signal_build_status_frame(can_frame_t *frame);
 
+/**
+ * @brief Refresh a turn signal status frame in place
+ *
+ * Only bytes whose value changed are written and the checksum is updated
+ * incrementally. frame must already hold a turn signal status frame, e.g. from
+ * turn_signal_build_status_frame() or a previous update.
+ *
+ * @param frame Frame to update
+ */
+void turn_signal_update_status_frame(can_frame_t *frame);
+
 /**
  * @brief Get current turn signal mode
  */
@@ -3,16 +3,25 @@
  * @brief BCM Core Implementation
  *
  * Message-driven architecture with periodic task scheduling.
+ * Dispatch table, scheduler state and TX pool belong to the bound BCM
+ * instance (bcm_ctx.h); only the task definitions are shared.
  */
 
 #include <string.h>
-#include <stdio.h>
 #include "bcm.h"
+#include "bcm_ctx_internal.h"
 #include "door_control.h"
 #include "lighting_control.h"
 #include "turn_signal.h"
 #include "fault_manager.h"
+#include "can_check.h"
+#include "bcm_trace.h"
+#include "bcm_store.h"
+#include "bcm_log.h"
+#include "bcm_timing.h"
 #include "can_ids.h"
+#include "can_messages.h"
+#include "bcm_config.h"
 
 /*******************************************************************************
  * Version
@@ -20,123 +29,614 @@
 
 #define BCM_VERSION_STRING  "1.0.0"
 
+/*******************************************************************************
+ * Dispatch and Scheduler Types
+ ******************************************************************************/
+
+typedef void (*bcm_task_fn_t)(uint32_t current_ms);
+
+typedef struct {
+    bcm_task_fn_t   fn;
+    uint32_t        period_ms;
+    uint32_t        offset_ms;      /**< Phase within the period */
+} bcm_task_def_t;
+
 /*******************************************************************************
  * Private Data
  ******************************************************************************/
 
-static bool g_initialized = false;
+/* Periodic task table; offsets keep the TX tasks out of each other's slot */
+static const bcm_task_def_t g_task_defs[BCM_TASK_COUNT] = {
+    [BCM_TASK_10MS]   = { bcm_process_10ms,   BCM_MAIN_CYCLE_TIME_MS,
+                          SCHED_OFFSET_10MS_MS },
+    [BCM_TASK_100MS]  = { bcm_process_100ms,  CAN_BCM_STATUS_PERIOD_MS,
+                          SCHED_OFFSET_STATUS_MS },
+    [BCM_TASK_500MS]  = { bcm_process_500ms,  FAULT_STATUS_PERIOD_MS,
+                          SCHED_OFFSET_FAULT_STATUS_MS },
+    [BCM_TASK_1000MS] = { bcm_process_1000ms, CAN_HEARTBEAT_PERIOD_MS,
+                          SCHED_OFFSET_HEARTBEAT_MS },
+};
 
 /*******************************************************************************
  * Private Functions
  ******************************************************************************/
 
+/**
+ * @brief Core state of the bound instance
+ */
+static bcm_core_t *bcm_core(void)
+{
+    return bcm_ctx_current()->core;
+}
+
+/**
+ * @brief Dispatch table entry of an ID, or NULL if unregistered
+ */
+static const bcm_rx_entry_t *rx_entry(uint32_t id)
+{
+    const bcm_core_t *core = bcm_core();
+    uint8_t slot = (id < CAN_ID_COUNT) ? core->rx_index[id] : 0U;
+    
+    return (slot == 0U) ? NULL : &core->rx_handlers[slot - 1U];
+}
+
 /**
  * @brief Route received CAN frame to appropriate handler
+ * @param bus Bus the frame came from (for its discard counters)
+ * @param flags CAN_CHECK_* flags from the entry's batch check (if it has one)
  */
-static void route_can_frame(const can_frame_t *frame)
+static void route_can_frame(const can_frame_t *frame, uint8_t bus, uint8_t flags)
 {
-    cmd_result_t result;
+    const bcm_rx_entry_t *entry = rx_entry(frame->id);
     
-    switch (frame->id) {
-        case CAN_ID_DOOR_CMD:
-            result = door_control_handle_cmd(frame);
-            (void)result;
-            break;
-            
-        case CAN_ID_LIGHTING_CMD:
-            result = lighting_control_handle_cmd(frame);
-            (void)result;
-            break;
-            
-        case CAN_ID_TURN_SIGNAL_CMD:
-            result = turn_signal_handle_cmd(frame);
-            (void)result;
-            break;
+    if (entry == NULL) {
+        can_bus_stats_rx_discard(bus, CAN_RX_UNKNOWN_ID);
+        bcm_trace_frame(BCM_TRACE_RX, frame, BCM_TRACE_RESULT_NONE);
+        return;
+    }
+    
+    if (frame->dlc != entry->dlc) {
+        can_bus_stats_rx_discard(bus, CAN_RX_BAD_DLC);
+        if (fault_manager_note(FAULT_CODE_INVALID_LENGTH)) {
+            uint8_t data[4] = { (uint8_t)CMD_RESULT_INVALID_CMD, frame->data[0], 0, 0 };
+            event_log_add(EVENT_CMD_ERROR, data);
+        }
+        bcm_trace_frame(BCM_TRACE_RX, frame, (uint8_t)CMD_RESULT_INVALID_CMD);
+        return;
+    }
+    
+    /* Recorded after the handler runs, so it follows any events it logged */
+    cmd_result_t result = (entry->check != NULL) ? entry->checked(frame, flags) :
+                                                   entry->handler(frame);
+    bcm_trace_frame(BCM_TRACE_RX, frame, (uint8_t)result);
+    
+    if (result != CMD_RESULT_OK) {
+        can_bus_stats_rx_discard(bus, CAN_RX_REJECTED);
+    }
+}
+
+/**
+ * @brief Validate and dispatch one received batch
+ *
+ * The frames of each built-in command ID are validated together by its
+ * batch check (can_check_batch()) before any handler runs. Checks touch
+ * only their own ID's rolling counter, so the flags are the same as if
+ * each frame were validated as it is handled. Frames then go to their
+ * handlers in arrival order.
+ */
+static void dispatch_batch(const can_frame_t *frames, uint8_t count, uint8_t bus)
+{
+    can_frame_t group[CAN_BATCH_MAX];
+    uint8_t group_flags[CAN_BATCH_MAX];
+    uint8_t at[CAN_BATCH_MAX];
+    uint8_t flags[CAN_BATCH_MAX];
+    uint16_t grouped = 0;
+    
+    for (uint8_t i = 0; i < count; i++) {
+        flags[i] = CAN_CHECK_OK;
+    }
+    
+    for (uint8_t i = 0; i < count; i++) {
+        const bcm_rx_entry_t *entry = rx_entry(frames[i].id);
+        if ((grouped & (1U << i)) != 0U || entry == NULL || entry->check == NULL) {
+            continue;
+        }
+        
+        uint8_t n = 0;
+        for (uint8_t j = i; j < count; j++) {
+            if (frames[j].id == frames[i].id) {
+                group[n] = frames[j];
+                at[n] = j;
+                n++;
+                grouped |= (uint16_t)(1U << j);
+            }
+        }
+        
+        /* A run of one ID (a flood, a replay burst) is checked in place */
+        bool contiguous = (at[n - 1U] == (uint8_t)(i + n - 1U));
+        entry->check(contiguous ? &frames[i] : group, n, group_flags);
+        for (uint8_t k = 0; k < n; k++) {
+            flags[at[k]] = group_flags[k];
+        }
+    }
+    
+    for (uint8_t i = 0; i < count; i++) {
+        route_can_frame(&frames[i], bus, flags[i]);
+    }
+}
+
+/**
+ * @brief Dispatch the frames received on every bus
+ *
+ * Buses take turns, one CAN_BATCH_MAX batch each, and a bus stops after
+ * one queue's worth (CAN_RX_QUEUE_SIZE) per call. A flooded gateway bus
+ * delays body-bus commands by at most one batch and cannot starve the
+ * tasks, even with a producer refilling its queue concurrently.
+ */
+static void rx_drain(void)
+{
+    can_frame_t rx_batch[CAN_BATCH_MAX];
+    uint32_t rx_total[CAN_BUS_MAX] = { 0 };
+    uint8_t buses = can_bus_count();
+    uint32_t active = (1U << buses) - 1U;   /* Buses that may hold more */
+    
+    while (active != 0U) {
+        for (uint8_t bus = 0; bus < buses; bus++) {
+            uint8_t rx_count;
+            if ((active & (1U << bus)) == 0U) {
+                continue;
+            }
+            if (can_bus_recv_batch(bus, rx_batch, CAN_BATCH_MAX, &rx_count) != CAN_STATUS_OK) {
+                active &= ~(1U << bus);
+                continue;
+            }
             
-        default:
-            /* Unknown message ID - ignore or log */
-            break;
+            dispatch_batch(rx_batch, rx_count, bus);
+            rx_total[bus] += rx_count;
+            if (rx_count < CAN_BATCH_MAX || rx_total[bus] >= CAN_RX_QUEUE_SIZE) {
+                active &= ~(1U << bus); /* Drained, skip the empty poll */
+            }
+        }
     }
 }
 
+#if !BCM_FEATURE_CAN_FD || BCM_FEATURE_TASK_TIMING
 /**
- * @brief Transmit all status frames
+ * @brief Send frames straight from the TX pool
+ *
+ * TX trace records are written by the CAN backend when a frame goes out,
+ * not here, so scheduled frames that get superseded are never traced.
  */
-static void transmit_status_frames(void)
+static void tx_send(const can_frame_t *frames, uint8_t count)
 {
-    can_frame_t frame;
+    (void)can_send_batch(frames, count, NULL);
+}
+#endif
+
+/**
+ * @brief Add or replace a dispatch table entry
+ * @param check Batch validator, or NULL for a plain handler
+ * @param checked Handler taking the check's flags (with check)
+ * @return 1 if a new ID was added, 0 if replaced, -1 on error
+ */
+static int dispatch_add(uint32_t id, uint8_t dlc, bcm_rx_handler_t handler,
+                        bcm_rx_check_t check, bcm_rx_checked_handler_t checked)
+{
+    if (id >= CAN_ID_COUNT || dlc > CAN_FRAME_MAX_DLC ||
+        (check == NULL ? handler == NULL : checked == NULL)) {
+        return -1;
+    }
+    
+    bcm_core_t *core = bcm_core();
+    int added = 0;
+    uint8_t slot = core->rx_index[id];
+    if (slot == 0U) {
+        if (core->rx_handler_count >= CAN_MAX_RX_HANDLERS) {
+            return -1;
+        }
+        core->rx_handler_count++;
+        slot = core->rx_handler_count;
+        core->rx_index[id] = slot;
+        added = 1;
+    }
+    
+    core->rx_handlers[slot - 1U].handler = handler;
+    core->rx_handlers[slot - 1U].check = check;
+    core->rx_handlers[slot - 1U].checked = checked;
+    core->rx_handlers[slot - 1U].id = id;
+    core->rx_handlers[slot - 1U].dlc = dlc;
+    return added;
+}
+
+/**
+ * @brief Limit CAN reception to the registered IDs
+ *
+ * On SocketCAN this moves the unknown-ID discard into the kernel.
+ */
+static void dispatch_apply_filter(void)
+{
+    const bcm_core_t *core = bcm_core();
+    uint32_t ids[CAN_MAX_RX_HANDLERS];
+    
+    for (uint8_t i = 0; i < core->rx_handler_count; i++) {
+        ids[i] = core->rx_handlers[i].id;
+    }
+    
+    if (can_set_rx_filter(ids, core->rx_handler_count) != CAN_STATUS_OK) {
+        BCM_LOG_WARN("[BCM] RX filter not installed, filtering in software\n");
+    }
+}
+
+/**
+ * @brief Clear the dispatch table and register the built-in commands
+ */
+static void dispatch_init(void)
+{
+    bcm_core_t *core = bcm_core();
+    
+    memset(core->rx_index, 0, sizeof(core->rx_index));
+    memset(core->rx_handlers, 0, sizeof(core->rx_handlers));
+    core->rx_handler_count = 0;
+    
+    (void)dispatch_add(CAN_ID_DOOR_CMD, DOOR_CMD_DLC, NULL,
+                       door_control_check_cmds, door_control_apply_cmd);
+    (void)dispatch_add(CAN_ID_LIGHTING_CMD, LIGHTING_CMD_DLC, NULL,
+                       lighting_control_check_cmds, lighting_control_apply_cmd);
+    (void)dispatch_add(CAN_ID_TURN_SIGNAL_CMD, TURN_SIGNAL_CMD_DLC, NULL,
+                       turn_signal_check_cmds, turn_signal_apply_cmd);
+    
+    dispatch_apply_filter();
+}
+
+/**
+ * @brief Build every TX frame template once
+ */
+static void tx_pool_init(void)
+{
+    can_frame_t *pool = bcm_core()->tx_pool;
+    
+    can_frame_template_init(&pool[BCM_TX_DOOR_STATUS], CAN_ID_DOOR_STATUS,
+                            DOOR_STATUS_DLC, CAN_CHECKSUM_SEED);
+    can_frame_template_init(&pool[BCM_TX_LIGHTING_STATUS], CAN_ID_LIGHTING_STATUS,
+                            LIGHTING_STATUS_DLC, CAN_CHECKSUM_SEED);
+    can_frame_template_init(&pool[BCM_TX_TURN_STATUS], CAN_ID_TURN_SIGNAL_STATUS,
+                            TURN_SIGNAL_STATUS_DLC, CAN_CHECKSUM_SEED);
+    can_frame_template_init(&pool[BCM_TX_FAULT_STATUS], CAN_ID_FAULT_STATUS,
+                            FAULT_STATUS_DLC, CAN_CHECKSUM_SEED);
+    can_frame_template_init(&pool[BCM_TX_HEARTBEAT], CAN_ID_BCM_HEARTBEAT,
+                            BCM_HEARTBEAT_DLC, CAN_CHECKSUM_SEED);
+#if BCM_FEATURE_CAN_FD
+    can_fd_frame_template_init(&bcm_core()->tx_aggregate, CAN_ID_BCM_AGGREGATE_STATUS,
+                               BCM_AGGREGATE_LEN, CAN_FD_FLAG_BRS, CAN_CHECKSUM_SEED);
+#endif
+}
+
+/**
+ * @brief Bring the heartbeat frame in the TX pool up to date
+ */
+static void update_heartbeat_frame(can_frame_t *frame)
+{
+    const system_state_t *state = sys_state_get();
+    system_state_t *mut_state = sys_state_get_mut();
+    
+    can_msg_bcm_heartbeat_t msg = {0};
+    msg.state = state->bcm_state;
+    msg.uptime_minutes = state->uptime_minutes;
+    
+    /* Only changed bytes are written; the checksum follows can_frame_put() */
+    can_msg_bcm_heartbeat_update(frame, &msg, mut_state->tx_counter_heartbeat);
+    mut_state->tx_counter_heartbeat = (mut_state->tx_counter_heartbeat + 1) & CAN_COUNTER_MASK;
+}
+
+#if BCM_FEATURE_CAN_FD
+
+_Static_assert(AGG_BYTE_LIGHTING == AGG_BYTE_DOOR + DOOR_STATUS_DLC &&
+               AGG_BYTE_TURN == AGG_BYTE_LIGHTING + LIGHTING_STATUS_DLC &&
+               AGG_BYTE_FAULT == AGG_BYTE_TURN + TURN_SIGNAL_STATUS_DLC &&
+               AGG_BYTE_HEARTBEAT == AGG_BYTE_FAULT + FAULT_STATUS_DLC &&
+               AGG_BYTE_RESERVED == AGG_BYTE_HEARTBEAT + BCM_HEARTBEAT_DLC &&
+               AGG_BYTE_RESERVED <= AGG_BYTE_CHECKSUM &&
+               AGG_BYTE_CHECKSUM == BCM_AGGREGATE_LEN - 1U,
+               "BCM_AGGREGATE_STATUS sections must follow the classic DLCs");
+
+/** First aggregate byte of each TX pool frame */
+static const uint8_t g_aggregate_offset[BCM_TX_COUNT] = {
+    [BCM_TX_DOOR_STATUS]     = AGG_BYTE_DOOR,
+    [BCM_TX_LIGHTING_STATUS] = AGG_BYTE_LIGHTING,
+    [BCM_TX_TURN_STATUS]     = AGG_BYTE_TURN,
+    [BCM_TX_FAULT_STATUS]    = AGG_BYTE_FAULT,
+    [BCM_TX_HEARTBEAT]       = AGG_BYTE_HEARTBEAT,
+};
+
+/**
+ * @brief Transmit one BCM_AGGREGATE_STATUS frame from the TX pool
+ *
+ * Fault and heartbeat sections are refreshed with every frame; the module
+ * sections hold whatever the caller last updated. The trace ring records
+ * classic frames only, so the aggregate frame is not traced.
+ */
+static void transmit_aggregate_status(void)
+{
+    bcm_core_t *core = bcm_core();
+    can_frame_t *pool = core->tx_pool;
+    can_fd_frame_t *agg = &core->tx_aggregate;
+    
+    fault_manager_update_status_frame(&pool[BCM_TX_FAULT_STATUS]);
+    update_heartbeat_frame(&pool[BCM_TX_HEARTBEAT]);
+    
+    /* Byte 0: Version and counter */
+    can_fd_frame_put(agg, AGG_BYTE_VER_CTR, CAN_BUILD_VER_CTR(
+        CAN_SCHEMA_VERSION, core->tx_counter_aggregate));
+    core->tx_counter_aggregate = (uint8_t)((core->tx_counter_aggregate + 1U) & CAN_COUNTER_MASK);
+    
+    /* Bytes 1-31: classic payloads; unchanged bytes cost a compare */
+    for (uint8_t slot = 0; slot < BCM_TX_COUNT; slot++) {
+        for (uint8_t b = 0; b < pool[slot].dlc; b++) {
+            can_fd_frame_put(agg, (uint8_t)(g_aggregate_offset[slot] + b), pool[slot].data[b]);
+        }
+    }
+    
+    /* Bytes 32-46 stay zero from the template; byte 47: checksum, kept
+     * current by can_fd_frame_put() */
+    (void)can_send_fd(agg);
+}
+
+#endif /* BCM_FEATURE_CAN_FD */
+
+/**
+ * @brief Transmit the selected status frames
+ * @param mask SYS_TX_DIRTY_* bits of the frames to send
+ */
+static void transmit_status_frames(uint8_t mask)
+{
+    can_frame_t *pool = bcm_core()->tx_pool;
     
     /* Door status */
-    door_control_build_status_frame(&frame);
-    can_send(&frame);
+    if ((mask & SYS_TX_DIRTY_DOOR) != 0U) {
+        door_control_update_status_frame(&pool[BCM_TX_DOOR_STATUS]);
+    }
     
     /* Lighting status */
-    lighting_control_build_status_frame(&frame);
-    can_send(&frame);
+    if ((mask & SYS_TX_DIRTY_LIGHTING) != 0U) {
+        lighting_control_update_status_frame(&pool[BCM_TX_LIGHTING_STATUS]);
+    }
     
     /* Turn signal status */
-    turn_signal_build_status_frame(&frame);
-    can_send(&frame);
+    if ((mask & SYS_TX_DIRTY_TURN) != 0U) {
+        turn_signal_update_status_frame(&pool[BCM_TX_TURN_STATUS]);
+    }
+
+#if BCM_FEATURE_CAN_FD
+    /* One aggregate frame instead of the classic status frames */
+    transmit_aggregate_status();
+#else
+    /* Send each run of adjacent selected slots straight from the pool */
+    uint8_t first = BCM_TX_DOOR_STATUS;
+    while (first <= BCM_TX_TURN_STATUS) {
+        if ((mask & (1U << first)) == 0U) {
+            first++;
+            continue;
+        }
+        
+        uint8_t end = (uint8_t)(first + 1U);
+        while (end <= BCM_TX_TURN_STATUS && (mask & (1U << end)) != 0U) {
+            end++;
+        }
+        
+        tx_send(&pool[first], (uint8_t)(end - first));
+        first = end;
+    }
+#endif
+    
+    /* Whatever was just sent is current again */
+    sys_state_get_mut()->tx_dirty &= (uint8_t)~mask;
 }
 
+#if !BCM_FEATURE_CAN_FD
 /**
  * @brief Transmit heartbeat frame
  */
 static void transmit_heartbeat(void)
 {
-    can_frame_t frame;
-    const system_state_t *state = sys_state_get();
-    system_state_t *mut_state = sys_state_get_mut();
+    can_frame_t *frame = &bcm_core()->tx_pool[BCM_TX_HEARTBEAT];
     
-    memset(&frame, 0, sizeof(frame));
-    frame.id = CAN_ID_BCM_HEARTBEAT;
-    frame.dlc = BCM_HEARTBEAT_DLC;
+    update_heartbeat_frame(frame);
+    tx_send(frame, 1);
+}
+#endif
+
+#if BCM_FEATURE_TASK_TIMING
+/**
+ * @brief Transmit one BCM_TIMING frame per timing slot
+ */
+static void transmit_timing(void)
+{
+    can_frame_t frames[BCM_TIMING_SLOT_COUNT];
     
-    /* Byte 0: BCM state */
-    frame.data[HEARTBEAT_BYTE_STATE] = (uint8_t)state->bcm_state;
+    for (uint8_t slot = 0; slot < BCM_TIMING_SLOT_COUNT; slot++) {
+        bcm_timing_build_frame(slot, &frames[slot]);
+    }
+    tx_send(frames, BCM_TIMING_SLOT_COUNT);
+}
+#endif
+
+#if !BCM_FEATURE_CAN_FD
+/**
+ * @brief Transmit fault status (less frequent)
+ */
+static void transmit_fault_status(void)
+{
+    can_frame_t *frame = &bcm_core()->tx_pool[BCM_TX_FAULT_STATUS];
     
-    /* Byte 1: Uptime (minutes) */
-    frame.data[HEARTBEAT_BYTE_UPTIME] = state->uptime_minutes;
+    fault_manager_update_status_frame(frame);
+    tx_send(frame, 1);
+}
+#endif
+
+/**
+ * @brief Wrap-safe check whether a deadline has been reached
+ */
+static bool deadline_reached(uint32_t now, uint32_t deadline)
+{
+    return (int32_t)(now - deadline) >= 0;
+}
+
+/**
+ * @brief Earliest next_due_ms in the task table
+ */
+static uint32_t sched_earliest(const bcm_core_t *core)
+{
+    uint32_t next = core->tasks[0].next_due_ms;
     
-    /* Byte 2: Version and counter */
-    frame.data[HEARTBEAT_BYTE_VER_CTR] = CAN_BUILD_VER_CTR(
-        CAN_SCHEMA_VERSION, mut_state->tx_counter_heartbeat);
-    mut_state->tx_counter_heartbeat = (mut_state->tx_counter_heartbeat + 1) & CAN_COUNTER_MASK;
+    for (uint8_t i = 1; i < BCM_TASK_COUNT; i++) {
+        if ((int32_t)(core->tasks[i].next_due_ms - next) < 0) {
+            next = core->tasks[i].next_due_ms;
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Anchor every task's first deadline to the first tick seen
+ */
+static void sched_start(uint32_t current_ms)
+{
+    bcm_core_t *core = bcm_core();
     
-    /* Byte 3: Checksum */
-    frame.data[HEARTBEAT_BYTE_CHECKSUM] = can_calculate_checksum(
-        frame.data, BCM_HEARTBEAT_DLC - 1);
+    for (uint8_t i = 0; i < BCM_TASK_COUNT; i++) {
+        core->tasks[i].next_due_ms = current_ms + g_task_defs[i].offset_ms;
+        core->tasks[i].overruns = 0;
+        core->tasks[i].late_runs = 0;
+    }
+    core->sched_next_ms = sched_earliest(core);
+
+#if BCM_FEATURE_TICKLESS
+    core->fast_slot_ms = core->tasks[BCM_TASK_10MS].next_due_ms;
+#endif
+
+#if BCM_FEATURE_SEND_ON_CHANGE
+    /* First status task run sends the keep-alive */
+    core->status_floor_ms = current_ms - CAN_STATUS_KEEPALIVE_PERIOD_MS;
+#endif
     
-    can_send(&frame);
+    can_stats_sample_load(current_ms); /* Opens the first bus load window */
+    core->sched_started = true;
 }
 
 /**
- * @brief Transmit fault status (less frequent)
+ * @brief Run every task whose deadline has been reached
+ *
+ * Skipped entirely until the earliest deadline. A task that fell behind by
+ * one or more whole periods runs once, counts the missed periods as
+ * overruns and keeps its phase. Any run after its deadline counts as late.
+ *
+ * @return Bit (1 << BCM_TASK_*) of every task that ran
  */
-static void transmit_fault_status(void)
+static uint8_t sched_run(uint32_t current_ms)
 {
-    can_frame_t frame;
-    fault_manager_build_status_frame(&frame);
-    can_send(&frame);
+    bcm_core_t *core = bcm_core();
+    uint8_t ran = 0;
+    
+    if (!deadline_reached(current_ms, core->sched_next_ms)) {
+        return 0;
+    }
+    
+    for (uint8_t i = 0; i < BCM_TASK_COUNT; i++) {
+        const bcm_task_def_t *def = &g_task_defs[i];
+        bcm_task_t *task = &core->tasks[i];
+        
+        if (deadline_reached(current_ms, task->next_due_ms)) {
+            uint32_t late = current_ms - task->next_due_ms;
+            uint32_t missed = late / def->period_ms;
+            
+            task->overruns += missed;
+            if (late > 0U) {
+                task->late_runs++;
+            }
+            task->next_due_ms += (missed + 1U) * def->period_ms;
+            
+            BCM_TIMING_BEGIN(start_ns);
+            def->fn(current_ms);
+            BCM_TIMING_END(i, start_ns);
+            ran |= (uint8_t)(1U << i);
+
+#if BCM_FEATURE_TICKLESS
+            if (i == BCM_TASK_10MS) {
+                core->fast_slot_ms = task->next_due_ms;
+            }
+#endif
+        }
+    }
+    
+    core->sched_next_ms = sched_earliest(core);
+    return ran;
+}
+
+#if BCM_FEATURE_TICKLESS
+
+/**
+ * @brief Earliest deadline of the modules updated by the 10ms task
+ */
+static uint32_t fast_modules_deadline(uint32_t current_ms)
+{
+    uint32_t next = door_control_next_deadline(current_ms);
+    uint32_t deadline = lighting_control_next_deadline(current_ms);
+    
+    if ((int32_t)(deadline - next) < 0) {
+        next = deadline;
+    }
+    deadline = turn_signal_next_deadline(current_ms);
+    if ((int32_t)(deadline - next) < 0) {
+        next = deadline;
+    }
+    return next;
 }
 
+/**
+ * @brief Move the 10ms task to the first slot at or after its modules' deadline
+ *
+ * Slots stay on the task's phase grid and never precede fast_slot_ms, the
+ * slot after its last run, so skipped slots count neither as late nor as
+ * overruns. Re-evaluated every bcm_process() call, after the RX drain, so
+ * commands and direct module calls pull the task back in.
+ */
+static void sched_defer_fast(uint32_t current_ms)
+{
+    bcm_core_t *core = bcm_core();
+    uint32_t period = g_task_defs[BCM_TASK_10MS].period_ms;
+    uint32_t slot = core->fast_slot_ms;
+    uint32_t deadline = fast_modules_deadline(current_ms);
+    
+    if (!deadline_reached(slot, deadline)) {
+        slot += ((deadline - slot + period - 1U) / period) * period;
+    }
+    
+    if (slot != core->tasks[BCM_TASK_10MS].next_due_ms) {
+        core->tasks[BCM_TASK_10MS].next_due_ms = slot;
+        core->sched_next_ms = sched_earliest(core);
+    }
+}
+
+#endif /* BCM_FEATURE_TICKLESS */
+
 /*******************************************************************************
  * Public Functions
  ******************************************************************************/
 
 int bcm_init(const char *can_ifname)
 {
-    printf("========================================\n");
-    printf("  BCM - Body Control Module\n");
-    printf("  Version: %s\n", BCM_VERSION_STRING);
-    printf("========================================\n\n");
+    BCM_LOG_INFO("========================================\n");
+    BCM_LOG_INFO("  BCM - Body Control Module\n");
+    BCM_LOG_INFO("  Version: " BCM_VERSION_STRING "\n");
+    BCM_LOG_INFO("========================================\n\n");
     
     /* Initialize system state */
     sys_state_init();
     
     /* Initialize CAN interface */
     if (can_init(can_ifname) != CAN_STATUS_OK) {
-        printf("[BCM] CAN init failed\n");
+        BCM_LOG_ERROR("[BCM] CAN init failed\n");
+        bcm_log_flush();
         return -1;
     }
     
@@ -146,64 +646,114 @@ int bcm_init(const char *can_ifname)
     turn_signal_init();
     fault_manager_init();
     
+    /* Fault counters and recent events of earlier runs */
+    uint32_t restored = bcm_store_restore();
+    if (restored > 0U) {
+        BCM_LOG_INFO("[BCM] Restored %u events from the store\n", restored);
+    }
+    
+    /* Register command handlers */
+    dispatch_init();
+    
+    /* Prebuild TX frames */
+    tx_pool_init();
+    bcm_timing_reset();
+    
     /* Set BCM to normal state */
     sys_state_get_mut()->bcm_state = BCM_STATE_NORMAL;
     
     /* Log state change */
     uint8_t data[4] = { BCM_STATE_INIT, BCM_STATE_NORMAL, 0, 0 };
     event_log_add(EVENT_STATE_CHANGE, data);
+    sys_state_publish();
     
-    g_initialized = true;
-    printf("[BCM] Initialized successfully\n\n");
+    bcm_core_t *core = bcm_core();
+    core->sched_started = false;
+    core->initialized = true;
+    BCM_LOG_INFO("[BCM] Initialized successfully\n\n");
+    bcm_log_flush();
     
     return 0;
 }
 
 void bcm_deinit(void)
 {
-    if (!g_initialized) {
+    bcm_core_t *core = bcm_core();
+    
+    if (!core->initialized) {
         return;
     }
     
+    /* Partly filled page included: shutdown loses no history */
+    if (bcm_store_release() != 0) {
+        BCM_LOG_ERROR("[BCM] Store write failed\n");
+    }
+    
     can_deinit();
-    g_initialized = false;
+    core->initialized = false;
     
-    printf("[BCM] Deinitialized\n");
+    BCM_LOG_INFO("[BCM] Deinitialized\n");
+    bcm_log_flush();
 }
 
-int bcm_process(uint32_t current_ms)
+int bcm_register_rx_handler(uint32_t id, uint8_t dlc, bcm_rx_handler_t handler)
 {
-    if (!g_initialized) {
+    int added = dispatch_add(id, dlc, handler, NULL, NULL);
+    if (added < 0) {
         return -1;
     }
     
-    system_state_t *state = sys_state_get_mut();
+    if (added > 0) {
+        dispatch_apply_filter();
+    }
+    return 0;
+}
+
+int bcm_process(uint32_t current_ms)
+{
+    bcm_core_t *core = bcm_core();
+    
+    if (!core->initialized) {
+        return -1;
+    }
     
     /* Update system time */
     sys_state_update_time(current_ms);
     
-    /* Poll for received CAN frames */
-    can_frame_t frame;
-    while (can_recv(&frame) == CAN_STATUS_OK) {
-        route_can_frame(&frame);
-    }
+    /* Status frames held back by a full TX queue or socket */
+    (void)can_tx_service();
     
-    /* 10ms tasks */
-    if ((current_ms - state->last_10ms_tick) >= 10) {
-        state->last_10ms_tick = current_ms;
-        bcm_process_10ms(current_ms);
-    }
+    /* Drain received CAN frames of all buses, bounded per bus */
+    BCM_TIMING_BEGIN(rx_start_ns);
+    rx_drain();
+    BCM_TIMING_END(BCM_TIMING_RX_DRAIN, rx_start_ns);
     
-    /* 100ms tasks */
-    if ((current_ms - state->last_100ms_tick) >= 100) {
-        state->last_100ms_tick = current_ms;
-        bcm_process_100ms(current_ms);
+    /* Periodic tasks */
+    if (!core->sched_started) {
+        sched_start(current_ms);
+    }
+#if BCM_FEATURE_TICKLESS
+    sched_defer_fast(current_ms);
+#endif
+    uint8_t ran = sched_run(current_ms);
+#if BCM_FEATURE_TICKLESS
+    if ((ran & (1U << BCM_TASK_10MS)) != 0U) {
+        sched_defer_fast(current_ms); /* Deadlines after this run */
+    }
+#endif
+
+#if BCM_FEATURE_SEND_ON_CHANGE
+    /* Status changed by this tick's commands or state machines: send now */
+    uint8_t dirty = sys_state_get()->tx_dirty;
+    if (dirty != 0U) {
+        transmit_status_frames(dirty);
     }
+#endif
     
-    /* 1000ms tasks */
-    if ((current_ms - state->last_1000ms_tick) >= 1000) {
-        state->last_1000ms_tick = current_ms;
-        bcm_process_1000ms(current_ms);
+    /* Readers on other threads see the state as of the end of the tick.
+     * Any task counts: a tickless 10ms task may idle for seconds. */
+    if (ran != 0U) {
+        sys_state_publish();
     }
     
     return 0;
@@ -211,28 +761,60 @@ int bcm_process(uint32_t current_ms)
 
 void bcm_process_10ms(uint32_t current_ms)
 {
-    /* Fast state machine updates */
-    door_control_update(current_ms);
-    lighting_control_update(current_ms);
-    turn_signal_update(current_ms);
+    /* Fast state machine updates, skipping modules with nothing due */
+    if (deadline_reached(current_ms, door_control_next_deadline(current_ms))) {
+        door_control_update(current_ms);
+    }
+    if (deadline_reached(current_ms, lighting_control_next_deadline(current_ms))) {
+        lighting_control_update(current_ms);
+    }
+    if (deadline_reached(current_ms, turn_signal_next_deadline(current_ms))) {
+        turn_signal_update(current_ms);
+    }
 }
 
 void bcm_process_100ms(uint32_t current_ms)
 {
     /* Transmit status frames */
-    transmit_status_frames();
+#if BCM_FEATURE_SEND_ON_CHANGE
+    /* Changes go out from bcm_process(); this is only the keep-alive floor */
+    bcm_core_t *core = bcm_core();
+    if ((uint32_t)(current_ms - core->status_floor_ms) >= CAN_STATUS_KEEPALIVE_PERIOD_MS) {
+        transmit_status_frames(SYS_TX_DIRTY_ALL);
+        core->status_floor_ms = current_ms;
+    }
+#else
+    transmit_status_frames(SYS_TX_DIRTY_ALL);
+#endif
     
     /* Fault manager update */
     fault_manager_update(current_ms);
 }
 
+void bcm_process_500ms(uint32_t current_ms)
+{
+    (void)current_ms;
+
+#if !BCM_FEATURE_CAN_FD
+    /* Transmit fault status (a section of the aggregate frame with CAN FD) */
+    transmit_fault_status();
+#endif
+}
+
 void bcm_process_1000ms(uint32_t current_ms)
 {
-    /* Transmit heartbeat */
+    /* Bus load of the last second */
+    can_stats_sample_load(current_ms);
+
+#if BCM_FEATURE_TASK_TIMING
+    /* Execution times up to the previous run of this task */
+    transmit_timing();
+#endif
+
+#if !BCM_FEATURE_CAN_FD
+    /* Transmit heartbeat, last frame of the 1000ms slot */
     transmit_heartbeat();
-    
-    /* Transmit fault status (every 500ms, but we do it here for simplicity) */
-    transmit_fault_status();
+#endif
     
     /* Check timeouts */
     turn_signal_check_timeout(current_ms);
@@ -242,11 +824,43 @@ void bcm_process_1000ms(uint32_t current_ms)
     if (fault_manager_get_count() > 0 && state->bcm_state == BCM_STATE_NORMAL) {
         /* Could transition to FAULT state if critical faults present */
     }
+    
+    /* Events staged over the last second, in whole flash pages */
+    bcm_store_process();
+    
+    /* Format the log messages queued over the last second */
+    bcm_log_flush();
+}
+
+uint32_t bcm_next_deadline_ms(void)
+{
+    const bcm_core_t *core = bcm_core();
+    
+    if (!core->sched_started) {
+        return sys_state_get()->uptime_ms; /* First tick starts the table */
+    }
+    return core->sched_next_ms;
+}
+
+uint32_t bcm_get_task_overruns(bcm_task_id_t task)
+{
+    if (task >= BCM_TASK_COUNT) {
+        return 0;
+    }
+    return bcm_core()->tasks[task].overruns;
+}
+
+uint32_t bcm_get_task_late_runs(bcm_task_id_t task)
+{
+    if (task >= BCM_TASK_COUNT) {
+        return 0;
+    }
+    return bcm_core()->tasks[task].late_runs;
 }
 
 bcm_state_t bcm_get_state(void)
 {
-    return sys_state_get()->bcm_state;
+    return (bcm_state_t)sys_state_get()->bcm_state;
 }
 
 const char* bcm_get_version(void)
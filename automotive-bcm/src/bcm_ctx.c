@@ -0,0 +1,316 @@
+/**
+ * @file bcm_ctx.c
+ * @brief BCM Instance Management
+ *
+ * The default instance is static so the classic single-BCM build needs
+ * no heap. Extra instances are allocated with BCM_CTX_ALIGN alignment:
+ * the hot state starts on a cache line and the stub CAN rings keep their
+ * indices on separate ones.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "bcm_ctx_internal.h"
+
+_Static_assert(sizeof(system_state_t) <= SYS_STATE_HOT_SIZE,
+               "system_state_t must stay within one cache line");
+
+/*******************************************************************************
+ * Private Types
+ ******************************************************************************/
+
+/** Stand-alone instance: handle first, so free(ctx) releases the block */
+typedef struct {
+    bcm_ctx_t       ctx;
+    bcm_ctx_block_t block;
+} bcm_ctx_alloc_t;
+
+struct bcm_ctx_pool {
+    uint32_t        count;
+    bcm_ctx_t       *ctx;           /**< count handles */
+    system_state_t  *state;         /**< count hot blocks, back to back */
+    bcm_core_t      *core;
+    can_backend_t   *can;
+    sys_cold_state_t *cold;
+    fault_state_t   *fault;
+    event_log_t     *event_log;
+};
+
+/*******************************************************************************
+ * Private Data
+ ******************************************************************************/
+
+static bcm_ctx_block_t g_ctx_default_block;
+
+static bcm_ctx_t g_ctx_default = {
+    .state      = &g_ctx_default_block.state,
+    .core       = &g_ctx_default_block.core,
+    .can        = &g_ctx_default_block.can,
+    .cold       = &g_ctx_default_block.cold,
+    .fault      = &g_ctx_default_block.fault,
+    .event_log  = &g_ctx_default_block.event_log,
+    .owned      = false,
+};
+
+/** NULL = default instance */
+static _Thread_local bcm_ctx_t *g_ctx_bound = NULL;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+/**
+ * @brief Zeroed, BCM_CTX_ALIGN aligned allocation of count elements
+ */
+static void *alloc_zeroed(size_t count, size_t size)
+{
+    /* aligned_alloc() needs a size that is a multiple of the alignment */
+    size_t bytes = (count * size + BCM_CTX_ALIGN - 1U) & ~(size_t)(BCM_CTX_ALIGN - 1U);
+    
+    void *mem = aligned_alloc(BCM_CTX_ALIGN, bytes);
+    if (mem != NULL) {
+        memset(mem, 0, bytes);
+    }
+    return mem;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+bcm_ctx_t *bcm_ctx_create(void)
+{
+    bcm_ctx_alloc_t *mem = alloc_zeroed(1U, sizeof(bcm_ctx_alloc_t));
+    if (mem == NULL) {
+        return NULL;
+    }
+    
+    bcm_ctx_t *ctx = &mem->ctx;
+    ctx->state = &mem->block.state;
+    ctx->core = &mem->block.core;
+    ctx->can = &mem->block.can;
+    ctx->cold = &mem->block.cold;
+    ctx->fault = &mem->block.fault;
+    ctx->event_log = &mem->block.event_log;
+    ctx->owned = true;
+    return ctx;
+}
+
+void bcm_ctx_destroy(bcm_ctx_t *ctx)
+{
+    if (ctx == NULL || !ctx->owned) {
+        return;
+    }
+    
+    bcm_ctx_deinit(ctx);
+    if (g_ctx_bound == ctx) {
+        g_ctx_bound = NULL;
+    }
+    free(ctx);
+}
+
+bcm_ctx_pool_t *bcm_ctx_pool_create(uint32_t count)
+{
+    if (count == 0U) {
+        return NULL;
+    }
+    
+    bcm_ctx_pool_t *pool = calloc(1U, sizeof(*pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    
+    pool->count = count;
+    pool->ctx = alloc_zeroed(count, sizeof(bcm_ctx_t));
+    pool->state = alloc_zeroed(count, sizeof(system_state_t));
+    pool->core = alloc_zeroed(count, sizeof(bcm_core_t));
+    pool->can = alloc_zeroed(count, sizeof(can_backend_t));
+    pool->cold = alloc_zeroed(count, sizeof(sys_cold_state_t));
+    pool->fault = alloc_zeroed(count, sizeof(fault_state_t));
+    pool->event_log = alloc_zeroed(count, sizeof(event_log_t));
+    
+    if (pool->ctx == NULL || pool->state == NULL || pool->core == NULL ||
+        pool->can == NULL || pool->cold == NULL || pool->fault == NULL ||
+        pool->event_log == NULL) {
+        pool->count = 0; /* Nothing to deinit */
+        bcm_ctx_pool_destroy(pool);
+        return NULL;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        bcm_ctx_t *ctx = &pool->ctx[i];
+        ctx->state = &pool->state[i];
+        ctx->core = &pool->core[i];
+        ctx->can = &pool->can[i];
+        ctx->cold = &pool->cold[i];
+        ctx->fault = &pool->fault[i];
+        ctx->event_log = &pool->event_log[i];
+        ctx->owned = false;
+    }
+    return pool;
+}
+
+bcm_ctx_t *bcm_ctx_pool_get(bcm_ctx_pool_t *pool, uint32_t index)
+{
+    if (pool == NULL || index >= pool->count) {
+        return NULL;
+    }
+    return &pool->ctx[index];
+}
+
+void bcm_ctx_pool_destroy(bcm_ctx_pool_t *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < pool->count; i++) {
+        bcm_ctx_deinit(&pool->ctx[i]);
+        if (g_ctx_bound == &pool->ctx[i]) {
+            g_ctx_bound = NULL;
+        }
+    }
+    
+    free(pool->ctx);
+    free(pool->state);
+    free(pool->core);
+    free(pool->can);
+    free(pool->cold);
+    free(pool->fault);
+    free(pool->event_log);
+    free(pool);
+}
+
+bcm_ctx_t *bcm_ctx_default(void)
+{
+    return &g_ctx_default;
+}
+
+bcm_ctx_t *bcm_ctx_current(void)
+{
+    return (g_ctx_bound != NULL) ? g_ctx_bound : &g_ctx_default;
+}
+
+bcm_ctx_t *bcm_ctx_bind(bcm_ctx_t *ctx)
+{
+    bcm_ctx_t *prev = bcm_ctx_current();
+    g_ctx_bound = ctx;
+    return prev;
+}
+
+int bcm_ctx_init(bcm_ctx_t *ctx, const char *can_ifname)
+{
+    if (ctx == NULL) {
+        return -1;
+    }
+    
+    bcm_ctx_t *prev = bcm_ctx_bind(ctx);
+    int result = bcm_init(can_ifname);
+    (void)bcm_ctx_bind(prev);
+    return result;
+}
+
+void bcm_ctx_deinit(bcm_ctx_t *ctx)
+{
+    if (ctx == NULL) {
+        return;
+    }
+    
+    bcm_ctx_t *prev = bcm_ctx_bind(ctx);
+    bcm_deinit();
+    (void)bcm_ctx_bind(prev);
+}
+
+int bcm_ctx_process(bcm_ctx_t *ctx, uint32_t current_ms)
+{
+    if (ctx == NULL) {
+        return -1;
+    }
+    
+    bcm_ctx_t *prev = bcm_ctx_bind(ctx);
+    int result = bcm_process(current_ms);
+    (void)bcm_ctx_bind(prev);
+    return result;
+}
+
+int bcm_ctx_register_rx_handler(bcm_ctx_t *ctx, uint32_t id, uint8_t dlc,
+                                bcm_rx_handler_t handler)
+{
+    if (ctx == NULL) {
+        return -1;
+    }
+    
+    bcm_ctx_t *prev = bcm_ctx_bind(ctx);
+    int result = bcm_register_rx_handler(id, dlc, handler);
+    (void)bcm_ctx_bind(prev);
+    return result;
+}
+
+uint32_t bcm_ctx_next_deadline_ms(bcm_ctx_t *ctx)
+{
+    if (ctx == NULL) {
+        return 0;
+    }
+    
+    bcm_ctx_t *prev = bcm_ctx_bind(ctx);
+    uint32_t deadline = bcm_next_deadline_ms();
+    (void)bcm_ctx_bind(prev);
+    return deadline;
+}
+
+const system_state_t *bcm_ctx_state(const bcm_ctx_t *ctx)
+{
+    return (ctx != NULL) ? ctx->state : NULL;
+}
+
+uint32_t bcm_ctx_snapshot(bcm_ctx_t *ctx, system_state_t *out)
+{
+    if (ctx == NULL) {
+        return 0;
+    }
+    
+    bcm_ctx_t *prev = bcm_ctx_bind(ctx);
+    uint32_t count = sys_state_snapshot(out);
+    (void)bcm_ctx_bind(prev);
+    return count;
+}
+
+#ifndef BCM_SIL
+
+can_status_t bcm_ctx_inject_rx(bcm_ctx_t *ctx, const can_frame_t *frame)
+{
+    if (ctx == NULL) {
+        return CAN_STATUS_NOT_INITIALIZED;
+    }
+    
+    bcm_ctx_t *prev = bcm_ctx_bind(ctx);
+    can_status_t status = can_stub_inject_rx(frame);
+    (void)bcm_ctx_bind(prev);
+    return status;
+}
+
+uint8_t bcm_ctx_drain_tx(bcm_ctx_t *ctx, can_frame_t *frames, uint8_t max_frames)
+{
+    if (ctx == NULL) {
+        return 0;
+    }
+    
+    bcm_ctx_t *prev = bcm_ctx_bind(ctx);
+    uint8_t count = can_stub_drain_tx(frames, max_frames);
+    (void)bcm_ctx_bind(prev);
+    return count;
+}
+
+uint8_t bcm_ctx_drain_tx_fd(bcm_ctx_t *ctx, can_fd_frame_t *frames, uint8_t max_frames)
+{
+    if (ctx == NULL) {
+        return 0;
+    }
+    
+    bcm_ctx_t *prev = bcm_ctx_bind(ctx);
+    uint8_t count = can_stub_drain_tx_fd(frames, max_frames);
+    (void)bcm_ctx_bind(prev);
+    return count;
+}
+
+#endif /* !BCM_SIL */
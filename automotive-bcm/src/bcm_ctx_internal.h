@@ -0,0 +1,249 @@
+/**
+ * @file bcm_ctx_internal.h
+ * @brief BCM Instance Layout (library internal)
+ *
+ * Everything one BCM instance owns: system state, the core's dispatch
+ * table, scheduler and TX pool, the CAN buses, and the cold module
+ * state, fault store and event log. Only the library sources include this file; applications
+ * hold the opaque bcm_ctx_t from bcm_ctx.h. Plain C11 (stdatomic), not for
+ * C++ translation units.
+ *
+ * A bcm_ctx_t only points at its blocks. A single instance keeps them
+ * together in one bcm_ctx_block_t; a pool (bcm_ctx_pool_create()) keeps
+ * one array per block type, so a sweep over many instances reads the hot
+ * system_state_t blocks back to back.
+ */
+
+#ifndef BCM_CTX_INTERNAL_H
+#define BCM_CTX_INTERNAL_H
+
+#include <stdatomic.h>
+#ifdef BCM_SIL
+#include <pthread.h>
+#endif
+#include "bcm_ctx.h"
+#include "bcm.h"
+#include "system_state.h"
+#include "can_interface.h"
+#include "can_ids.h"
+#include "bcm_timing.h"
+#include "bcm_config.h"
+
+#define BCM_CTX_ALIGN       64U     /**< Cache line; hot blocks start on one */
+
+/*******************************************************************************
+ * BCM Core
+ ******************************************************************************/
+
+/** Batch validator of a built-in command: CAN_CHECK_* flags per frame */
+typedef void (*bcm_rx_check_t)(const can_frame_t *frames, uint8_t count, uint8_t *flags);
+
+/** Handler of a built-in command, given the flags from its bcm_rx_check_t */
+typedef cmd_result_t (*bcm_rx_checked_handler_t)(const can_frame_t *frame, uint8_t flags);
+
+typedef struct {
+    bcm_rx_handler_t            handler;    /**< Used when check is NULL */
+    bcm_rx_check_t              check;      /**< Built-in commands only */
+    bcm_rx_checked_handler_t    checked;    /**< Handler after check */
+    uint32_t                    id;         /**< Registered CAN ID */
+    uint8_t                     dlc;        /**< Expected DLC */
+} bcm_rx_entry_t;
+
+/** TX pool slots; the 100ms status frames are contiguous for one batch.
+ *  Status slot n matches SYS_TX_DIRTY_* bit n. */
+typedef enum {
+    BCM_TX_DOOR_STATUS = 0,
+    BCM_TX_LIGHTING_STATUS,
+    BCM_TX_TURN_STATUS,
+    BCM_TX_FAULT_STATUS,
+    BCM_TX_HEARTBEAT,
+    BCM_TX_COUNT
+} bcm_tx_slot_t;
+
+/** Run-time part of a scheduler entry; period and phase are shared */
+typedef struct {
+    uint32_t        next_due_ms;    /**< Absolute deadline of next run */
+    uint32_t        overruns;       /**< Full periods missed */
+    uint32_t        late_runs;      /**< Runs that started after their deadline */
+} bcm_task_t;
+
+/** Words of a published system_state_t copy */
+#define SYS_SNAPSHOT_WORDS  ((sizeof(system_state_t) + 3U) / 4U)
+
+/**
+ * Seqlock-published copy of system_state_t (sys_state_publish()).
+ *
+ * One writer, the thread running the instance; readers on any thread.
+ * seq is odd while a copy is in progress and advances by two per
+ * publication. The copy is kept in relaxed atomic words, so a reader
+ * racing the writer gets a torn copy, which it discards when seq was odd
+ * or changed around its read, but never a data race.
+ */
+typedef struct {
+    _Alignas(BCM_CTX_ALIGN) atomic_uint_least32_t seq;
+    atomic_uint_least32_t   words[SYS_SNAPSHOT_WORDS];
+} sys_snapshot_t;
+
+/** Per-tick scheduler fields first, the 2KB RX index and timing last */
+typedef struct {
+    bool            initialized;
+    bool            sched_started;
+    uint8_t         rx_handler_count;
+    uint32_t        sched_next_ms;      /**< Earliest next_due_ms in table */
+    uint32_t        status_floor_ms;    /**< Last keep-alive status send */
+#if BCM_FEATURE_TICKLESS
+    uint32_t        fast_slot_ms;       /**< 10ms slot after the last run */
+#endif
+    
+    /* Periodic task table */
+    bcm_task_t      tasks[BCM_TASK_COUNT];
+    
+    /* One persistent frame per TX message, built from templates at init */
+    can_frame_t     tx_pool[BCM_TX_COUNT];
+#if BCM_FEATURE_CAN_FD
+    can_fd_frame_t  tx_aggregate;       /**< Sections copied from tx_pool */
+    uint8_t         tx_counter_aggregate;
+#endif
+    
+    /* RX dispatch: ID -> slot index (0 = unregistered) -> handler entry */
+    bcm_rx_entry_t  rx_handlers[CAN_MAX_RX_HANDLERS];
+    uint8_t         rx_index[CAN_ID_COUNT];
+    
+    /* State copy for readers on other threads, after each task run */
+    sys_snapshot_t  snapshot;
+
+#if BCM_FEATURE_TASK_TIMING
+    /* Execution time statistics, read once a second */
+    bcm_timing_stats_t  timing[BCM_TIMING_SLOT_COUNT];
+    uint8_t         tx_counter_timing;
+#endif
+} bcm_core_t;
+
+/*******************************************************************************
+ * CAN Backend
+ ******************************************************************************/
+
+#define CAN_RING_ALIGN      64      /**< Keeps head and tail on separate cache lines */
+
+/**
+ * Single-producer/single-consumer ring.
+ *
+ * head and tail are free-running; (tail - head) is the fill level and
+ * (index & mask) the slot. Only the producer stores tail and only the
+ * consumer stores head, so one producer thread/ISR and the BCM loop can
+ * run concurrently without a lock.
+ */
+typedef struct {
+    _Alignas(CAN_RING_ALIGN) atomic_uint_fast32_t head;  /**< Consumer index */
+    _Alignas(CAN_RING_ALIGN) atomic_uint_fast32_t tail;  /**< Producer index */
+    uint32_t        mask;                                /**< size - 1 */
+    can_frame_t     *frames;
+} can_ring_t;
+
+/**
+ * Relaxed-atomic counterparts of can_stats_t. Every counter has a single
+ * writer (the BCM loop, or the RX producer for rx_dropped in stub mode and
+ * rx_dropped/rx_errors of a bus with an RX thread), so updates are a
+ * relaxed load and store; other threads may read them at any time.
+ */
+typedef struct {
+    atomic_uint_least32_t   tx_count;
+    atomic_uint_least32_t   rx_count;
+    atomic_uint_least32_t   tx_errors;
+    atomic_uint_least32_t   rx_errors;
+    atomic_uint_least32_t   tx_dropped;
+    atomic_uint_least32_t   tx_coalesced;
+    atomic_uint_least32_t   rx_dropped;
+    atomic_uint_least32_t   rx_unknown_id;
+    atomic_uint_least32_t   rx_bad_dlc;
+    atomic_uint_least32_t   rx_rejected;
+    atomic_uint_least32_t   id_overflow;
+    atomic_uint_least32_t   bus_bits;       /**< Last closed window */
+    atomic_uint_least32_t   bus_load_x10;
+    atomic_uint_least32_t   window_bits;    /**< Open window */
+    uint32_t                window_start_ms;
+    bool                    window_open;
+} can_counters_t;
+
+/** Per-ID slot, open addressing on the 11-bit ID */
+typedef struct {
+    atomic_uint_least32_t   key;            /**< id + 1, 0 = free */
+    atomic_uint_least32_t   rx_count;
+    atomic_uint_least32_t   tx_count;
+    atomic_uint_least32_t   last_rx_ms;
+    atomic_uint_least32_t   last_tx_ms;
+} can_id_counter_t;
+
+/** One CAN bus: socket or stub queues, TX scheduler, filter and statistics */
+typedef struct {
+    bool            initialized;
+    can_counters_t  stats;
+    can_id_counter_t id_stats[CAN_STATS_ID_SLOTS];
+    can_frame_t     tx_pending[CAN_TX_PENDING_SIZE];    /**< Lowest ID first */
+    uint8_t         tx_pending_count;
+    
+    /* Stub: filled by can_stub_inject_rx*(). SIL: by the RX thread. */
+    can_frame_t     rx_frames[CAN_RX_QUEUE_SIZE];
+    can_ring_t      rx_queue;
+
+#ifdef BCM_SIL
+    int             socket_fd;
+    uint32_t        rx_ovfl_last;       /**< Last SO_RXQ_OVFL drop count */
+    bool            fd_enabled;         /**< CAN_RAW_FD_FRAMES on an FD interface */
+    
+    /* RX thread (can_start_rx_threads()): socket -> rx_queue */
+    bool            rx_threaded;
+    pthread_t       rx_thread;
+    int             rx_event_fd;        /**< eventfd, set after frames are queued */
+    int             rx_stop_fd;         /**< eventfd, ends the RX thread */
+#else
+    can_frame_t     tx_frames[CAN_TX_QUEUE_SIZE];
+    can_ring_t      tx_queue;
+    can_frame_t     last_tx;
+    bool            last_tx_valid;
+    uint32_t        rx_filter[CAN_RX_FILTER_MAX];
+    int             rx_filter_count;    /**< -1 = accept all */
+    can_fd_frame_t  tx_fd_frames[CAN_TX_FD_QUEUE_SIZE];
+    uint8_t         tx_fd_count;        /**< Queued, oldest first */
+#endif
+} can_port_t;
+
+/** TX route of one ID to a bus other than bus 0 */
+typedef struct {
+    uint16_t        id;
+    uint8_t         bus;
+} can_tx_route_t;
+
+/** All buses of an instance; bus 0 is the first interface given to can_init() */
+typedef struct {
+    can_port_t      ports[CAN_BUS_MAX];
+    uint8_t         bus_count;
+    uint8_t         route_count;
+    can_tx_route_t  routes[CAN_TX_ROUTE_MAX];
+} can_backend_t;
+
+/*******************************************************************************
+ * Instance
+ ******************************************************************************/
+
+/** Storage of one stand-alone instance */
+typedef struct {
+    _Alignas(BCM_CTX_ALIGN) system_state_t state;
+    bcm_core_t      core;
+    can_backend_t   can;
+    sys_cold_state_t cold;
+    fault_state_t   fault;
+    event_log_t     event_log;
+} bcm_ctx_block_t;
+
+struct bcm_ctx {
+    system_state_t  *state;         /**< Hot, one cache line */
+    bcm_core_t      *core;
+    can_backend_t   *can;
+    sys_cold_state_t *cold;         /**< Cold */
+    fault_state_t   *fault;         /**< Cold */
+    event_log_t     *event_log;     /**< Cold */
+    bool            owned;          /**< Freed by bcm_ctx_destroy() */
+};
+
+#endif /* BCM_CTX_INTERNAL_H */
@@ -0,0 +1,127 @@
+/**
+ * @file bcm_flash_file.c
+ * @brief File-Backed Flash Device for the Persistent Store
+ *
+ * Pages live at page * page_size in an ordinary file. Erase fills a page
+ * with 0xFF and program is pwrite() followed by fdatasync(), so a page
+ * that bcm_store_sync() reported written survives a crash of the host.
+ * Built for Linux hosts only (BCM_FEATURE_FLASH_FILE).
+ */
+
+#define _DEFAULT_SOURCE     /* pread/pwrite/fdatasync under -std=c11 */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bcm_store.h"
+#include "bcm_config.h"
+
+#define FLASH_ERASED        0xFFU
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static int file_fd(const bcm_flash_t *flash)
+{
+    return (int)(intptr_t)flash->dev;
+}
+
+static int file_read(const bcm_flash_t *flash, uint32_t page, void *buf)
+{
+    off_t offset = (off_t)page * (off_t)flash->page_size;
+    ssize_t n = pread(file_fd(flash), buf, flash->page_size, offset);
+    return (n == (ssize_t)flash->page_size) ? 0 : -1;
+}
+
+static int file_program(const bcm_flash_t *flash, uint32_t page, const void *data)
+{
+    off_t offset = (off_t)page * (off_t)flash->page_size;
+    ssize_t n = pwrite(file_fd(flash), data, flash->page_size, offset);
+    if (n != (ssize_t)flash->page_size) {
+        return -1;
+    }
+    return (fdatasync(file_fd(flash)) == 0) ? 0 : -1;
+}
+
+/**
+ * @brief Fill a byte range of the file with the erased value
+ */
+static int file_fill_erased(int fd, off_t pos, off_t end)
+{
+    uint8_t erased[256];
+    
+    memset(erased, FLASH_ERASED, sizeof(erased));
+    while (pos < end) {
+        size_t chunk = (end - pos < (off_t)sizeof(erased)) ? (size_t)(end - pos) : sizeof(erased);
+        ssize_t n = pwrite(fd, erased, chunk, pos);
+        if (n <= 0) {
+            return -1;
+        }
+        pos += n;
+    }
+    return 0;
+}
+
+static int file_erase(const bcm_flash_t *flash, uint32_t page)
+{
+    off_t offset = (off_t)page * (off_t)flash->page_size;
+    return file_fill_erased(file_fd(flash), offset, offset + (off_t)flash->page_size);
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+int bcm_flash_file_open(bcm_flash_t *flash, const char *path, uint32_t page_size,
+                        uint32_t page_count)
+{
+    if (flash == NULL || path == NULL) {
+        return -1;
+    }
+    
+    if (page_size == 0U) {
+        page_size = BCM_STORE_FILE_PAGE_SIZE;
+    }
+    if (page_count == 0U) {
+        page_count = BCM_STORE_FILE_PAGE_COUNT;
+    }
+    if (page_size > BCM_STORE_PAGE_MAX) {
+        return -1;
+    }
+    
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    /* Pages past the old end of the file start out erased */
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (file_fill_erased(fd, st.st_size, (off_t)page_size * (off_t)page_count) != 0) {
+        close(fd);
+        return -1;
+    }
+    
+    flash->page_size = page_size;
+    flash->page_count = page_count;
+    flash->read = file_read;
+    flash->program = file_program;
+    flash->erase = file_erase;
+    flash->dev = (void *)(intptr_t)fd; /* File descriptor */
+    return 0;
+}
+
+void bcm_flash_file_close(bcm_flash_t *flash)
+{
+    if (flash == NULL || flash->read != file_read) {
+        return;
+    }
+    
+    close(file_fd(flash));
+    memset(flash, 0, sizeof(*flash));
+}
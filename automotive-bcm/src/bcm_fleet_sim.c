@@ -0,0 +1,502 @@
+/**
+ * @file bcm_fleet_sim.c
+ * @brief Multi-Threaded Fleet Simulator
+ *
+ * Steps N independent BCM instances (bcm_ctx.h) on a shared virtual clock,
+ * one BCM_MAIN_CYCLE_TIME_MS tick at a time, across a pool of worker
+ * threads. Each worker owns a contiguous shard of instances and steals
+ * unclaimed instances from the other shards once its own is done. An
+ * instance is claimed by exactly one worker per tick, so its stub RX/TX
+ * queues are only touched by that thread and need no synchronization.
+ *
+ * Instances are grouped into buses. Frames an instance transmits in one
+ * tick are delivered as one batch to every other instance on its bus at
+ * the start of the next tick; outboxes are double-buffered by tick parity
+ * so the tick barrier is the only synchronization point.
+ *
+ * With -s the instances come from one bcm_ctx_pool_create() block
+ * (struct-of-arrays), so the sweep streams through their hot state.
+ *
+ * Reports aggregate frames per wall-clock second and per-tick latency
+ * percentiles (one tick = the whole fleet stepped once).
+ */
+
+#define _DEFAULT_SOURCE     /* fdopen/dup/clock_gettime under -std=c11 */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bcm.h"
+#include "bcm_ctx.h"
+#include "can_interface.h"
+#include "can_ids.h"
+#include "bcm_config.h"
+
+/*******************************************************************************
+ * Configuration
+ ******************************************************************************/
+
+#define FLEET_CACHE_LINE        64U
+#define FLEET_DEFAULT_NODES     64U
+#define FLEET_DEFAULT_MS        10000U
+#define FLEET_DEFAULT_BUS_SIZE  4U
+#define FLEET_DEFAULT_CMD_MS    100U
+#define FLEET_MAX_WORKERS       256U
+
+/*******************************************************************************
+ * Private Types
+ ******************************************************************************/
+
+typedef struct {
+    _Alignas(FLEET_CACHE_LINE) bcm_ctx_t *ctx;
+    uint8_t     counter;                            /**< Stimulus rolling counter */
+    uint8_t     cmd;                                /**< Next stimulus door command */
+    uint8_t     outbox_count[2];
+    can_frame_t outbox[2][CAN_TX_QUEUE_SIZE];       /**< TX of the last two ticks */
+    uint64_t    rx_frames;
+    uint64_t    tx_frames;
+    uint64_t    rx_dropped;                         /**< Peer frames that found RX full */
+} fleet_node_t;
+
+/** Tick barrier from a mutex and condition variable (macOS has no POSIX barriers) */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  released;
+    uint32_t        parties;
+    uint32_t        waiting;
+    uint32_t        phase;      /**< Bumped each time the barrier opens */
+} fleet_barrier_t;
+
+typedef struct {
+    _Alignas(FLEET_CACHE_LINE) atomic_uint next;    /**< Next unclaimed node of the shard */
+    uint32_t    begin;
+    uint32_t    end;
+    uint32_t    index;
+    uint64_t    steals;
+    pthread_t   thread;
+} fleet_worker_t;
+
+/*******************************************************************************
+ * Private Data
+ ******************************************************************************/
+
+static fleet_node_t     *g_nodes = NULL;
+static uint32_t         g_node_count = FLEET_DEFAULT_NODES;
+static fleet_worker_t   *g_workers = NULL;
+static uint32_t         g_worker_count = 0;
+static uint32_t         g_bus_size = FLEET_DEFAULT_BUS_SIZE;
+static uint32_t         g_cmd_ticks = 0;        /**< 0 = no stimulus */
+
+static fleet_barrier_t  g_tick_start;
+static fleet_barrier_t  g_tick_end;
+static uint32_t         g_tick = 0;             /**< Written by worker 0 between barriers */
+static uint32_t         g_tick_count = 0;
+static bool             g_stop = false;
+static uint64_t         *g_tick_ns = NULL;      /**< Wall time of each tick */
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Allocate zeroed, cache-line aligned memory
+ */
+static void *alloc_aligned(size_t size)
+{
+    size = (size + FLEET_CACHE_LINE - 1U) & ~(size_t)(FLEET_CACHE_LINE - 1U);
+    void *mem = aligned_alloc(FLEET_CACHE_LINE, size);
+    if (mem != NULL) {
+        memset(mem, 0, size);
+    }
+    return mem;
+}
+
+static void barrier_init(fleet_barrier_t *barrier, uint32_t parties)
+{
+    (void)pthread_mutex_init(&barrier->lock, NULL);
+    (void)pthread_cond_init(&barrier->released, NULL);
+    barrier->parties = parties;
+    barrier->waiting = 0;
+    barrier->phase = 0;
+}
+
+static void barrier_destroy(fleet_barrier_t *barrier)
+{
+    (void)pthread_cond_destroy(&barrier->released);
+    (void)pthread_mutex_destroy(&barrier->lock);
+}
+
+/**
+ * @brief Block until all parties have arrived
+ *
+ * The mutex orders every write made before the barrier ahead of every
+ * read made after it, as a POSIX barrier would.
+ */
+static void barrier_wait(fleet_barrier_t *barrier)
+{
+    (void)pthread_mutex_lock(&barrier->lock);
+    uint32_t phase = barrier->phase;
+    
+    if (++barrier->waiting == barrier->parties) {
+        barrier->waiting = 0;
+        barrier->phase++;
+        (void)pthread_cond_broadcast(&barrier->released);
+    } else {
+        while (barrier->phase == phase) {
+            (void)pthread_cond_wait(&barrier->released, &barrier->lock);
+        }
+    }
+    (void)pthread_mutex_unlock(&barrier->lock);
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Nearest-rank percentile of a sorted array, in microseconds
+ */
+static double percentile_us(const uint64_t *sorted, uint32_t count, uint32_t pct)
+{
+    if (count == 0U) {
+        return 0.0;
+    }
+    
+    uint32_t rank = (uint32_t)(((uint64_t)count * pct + 99U) / 100U);
+    if (rank == 0U) {
+        rank = 1U;
+    }
+    return (double)sorted[rank - 1U] / 1000.0;
+}
+
+/*******************************************************************************
+ * Simulation
+ ******************************************************************************/
+
+/**
+ * @brief Queue the periodic door lock/unlock stimulus for the bound node
+ */
+static void inject_stimulus(fleet_node_t *node)
+{
+    can_frame_t frame;
+    can_frame_template_init(&frame, CAN_ID_DOOR_CMD, DOOR_CMD_DLC, CAN_CHECKSUM_SEED);
+    can_frame_put(&frame, DOOR_CMD_BYTE_CMD, node->cmd);
+    can_frame_put(&frame, DOOR_CMD_BYTE_DOOR_ID, DOOR_ID_ALL);
+    can_frame_put(&frame, DOOR_CMD_BYTE_VER_CTR,
+                  CAN_BUILD_VER_CTR(CAN_SCHEMA_VERSION, node->counter));
+    
+    if (can_stub_inject_rx(&frame) == CAN_STATUS_OK) {
+        node->rx_frames++;
+    }
+    node->counter = (uint8_t)((node->counter + 1U) & CAN_COUNTER_MASK);
+    node->cmd = (node->cmd == DOOR_CMD_LOCK_ALL) ? DOOR_CMD_UNLOCK_ALL : DOOR_CMD_LOCK_ALL;
+}
+
+/**
+ * @brief Run one tick of one node: deliver bus traffic, process, collect TX
+ */
+static void step_node(uint32_t index, uint32_t tick)
+{
+    fleet_node_t *node = &g_nodes[index];
+    uint32_t in = (tick + 1U) & 1U;
+    uint32_t out = tick & 1U;
+    
+    bcm_ctx_t *prev = bcm_ctx_bind(node->ctx);
+    
+    /* Last tick's TX of every other node on this bus, one batch per peer */
+    uint32_t bus_first = (index / g_bus_size) * g_bus_size;
+    uint32_t bus_end = bus_first + g_bus_size;
+    if (bus_end > g_node_count) {
+        bus_end = g_node_count;
+    }
+    for (uint32_t p = bus_first; p < bus_end; p++) {
+        const fleet_node_t *peer = &g_nodes[p];
+        uint8_t count = peer->outbox_count[in];
+        if (p == index || count == 0U) {
+            continue;
+        }
+        
+        uint8_t injected = 0;
+        (void)can_stub_inject_rx_batch(peer->outbox[in], count, &injected);
+        node->rx_frames += injected;
+        node->rx_dropped += (uint64_t)(count - injected);
+    }
+    
+    if (g_cmd_ticks != 0U && ((tick + index) % g_cmd_ticks) == 0U) {
+        inject_stimulus(node);
+    }
+    
+    (void)bcm_process(tick * BCM_MAIN_CYCLE_TIME_MS);
+    
+    node->outbox_count[out] = can_stub_drain_tx(node->outbox[out], CAN_TX_QUEUE_SIZE);
+    node->tx_frames += node->outbox_count[out];
+    
+    (void)bcm_ctx_bind(prev);
+}
+
+/**
+ * @brief Claim the next unprocessed node of a shard
+ * @return true if a node was claimed
+ */
+static bool claim_node(fleet_worker_t *shard, uint32_t *index)
+{
+    /* Visibility of node data across ticks comes from the tick barriers */
+    uint32_t i = atomic_fetch_add_explicit(&shard->next, 1U, memory_order_relaxed);
+    if (i >= shard->end) {
+        return false;
+    }
+    *index = i;
+    return true;
+}
+
+/**
+ * @brief Process the own shard, then steal from the others in ring order
+ */
+static void run_tick(fleet_worker_t *self, uint32_t tick)
+{
+    uint32_t index;
+    
+    while (claim_node(self, &index)) {
+        step_node(index, tick);
+    }
+    
+    for (uint32_t k = 1U; k < g_worker_count; k++) {
+        fleet_worker_t *victim = &g_workers[(self->index + k) % g_worker_count];
+        while (claim_node(victim, &index)) {
+            step_node(index, tick);
+            self->steals++;
+        }
+    }
+}
+
+/**
+ * @brief Worker loop; worker 0 runs on the main thread and keeps the clock
+ */
+static void *worker_main(void *arg)
+{
+    fleet_worker_t *self = (fleet_worker_t *)arg;
+    
+    for (;;) {
+        barrier_wait(&g_tick_start);
+        if (g_stop) {
+            break;
+        }
+        
+        uint64_t start = (self->index == 0U) ? now_ns() : 0U;
+        uint32_t tick = g_tick;
+        run_tick(self, tick);
+        barrier_wait(&g_tick_end);
+        
+        if (self->index == 0U) {
+            g_tick_ns[tick] = now_ns() - start;
+            for (uint32_t w = 0; w < g_worker_count; w++) {
+                atomic_store_explicit(&g_workers[w].next, g_workers[w].begin,
+                                      memory_order_relaxed);
+            }
+            g_tick = tick + 1U;
+            g_stop = (g_tick >= g_tick_count);
+        }
+    }
+    
+    return NULL;
+}
+
+/*******************************************************************************
+ * Usage
+ ******************************************************************************/
+
+static void print_usage(const char *prog_name)
+{
+    printf("Usage: %s [options]\n", prog_name);
+    printf("Options:\n");
+    printf("  -n <count>      BCM instances (default: %u)\n", FLEET_DEFAULT_NODES);
+    printf("  -w <count>      Worker threads (default: online CPUs)\n");
+    printf("  -d <ms>         Virtual time to simulate (default: %u)\n", FLEET_DEFAULT_MS);
+    printf("  -b <count>      Instances per CAN bus (default: %u)\n", FLEET_DEFAULT_BUS_SIZE);
+    printf("  -c <ms>         Door command period per instance, 0 = none (default: %u)\n",
+           FLEET_DEFAULT_CMD_MS);
+    printf("  -s              Struct-of-arrays instance pool (default: one block each)\n");
+    printf("  -q              Discard BCM log output (default: to stderr)\n");
+    printf("  -h              Show this help\n");
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    uint32_t duration_ms = FLEET_DEFAULT_MS;
+    uint32_t cmd_ms = FLEET_DEFAULT_CMD_MS;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    bool quiet = false;
+    bool soa = false;
+    
+    g_worker_count = (cpus > 0) ? (uint32_t)cpus : 1U;
+    
+    /* Parse arguments */
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && (i + 1) < argc) {
+            g_node_count = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-w") == 0 && (i + 1) < argc) {
+            g_worker_count = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-d") == 0 && (i + 1) < argc) {
+            duration_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-b") == 0 && (i + 1) < argc) {
+            g_bus_size = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-c") == 0 && (i + 1) < argc) {
+            cmd_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-q") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "-s") == 0) {
+            soa = true;
+        } else if (strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (g_node_count == 0U || g_bus_size == 0U || duration_ms < BCM_MAIN_CYCLE_TIME_MS) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (g_worker_count == 0U || g_worker_count > FLEET_MAX_WORKERS) {
+        g_worker_count = (g_worker_count == 0U) ? 1U : FLEET_MAX_WORKERS;
+    }
+    if (g_worker_count > g_node_count) {
+        g_worker_count = g_node_count;
+    }
+    g_tick_count = duration_ms / BCM_MAIN_CYCLE_TIME_MS;
+    g_cmd_ticks = (cmd_ms + BCM_MAIN_CYCLE_TIME_MS - 1U) / BCM_MAIN_CYCLE_TIME_MS;
+    
+    /* The report gets its own stream; module log output is moved off stdout */
+    int fd = dup(STDOUT_FILENO);
+    FILE *out = (fd >= 0) ? fdopen(fd, "w") : NULL;
+    if (out == NULL) {
+        perror("[FLEET] open output");
+        return 1;
+    }
+    if (quiet) {
+        if (freopen("/dev/null", "w", stdout) == NULL) {
+            perror("[FLEET] /dev/null");
+        }
+    } else {
+        fflush(stdout);
+        (void)dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+    
+    g_nodes = alloc_aligned((size_t)g_node_count * sizeof(fleet_node_t));
+    g_workers = alloc_aligned((size_t)g_worker_count * sizeof(fleet_worker_t));
+    g_tick_ns = calloc(g_tick_count, sizeof(uint64_t));
+    if (g_nodes == NULL || g_workers == NULL || g_tick_ns == NULL) {
+        fprintf(stderr, "[FLEET] Out of memory\n");
+        return 1;
+    }
+    
+    bcm_ctx_pool_t *pool = NULL;
+    if (soa && (pool = bcm_ctx_pool_create(g_node_count)) == NULL) {
+        fprintf(stderr, "[FLEET] Out of memory\n");
+        return 1;
+    }
+    
+    for (uint32_t i = 0; i < g_node_count; i++) {
+        g_nodes[i].ctx = soa ? bcm_ctx_pool_get(pool, i) : bcm_ctx_create();
+        g_nodes[i].cmd = DOOR_CMD_LOCK_ALL;
+        if (bcm_ctx_init(g_nodes[i].ctx, NULL) != 0) {
+            fprintf(stderr, "[FLEET] BCM instance %u initialization failed\n", i);
+            return 1;
+        }
+    }
+    
+    /* Contiguous shards keep each bus mostly on one worker */
+    for (uint32_t w = 0; w < g_worker_count; w++) {
+        fleet_worker_t *worker = &g_workers[w];
+        worker->index = w;
+        worker->begin = (uint32_t)(((uint64_t)g_node_count * w) / g_worker_count);
+        worker->end = (uint32_t)(((uint64_t)g_node_count * (w + 1U)) / g_worker_count);
+        atomic_init(&worker->next, worker->begin);
+    }
+    
+    barrier_init(&g_tick_start, g_worker_count);
+    barrier_init(&g_tick_end, g_worker_count);
+    
+    uint64_t wall_start = now_ns();
+    
+    for (uint32_t w = 1U; w < g_worker_count; w++) {
+        if (pthread_create(&g_workers[w].thread, NULL, worker_main, &g_workers[w]) != 0) {
+            fprintf(stderr, "[FLEET] Cannot start worker %u\n", w);
+            return 1;
+        }
+    }
+    (void)worker_main(&g_workers[0]);
+    for (uint32_t w = 1U; w < g_worker_count; w++) {
+        (void)pthread_join(g_workers[w].thread, NULL);
+    }
+    
+    double wall_s = (double)(now_ns() - wall_start) / 1e9;
+    
+    /* Aggregate */
+    uint64_t rx = 0;
+    uint64_t tx = 0;
+    uint64_t dropped = 0;
+    for (uint32_t i = 0; i < g_node_count; i++) {
+        rx += g_nodes[i].rx_frames;
+        tx += g_nodes[i].tx_frames;
+        dropped += g_nodes[i].rx_dropped;
+    }
+    uint64_t steals = 0;
+    for (uint32_t w = 0; w < g_worker_count; w++) {
+        steals += g_workers[w].steals;
+    }
+    
+    qsort(g_tick_ns, g_tick_count, sizeof(uint64_t), compare_u64);
+    
+    fprintf(out, "[FLEET] %u instances (%s), %u workers, %u per bus, %u ticks (%.3f s virtual)\n",
+            g_node_count, soa ? "pool" : "separate", g_worker_count, g_bus_size, g_tick_count,
+            (double)(g_tick_count * BCM_MAIN_CYCLE_TIME_MS) / 1000.0);
+    fprintf(out, "[FLEET] %llu RX frames, %llu TX frames, %llu RX dropped, %llu steals\n",
+            (unsigned long long)rx, (unsigned long long)tx,
+            (unsigned long long)dropped, (unsigned long long)steals);
+    fprintf(out, "[FLEET] %.3f s wall, %.0f frames/s, %.1fx real time\n",
+            wall_s, (wall_s > 0.0) ? (double)(rx + tx) / wall_s : 0.0,
+            (wall_s > 0.0) ? ((double)(g_tick_count * BCM_MAIN_CYCLE_TIME_MS) / 1000.0) / wall_s : 0.0);
+    fprintf(out, "[FLEET] tick latency us: p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+            percentile_us(g_tick_ns, g_tick_count, 50U),
+            percentile_us(g_tick_ns, g_tick_count, 90U),
+            percentile_us(g_tick_ns, g_tick_count, 99U),
+            percentile_us(g_tick_ns, g_tick_count, 100U));
+    
+    for (uint32_t i = 0; i < g_node_count; i++) {
+        bcm_ctx_destroy(g_nodes[i].ctx); /* No-op for pool members */
+    }
+    bcm_ctx_pool_destroy(pool);
+    barrier_destroy(&g_tick_start);
+    barrier_destroy(&g_tick_end);
+    free(g_tick_ns);
+    free(g_workers);
+    free(g_nodes);
+    fclose(out);
+    
+    return 0;
+}
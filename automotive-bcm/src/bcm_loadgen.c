@@ -0,0 +1,775 @@
+/**
+ * @file bcm_loadgen.c
+ * @brief End-to-End Load Generator (SocketCAN)
+ *
+ * Drives a running bcm_app (-i <ifname>) over a real or virtual CAN bus
+ * and measures it from the outside, the way a gateway sees it:
+ *
+ * - Filler traffic at a fixed frame rate from a weighted command mix,
+ *   valid commands and the malformed frames of can_simulator.py
+ *   (wrong DLC, bad checksum, bad command).
+ * - Door lock/unlock probes, one in flight at a time. Latency runs from
+ *   the probe on the bus to the first DOOR_STATUS (or CAN FD aggregate)
+ *   showing the new lock state. Both ends are kernel receive timestamps
+ *   (SO_TIMESTAMPING); the probe's comes from its own loopback copy.
+ * - With -S, a rate sweep that raises the rate step by step until the
+ *   BCM loses frames and reports the last clean rate.
+ *
+ * The BCM's RX drops are not visible on the bus, but their effect is:
+ * a lost frame breaks the rolling counter sequence and the next command
+ * of that ID is answered with CMD_RESULT_COUNTER_ERROR in its status
+ * frame. The generator keeps every counter in sequence itself, so any
+ * counter error (or a lost probe) during a step counts as a drop.
+ * Malformed frames only advance the counter when the BCM accepts their
+ * DLC and checksum, as can_check.h does.
+ */
+
+#define _GNU_SOURCE     /* struct ifreq, SO_TIMESTAMPING */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include "can_messages.h"
+#include "can_ids.h"
+#include "bcm_config.h"
+
+#undef CAN_MAX_DLC      /* Same value in <linux/can.h> */
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+/*******************************************************************************
+ * Configuration
+ ******************************************************************************/
+
+#define LOAD_DEFAULT_IFNAME     "vcan0"
+#define LOAD_DEFAULT_RATE       500U        /**< Filler frames/s */
+#define LOAD_DEFAULT_MS         10000U      /**< Run (or sweep step) length */
+#define LOAD_DEFAULT_PROBE_MS   200U        /**< Minimum probe spacing */
+#define LOAD_DEFAULT_MIX        "light=1,turn=1"
+#define LOAD_MAX_RATE           100000U
+#define LOAD_SWEEP_GROWTH_PCT   125U        /**< Rate of the next sweep step */
+#define LOAD_PROBE_TIMEOUT_MS   1000U       /**< Unanswered probe counts as lost */
+#define LOAD_SETTLE_MS          300U        /**< Quiet time after counter sync */
+#define LOAD_POLL_MS            1           /**< Pacing granularity */
+#define LOAD_MAX_SAMPLES        65536U
+#define LOAD_RX_BATCH           64U
+
+_Static_assert(sizeof(can_frame_t) == CAN_MTU, "can_frame_t must match struct can_frame");
+_Static_assert(sizeof(can_fd_frame_t) == CANFD_MTU, "can_fd_frame_t must match struct canfd_frame");
+
+/*******************************************************************************
+ * Private Types
+ ******************************************************************************/
+
+/** Filler frame kinds (-m) */
+typedef enum {
+    LOAD_LIGHT = 0,
+    LOAD_TURN,
+    LOAD_WRONG_DLC,
+    LOAD_BAD_CHECKSUM,
+    LOAD_BAD_COMMAND,
+    LOAD_KIND_COUNT
+} load_kind_t;
+
+/** Command IDs, index of the rolling counter the generator keeps */
+typedef enum {
+    LOAD_CMD_DOOR = 0,
+    LOAD_CMD_LIGHT,
+    LOAD_CMD_TURN,
+    LOAD_CMD_COUNT
+} load_cmd_t;
+
+typedef struct {
+    uint64_t    sent[LOAD_KIND_COUNT];
+    uint64_t    probes_sent;
+    uint64_t    probes_lost;
+    uint64_t    tx_errors;          /**< write() failed (e.g. ENOBUFS: TX queue full) */
+    uint64_t    status_rx;
+    uint64_t    status_bad;         /**< Status frames failing their descriptor */
+    uint64_t    counter_errors;     /**< Status frames reporting COUNTER_ERROR */
+    uint64_t    local_drops;        /**< Frames our own socket buffer lost */
+    uint32_t    samples;            /**< Latencies in g_latency_ns */
+} load_stats_t;
+
+typedef struct {
+    bool        pending;
+    uint8_t     cmd;                /**< DOOR_CMD_LOCK_ALL or DOOR_CMD_UNLOCK_ALL */
+    uint8_t     expected_locks;     /**< DOOR_STATUS lock bits once executed */
+    can_frame_t frame;              /**< As sent, to recognize the loopback copy */
+    uint64_t    bus_ns;             /**< On the bus (realtime), 0 until seen */
+    uint64_t    sent_mono_ns;
+    uint64_t    next_mono_ns;       /**< Earliest time for the next probe */
+} load_probe_t;
+
+/*******************************************************************************
+ * Private Data
+ ******************************************************************************/
+
+static const char *const g_kind_names[LOAD_KIND_COUNT] = {
+    "light", "turn", "wrong_dlc", "bad_checksum", "bad_command",
+};
+
+static int          g_fd = -1;
+static bool         g_fd_frames = false;    /**< CAN FD aggregate reception enabled */
+static uint8_t      g_counter[LOAD_CMD_COUNT];
+static uint32_t     g_weights[LOAD_KIND_COUNT];
+static uint32_t     g_weight_total = 0;
+static uint32_t     g_rng = 0x2545F491U;
+static uint32_t     g_bad_target = 0;       /**< Round robin over command IDs */
+static uint32_t     g_ovfl_last = 0;
+static uint32_t     g_probe_ms = LOAD_DEFAULT_PROBE_MS;
+static load_probe_t g_probe;
+static load_stats_t g_stats;
+static uint64_t     g_latency_ns[LOAD_MAX_SAMPLES];
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static uint64_t clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Nearest-rank percentile of a sorted array, in microseconds
+ * @param permille Rank in 1/1000 (500 = p50, 999 = p99.9)
+ */
+static double percentile_us(const uint64_t *sorted, uint32_t count, uint32_t permille)
+{
+    if (count == 0U) {
+        return 0.0;
+    }
+    
+    uint32_t rank = (uint32_t)(((uint64_t)count * permille + 999U) / 1000U);
+    if (rank == 0U) {
+        rank = 1U;
+    }
+    return (double)sorted[rank - 1U] / 1000.0;
+}
+
+static uint32_t next_random(void)
+{
+    /* xorshift32: a fixed, reproducible mix sequence */
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 17;
+    g_rng ^= g_rng << 5;
+    return g_rng;
+}
+
+/**
+ * @brief Parse "kind=weight,..." into g_weights
+ * @return true if at least one kind has a weight
+ */
+static bool parse_mix(const char *spec)
+{
+    char buf[256];
+    memset(g_weights, 0, sizeof(g_weights));
+    g_weight_total = 0;
+    
+    if (strlen(spec) >= sizeof(buf)) {
+        return false;
+    }
+    strcpy(buf, spec);
+    
+    for (char *save = NULL, *item = strtok_r(buf, ",", &save); item != NULL;
+         item = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(item, '=');
+        uint32_t weight = 1U;
+        if (eq != NULL) {
+            *eq = '\0';
+            weight = (uint32_t)strtoul(eq + 1, NULL, 10);
+        }
+        
+        uint32_t kind = 0;
+        while (kind < LOAD_KIND_COUNT && strcmp(item, g_kind_names[kind]) != 0) {
+            kind++;
+        }
+        if (kind == LOAD_KIND_COUNT) {
+            fprintf(stderr, "[LOAD] Unknown mix kind: %s\n", item);
+            return false;
+        }
+        g_weights[kind] += weight;
+        g_weight_total += weight;
+    }
+    
+    return g_weight_total > 0U;
+}
+
+static load_kind_t pick_kind(void)
+{
+    uint32_t r = next_random() % g_weight_total;
+    uint32_t kind = 0;
+    while (r >= g_weights[kind]) {
+        r -= g_weights[kind];
+        kind++;
+    }
+    return (load_kind_t)kind;
+}
+
+/*******************************************************************************
+ * Socket
+ ******************************************************************************/
+
+/**
+ * @brief Raw CAN socket: own frames looped back, kernel RX timestamps,
+ *        drop counter, and only the frames the measurement needs
+ */
+static int open_socket(const char *ifname)
+{
+    int fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (fd < 0) {
+        perror("[LOAD] socket");
+        return -1;
+    }
+    
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+    if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0) {
+        perror("[LOAD] SIOCGIFINDEX");
+        close(fd);
+        return -1;
+    }
+    
+    int one = 1;
+    int stamping = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(fd, SOL_CAN_RAW, CAN_RAW_RECV_OWN_MSGS, &one, sizeof(one)) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &stamping, sizeof(stamping)) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one)) < 0) {
+        perror("[LOAD] setsockopt");
+        close(fd);
+        return -1;
+    }
+    
+    /* Aggregate status of BCM_CAN_FD=ON builds; classic-only interfaces refuse */
+    g_fd_frames = (setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &one, sizeof(one)) == 0);
+    
+    const struct can_filter filters[] = {
+        { CAN_ID_DOOR_CMD, CAN_SFF_MASK },          /* Loopback of our probes */
+        { CAN_ID_DOOR_STATUS, CAN_SFF_MASK },
+        { CAN_ID_LIGHTING_STATUS, CAN_SFF_MASK },
+        { CAN_ID_TURN_SIGNAL_STATUS, CAN_SFF_MASK },
+        { CAN_ID_FAULT_STATUS, CAN_SFF_MASK },
+        { CAN_ID_BCM_AGGREGATE_STATUS, CAN_SFF_MASK },
+    };
+    if (setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FILTER, filters, sizeof(filters)) < 0) {
+        perror("[LOAD] CAN_RAW_FILTER");
+        close(fd);
+        return -1;
+    }
+    
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("[LOAD] bind");
+        close(fd);
+        return -1;
+    }
+    
+    return fd;
+}
+
+static bool send_frame(const can_frame_t *frame)
+{
+    if (write(g_fd, frame, sizeof(*frame)) != (ssize_t)sizeof(*frame)) {
+        g_stats.tx_errors++;
+        return false;
+    }
+    return true;
+}
+
+/*******************************************************************************
+ * Frame Builders
+ ******************************************************************************/
+
+/**
+ * @brief Valid, state-neutral command (repeats leave the BCM state as is)
+ */
+static void build_valid(load_cmd_t cmd, can_frame_t *frame)
+{
+    uint8_t counter = g_counter[cmd];
+    
+    if (cmd == LOAD_CMD_DOOR) {
+        can_msg_door_cmd_t msg = { g_probe.cmd, DOOR_ID_ALL };
+        can_msg_door_cmd_encode(frame, &msg, counter);
+    } else if (cmd == LOAD_CMD_LIGHT) {
+        can_msg_lighting_cmd_t msg = { HEADLIGHT_CMD_ON, INTERIOR_CMD_OFF, 0 };
+        can_msg_lighting_cmd_encode(frame, &msg, counter);
+    } else {
+        can_msg_turn_signal_cmd_t msg = { TURN_CMD_OFF };
+        can_msg_turn_signal_cmd_encode(frame, &msg, counter);
+    }
+}
+
+/**
+ * @brief Send one valid command, advancing its counter once it is on the bus
+ */
+static bool send_valid(load_cmd_t cmd)
+{
+    can_frame_t frame;
+    build_valid(cmd, &frame);
+    if (!send_frame(&frame)) {
+        return false;
+    }
+    g_counter[cmd] = (uint8_t)((g_counter[cmd] + 1U) & CAN_COUNTER_MASK);
+    return true;
+}
+
+/**
+ * @brief Malformed frame on the next command ID in turn
+ */
+static void send_malformed(load_kind_t kind)
+{
+    load_cmd_t cmd = (load_cmd_t)(g_bad_target++ % LOAD_CMD_COUNT);
+    can_frame_t frame;
+    build_valid(cmd, &frame);
+    
+    bool advances = false;
+    if (kind == LOAD_WRONG_DLC) {
+        frame.dlc = 2U;
+    } else if (kind == LOAD_BAD_CHECKSUM) {
+        frame.data[frame.dlc - 1U] ^= 0xFFU;
+    } else {
+        /* 0xFF is out of range for every command byte; checksum stays valid */
+        uint8_t old = frame.data[0];
+        frame.data[0] = 0xFFU;
+        frame.data[frame.dlc - 1U] ^= (uint8_t)(old ^ 0xFFU);
+        advances = true;
+    }
+    
+    if (send_frame(&frame) && advances) {
+        g_counter[cmd] = (uint8_t)((g_counter[cmd] + 1U) & CAN_COUNTER_MASK);
+    }
+}
+
+static void send_filler(void)
+{
+    load_kind_t kind = pick_kind();
+    
+    if (kind == LOAD_LIGHT) {
+        (void)send_valid(LOAD_CMD_LIGHT);
+    } else if (kind == LOAD_TURN) {
+        (void)send_valid(LOAD_CMD_TURN);
+    } else {
+        send_malformed(kind);
+    }
+    g_stats.sent[kind]++;
+}
+
+/**
+ * @brief Toggle all doors and start timing the status response
+ */
+static void send_probe(uint64_t now)
+{
+    g_probe.cmd = (g_probe.cmd == DOOR_CMD_LOCK_ALL) ? DOOR_CMD_UNLOCK_ALL : DOOR_CMD_LOCK_ALL;
+    g_probe.expected_locks = (g_probe.cmd == DOOR_CMD_LOCK_ALL) ?
+        (uint8_t)(DOOR_LOCK_BIT_FL | DOOR_LOCK_BIT_FR | DOOR_LOCK_BIT_RL | DOOR_LOCK_BIT_RR) : 0U;
+    build_valid(LOAD_CMD_DOOR, &g_probe.frame);
+    
+    g_probe.next_mono_ns = now + (uint64_t)g_probe_ms * 1000000ULL;
+    if (!send_frame(&g_probe.frame)) {
+        return;
+    }
+    g_counter[LOAD_CMD_DOOR] = (uint8_t)((g_counter[LOAD_CMD_DOOR] + 1U) & CAN_COUNTER_MASK);
+    
+    g_probe.pending = true;
+    g_probe.bus_ns = 0;
+    g_probe.sent_mono_ns = now;
+    g_stats.probes_sent++;
+}
+
+/*******************************************************************************
+ * Reception
+ ******************************************************************************/
+
+/**
+ * @brief Account one status frame (classic, or a section of the aggregate)
+ */
+static void handle_status(const can_frame_t *frame, uint64_t ts_ns)
+{
+    const can_msg_desc_t *desc;
+    switch (frame->id) {
+        case CAN_ID_DOOR_STATUS:            desc = &can_msg_door_status_desc; break;
+        case CAN_ID_LIGHTING_STATUS:        desc = &can_msg_lighting_status_desc; break;
+        case CAN_ID_TURN_SIGNAL_STATUS:     desc = &can_msg_turn_signal_status_desc; break;
+        case CAN_ID_FAULT_STATUS:           desc = &can_msg_fault_status_desc; break;
+        default:                            return;
+    }
+    
+    g_stats.status_rx++;
+    if (can_check_frame(desc, frame, NULL) != CAN_CHECK_OK) {
+        g_stats.status_bad++;
+        return;
+    }
+    
+    uint8_t result = CMD_RESULT_OK;
+    if (frame->id == CAN_ID_DOOR_STATUS) {
+        can_msg_door_status_t door;
+        can_msg_door_status_decode(frame, &door);
+        result = door.result;
+        
+        if (g_probe.pending && door.locks == g_probe.expected_locks && g_probe.bus_ns != 0U &&
+            ts_ns >= g_probe.bus_ns) {
+            if (g_stats.samples < LOAD_MAX_SAMPLES) {
+                g_latency_ns[g_stats.samples++] = ts_ns - g_probe.bus_ns;
+            }
+            g_probe.pending = false;
+        }
+    } else if (frame->id == CAN_ID_LIGHTING_STATUS) {
+        can_msg_lighting_status_t lighting;
+        can_msg_lighting_status_decode(frame, &lighting);
+        result = lighting.result;
+    } else if (frame->id == CAN_ID_TURN_SIGNAL_STATUS) {
+        can_msg_turn_signal_status_t turn;
+        can_msg_turn_signal_status_decode(frame, &turn);
+        result = turn.result;
+    }
+    
+    if (result == CMD_RESULT_COUNTER_ERROR) {
+        g_stats.counter_errors++;
+    }
+}
+
+/**
+ * @brief Split a CAN FD aggregate into its classic status sections
+ */
+static void handle_aggregate(const can_fd_frame_t *agg, uint64_t ts_ns)
+{
+    static const struct { uint32_t id; uint8_t offset; uint8_t dlc; } sections[] = {
+        { CAN_ID_DOOR_STATUS, AGG_BYTE_DOOR, DOOR_STATUS_DLC },
+        { CAN_ID_LIGHTING_STATUS, AGG_BYTE_LIGHTING, LIGHTING_STATUS_DLC },
+        { CAN_ID_TURN_SIGNAL_STATUS, AGG_BYTE_TURN, TURN_SIGNAL_STATUS_DLC },
+        { CAN_ID_FAULT_STATUS, AGG_BYTE_FAULT, FAULT_STATUS_DLC },
+    };
+    
+    if (agg->len != BCM_AGGREGATE_LEN) {
+        g_stats.status_bad++;
+        return;
+    }
+    
+    for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); i++) {
+        can_frame_t frame;
+        memset(&frame, 0, sizeof(frame));
+        frame.id = sections[i].id;
+        frame.dlc = sections[i].dlc;
+        memcpy(frame.data, &agg->data[sections[i].offset], sections[i].dlc);
+        handle_status(&frame, ts_ns);
+    }
+}
+
+/**
+ * @brief Read everything queued on the socket
+ */
+static void drain_rx(void)
+{
+    for (uint32_t n = 0; n < LOAD_RX_BATCH; n++) {
+        can_fd_frame_t frame;
+        _Alignas(struct cmsghdr) char ctrl[CMSG_SPACE(sizeof(struct scm_timestamping)) +
+                                           CMSG_SPACE(sizeof(uint32_t))];
+        struct iovec iov = { &frame, sizeof(frame) };
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+        
+        ssize_t len = recvmsg(g_fd, &msg, MSG_DONTWAIT);
+        if (len < 0) {
+            return;
+        }
+        
+        /* Kernel software timestamp; our clock if the driver gave none */
+        uint64_t ts_ns = 0;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+             cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET) {
+                continue;
+            }
+            if (cmsg->cmsg_type == SO_TIMESTAMPING) {
+                struct scm_timestamping stamps;
+                memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+                ts_ns = ((uint64_t)stamps.ts[0].tv_sec * 1000000000ULL) +
+                        (uint64_t)stamps.ts[0].tv_nsec;
+            } else if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+                uint32_t drops;
+                memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+                g_stats.local_drops += drops - g_ovfl_last;
+                g_ovfl_last = drops;
+            }
+        }
+        if (ts_ns == 0U) {
+            ts_ns = clock_ns(CLOCK_REALTIME);
+        }
+        
+        if (len == (ssize_t)CANFD_MTU) {
+            handle_aggregate(&frame, ts_ns);
+        } else if (len == (ssize_t)CAN_MTU) {
+            can_frame_t classic;
+            memcpy(&classic, &frame, sizeof(classic));
+            if ((msg.msg_flags & MSG_CONFIRM) != 0) {
+                /* Own frame: the probe's time on the bus */
+                if (g_probe.pending && g_probe.bus_ns == 0U &&
+                    memcmp(&classic, &g_probe.frame, sizeof(classic)) == 0) {
+                    g_probe.bus_ns = ts_ns;
+                }
+            } else {
+                handle_status(&classic, ts_ns);
+            }
+        }
+    }
+}
+
+static void wait_rx(int timeout_ms)
+{
+    struct pollfd pfd = { g_fd, POLLIN, 0 };
+    if (poll(&pfd, 1, timeout_ms) > 0) {
+        drain_rx();
+    }
+}
+
+/*******************************************************************************
+ * Load Phases
+ ******************************************************************************/
+
+/**
+ * @brief Bring the BCM's counters in line with ours, then let it settle
+ *
+ * The BCM only accepts last + 1, so one pass over all 16 counter values
+ * hits the expected one and the rest follow in sequence.
+ */
+static void sync_counters(void)
+{
+    for (uint32_t i = 0; i <= CAN_COUNTER_MASK; i++) {
+        for (uint32_t cmd = 0; cmd < LOAD_CMD_COUNT; cmd++) {
+            (void)send_valid((load_cmd_t)cmd);
+        }
+        wait_rx(LOAD_POLL_MS);
+    }
+    
+    uint64_t end = clock_ns(CLOCK_MONOTONIC) + (uint64_t)LOAD_SETTLE_MS * 1000000ULL;
+    while (clock_ns(CLOCK_MONOTONIC) < end) {
+        wait_rx(LOAD_POLL_MS);
+    }
+    
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_probe.pending = false;
+}
+
+/**
+ * @brief Filler at rate frames/s plus probes for duration_ms
+ */
+static void run_phase(uint32_t rate, uint32_t duration_ms)
+{
+    uint64_t start = clock_ns(CLOCK_MONOTONIC);
+    uint64_t duration_ns = (uint64_t)duration_ms * 1000000ULL;
+    uint64_t sent = 0;
+    g_probe.next_mono_ns = start;
+    
+    for (;;) {
+        uint64_t now = clock_ns(CLOCK_MONOTONIC);
+        uint64_t elapsed = now - start;
+        if (elapsed >= duration_ns) {
+            break;
+        }
+        
+        uint64_t due = (elapsed * rate) / 1000000000ULL;
+        while (sent < due) {
+            send_filler();
+            sent++;
+        }
+        
+        if (g_probe.pending &&
+            now - g_probe.sent_mono_ns > (uint64_t)LOAD_PROBE_TIMEOUT_MS * 1000000ULL) {
+            g_probe.pending = false;
+            g_stats.probes_lost++;
+        }
+        if (!g_probe.pending && now >= g_probe.next_mono_ns) {
+            send_probe(now);
+        }
+        
+        wait_rx(LOAD_POLL_MS);
+    }
+    
+    /* Let the last probe answer; frames still queued are not counted */
+    uint64_t end = clock_ns(CLOCK_MONOTONIC) + (uint64_t)LOAD_PROBE_TIMEOUT_MS * 1000000ULL;
+    while (g_probe.pending && clock_ns(CLOCK_MONOTONIC) < end) {
+        wait_rx(LOAD_POLL_MS);
+    }
+    if (g_probe.pending) {
+        g_probe.pending = false;
+        g_stats.probes_lost++;
+    }
+}
+
+static uint64_t frames_sent(void)
+{
+    uint64_t total = g_stats.probes_sent;
+    for (uint32_t k = 0; k < LOAD_KIND_COUNT; k++) {
+        total += g_stats.sent[k];
+    }
+    return total;
+}
+
+/**
+ * @brief A step is clean when the BCM lost nothing and we measured everything
+ */
+static bool phase_clean(void)
+{
+    return g_stats.counter_errors == 0U && g_stats.probes_lost == 0U &&
+           g_stats.tx_errors == 0U && g_stats.local_drops == 0U;
+}
+
+static void print_report(FILE *out, uint32_t rate, uint32_t duration_ms)
+{
+    qsort(g_latency_ns, g_stats.samples, sizeof(uint64_t), compare_u64);
+    
+    fprintf(out, "[LOAD] %u filler frames/s for %u ms, %llu frames sent (%.0f frames/s incl. probes)\n",
+            rate, duration_ms, (unsigned long long)frames_sent(),
+            (double)frames_sent() * 1000.0 / (double)duration_ms);
+    fprintf(out, "[LOAD] mix:");
+    for (uint32_t k = 0; k < LOAD_KIND_COUNT; k++) {
+        if (g_weights[k] != 0U) {
+            fprintf(out, " %s %llu", g_kind_names[k], (unsigned long long)g_stats.sent[k]);
+        }
+    }
+    fprintf(out, "\n");
+    fprintf(out, "[LOAD] %llu status frames (%llu bad, %llu counter errors), "
+            "%llu TX errors, %llu local RX drops\n",
+            (unsigned long long)g_stats.status_rx, (unsigned long long)g_stats.status_bad,
+            (unsigned long long)g_stats.counter_errors, (unsigned long long)g_stats.tx_errors,
+            (unsigned long long)g_stats.local_drops);
+    fprintf(out, "[LOAD] %llu probes, %llu lost; cmd->status latency us: "
+            "p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+            (unsigned long long)g_stats.probes_sent, (unsigned long long)g_stats.probes_lost,
+            percentile_us(g_latency_ns, g_stats.samples, 500U),
+            percentile_us(g_latency_ns, g_stats.samples, 990U),
+            percentile_us(g_latency_ns, g_stats.samples, 999U),
+            percentile_us(g_latency_ns, g_stats.samples, 1000U));
+}
+
+/*******************************************************************************
+ * Usage
+ ******************************************************************************/
+
+static void print_usage(const char *prog_name)
+{
+    printf("Usage: %s [options]\n", prog_name);
+    printf("Options:\n");
+    printf("  -i <ifname>     CAN interface with a running bcm_app (default: %s)\n",
+           LOAD_DEFAULT_IFNAME);
+    printf("  -r <fps>        Filler frames/s, start rate with -S (default: %u)\n",
+           LOAD_DEFAULT_RATE);
+    printf("  -d <ms>         Run length, per step with -S (default: %u)\n", LOAD_DEFAULT_MS);
+    printf("  -m <mix>        Filler mix kind=weight,... of light, turn, wrong_dlc,\n");
+    printf("                  bad_checksum, bad_command (default: %s)\n", LOAD_DEFAULT_MIX);
+    printf("  -p <ms>         Minimum door probe spacing (default: %u)\n", LOAD_DEFAULT_PROBE_MS);
+    printf("  -S              Sweep: raise the rate %u%% per step until frames are lost\n",
+           LOAD_SWEEP_GROWTH_PCT - 100U);
+    printf("  -h              Show this help\n");
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    const char *ifname = LOAD_DEFAULT_IFNAME;
+    const char *mix = LOAD_DEFAULT_MIX;
+    uint32_t rate = LOAD_DEFAULT_RATE;
+    uint32_t duration_ms = LOAD_DEFAULT_MS;
+    bool sweep = false;
+    
+    /* Parse arguments */
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && (i + 1) < argc) {
+            ifname = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0 && (i + 1) < argc) {
+            rate = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-d") == 0 && (i + 1) < argc) {
+            duration_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-m") == 0 && (i + 1) < argc) {
+            mix = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && (i + 1) < argc) {
+            g_probe_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-S") == 0) {
+            sweep = true;
+        } else if (strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (!parse_mix(mix) || rate == 0U || rate > LOAD_MAX_RATE || duration_ms == 0U) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    g_fd = open_socket(ifname);
+    if (g_fd < 0) {
+        return 1;
+    }
+    g_probe.cmd = DOOR_CMD_LOCK_ALL; /* First probe unlocks, so sync leaves doors locked */
+    
+    printf("[LOAD] %s, CAN FD aggregate %s\n", ifname, g_fd_frames ? "on" : "off");
+    sync_counters();
+    
+    if (!sweep) {
+        run_phase(rate, duration_ms);
+        print_report(stdout, rate, duration_ms);
+        close(g_fd);
+        return phase_clean() ? 0 : 2;
+    }
+    
+    uint32_t clean_rate = 0;
+    for (;;) {
+        run_phase(rate, duration_ms);
+        bool clean = phase_clean();
+        printf("[LOAD] step %6u frames/s: %s\n", rate, clean ? "clean" : "frames lost");
+        if (!clean) {
+            print_report(stdout, rate, duration_ms);
+            break;
+        }
+        clean_rate = rate;
+        if (rate >= LOAD_MAX_RATE) {
+            break;
+        }
+        
+        uint32_t next = (uint32_t)(((uint64_t)rate * LOAD_SWEEP_GROWTH_PCT) / 100U);
+        rate = (next > rate) ? ((next < LOAD_MAX_RATE) ? next : LOAD_MAX_RATE) : rate + 1U;
+        memset(&g_stats, 0, sizeof(g_stats));
+    }
+    
+    printf("[LOAD] max sustainable: %u filler frames/s\n", clean_rate);
+    close(g_fd);
+    return (clean_rate > 0U) ? 0 : 2;
+}
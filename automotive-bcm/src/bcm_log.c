@@ -0,0 +1,147 @@
+/**
+ * @file bcm_log.c
+ * @brief Deferred Log Ring Implementation
+ *
+ * Bounded lock-free ring of {format, args} entries. A producer only
+ * claims a slot and copies a pointer and up to three ints; the consumer
+ * runs printf(). When the ring is full new messages are dropped and
+ * counted rather than blocking the caller.
+ *
+ * Several BCM instances on different threads log and flush through the
+ * same ring, so both ends are multi-threaded: head and tail are claimed
+ * with compare-and-swap and every slot carries a sequence number that
+ * says whether it is free, being written, or ready to format. The
+ * sequence is stored minus the slot index, so the zeroed ring is valid
+ * without an init call.
+ */
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "bcm_log.h"
+
+_Static_assert((BCM_LOG_BUFFER_SIZE & (BCM_LOG_BUFFER_SIZE - 1U)) == 0U,
+               "BCM_LOG_BUFFER_SIZE must be a power of two");
+
+/*******************************************************************************
+ * Private Types
+ ******************************************************************************/
+
+typedef struct {
+    atomic_uint  seq;       /**< Sequence minus slot index */
+    const char  *fmt;
+    int          args[BCM_LOG_MAX_ARGS];
+} bcm_log_entry_t;
+
+/*******************************************************************************
+ * Private Data
+ ******************************************************************************/
+
+static bcm_log_entry_t g_log_entries[BCM_LOG_BUFFER_SIZE];
+
+static _Alignas(64) atomic_uint g_log_head;     /**< Next slot to claim */
+static _Alignas(64) atomic_uint g_log_tail;     /**< Next slot to format */
+static atomic_uint_fast32_t g_log_dropped;
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void bcm_log_defer(int nargs, const char *fmt, ...)
+{
+    unsigned int pos = atomic_load_explicit(&g_log_head, memory_order_relaxed);
+    bcm_log_entry_t *entry;
+    uint32_t slot;
+    
+    for (;;) {
+        slot = pos & (BCM_LOG_BUFFER_SIZE - 1U);
+        entry = &g_log_entries[slot];
+        
+        uint32_t seq = atomic_load_explicit(&entry->seq, memory_order_acquire) + slot;
+        int32_t diff = (int32_t)(seq - pos);
+        
+        if (diff == 0) {
+            /* Slot is free for this lap: try to claim it */
+            if (atomic_compare_exchange_weak_explicit(&g_log_head, &pos, pos + 1U,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /* Still holds last lap's message: ring is full */
+            atomic_fetch_add_explicit(&g_log_dropped, 1U, memory_order_relaxed);
+            return;
+        } else {
+            pos = atomic_load_explicit(&g_log_head, memory_order_relaxed);
+        }
+    }
+    
+    entry->fmt = fmt;
+    
+    va_list ap;
+    va_start(ap, fmt);
+    for (int i = 0; i < (int)BCM_LOG_MAX_ARGS; i++) {
+        entry->args[i] = (i < nargs) ? va_arg(ap, int) : 0;
+    }
+    va_end(ap);
+    
+    /* Ready to format */
+    atomic_store_explicit(&entry->seq, pos + 1U - slot, memory_order_release);
+}
+
+uint32_t bcm_log_drain(FILE *out)
+{
+    unsigned int pos = atomic_load_explicit(&g_log_tail, memory_order_relaxed);
+    uint32_t written = 0;
+    
+    for (;;) {
+        uint32_t slot = pos & (BCM_LOG_BUFFER_SIZE - 1U);
+        bcm_log_entry_t *entry = &g_log_entries[slot];
+        
+        uint32_t seq = atomic_load_explicit(&entry->seq, memory_order_acquire) + slot;
+        int32_t diff = (int32_t)(seq - (pos + 1U));
+        
+        if (diff < 0) {
+            break; /* Empty, or the next message is still being written */
+        }
+        if (diff > 0) {
+            pos = atomic_load_explicit(&g_log_tail, memory_order_relaxed);
+            continue; /* Another thread formatted it */
+        }
+        if (!atomic_compare_exchange_weak_explicit(&g_log_tail, &pos, pos + 1U,
+                                                   memory_order_relaxed,
+                                                   memory_order_relaxed)) {
+            continue;
+        }
+        
+        /* Copy out, hand the slot back for the next lap, then format */
+        const char *fmt = entry->fmt;
+        int args[BCM_LOG_MAX_ARGS];
+        memcpy(args, entry->args, sizeof(args));
+        atomic_store_explicit(&entry->seq, pos + BCM_LOG_BUFFER_SIZE - slot,
+                              memory_order_release);
+        pos++;
+        
+        /* Surplus arguments are ignored by fprintf() */
+        (void)fprintf(out, fmt, args[0], args[1], args[2]);
+        written++;
+    }
+    
+    uint32_t dropped = (uint32_t)atomic_exchange_explicit(&g_log_dropped, 0U,
+                                                          memory_order_relaxed);
+    if (dropped > 0U) {
+        (void)fprintf(out, "[LOG] %u messages dropped\n", dropped);
+    }
+    
+    return written;
+}
+
+void bcm_log_flush(void)
+{
+    (void)bcm_log_drain(stdout);
+}
+
+uint32_t bcm_log_dropped(void)
+{
+    return (uint32_t)atomic_load_explicit(&g_log_dropped, memory_order_relaxed);
+}
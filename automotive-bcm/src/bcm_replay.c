@@ -0,0 +1,460 @@
+/**
+ * @file bcm_replay.c
+ * @brief Headless CAN Trace Replay
+ *
+ * Feeds a recorded trace (candump log or Vector ASC) through the stub CAN
+ * interface on a virtual clock. bcm_process() is called for every frame
+ * and every scheduler deadline in between, as fast as possible, and all
+ * transmitted frames are written out in candump log format. Frames of one
+ * millisecond are queued together and reach bcm_process() as one RX batch,
+ * so each command ID is validated with a single can_check_batch() call.
+ */
+
+#define _DEFAULT_SOURCE     /* fdopen/dup/clock_gettime under -std=c11 */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bcm.h"
+#include "system_state.h"
+#include "can_interface.h"
+#include "bcm_trace.h"
+
+/*******************************************************************************
+ * Configuration
+ ******************************************************************************/
+
+#define REPLAY_LINE_MAX     512U
+#define REPLAY_IFNAME       "bcm"   /**< Interface name written on TX lines */
+
+/*******************************************************************************
+ * Private Types
+ ******************************************************************************/
+
+typedef enum {
+    LINE_FRAME = 0,     /**< Frame parsed */
+    LINE_SKIP,          /**< Header, comment, blank or unsupported event */
+    LINE_ERROR          /**< Looked like a frame but could not be parsed */
+} line_result_t;
+
+typedef struct {
+    uint32_t    lines;
+    uint32_t    rx_frames;
+    uint32_t    tx_frames;
+    uint32_t    skipped;
+    uint32_t    errors;
+} replay_stats_t;
+
+/*******************************************************************************
+ * Private Data
+ ******************************************************************************/
+
+static FILE             *g_out = NULL;
+static double           g_base_s = 0.0;     /**< Trace time of virtual 0 */
+static bool             g_asc_decimal = false;
+static replay_stats_t   g_stats;
+
+/*******************************************************************************
+ * Trace Parsing
+ ******************************************************************************/
+
+/**
+ * @brief Parse hex payload "0100AB12" into frame data
+ * @return true if 0-8 whole bytes were read
+ */
+static bool parse_hex_payload(const char *p, can_frame_t *frame)
+{
+    frame->dlc = 0;
+    
+    while (isxdigit((unsigned char)p[0]) && isxdigit((unsigned char)p[1])) {
+        if (frame->dlc >= CAN_FRAME_MAX_DLC) {
+            return false;
+        }
+        char byte[3] = { p[0], p[1], '\0' };
+        frame->data[frame->dlc++] = (uint8_t)strtoul(byte, NULL, 16);
+        p += 2;
+    }
+    
+    return (*p == '\0' || isspace((unsigned char)*p));
+}
+
+/**
+ * @brief Parse "ID#DATA" or "ID [n] b0 b1 ..." after the candump interface
+ */
+static line_result_t parse_candump_frame(const char *p, can_frame_t *frame)
+{
+    char *end;
+    unsigned long id = strtoul(p, &end, 16);
+    
+    if (*end == '#') {
+        if ((end - p) > 3) {
+            return LINE_SKIP; /* Extended ID */
+        }
+        if (end[1] == '#' || end[1] == 'R' || end[1] == 'r') {
+            return LINE_SKIP; /* CAN FD or remote frame */
+        }
+        frame->id = (uint32_t)id;
+        return parse_hex_payload(end + 1, frame) ? LINE_FRAME : LINE_ERROR;
+    }
+    
+    /* "-ta" style: 100   [4]  01 02 03 04 */
+    unsigned int dlc;
+    int used = 0;
+    if (end == p || sscanf(end, " [%u]%n", &dlc, &used) != 1 || dlc > CAN_FRAME_MAX_DLC) {
+        return LINE_ERROR;
+    }
+    if (id > 0x7FFUL) {
+        return LINE_SKIP;
+    }
+    
+    frame->id = (uint32_t)id;
+    frame->dlc = (uint8_t)dlc;
+    p = end + used;
+    for (uint8_t i = 0; i < frame->dlc; i++) {
+        unsigned long byte = strtoul(p, &end, 16);
+        if (end == p || byte > 0xFFUL) {
+            return LINE_ERROR;
+        }
+        frame->data[i] = (uint8_t)byte;
+        p = end;
+    }
+    return LINE_FRAME;
+}
+
+/**
+ * @brief candump log line: "(1436509052.249713) vcan0 100#0100AB12"
+ */
+static line_result_t parse_candump_line(const char *line, double *ts, can_frame_t *frame)
+{
+    char ifname[32];
+    int used = 0;
+    
+    if (sscanf(line, " (%lf) %31s %n", ts, ifname, &used) != 2 || used == 0) {
+        return LINE_ERROR;
+    }
+    return parse_candump_frame(line + used, frame);
+}
+
+/**
+ * @brief Vector ASC line: "   0.010000 1  100   Rx   d 4 01 00 AB 12"
+ */
+static line_result_t parse_asc_line(const char *line, double *ts, can_frame_t *frame)
+{
+    unsigned int channel;
+    char id_str[16];
+    char dir[4];
+    char type;
+    unsigned int dlc;
+    int used = 0;
+    
+    if (strncmp(line, "base ", 5U) == 0) {
+        g_asc_decimal = (strncmp(line + 5, "dec", 3U) == 0);
+        return LINE_SKIP;
+    }
+    
+    if (sscanf(line, " %lf %u %15s %3s %c %u%n",
+               ts, &channel, id_str, dir, &type, &dlc, &used) != 6) {
+        return LINE_SKIP; /* Header, marker or error frame */
+    }
+    (void)channel;
+    
+    size_t id_len = strlen(id_str);
+    if (type != 'd' || (id_len > 0U && (id_str[id_len - 1U] == 'x'))) {
+        return LINE_SKIP; /* Remote frame or extended ID */
+    }
+    if (dlc > CAN_FRAME_MAX_DLC) {
+        return LINE_ERROR;
+    }
+    
+    int base = g_asc_decimal ? 10 : 16;
+    char *end;
+    unsigned long id = strtoul(id_str, &end, base);
+    if (*end != '\0' || id > 0x7FFUL) {
+        return LINE_ERROR;
+    }
+    
+    frame->id = (uint32_t)id;
+    frame->dlc = (uint8_t)dlc;
+    const char *p = line + used;
+    for (uint8_t i = 0; i < frame->dlc; i++) {
+        unsigned long byte = strtoul(p, &end, base);
+        if (end == p || byte > 0xFFUL) {
+            return LINE_ERROR;
+        }
+        frame->data[i] = (uint8_t)byte;
+        p = end;
+    }
+    return LINE_FRAME;
+}
+
+/**
+ * @brief Parse one trace line in either format
+ */
+static line_result_t parse_line(const char *line, double *ts, can_frame_t *frame)
+{
+    while (isspace((unsigned char)*line)) {
+        line++;
+    }
+    
+    if (*line == '\0' || *line == '#' || *line == ';' || strncmp(line, "//", 2U) == 0) {
+        return LINE_SKIP;
+    }
+    
+    memset(frame, 0, sizeof(*frame));
+    
+    if (*line == '(') {
+        return parse_candump_line(line, ts, frame);
+    }
+    if (isdigit((unsigned char)*line) || strncmp(line, "base ", 5U) == 0) {
+        return parse_asc_line(line, ts, frame);
+    }
+    return LINE_SKIP;
+}
+
+/*******************************************************************************
+ * Virtual Clock
+ ******************************************************************************/
+
+/**
+ * @brief Write all queued TX frames in candump log format
+ */
+static void drain_tx(uint32_t now_ms)
+{
+    can_frame_t frames[CAN_BATCH_MAX];
+    uint8_t count;
+    double ts = g_base_s + (double)now_ms / 1000.0;
+    
+    while ((count = can_stub_drain_tx(frames, CAN_BATCH_MAX)) > 0U) {
+        for (uint8_t i = 0; i < count; i++) {
+            fprintf(g_out, "(%.6f) %s %03X#", ts, REPLAY_IFNAME, (unsigned int)frames[i].id);
+            for (uint8_t b = 0; b < frames[i].dlc; b++) {
+                fprintf(g_out, "%02X", frames[i].data[b]);
+            }
+            fputc('\n', g_out);
+        }
+        g_stats.tx_frames += count;
+    }
+}
+
+/**
+ * @brief Run one BCM tick at now_ms and collect its output
+ */
+static void step(uint32_t now_ms)
+{
+    bcm_process(now_ms);
+    drain_tx(now_ms);
+}
+
+/**
+ * @brief Run every scheduler deadline before target_ms
+ */
+static void advance_to(uint32_t target_ms)
+{
+    uint32_t next = bcm_next_deadline_ms();
+    
+    while ((int32_t)(next - target_ms) < 0) {
+        step(next);
+        next = bcm_next_deadline_ms();
+    }
+}
+
+/**
+ * @brief Deliver one frame at now_ms
+ */
+static void deliver(uint32_t now_ms, const can_frame_t *frame)
+{
+    advance_to(now_ms);
+    
+    if (can_stub_inject_rx(frame) != CAN_STATUS_OK) {
+        /* RX queue full of same-ms frames: process them, then retry */
+        step(now_ms);
+        (void)can_stub_inject_rx(frame);
+    }
+    
+    g_stats.rx_frames++;
+}
+
+/*******************************************************************************
+ * Usage
+ ******************************************************************************/
+
+static void print_usage(const char *prog_name)
+{
+    printf("Usage: %s [options] <trace>\n", prog_name);
+    printf("Options:\n");
+    printf("  -o <file>       Write TX frames to file (default: stdout)\n");
+    printf("  -d <ms>         Keep running for ms after the last frame (default: 0)\n");
+    printf("  -q              Discard BCM log output (default: to stderr)\n");
+    printf("  -t <file>       Also write a binary frame/event trace to file\n");
+    printf("  -h              Show this help\n");
+    printf("\n");
+    printf("Trace formats (detected per line):\n");
+    printf("  candump -l log   (1436509052.249713) can0 100#0100AB12\n");
+    printf("  Vector ASC       0.010000 1  100  Rx  d 4 01 00 AB 12\n");
+    printf("\n");
+    printf("Use '-' to read the trace from stdin.\n");
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    const char *trace_path = NULL;
+    const char *out_path = NULL;
+    const char *bin_path = NULL;
+    uint32_t tail_ms = 0;
+    bool quiet = false;
+    
+    /* Parse arguments */
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && (i + 1) < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "-d") == 0 && (i + 1) < argc) {
+            tail_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-t") == 0 && (i + 1) < argc) {
+            bin_path = argv[++i];
+        } else if (strcmp(argv[i], "-q") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (trace_path == NULL && (argv[i][0] != '-' || argv[i][1] == '\0')) {
+            trace_path = argv[i];
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (trace_path == NULL) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    FILE *in = (strcmp(trace_path, "-") == 0) ? stdin : fopen(trace_path, "r");
+    if (in == NULL) {
+        perror("[REPLAY] open trace");
+        return 1;
+    }
+    
+    /* TX frames get their own stream; module printf() output is moved off stdout */
+    if (out_path != NULL) {
+        g_out = fopen(out_path, "w");
+    } else {
+        int fd = dup(STDOUT_FILENO);
+        g_out = (fd >= 0) ? fdopen(fd, "w") : NULL;
+    }
+    if (g_out == NULL) {
+        perror("[REPLAY] open output");
+        return 1;
+    }
+    if (quiet) {
+        if (freopen("/dev/null", "w", stdout) == NULL) {
+            perror("[REPLAY] /dev/null");
+        }
+    } else {
+        fflush(stdout);
+        (void)dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+    
+    if (bin_path != NULL && bcm_trace_open(bin_path, 0) != 0) {
+        fprintf(stderr, "[REPLAY] Cannot create trace file %s\n", bin_path);
+        return 1;
+    }
+    
+    if (bcm_init(NULL) != 0) {
+        fprintf(stderr, "[REPLAY] BCM initialization failed\n");
+        bcm_trace_close();
+        return 1;
+    }
+    
+    struct timespec wall_start, wall_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    
+    char line[REPLAY_LINE_MAX];
+    bool started = false;
+    uint32_t now_ms = 0;
+    
+    while (fgets(line, sizeof(line), in) != NULL) {
+        double ts = 0.0;
+        can_frame_t frame;
+        
+        g_stats.lines++;
+        switch (parse_line(line, &ts, &frame)) {
+            case LINE_FRAME:
+                break;
+            case LINE_SKIP:
+                g_stats.skipped++;
+                continue;
+            default:
+                g_stats.errors++;
+                fprintf(stderr, "[REPLAY] line %u: cannot parse\n", g_stats.lines);
+                continue;
+        }
+        
+        if (!started) {
+            g_base_s = ts;
+            step(0);
+            started = true;
+        }
+        
+        /* Never step backwards: out-of-order frames replay at the current time */
+        double rel_ms = (ts - g_base_s) * 1000.0;
+        uint32_t frame_ms = (rel_ms > 0.0) ? (uint32_t)rel_ms : 0U;
+        if ((int32_t)(frame_ms - now_ms) > 0) {
+            now_ms = frame_ms;
+        }
+        
+        deliver(now_ms, &frame);
+        step(now_ms);
+    }
+    
+    if (started && tail_ms > 0U) {
+        now_ms += tail_ms;
+        advance_to(now_ms);
+        step(now_ms);
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    double wall_s = (double)(wall_end.tv_sec - wall_start.tv_sec) +
+                    (double)(wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+    
+    can_stats_t can_stats;
+    can_get_stats(&can_stats);
+    
+    fprintf(stderr, "[REPLAY] %u lines, %u RX frames, %u TX frames, %u skipped, %u errors\n",
+            g_stats.lines, g_stats.rx_frames, g_stats.tx_frames,
+            g_stats.skipped, g_stats.errors);
+    fprintf(stderr, "[REPLAY] RX discarded: %u unknown ID, %u bad DLC, %u rejected\n",
+            can_stats.rx_unknown_id, can_stats.rx_bad_dlc, can_stats.rx_rejected);
+    fprintf(stderr, "[REPLAY] Dropped: %u RX, %u TX; bus load %u.%u%% (last window)\n",
+            can_stats.rx_dropped, can_stats.tx_dropped,
+            can_stats.bus_load_x10 / 10U, can_stats.bus_load_x10 % 10U);
+    
+    can_id_stats_t id_stats[CAN_STATS_ID_SLOTS];
+    uint8_t id_count = can_get_all_id_stats(id_stats, CAN_STATS_ID_SLOTS);
+    for (uint8_t i = 0; i < id_count; i++) {
+        fprintf(stderr, "[REPLAY]   0x%03X: %u RX, %u TX\n",
+                id_stats[i].id, id_stats[i].rx_count, id_stats[i].tx_count);
+    }
+    fprintf(stderr, "[REPLAY] %.3f s virtual in %.3f s wall\n",
+            (double)now_ms / 1000.0, wall_s);
+    
+    bcm_deinit();
+    bcm_trace_close();
+    if (in != stdin) {
+        fclose(in);
+    }
+    fclose(g_out);
+    
+    return (g_stats.errors > 0U) ? 2 : 0;
+}
@@ -0,0 +1,354 @@
+/**
+ * @file bcm_store.c
+ * @brief Persistent Fault/Event Store Implementation
+ *
+ * Mount invariant: pages are written in ring order with sequence numbers
+ * one apart, so from page 0 (sequence s) up to the newest page every page
+ * holds s + index. Past the newest page sit erased pages or the previous
+ * lap, which never match, and a binary search for the last match finds
+ * the newest page. If page 0 itself is erased or torn, the write after a
+ * full lap stopped there and the newest page is the last one.
+ *
+ * Ownership: the store keeps one instance's history. bcm_store_restore()
+ * in the first bcm_init() after bcm_store_open() claims it for the bound
+ * instance and bcm_store_release() in its bcm_deinit() gives it up. Other
+ * instances neither stage events nor restore.
+ */
+
+#include <string.h>
+#include "bcm_store.h"
+#include "bcm_config.h"
+#include "bcm_ctx.h"
+#include "system_state.h"
+
+_Static_assert(sizeof(bcm_store_page_header_t) == 32U, "store page header layout");
+_Static_assert(sizeof(event_log_entry_t) == 8U, "store record layout");
+_Static_assert(BCM_STORE_PAGE_MAX % 8U == 0U && BCM_STORE_PAGE_MAX >= 64U,
+               "BCM_STORE_PAGE_MAX must be a multiple of 8, at least 64");
+_Static_assert(BCM_STORE_RESTORE_EVENTS <= EVENT_LOG_SIZE,
+               "BCM_STORE_RESTORE_EVENTS must fit in the event log");
+
+#define STORE_NO_PAGE       0xFFFFFFFFUL    /**< g_store_newest of an empty log */
+#define STORE_ERASED        0xFFU
+
+/*******************************************************************************
+ * Private Data
+ ******************************************************************************/
+
+static const bcm_flash_t   *g_store_flash = NULL;
+static const bcm_ctx_t     *g_store_owner = NULL;  /**< Instance whose history is kept */
+static uint32_t             g_store_per_page = 0;   /**< Records per page */
+static uint32_t             g_store_head = 0;       /**< Next page to write */
+static uint32_t             g_store_newest = STORE_NO_PAGE;
+static uint32_t             g_store_seq = 1;        /**< Sequence number of the next page */
+static bcm_store_page_header_t g_store_checkpoint;  /**< Header of the newest page */
+static event_log_entry_t    g_store_stage[BCM_STORE_STAGE_RECORDS];
+static bcm_store_stats_t    g_store_stats;
+
+/* One page, aligned for the header and records */
+static uint64_t             g_store_page[BCM_STORE_PAGE_MAX / 8U];
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+/**
+ * @brief True if a store is open and owned by the bound instance
+ */
+static bool store_owned(void)
+{
+    return g_store_flash != NULL && g_store_owner == bcm_ctx_current();
+}
+
+/**
+ * @brief CRC-32 (IEEE 802.3, reflected)
+ */
+static uint32_t store_crc32(const uint8_t *data, uint32_t len)
+{
+    uint32_t crc = 0xFFFFFFFFU;
+    
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8U; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+    return ~crc;
+}
+
+static bcm_store_page_header_t *page_header(void)
+{
+    return (bcm_store_page_header_t *)g_store_page;
+}
+
+static event_log_entry_t *page_records(void)
+{
+    return (event_log_entry_t *)(page_header() + 1);
+}
+
+/**
+ * @brief Read a page into g_store_page
+ * @return Its sequence number, 0 if erased, torn or unreadable
+ */
+static uint32_t page_load(uint32_t page)
+{
+    const bcm_flash_t *flash = g_store_flash;
+    bcm_store_page_header_t *header = page_header();
+    
+    g_store_stats.pages_read++;
+    if (flash->read(flash, page, g_store_page) != 0 ||
+        header->magic != BCM_STORE_MAGIC || header->version != BCM_STORE_VERSION ||
+        header->seq == 0U || header->count > g_store_per_page) {
+        return 0;
+    }
+    
+    uint32_t crc = header->crc;
+    header->crc = 0;
+    bool valid = store_crc32((const uint8_t *)g_store_page, flash->page_size) == crc;
+    header->crc = crc;
+    return valid ? header->seq : 0U;
+}
+
+/**
+ * @brief Find the newest page and the next write position
+ */
+static void store_mount(void)
+{
+    uint32_t count = g_store_flash->page_count;
+    uint32_t newest;
+    uint32_t first = page_load(0);
+    
+    if (first == 0U) {
+        if (page_load(count - 1U) == 0U) {
+            g_store_newest = STORE_NO_PAGE;
+            g_store_head = 0;
+            g_store_seq = 1;
+            memset(&g_store_checkpoint, 0, sizeof(g_store_checkpoint));
+            return;
+        }
+        newest = count - 1U;
+    } else {
+        uint32_t lo = 0;
+        uint32_t hi = count - 1U;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo + 1U) / 2U;
+            if (page_load(mid) == first + mid) {
+                lo = mid;
+            } else {
+                hi = mid - 1U;
+            }
+        }
+        newest = lo;
+        (void)page_load(newest); /* The search may have ended on another page */
+    }
+    
+    g_store_checkpoint = *page_header();
+    g_store_newest = newest;
+    g_store_head = (newest + 1U) % count;
+    g_store_seq = g_store_checkpoint.seq + 1U;
+    g_store_stats.events = g_store_checkpoint.events + g_store_checkpoint.count;
+}
+
+/**
+ * @brief Erase the head page and program it with the oldest staged records
+ * @return 0 on success, -1 if the flash refused (records stay staged)
+ */
+static int store_write_page(uint32_t count)
+{
+    const bcm_flash_t *flash = g_store_flash;
+    const fault_state_t *fault = sys_fault_get();
+    bcm_store_page_header_t *header = page_header();
+    
+    memset(g_store_page, STORE_ERASED, flash->page_size);
+    memset(header, 0, sizeof(*header));
+    header->magic = BCM_STORE_MAGIC;
+    header->seq = g_store_seq;
+    header->version = BCM_STORE_VERSION;
+    header->count = (uint16_t)count;
+    header->events = g_store_stats.events;
+    header->fault_recent_ms = fault->most_recent_time_ms;
+    header->fault_total = fault->total_count;
+    header->fault_recent_code = fault->most_recent_code;
+    memcpy(page_records(), g_store_stage, count * sizeof(event_log_entry_t));
+    header->crc = store_crc32((const uint8_t *)g_store_page, flash->page_size);
+    
+    if (flash->erase(flash, g_store_head) != 0) {
+        g_store_stats.write_errors++;
+        return -1;
+    }
+    g_store_stats.erases++;
+    if (flash->program(flash, g_store_head, g_store_page) != 0) {
+        g_store_stats.write_errors++;
+        return -1;
+    }
+    g_store_stats.pages_written++;
+    
+    g_store_checkpoint = *header;
+    g_store_newest = g_store_head;
+    g_store_head = (g_store_head + 1U) % flash->page_count;
+    g_store_seq++;
+    g_store_stats.events += count;
+    
+    g_store_stats.staged -= count;
+    memmove(g_store_stage, &g_store_stage[count],
+            g_store_stats.staged * sizeof(event_log_entry_t));
+    return 0;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+int bcm_store_open(const bcm_flash_t *flash)
+{
+    if (flash == NULL || g_store_flash != NULL ||
+        flash->read == NULL || flash->program == NULL || flash->erase == NULL ||
+        flash->page_count < 2U || flash->page_size < 64U ||
+        flash->page_size > BCM_STORE_PAGE_MAX || (flash->page_size % 8U) != 0U) {
+        return -1;
+    }
+    
+    g_store_flash = flash;
+    g_store_owner = NULL;
+    g_store_per_page = (flash->page_size - (uint32_t)sizeof(bcm_store_page_header_t)) /
+                       (uint32_t)sizeof(event_log_entry_t);
+    memset(&g_store_stats, 0, sizeof(g_store_stats));
+    store_mount();
+    return 0;
+}
+
+void bcm_store_close(void)
+{
+    if (g_store_flash == NULL) {
+        return;
+    }
+    
+    (void)bcm_store_release();
+    g_store_flash = NULL;
+    g_store_newest = STORE_NO_PAGE;
+}
+
+bool bcm_store_is_open(void)
+{
+    return g_store_flash != NULL;
+}
+
+void bcm_store_event(uint8_t type, const uint8_t *data)
+{
+    if (!store_owned() || type >= EVENT_TYPE_COUNT ||
+        (BCM_STORE_EVENT_MASK & EVENT_MASK(type)) == 0U) {
+        return;
+    }
+    
+    if (g_store_stats.staged >= BCM_STORE_STAGE_RECORDS) {
+        g_store_stats.records_dropped++;
+        return;
+    }
+    
+    event_log_entry_t *entry = &g_store_stage[g_store_stats.staged++];
+    entry->timestamp_ms = sys_state_get()->uptime_ms;
+    entry->type = type;
+    if (data != NULL) {
+        memcpy(entry->data, data, sizeof(entry->data));
+    } else {
+        memset(entry->data, 0, sizeof(entry->data));
+    }
+}
+
+void bcm_store_process(void)
+{
+    if (!store_owned()) {
+        return;
+    }
+    
+    while (g_store_stats.staged >= g_store_per_page) {
+        if (store_write_page(g_store_per_page) != 0) {
+            return; /* Retried on the next run */
+        }
+    }
+    
+    uint32_t now_ms = sys_state_get()->uptime_ms;
+    if (g_store_stats.staged > 0U &&
+        (uint32_t)(now_ms - g_store_stage[0].timestamp_ms) >= BCM_STORE_FLUSH_AGE_MS) {
+        (void)store_write_page(g_store_stats.staged);
+    }
+}
+
+int bcm_store_sync(void)
+{
+    if (!store_owned()) {
+        return 0;
+    }
+    
+    while (g_store_stats.staged > 0U) {
+        uint32_t count = (g_store_stats.staged < g_store_per_page) ?
+                         g_store_stats.staged : g_store_per_page;
+        if (store_write_page(count) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int bcm_store_release(void)
+{
+    if (!store_owned()) {
+        return 0;
+    }
+    
+    int status = bcm_store_sync();
+    g_store_owner = NULL;
+    return status;
+}
+
+uint32_t bcm_store_restore(void)
+{
+    if (g_store_flash == NULL || g_store_owner != NULL) {
+        return 0; /* No store, or it keeps another instance's history */
+    }
+    
+    g_store_owner = bcm_ctx_current();
+    if (g_store_newest == STORE_NO_PAGE) {
+        return 0;
+    }
+    
+    fault_state_t *fault = sys_fault_get_mut();
+    fault->total_count = g_store_checkpoint.fault_total;
+    fault->most_recent_code = g_store_checkpoint.fault_recent_code;
+    fault->most_recent_time_ms = g_store_checkpoint.fault_recent_ms;
+    
+    /* Newest pages first, filling the buffer from its end */
+    event_log_entry_t restored[BCM_STORE_RESTORE_EVENTS];
+    uint32_t count = g_store_flash->page_count;
+    uint32_t page = g_store_newest;
+    uint32_t seq = g_store_checkpoint.seq;
+    uint32_t held = 0;
+    
+    for (uint32_t n = 0; n < count && held < BCM_STORE_RESTORE_EVENTS && seq != 0U; n++) {
+        if (page_load(page) != seq) {
+            break; /* Erased, torn or from an older lap */
+        }
+        
+        uint32_t take = page_header()->count;
+        if (take > BCM_STORE_RESTORE_EVENTS - held) {
+            take = BCM_STORE_RESTORE_EVENTS - held;
+        }
+        held += take;
+        memcpy(&restored[BCM_STORE_RESTORE_EVENTS - held],
+               &page_records()[page_header()->count - take],
+               take * sizeof(event_log_entry_t));
+        
+        page = (page + count - 1U) % count;
+        seq--;
+    }
+    
+    event_log_restore(&restored[BCM_STORE_RESTORE_EVENTS - held], held);
+    return held;
+}
+
+void bcm_store_get_stats(bcm_store_stats_t *stats)
+{
+    if (stats != NULL) {
+        *stats = g_store_stats;
+    }
+}
@@ -0,0 +1,215 @@
+/**
+ * @file bcm_timing.c
+ * @brief Task Execution Time Instrumentation
+ *
+ * Statistics live in the bound instance's core, so each BCM of a fleet
+ * reports its own times. Recording is a clock read, a clz and a few
+ * adds; percentiles are only computed when the 1000ms report is built.
+ */
+
+#define _DEFAULT_SOURCE     /* clock_gettime under -std=c11 */
+
+#include <string.h>
+#include <time.h>
+#include "bcm_timing.h"
+#include "bcm_ctx_internal.h"
+#include "can_ids.h"
+#include "can_messages.h"
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+#if BCM_FEATURE_TASK_TIMING
+
+/**
+ * @brief Statistics of a slot on the bound instance, NULL if invalid
+ */
+static bcm_timing_stats_t *timing_slot(uint8_t slot)
+{
+    if (slot >= BCM_TIMING_SLOT_COUNT) {
+        return NULL;
+    }
+    return &bcm_ctx_current()->core->timing[slot];
+}
+
+/**
+ * @brief Reset one slot so the first run sets min and max
+ */
+static void timing_clear(bcm_timing_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->min_ns = UINT32_MAX;
+}
+
+#endif /* BCM_FEATURE_TASK_TIMING */
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+uint8_t bcm_timing_encode(uint32_t ns)
+{
+    if (ns < 4U) {
+        return (uint8_t)ns;
+    }
+    
+    /* Octave from the top bit, sub-bucket from the next two */
+    uint32_t msb = 31U - (uint32_t)__builtin_clz(ns);
+    return (uint8_t)(((msb - 1U) << 2) | ((ns >> (msb - 2U)) & 3U));
+}
+
+uint32_t bcm_timing_decode(uint8_t code)
+{
+    if (code < 4U) {
+        return code;
+    }
+    
+    uint32_t shift = (uint32_t)(code >> 2) - 1U;
+    if (shift > 29U) {
+        return UINT32_MAX; /* 4 << 30 no longer fits */
+    }
+    return (4U + (code & 3U)) << shift;
+}
+
+uint64_t bcm_timing_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void bcm_timing_record(uint8_t slot, uint32_t ns)
+{
+#if BCM_FEATURE_TASK_TIMING
+    bcm_timing_stats_t *stats = timing_slot(slot);
+    if (stats == NULL) {
+        return;
+    }
+    
+    uint8_t code = bcm_timing_encode(ns);
+    if (code >= BCM_TIMING_BUCKETS) {
+        code = (uint8_t)(BCM_TIMING_BUCKETS - 1U);
+    }
+    
+    stats->runs++;
+    stats->total_ns += ns;
+    stats->hist[code]++;
+    if (ns < stats->min_ns) {
+        stats->min_ns = ns;
+    }
+    if (ns > stats->max_ns) {
+        stats->max_ns = ns;
+    }
+#else
+    (void)slot;
+    (void)ns;
+#endif
+}
+
+bool bcm_timing_get(uint8_t slot, bcm_timing_stats_t *stats)
+{
+#if BCM_FEATURE_TASK_TIMING
+    const bcm_timing_stats_t *src = timing_slot(slot);
+    if (src == NULL || stats == NULL) {
+        return false;
+    }
+    
+    *stats = *src;
+    return true;
+#else
+    (void)slot;
+    (void)stats;
+    return false;
+#endif
+}
+
+uint32_t bcm_timing_percentile_ns(uint8_t slot, uint8_t pct)
+{
+#if BCM_FEATURE_TASK_TIMING
+    const bcm_timing_stats_t *stats = timing_slot(slot);
+    if (stats == NULL || stats->runs == 0U || pct == 0U) {
+        return 0;
+    }
+    if (pct > 100U) {
+        pct = 100U;
+    }
+    
+    /* Smallest bucket holding the ceil(runs * pct / 100)-th run */
+    uint64_t rank = ((uint64_t)stats->runs * pct + 99U) / 100U;
+    uint64_t seen = 0;
+    for (uint8_t code = 0; code < BCM_TIMING_BUCKETS; code++) {
+        seen += stats->hist[code];
+        if (seen >= rank) {
+            return bcm_timing_decode(code);
+        }
+    }
+    return bcm_timing_decode((uint8_t)(BCM_TIMING_BUCKETS - 1U));
+#else
+    (void)slot;
+    (void)pct;
+    return 0;
+#endif
+}
+
+uint32_t bcm_timing_mean_ns(uint8_t slot)
+{
+#if BCM_FEATURE_TASK_TIMING
+    const bcm_timing_stats_t *stats = timing_slot(slot);
+    if (stats == NULL || stats->runs == 0U) {
+        return 0;
+    }
+    return (uint32_t)(stats->total_ns / stats->runs);
+#else
+    (void)slot;
+    return 0;
+#endif
+}
+
+void bcm_timing_reset(void)
+{
+#if BCM_FEATURE_TASK_TIMING
+    for (uint8_t slot = 0; slot < BCM_TIMING_SLOT_COUNT; slot++) {
+        timing_clear(timing_slot(slot));
+    }
+    bcm_ctx_current()->core->tx_counter_timing = 0;
+#endif
+}
+
+void bcm_timing_build_frame(uint8_t slot, can_frame_t *frame)
+{
+    if (frame == NULL) {
+        return;
+    }
+    
+    can_frame_template_init(frame, CAN_ID_BCM_TIMING, BCM_TIMING_DLC, CAN_CHECKSUM_SEED);
+
+#if BCM_FEATURE_TASK_TIMING
+    bcm_timing_stats_t stats;
+    uint8_t late = 0;
+    if (!bcm_timing_get(slot, &stats)) {
+        return;
+    }
+    if (slot < BCM_TASK_COUNT) {
+        uint32_t runs = bcm_get_task_late_runs((bcm_task_id_t)slot);
+        late = (runs > UINT8_MAX) ? UINT8_MAX : (uint8_t)runs;
+    }
+    
+    can_msg_bcm_timing_t msg = {0};
+    msg.slot = slot;
+    
+    /* p50, p99, max and mean as time codes */
+    msg.p50 = bcm_timing_encode(bcm_timing_percentile_ns(slot, 50));
+    msg.p99 = bcm_timing_encode(bcm_timing_percentile_ns(slot, 99));
+    msg.max = bcm_timing_encode(stats.max_ns);
+    msg.mean = bcm_timing_encode(bcm_timing_mean_ns(slot));
+    msg.late = late;
+    
+    /* Only changed bytes are written; the checksum follows can_frame_put() */
+    bcm_core_t *core = bcm_ctx_current()->core;
+    can_msg_bcm_timing_update(frame, &msg, core->tx_counter_timing);
+    core->tx_counter_timing = (uint8_t)((core->tx_counter_timing + 1U) & CAN_COUNTER_MASK);
+#else
+    (void)slot;
+#endif
+}
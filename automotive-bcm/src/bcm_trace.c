@@ -0,0 +1,153 @@
+/**
+ * @file bcm_trace.c
+ * @brief Binary Trace Ring Implementation
+ *
+ * The file is preallocated with posix_fallocate() so a full disk fails
+ * at open instead of raising SIGBUS on a later store into the mapping.
+ */
+
+#define _DEFAULT_SOURCE     /* posix_fallocate/MAP_SHARED under -std=c11 */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "bcm_trace.h"
+#include "bcm_config.h"
+#include "system_state.h"
+
+_Static_assert(sizeof(bcm_trace_record_t) == 24U, "trace record layout");
+_Static_assert(sizeof(bcm_trace_header_t) == 64U, "trace header layout");
+
+/*******************************************************************************
+ * Private Data
+ ******************************************************************************/
+
+static bcm_trace_header_t  *g_trace_header = NULL;
+static bcm_trace_record_t  *g_trace_records = NULL;
+static size_t               g_trace_map_size = 0;
+static uint32_t             g_trace_mask = 0;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+/**
+ * @brief Claim the next ring slot and fill the common fields
+ */
+static bcm_trace_record_t *trace_next(uint8_t kind, uint32_t id, uint8_t dlc,
+                                      uint8_t result)
+{
+    uint64_t n = g_trace_header->written++;
+    bcm_trace_record_t *rec = &g_trace_records[(uint32_t)n & g_trace_mask];
+    
+    rec->seq = (uint32_t)(n + 1U);
+    rec->timestamp_ms = sys_state_get()->uptime_ms;
+    rec->id = id;
+    rec->kind = kind;
+    rec->dlc = dlc;
+    rec->result = result;
+    rec->reserved = 0;
+    
+    return rec;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+int bcm_trace_open(const char *path, uint32_t records)
+{
+    if (path == NULL || g_trace_header != NULL) {
+        return -1;
+    }
+    
+    if (records == 0U) {
+        records = BCM_TRACE_DEFAULT_RECORDS;
+    }
+    if (records > (1UL << 30)) {
+        return -1;
+    }
+    
+    uint32_t capacity = 1U;
+    while (capacity < records) {
+        capacity <<= 1;
+    }
+    
+    size_t size = sizeof(bcm_trace_header_t) +
+                  (size_t)capacity * sizeof(bcm_trace_record_t);
+    
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    if (posix_fallocate(fd, 0, (off_t)size) != 0) {
+        close(fd);
+        return -1;
+    }
+    
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); /* The mapping keeps the file referenced */
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    
+    /* Fresh file: every slot reads back as seq 0 (unused) */
+    g_trace_header = (bcm_trace_header_t *)map;
+    g_trace_records = (bcm_trace_record_t *)(g_trace_header + 1);
+    g_trace_map_size = size;
+    g_trace_mask = capacity - 1U;
+    
+    g_trace_header->magic = BCM_TRACE_MAGIC;
+    g_trace_header->version = BCM_TRACE_VERSION;
+    g_trace_header->record_size = (uint16_t)sizeof(bcm_trace_record_t);
+    g_trace_header->capacity = capacity;
+    g_trace_header->written = 0;
+    
+    return 0;
+}
+
+void bcm_trace_close(void)
+{
+    if (g_trace_header == NULL) {
+        return;
+    }
+    
+    (void)msync(g_trace_header, g_trace_map_size, MS_SYNC);
+    (void)munmap(g_trace_header, g_trace_map_size);
+    
+    g_trace_header = NULL;
+    g_trace_records = NULL;
+    g_trace_map_size = 0;
+    g_trace_mask = 0;
+}
+
+bool bcm_trace_is_open(void)
+{
+    return g_trace_header != NULL;
+}
+
+void bcm_trace_frame(bcm_trace_kind_t kind, const can_frame_t *frame, uint8_t result)
+{
+    if (g_trace_header == NULL || frame == NULL) {
+        return;
+    }
+    
+    bcm_trace_record_t *rec = trace_next((uint8_t)kind, frame->id, frame->dlc, result);
+    memcpy(rec->data, frame->data, CAN_FRAME_MAX_DLC);
+}
+
+void bcm_trace_event(uint8_t type, const uint8_t *data)
+{
+    if (g_trace_header == NULL) {
+        return;
+    }
+    
+    bcm_trace_record_t *rec = trace_next((uint8_t)BCM_TRACE_EVENT, type, 4U,
+                                         BCM_TRACE_RESULT_NONE);
+    memset(rec->data, 0, CAN_FRAME_MAX_DLC);
+    if (data != NULL) {
+        memcpy(rec->data, data, 4);
+    }
+}
@@ -0,0 +1,160 @@
+/**
+ * @file can_check.c
+ * @brief Shared RX Frame Validation Kernel Implementation
+ *
+ * Checksums are folded 64 bits at a time: the payload is loaded as one
+ * word, bytes past the DLC are masked off and the word is XOR-folded down
+ * to a byte. A frame is valid when the fold over all DLC bytes (checksum
+ * included) equals CAN_CHECKSUM_SEED.
+ */
+
+#include <string.h>
+#include "can_check.h"
+
+/*******************************************************************************
+ * Private Data
+ ******************************************************************************/
+
+/** Byte masks selecting the first n payload bytes, n = 0..8 */
+static const uint8_t g_dlc_mask[CAN_FRAME_MAX_DLC + 1U][CAN_FRAME_MAX_DLC] = {
+    { 0 },
+    { 0xFF },
+    { 0xFF, 0xFF },
+    { 0xFF, 0xFF, 0xFF },
+    { 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+};
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+/**
+ * @brief XOR of the first dlc payload bytes
+ */
+static uint8_t xor_fold(const can_frame_t *frame)
+{
+    uint8_t dlc = (frame->dlc > CAN_FRAME_MAX_DLC) ? CAN_FRAME_MAX_DLC : frame->dlc;
+    uint64_t data;
+    uint64_t mask;
+    
+    memcpy(&data, frame->data, sizeof(data));
+    memcpy(&mask, g_dlc_mask[dlc], sizeof(mask));
+    
+    data &= mask;
+    data ^= data >> 32;
+    data ^= data >> 16;
+    data ^= data >> 8;
+    return (uint8_t)data;
+}
+
+/**
+ * @brief Check counter and field rules of a frame with good DLC and checksum
+ */
+static uint8_t check_fields(const can_msg_desc_t *desc, const can_frame_t *frame,
+                            can_rx_counter_t *counter)
+{
+    uint8_t flags = CAN_CHECK_OK;
+    
+    if (counter != NULL) {
+        uint8_t value = CAN_GET_COUNTER(frame->data[desc->ver_ctr_byte]);
+        if (counter->seen != 0U && !can_validate_counter(value, counter->last)) {
+            flags |= CAN_CHECK_BAD_COUNTER;
+        } else {
+            counter->last = value;
+            counter->seen = 1U;
+        }
+    }
+    
+    for (uint8_t i = 0; i < desc->field_count; i++) {
+        const can_field_rule_t *rule = &desc->fields[i];
+        uint8_t value = frame->data[rule->byte] & rule->mask;
+        if (value < rule->min || value > rule->max) {
+            flags |= CAN_CHECK_BAD_FIELD;
+            break;
+        }
+    }
+    
+    return flags;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+uint16_t can_check_checksums(const can_frame_t *frames, uint8_t count)
+{
+    uint16_t bad = 0;
+    
+    if (count > CAN_BATCH_MAX) {
+        count = CAN_BATCH_MAX;
+    }
+    
+    for (uint8_t i = 0; i < count; i++) {
+        if (frames[i].dlc == 0U || xor_fold(&frames[i]) != CAN_CHECKSUM_SEED) {
+            bad |= (uint16_t)(1U << i);
+        }
+    }
+    
+    return bad;
+}
+
+uint16_t can_check_batch(const can_msg_desc_t *desc, const can_frame_t *frames,
+                         uint8_t count, can_rx_counter_t *counter, uint8_t *flags)
+{
+    if (count > CAN_BATCH_MAX) {
+        count = CAN_BATCH_MAX;
+    }
+    
+    uint16_t bad_checksum = can_check_checksums(frames, count);
+    uint16_t bad = 0;
+    
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t result;
+        
+        if (frames[i].dlc != desc->dlc) {
+            result = CAN_CHECK_BAD_DLC;
+        } else if ((bad_checksum & (1U << i)) != 0U) {
+            result = CAN_CHECK_BAD_CHECKSUM;
+        } else {
+            result = check_fields(desc, &frames[i], counter);
+        }
+        
+        if (result != CAN_CHECK_OK) {
+            bad |= (uint16_t)(1U << i);
+        }
+        if (flags != NULL) {
+            flags[i] = result;
+        }
+    }
+    
+    return bad;
+}
+
+uint8_t can_check_frame(const can_msg_desc_t *desc, const can_frame_t *frame,
+                        can_rx_counter_t *counter)
+{
+    uint8_t flags = CAN_CHECK_OK;
+    (void)can_check_batch(desc, frame, 1U, counter, &flags);
+    return flags;
+}
+
+cmd_result_t can_check_to_result(uint8_t flags)
+{
+    if ((flags & CAN_CHECK_BAD_DLC) != 0U) {
+        return CMD_RESULT_INVALID_CMD;
+    }
+    if ((flags & CAN_CHECK_BAD_CHECKSUM) != 0U) {
+        return CMD_RESULT_CHECKSUM_ERROR;
+    }
+    if ((flags & CAN_CHECK_BAD_COUNTER) != 0U) {
+        return CMD_RESULT_COUNTER_ERROR;
+    }
+    if ((flags & CAN_CHECK_BAD_FIELD) != 0U) {
+        return CMD_RESULT_INVALID_CMD;
+    }
+    return CMD_RESULT_OK;
+}
@@ -4,37 +4,60 @@
  *
  * BCM_SIL=1: Linux SocketCAN implementation
  * BCM_SIL=0: Stub in-memory queue implementation
+ *
+ * Socket, queues and statistics belong to the bound BCM instance
+ * (can_port_t in bcm_ctx_internal.h). Every frame sent or received is
+ * counted per ID and toward the bus load estimate. CAN FD frames bypass
+ * the classic batch path: one write() each on SocketCAN, a small FD TX
+ * queue in stub mode.
+ *
+ * Classic frames the backend cannot take (stub TX queue or kernel socket
+ * queue full) wait in a small per-bus TX scheduler instead of being
+ * dropped. It releases them lowest ID first, as bus arbitration would,
+ * and keeps only the newest pending copy of a status frame.
+ *
+ * Each bus (can_port_t) is opened from one name of the can_init() list.
+ * TX picks the bus from a short route table in can_backend_t. On
+ * SocketCAN a bus may get an RX thread that moves frames from its socket
+ * into an SPSC ring; the BCM thread then drains the ring instead of the
+ * socket, exactly like the stub RX queue.
  */
 
+#ifdef BCM_SIL
+#define _GNU_SOURCE     /* recvmmsg/sendmmsg, struct ifreq */
+#endif
+
 #include <string.h>
 #include <stdio.h>
 #include "can_interface.h"
+#include "bcm_log.h"
+#include "bcm_trace.h"
+#include "bcm_config.h"     /* CAN_RX_QUEUE_SIZE, CAN_TX_QUEUE_SIZE */
+#include "bcm_ctx_internal.h"
 
 /*******************************************************************************
  * Configuration
  ******************************************************************************/
 
-#define CAN_RX_QUEUE_SIZE   32U
-#define CAN_TX_QUEUE_SIZE   16U
+/* Own TX frames echoed to other local sockets (candump on vcan) */
+#ifndef CAN_SIL_LOOPBACK
+#define CAN_SIL_LOOPBACK    1
+#endif
 
-/*******************************************************************************
- * Private Types
- ******************************************************************************/
+#define CAN_IFNAME_MAX      16U     /**< IFNAMSIZ, terminator included */
 
-typedef struct {
-    can_frame_t frames[CAN_RX_QUEUE_SIZE];
-    uint8_t     head;
-    uint8_t     tail;
-    uint8_t     count;
-} can_queue_t;
+_Static_assert((CAN_RX_QUEUE_SIZE & (CAN_RX_QUEUE_SIZE - 1U)) == 0U,
+               "CAN_RX_QUEUE_SIZE must be a power of two");
+_Static_assert(CAN_BUS_MAX >= 1U && CAN_BUS_MAX <= 8U, "CAN_BUS_MAX must be 1 to 8");
+#ifndef BCM_SIL
+_Static_assert((CAN_TX_QUEUE_SIZE & (CAN_TX_QUEUE_SIZE - 1U)) == 0U,
+               "CAN_TX_QUEUE_SIZE must be a power of two");
+#endif
 
 /*******************************************************************************
  * Private Data
  ******************************************************************************/
 
-static bool         g_initialized = false;
-static can_stats_t  g_stats;
-
 #ifdef BCM_SIL
 /* SocketCAN specific */
 #include <sys/socket.h>
@@ -45,56 +68,291 @@ static can_stats_t  g_stats;
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
 
-static int g_socket_fd = -1;
+#include <stddef.h>
 
-#else
-/* Stub mode specific */
-static can_queue_t  g_rx_queue;
-static can_queue_t  g_tx_queue;
-static can_frame_t  g_last_tx;
-static bool         g_last_tx_valid = false;
+/* can_frame_t is passed to the kernel as-is */
+_Static_assert(sizeof(can_frame_t) == sizeof(struct can_frame),
+               "can_frame_t must match struct can_frame");
+_Static_assert(offsetof(can_frame_t, data) == offsetof(struct can_frame, data),
+               "can_frame_t payload offset must match struct can_frame");
+_Static_assert(sizeof(can_fd_frame_t) == CANFD_MTU,
+               "can_fd_frame_t must match struct canfd_frame");
+_Static_assert(offsetof(can_fd_frame_t, flags) == offsetof(struct canfd_frame, flags) &&
+               offsetof(can_fd_frame_t, data) == offsetof(struct canfd_frame, data),
+               "can_fd_frame_t layout must match struct canfd_frame");
+_Static_assert(CAN_IFNAME_MAX <= IFNAMSIZ, "CAN_IFNAME_MAX must fit in ifr_name");
+
+/* Batched RX/TX: one mmsghdr per frame, iovecs point at caller buffers.
+ * Only scratch for a single call, so they are per thread, not per instance. */
+static _Thread_local struct iovec     g_rx_iov[CAN_BATCH_MAX];
+static _Thread_local struct mmsghdr   g_rx_msgs[CAN_BATCH_MAX];
+/* SO_RXQ_OVFL drop counter; CMSG_SPACE() keeps every row aligned */
+static _Thread_local _Alignas(struct cmsghdr) char
+    g_rx_ctrl[CAN_BATCH_MAX][CMSG_SPACE(sizeof(uint32_t))];
+static _Thread_local struct iovec     g_tx_iov[CAN_BATCH_MAX];
+static _Thread_local struct mmsghdr   g_tx_msgs[CAN_BATCH_MAX];
+static _Thread_local bool             g_batch_ready = false;
 
 #endif
 
 /*******************************************************************************
- * Queue Operations (Stub Mode)
+ * Private Functions
  ******************************************************************************/
 
-#ifndef BCM_SIL
+/**
+ * @brief CAN buses of the bound instance
+ */
+static can_backend_t *can_backend(void)
+{
+    return bcm_ctx_current()->can;
+}
 
-static void queue_init(can_queue_t *q)
+/**
+ * @brief Bus 0 of the bound instance
+ */
+static can_port_t *can_port(void)
 {
-    q->head = 0;
-    q->tail = 0;
-    q->count = 0;
+    return &can_backend()->ports[CAN_BUS_BODY];
 }
 
-static bool queue_push(can_queue_t *q, const can_frame_t *frame, uint8_t max_size)
+/**
+ * @brief One bus of the bound instance, NULL if out of range
+ */
+static can_port_t *bus_port(uint8_t bus)
 {
-    if (q->count >= max_size) {
-        return false;
+    return (bus < CAN_BUS_MAX) ? &can_backend()->ports[bus] : NULL;
+}
+
+/**
+ * @brief Bus an ID is transmitted on
+ */
+static uint8_t route_bus(const can_backend_t *can, uint32_t id)
+{
+    for (uint8_t i = 0; i < can->route_count; i++) {
+        if (can->routes[i].id == id) {
+            return can->routes[i].bus;
+        }
     }
+    return CAN_BUS_BODY;
+}
+
+/**
+ * @brief Bus an ID is transmitted on, as a port
+ */
+static can_port_t *tx_port(uint32_t id)
+{
+    can_backend_t *can = can_backend();
+    return &can->ports[route_bus(can, id)];
+}
+
+/*******************************************************************************
+ * Statistics
+ ******************************************************************************/
+
+/**
+ * @brief Add to a counter that only the calling thread writes
+ *
+ * A relaxed load and store instead of a read-modify-write: no locked
+ * instruction, readers on other threads still see whole values.
+ */
+static void stat_add(atomic_uint_least32_t *counter, uint32_t n)
+{
+    uint32_t value = (uint32_t)atomic_load_explicit(counter, memory_order_relaxed);
+    atomic_store_explicit(counter, value + n, memory_order_relaxed);
+}
+
+static uint32_t stat_get(atomic_uint_least32_t *counter)
+{
+    return (uint32_t)atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+/**
+ * @brief Zero all counters (from the BCM loop only)
+ */
+static void stats_clear(can_port_t *port)
+{
+    memset(&port->stats, 0, sizeof(port->stats));
+    memset(port->id_stats, 0, sizeof(port->id_stats));
+}
+
+/**
+ * @brief Find the per-ID slot of an ID, claiming a free one if needed
+ * @return Slot, or NULL if the ID is new and the table is full
+ */
+static can_id_counter_t *id_slot(can_port_t *port, uint32_t id, bool claim)
+{
+    const uint32_t mask = CAN_STATS_ID_SLOTS - 1U;
+    uint32_t key = id + 1U;
+    uint32_t home = (id ^ (id >> 5)) & mask; /* Spreads the 0x10-spaced BCM IDs */
     
-    q->frames[q->tail] = *frame;
-    q->tail = (q->tail + 1U) % max_size;
-    q->count++;
-    return true;
+    for (uint32_t probe = 0; probe < CAN_STATS_ID_SLOTS; probe++) {
+        can_id_counter_t *slot = &port->id_stats[(home + probe) & mask];
+        uint32_t k = stat_get(&slot->key);
+        
+        if (k == key) {
+            return slot;
+        }
+        if (k == 0U) {
+            if (!claim) {
+                return NULL;
+            }
+            atomic_store_explicit(&slot->key, key, memory_order_release);
+            return slot;
+        }
+    }
+    return NULL;
 }
 
-static bool queue_pop(can_queue_t *q, can_frame_t *frame, uint8_t max_size)
+/**
+ * @brief Count one frame of an ID in its per-ID slot
+ */
+static void stats_count_id(can_port_t *port, uint32_t id, bool tx, uint32_t now_ms)
 {
-    if (q->count == 0) {
-        return false;
+    can_id_counter_t *slot = id_slot(port, id, true);
+    
+    if (slot == NULL) {
+        stat_add(&port->stats.id_overflow, 1U);
+    } else if (tx) {
+        stat_add(&slot->tx_count, 1U);
+        atomic_store_explicit(&slot->last_tx_ms, now_ms, memory_order_relaxed);
+    } else {
+        stat_add(&slot->rx_count, 1U);
+        atomic_store_explicit(&slot->last_rx_ms, now_ms, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Count frames that went over the bus, per ID and toward bus load
+ *
+ * Transmitted frames are traced here too, once they leave the scheduler,
+ * so the trace matches tx_count. RX is traced by bcm.c with its result.
+ */
+static void stats_account(can_port_t *port, const can_frame_t *frames,
+                          uint32_t count, bool tx)
+{
+    if (count == 0U) {
+        return;
     }
     
-    *frame = q->frames[q->head];
-    q->head = (q->head + 1U) % max_size;
-    q->count--;
-    return true;
+    uint32_t now_ms = bcm_ctx_current()->state->uptime_ms;
+    uint32_t bits = 0;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        bits += can_frame_bits(frames[i].dlc);
+        stats_count_id(port, frames[i].id, tx, now_ms);
+        if (tx) {
+            bcm_trace_frame(BCM_TRACE_TX, &frames[i], BCM_TRACE_RESULT_NONE);
+        }
+    }
+    
+    stat_add(tx ? &port->stats.tx_count : &port->stats.rx_count, count);
+    stat_add(&port->stats.window_bits, bits);
+}
+
+/**
+ * @brief Count a transmitted CAN FD frame
+ */
+static void stats_account_fd_tx(can_port_t *port, const can_fd_frame_t *frame)
+{
+    stats_count_id(port, frame->id, true, bcm_ctx_current()->state->uptime_ms);
+    stat_add(&port->stats.tx_count, 1U);
+    stat_add(&port->stats.window_bits, can_fd_frame_bits(frame->len, frame->flags));
+}
+
+/**
+ * @brief True if len is one of the CAN FD payload lengths
+ */
+static bool fd_len_valid(uint8_t len)
+{
+    return len <= CAN_FD_MAX_LEN && can_fd_len_round(len) == len;
+}
+
+/**
+ * @brief Count frames that could not be queued for transmission
+ */
+static void stats_tx_failed(can_port_t *port, uint32_t count, can_status_t status)
+{
+    stat_add(&port->stats.tx_errors, count);
+    if (status == CAN_STATUS_BUFFER_FULL) {
+        stat_add(&port->stats.tx_dropped, count);
+    }
+}
+
+/*******************************************************************************
+ * Ring Operations
+ ******************************************************************************/
+
+/**
+ * @brief Reset a ring (not safe while a producer is running)
+ */
+static void ring_init(can_ring_t *r, can_frame_t *frames, uint32_t size)
+{
+    r->frames = frames;
+    r->mask = size - 1U;
+    atomic_store_explicit(&r->head, 0U, memory_order_relaxed);
+    atomic_store_explicit(&r->tail, 0U, memory_order_release);
+}
+
+#ifndef BCM_SIL
+/**
+ * @brief Number of frames currently queued
+ */
+static uint32_t ring_count(can_ring_t *r)
+{
+    uint_fast32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    uint_fast32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    return (uint32_t)(tail - head);
+}
+#endif
+
+/**
+ * @brief Producer side: append up to count frames
+ * @return Number of frames queued (less than count if the ring filled)
+ */
+static uint32_t ring_push_bulk(can_ring_t *r, const can_frame_t *frames, uint32_t count)
+{
+    uint_fast32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint_fast32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    uint32_t space = (r->mask + 1U) - (uint32_t)(tail - head);
+    
+    if (count > space) {
+        count = space;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        r->frames[(tail + i) & r->mask] = frames[i];
+    }
+    
+    /* Publish the frames before the new tail becomes visible */
+    atomic_store_explicit(&r->tail, tail + count, memory_order_release);
+    return count;
 }
 
-#endif /* !BCM_SIL */
+/**
+ * @brief Consumer side: remove up to max_frames frames
+ * @return Number of frames copied to frames
+ */
+static uint32_t ring_pop_bulk(can_ring_t *r, can_frame_t *frames, uint32_t max_frames)
+{
+    uint_fast32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint_fast32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    uint32_t count = (uint32_t)(tail - head);
+    
+    if (count > max_frames) {
+        count = max_frames;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        frames[i] = r->frames[(head + i) & r->mask];
+    }
+    
+    /* Release the slots only after they have been copied out */
+    atomic_store_explicit(&r->head, head + count, memory_order_release);
+    return count;
+}
 
 /*******************************************************************************
  * SocketCAN Implementation
@@ -102,19 +360,60 @@ static bool queue_pop(can_queue_t *q, can_frame_t *frame, uint8_t max_size)
 
 #ifdef BCM_SIL
 
-can_status_t can_init(const char *ifname)
+/**
+ * @brief Attach each mmsghdr to its iovec once per thread; buffers are set per call
+ */
+static void batch_init(void)
 {
-    if (g_initialized) {
-        return CAN_STATUS_OK;
+    if (g_batch_ready) {
+        return;
     }
     
-    if (ifname == NULL) {
-        ifname = "vcan0";
-    }
+    memset(g_rx_msgs, 0, sizeof(g_rx_msgs));
+    memset(g_tx_msgs, 0, sizeof(g_tx_msgs));
     
+    for (uint8_t i = 0; i < CAN_BATCH_MAX; i++) {
+        g_rx_iov[i].iov_len = sizeof(can_frame_t);
+        g_rx_msgs[i].msg_hdr.msg_iov = &g_rx_iov[i];
+        g_rx_msgs[i].msg_hdr.msg_iovlen = 1;
+        g_rx_msgs[i].msg_hdr.msg_control = g_rx_ctrl[i];
+        
+        g_tx_iov[i].iov_len = sizeof(can_frame_t);
+        g_tx_msgs[i].msg_hdr.msg_iov = &g_tx_iov[i];
+        g_tx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    g_batch_ready = true;
+}
+
+/**
+ * @brief Count socket buffer drops reported with a received frame
+ *
+ * SO_RXQ_OVFL carries the socket's cumulative drop count; only the
+ * increase since the last report is new.
+ */
+static void rx_note_overflow(can_port_t *port, struct msghdr *msg)
+{
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SO_RXQ_OVFL) {
+            continue;
+        }
+        
+        uint32_t drops;
+        memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+        stat_add(&port->stats.rx_dropped, drops - port->rx_ovfl_last);
+        port->rx_ovfl_last = drops;
+    }
+}
+
+/**
+ * @brief Open a raw socket on one interface for a bus
+ */
+static can_status_t port_open(can_port_t *port, const char *ifname)
+{
     /* Create socket */
-    g_socket_fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
-    if (g_socket_fd < 0) {
+    port->socket_fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (port->socket_fd < 0) {
         perror("[CAN] socket");
         return CAN_STATUS_ERROR;
     }
@@ -122,12 +421,12 @@ can_status_t can_init(const char *ifname)
     /* Get interface index */
     struct ifreq ifr;
     memset(&ifr, 0, sizeof(ifr));
-    strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+    memcpy(ifr.ifr_name, ifname, strnlen(ifname, IFNAMSIZ - 1)); /* Zeroed: terminated */
     
-    if (ioctl(g_socket_fd, SIOCGIFINDEX, &ifr) < 0) {
+    if (ioctl(port->socket_fd, SIOCGIFINDEX, &ifr) < 0) {
         perror("[CAN] ioctl SIOCGIFINDEX");
-        close(g_socket_fd);
-        g_socket_fd = -1;
+        close(port->socket_fd);
+        port->socket_fd = -1;
         return CAN_STATUS_ERROR;
     }
     
@@ -137,219 +436,1272 @@ can_status_t can_init(const char *ifname)
     addr.can_family = AF_CAN;
     addr.can_ifindex = ifr.ifr_ifindex;
     
-    if (bind(g_socket_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    if (bind(port->socket_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
         perror("[CAN] bind");
-        close(g_socket_fd);
-        g_socket_fd = -1;
+        close(port->socket_fd);
+        port->socket_fd = -1;
         return CAN_STATUS_ERROR;
     }
     
+    /* Never read back our own TX frames; optional loopback to local sockets */
+    int loopback = CAN_SIL_LOOPBACK;
+    int recv_own = 0;
+    if (setsockopt(port->socket_fd, SOL_CAN_RAW, CAN_RAW_LOOPBACK,
+                   &loopback, sizeof(loopback)) < 0 ||
+        setsockopt(port->socket_fd, SOL_CAN_RAW, CAN_RAW_RECV_OWN_MSGS,
+                   &recv_own, sizeof(recv_own)) < 0) {
+        perror("[CAN] setsockopt loopback");
+    }
+    
+    /* Kernel reports frames dropped on a full socket buffer with each read */
+    int ovfl = 1;
+    if (setsockopt(port->socket_fd, SOL_SOCKET, SO_RXQ_OVFL, &ovfl, sizeof(ovfl)) < 0) {
+        perror("[CAN] setsockopt SO_RXQ_OVFL");
+    }
+    
+    /* CAN FD only on an FD-capable interface; classic traffic is unaffected */
+    port->fd_enabled = false;
+#if BCM_FEATURE_CAN_FD
+    int fd_frames = 1;
+    if (ioctl(port->socket_fd, SIOCGIFMTU, &ifr) < 0 || ifr.ifr_mtu != (int)CANFD_MTU) {
+        BCM_LOG_NOW(BCM_LOG_LEVEL_WARN, "[CAN] %s is not CAN FD capable\n", ifname);
+    } else if (setsockopt(port->socket_fd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES,
+                          &fd_frames, sizeof(fd_frames)) < 0) {
+        perror("[CAN] setsockopt CAN_RAW_FD_FRAMES");
+    } else {
+        port->fd_enabled = true;
+    }
+#endif
+    
     /* Set non-blocking */
-    int flags = fcntl(g_socket_fd, F_GETFL, 0);
-    fcntl(g_socket_fd, F_SETFL, flags | O_NONBLOCK);
+    int flags = fcntl(port->socket_fd, F_GETFL, 0);
+    fcntl(port->socket_fd, F_SETFL, flags | O_NONBLOCK);
     
-    memset(&g_stats, 0, sizeof(g_stats));
-    g_initialized = true;
+    stats_clear(port);
+    ring_init(&port->rx_queue, port->rx_frames, CAN_RX_QUEUE_SIZE);
+    port->rx_ovfl_last = 0;
+    port->rx_threaded = false;
+    port->tx_pending_count = 0;
+    port->initialized = true;
     
-    printf("[CAN] Initialized on %s\n", ifname);
+    BCM_LOG_NOW(BCM_LOG_LEVEL_INFO, "[CAN] Initialized on %s\n", ifname);
     return CAN_STATUS_OK;
 }
 
-void can_deinit(void)
+static void rx_thread_stop(can_port_t *port);
+
+/**
+ * @brief Stop the RX thread of a bus and close its socket
+ */
+static void port_close(can_port_t *port)
+{
+    if (port->initialized && port->rx_threaded) {
+        rx_thread_stop(port);
+    }
+    
+    /* A zeroed, never-initialized instance has socket_fd 0: not ours */
+    if (port->initialized && port->socket_fd >= 0) {
+        close(port->socket_fd);
+        port->socket_fd = -1;
+    }
+    port->initialized = false;
+}
+
+/**
+ * @brief Hand frames to the kernel, one sendmmsg() per CAN_BATCH_MAX
+ * @param sent Output: number of frames the kernel accepted
+ * @return CAN_STATUS_BUFFER_FULL if the socket queue filled (worth a retry),
+ *         CAN_STATUS_ERROR on any other failure
+ */
+static can_status_t tx_write(can_port_t *port, const can_frame_t *frames, uint8_t count,
+                             uint8_t *sent)
 {
-    if (g_socket_fd >= 0) {
-        close(g_socket_fd);
-        g_socket_fd = -1;
+    uint8_t total = 0;
+    can_status_t status = CAN_STATUS_OK;
+    
+    batch_init();
+    
+    while (total < count) {
+        uint8_t chunk = (uint8_t)(count - total);
+        if (chunk > CAN_BATCH_MAX) {
+            chunk = CAN_BATCH_MAX;
+        }
+        
+        for (uint8_t i = 0; i < chunk; i++) {
+            /* sendmmsg() only reads through iov_base */
+            g_tx_iov[i].iov_base = (void *)(uintptr_t)&frames[total + i];
+        }
+        
+        int n = sendmmsg(port->socket_fd, g_tx_msgs, chunk, 0);
+        if (n < 0) {
+            status = (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) ?
+                     CAN_STATUS_BUFFER_FULL : CAN_STATUS_ERROR;
+            break;
+        }
+        
+        stats_account(port, &frames[total], (uint32_t)n, true);
+        total = (uint8_t)(total + n);
+        
+        if (n < chunk) {
+            /* Kernel queue filled part-way through the batch */
+            status = CAN_STATUS_BUFFER_FULL;
+            break;
+        }
     }
-    g_initialized = false;
+    
+    *sent = total;
+    return status;
 }
 
-bool can_is_initialized(void)
+/**
+ * @brief True if the socket has room for more frames
+ *
+ * A full device queue (ENOBUFS) does not always clear POLLOUT, so a
+ * writable socket can still refuse; the frames then simply stay pending.
+ */
+static bool tx_ready(const can_port_t *port)
 {
-    return g_initialized;
+    struct pollfd pfd = { .fd = port->socket_fd, .events = POLLOUT, .revents = 0 };
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLOUT) != 0;
 }
 
-can_status_t can_send(const can_frame_t *frame)
+can_status_t can_send_fd(const can_fd_frame_t *frame)
 {
-    if (!g_initialized || frame == NULL) {
+    if (frame == NULL || !can_port()->initialized) {
         return CAN_STATUS_NOT_INITIALIZED;
     }
     
-    struct can_frame cf;
-    memset(&cf, 0, sizeof(cf));
-    cf.can_id = frame->id;
-    cf.can_dlc = (frame->dlc > CAN_FRAME_MAX_DLC) ? CAN_FRAME_MAX_DLC : frame->dlc;
-    memcpy(cf.data, frame->data, cf.can_dlc);
+    can_port_t *port = tx_port(frame->id);
+    can_status_t status = CAN_STATUS_OK;
+    if (!port->fd_enabled || !fd_len_valid(frame->len)) {
+        status = CAN_STATUS_ERROR;
+    } else if (write(port->socket_fd, frame, CANFD_MTU) != (ssize_t)CANFD_MTU) {
+        status = (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) ?
+                 CAN_STATUS_BUFFER_FULL : CAN_STATUS_ERROR;
+    }
     
-    ssize_t nbytes = write(g_socket_fd, &cf, sizeof(cf));
-    if (nbytes != sizeof(cf)) {
-        g_stats.tx_errors++;
-        return CAN_STATUS_ERROR;
+    if (status != CAN_STATUS_OK) {
+        stats_tx_failed(port, 1U, status);
+        return status;
     }
     
-    g_stats.tx_count++;
+    stats_account_fd_tx(port, frame);
     return CAN_STATUS_OK;
 }
 
-can_status_t can_recv(can_frame_t *frame)
+/**
+ * @brief Read up to max_frames frames from the socket, one recvmmsg()
+ *
+ * Runs on the BCM thread, or on the RX thread of a threaded bus. Only
+ * rx_errors and rx_dropped are counted here, so each has one writer.
+ *
+ * @param max_frames At most CAN_BATCH_MAX
+ * @param count Output: number of frames received
+ */
+static can_status_t socket_recv(can_port_t *port, can_frame_t *frames, uint8_t max_frames,
+                                uint8_t *count)
 {
-    if (!g_initialized || frame == NULL) {
-        return CAN_STATUS_NOT_INITIALIZED;
-    }
+    *count = 0;
+    batch_init();
     
-    struct can_frame cf;
-    ssize_t nbytes = read(g_socket_fd, &cf, sizeof(cf));
+    for (uint8_t i = 0; i < max_frames; i++) {
+        g_rx_iov[i].iov_base = &frames[i];
+        g_rx_msgs[i].msg_hdr.msg_controllen = sizeof(g_rx_ctrl[i]);
+    }
     
-    if (nbytes < 0) {
+    int n = recvmmsg(port->socket_fd, g_rx_msgs, max_frames, 0, NULL);
+    if (n < 0) {
         if (errno == EAGAIN || errno == EWOULDBLOCK) {
             return CAN_STATUS_NO_DATA;
         }
-        g_stats.rx_errors++;
+        stat_add(&port->stats.rx_errors, 1U);
         return CAN_STATUS_ERROR;
     }
     
-    if (nbytes < (ssize_t)sizeof(cf)) {
-        g_stats.rx_errors++;
-        return CAN_STATUS_ERROR;
+    uint8_t received = 0;
+    for (int i = 0; i < n; i++) {
+        rx_note_overflow(port, &g_rx_msgs[i].msg_hdr);
+        /* Short read, or a CAN FD frame cut to CAN_MTU: not a command */
+        if (g_rx_msgs[i].msg_len < sizeof(can_frame_t) ||
+            (g_rx_msgs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0) {
+            stat_add(&port->stats.rx_errors, 1U);
+            continue;
+        }
+        if (received != i) {
+            frames[received] = frames[i]; /* Close the gap left by a short read */
+        }
+        can_frame_t *frame = &frames[received];
+        frame->id &= CAN_SFF_MASK; /* 11-bit only */
+        if (frame->dlc > CAN_FRAME_MAX_DLC) {
+            frame->dlc = CAN_FRAME_MAX_DLC;
+        }
+        received++;
     }
     
-    frame->id = cf.can_id & CAN_SFF_MASK; /* 11-bit only */
-    frame->dlc = cf.can_dlc;
-    memcpy(frame->data, cf.data, cf.can_dlc);
+    *count = received;
     
-    g_stats.rx_count++;
+    if (received == 0) {
+        return (n > 0) ? CAN_STATUS_ERROR : CAN_STATUS_NO_DATA;
+    }
     return CAN_STATUS_OK;
 }
 
-can_status_t can_rx_poll(void)
+/**
+ * @brief Take frames the RX thread has queued
+ *
+ * Once the queue looks empty the eventfd is cleared and the queue read
+ * again: a frame queued in between is either taken now or leaves the
+ * eventfd set for the next wake-up.
+ */
+static uint8_t rx_queue_pop(can_port_t *port, can_frame_t *frames, uint8_t max_frames)
 {
-    return can_is_initialized() ? CAN_STATUS_OK : CAN_STATUS_NOT_INITIALIZED;
+    uint32_t n = ring_pop_bulk(&port->rx_queue, frames, max_frames);
+    
+    if (n < max_frames) {
+        uint64_t value;
+        (void)read(port->rx_event_fd, &value, sizeof(value));
+        n += ring_pop_bulk(&port->rx_queue, &frames[n], max_frames - n);
+    }
+    return (uint8_t)n;
 }
 
-#else /* Stub Mode */
-
-/*******************************************************************************
- * Stub Implementation
- ******************************************************************************/
-
-can_status_t can_init(const char *ifname)
+can_status_t can_bus_recv_batch(uint8_t bus, can_frame_t *frames, uint8_t max_frames,
+                                uint8_t *count)
 {
-    (void)ifname;
+    can_port_t *port = bus_port(bus);
     
-    if (g_initialized) {
-        return CAN_STATUS_OK;
+    if (count != NULL) {
+        *count = 0;
     }
     
-    queue_init(&g_rx_queue);
-    queue_init(&g_tx_queue);
-    g_last_tx_valid = false;
-    memset(&g_stats, 0, sizeof(g_stats));
-    g_initialized = true;
+    if (port == NULL || !port->initialized || frames == NULL || count == NULL) {
+        return CAN_STATUS_NOT_INITIALIZED;
+    }
     
-    printf("[CAN] Initialized (stub mode)\n");
-    return CAN_STATUS_OK;
+    if (max_frames > CAN_BATCH_MAX) {
+        max_frames = CAN_BATCH_MAX;
+    }
+    
+    uint8_t received = 0;
+    can_status_t status;
+    if (port->rx_threaded) {
+        received = rx_queue_pop(port, frames, max_frames);
+        status = (received > 0U) ? CAN_STATUS_OK : CAN_STATUS_NO_DATA;
+    } else {
+        status = socket_recv(port, frames, max_frames, &received);
+    }
+    
+    stats_account(port, frames, received, false);
+    *count = received;
+    return status;
 }
 
-void can_deinit(void)
+/**
+ * @brief RX thread: socket to rx_queue until rx_stop_fd is set
+ *
+ * Touches only its bus: the socket, the producer side of rx_queue and
+ * the rx_dropped/rx_errors counters. Never the bound instance.
+ */
+static void *rx_thread_main(void *arg)
 {
-    g_initialized = false;
+    can_port_t *port = arg;
+    can_frame_t frames[CAN_BATCH_MAX];
+    struct pollfd pfd[2] = {
+        { .fd = port->socket_fd, .events = POLLIN, .revents = 0 },
+        { .fd = port->rx_stop_fd, .events = POLLIN, .revents = 0 },
+    };
+    
+    for (;;) {
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (pfd[1].revents != 0 || (pfd[0].revents & POLLNVAL) != 0) {
+            break;
+        }
+        
+        uint8_t count = 0;
+        (void)socket_recv(port, frames, CAN_BATCH_MAX, &count);
+        
+        uint32_t queued = ring_push_bulk(&port->rx_queue, frames, count);
+        if (queued < count) {
+            stat_add(&port->stats.rx_dropped, count - queued);
+        }
+        if (queued > 0U) {
+            uint64_t one = 1;
+            (void)write(port->rx_event_fd, &one, sizeof(one));
+        }
+    }
+    return NULL;
 }
 
-bool can_is_initialized(void)
+/**
+ * @brief Close an eventfd of a bus, if open
+ */
+static void event_fd_close(int *fd)
 {
-    return g_initialized;
+    if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+    }
 }
 
-can_status_t can_send(const can_frame_t *frame)
+/**
+ * @brief Start the RX thread of a bus
+ */
+static can_status_t rx_thread_start(can_port_t *port)
 {
-    if (!g_initialized || frame == NULL) {
-        return CAN_STATUS_NOT_INITIALIZED;
+    port->rx_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    port->rx_stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (port->rx_event_fd < 0 || port->rx_stop_fd < 0) {
+        perror("[CAN] eventfd");
+        event_fd_close(&port->rx_event_fd);
+        event_fd_close(&port->rx_stop_fd);
+        return CAN_STATUS_ERROR;
     }
     
-    /* Store in TX queue and save as last TX */
-    if (!queue_push(&g_tx_queue, frame, CAN_TX_QUEUE_SIZE)) {
-        g_stats.tx_errors++;
-        return CAN_STATUS_BUFFER_FULL;
+    /* Frames the BCM thread has not taken yet stay in the socket */
+    ring_init(&port->rx_queue, port->rx_frames, CAN_RX_QUEUE_SIZE);
+    if (pthread_create(&port->rx_thread, NULL, rx_thread_main, port) != 0) {
+        BCM_LOG_NOW(BCM_LOG_LEVEL_ERROR, "[CAN] Cannot start RX thread\n");
+        event_fd_close(&port->rx_event_fd);
+        event_fd_close(&port->rx_stop_fd);
+        return CAN_STATUS_ERROR;
     }
     
-    g_last_tx = *frame;
-    g_last_tx_valid = true;
-    g_stats.tx_count++;
-    
+    port->rx_threaded = true;
     return CAN_STATUS_OK;
 }
 
-can_status_t can_recv(can_frame_t *frame)
+/**
+ * @brief Stop and join the RX thread of a bus
+ */
+static void rx_thread_stop(can_port_t *port)
+{
+    uint64_t one = 1;
+    
+    (void)write(port->rx_stop_fd, &one, sizeof(one));
+    (void)pthread_join(port->rx_thread, NULL);
+    event_fd_close(&port->rx_event_fd);
+    event_fd_close(&port->rx_stop_fd);
+    port->rx_threaded = false;
+}
+
+can_status_t can_start_rx_threads(void)
 {
-    if (!g_initialized || frame == NULL) {
+    can_backend_t *can = can_backend();
+    
+    if (!can->ports[CAN_BUS_BODY].initialized) {
         return CAN_STATUS_NOT_INITIALIZED;
     }
     
-    if (!queue_pop(&g_rx_queue, frame, CAN_RX_QUEUE_SIZE)) {
-        return CAN_STATUS_NO_DATA;
+    for (uint8_t bus = 0; bus < can->bus_count; bus++) {
+        can_port_t *port = &can->ports[bus];
+        if (!port->rx_threaded && rx_thread_start(port) != CAN_STATUS_OK) {
+            return CAN_STATUS_ERROR;
+        }
     }
     
-    g_stats.rx_count++;
+    BCM_LOG_INFO("[CAN] %u RX threads running\n", can->bus_count);
     return CAN_STATUS_OK;
 }
 
 can_status_t can_rx_poll(void)
 {
-    if (!g_initialized) {
-        return CAN_STATUS_NOT_INITIALIZED;
-    }
-    
-    return (g_rx_queue.count > 0) ? CAN_STATUS_OK : CAN_STATUS_NO_DATA;
+    return can_is_initialized() ? CAN_STATUS_OK : CAN_STATUS_NOT_INITIALIZED;
 }
 
-can_status_t can_stub_inject_rx(const can_frame_t *frame)
+int can_bus_get_fd(uint8_t bus)
 {
-    if (!g_initialized || frame == NULL) {
-        return CAN_STATUS_NOT_INITIALIZED;
-    }
+    const can_port_t *port = bus_port(bus);
     
-    if (!queue_push(&g_rx_queue, frame, CAN_RX_QUEUE_SIZE)) {
-        return CAN_STATUS_BUFFER_FULL;
+    if (port == NULL || !port->initialized) {
+        return -1;
+    }
+    return port->rx_threaded ? port->rx_event_fd : port->socket_fd;
+}
+
+int can_bus_get_tx_fd(uint8_t bus)
+{
+    const can_port_t *port = bus_port(bus);
+    
+    if (port == NULL || !port->initialized) {
+        return -1;
+    }
+    return port->socket_fd;
+}
+
+can_status_t can_bus_set_rx_filter(uint8_t bus, const uint32_t *ids, uint8_t count)
+{
+    can_port_t *port = bus_port(bus);
+    struct can_filter filters[CAN_RX_FILTER_MAX];
+    
+    if (port == NULL || !port->initialized) {
+        return CAN_STATUS_NOT_INITIALIZED;
+    }
+    
+    if (ids == NULL) {
+        /* Kernel default: a single match-all entry */
+        filters[0].can_id = 0;
+        filters[0].can_mask = 0;
+        count = 1;
+    } else {
+        if (count > CAN_RX_FILTER_MAX) {
+            return CAN_STATUS_ERROR;
+        }
+        for (uint8_t i = 0; i < count; i++) {
+            filters[i].can_id = ids[i] & CAN_SFF_MASK;
+            filters[i].can_mask = CAN_SFF_MASK | CAN_EFF_FLAG | CAN_RTR_FLAG;
+        }
+    }
+    
+    if (setsockopt(port->socket_fd, SOL_CAN_RAW, CAN_RAW_FILTER, filters,
+                   (socklen_t)(count * sizeof(struct can_filter))) < 0) {
+        perror("[CAN] setsockopt CAN_RAW_FILTER");
+        return CAN_STATUS_ERROR;
+    }
+    
+    return CAN_STATUS_OK;
+}
+
+#else /* Stub Mode */
+
+/*******************************************************************************
+ * Stub Implementation
+ ******************************************************************************/
+
+/**
+ * @brief Reset the queues of a bus
+ */
+static can_status_t port_open(can_port_t *port, const char *ifname)
+{
+    (void)ifname;
+    
+    ring_init(&port->rx_queue, port->rx_frames, CAN_RX_QUEUE_SIZE);
+    ring_init(&port->tx_queue, port->tx_frames, CAN_TX_QUEUE_SIZE);
+    port->last_tx_valid = false;
+    port->tx_fd_count = 0;
+    port->tx_pending_count = 0;
+    port->rx_filter_count = -1;
+    stats_clear(port);
+    port->initialized = true;
+    
+    BCM_LOG_INFO("[CAN] Initialized (stub mode)\n");
+    return CAN_STATUS_OK;
+}
+
+/**
+ * @brief Mark a bus closed
+ */
+static void port_close(can_port_t *port)
+{
+    port->initialized = false;
+}
+
+/**
+ * @brief Append frames to the TX queue
+ * @param sent Output: number of frames queued
+ * @return CAN_STATUS_BUFFER_FULL if the queue filled
+ */
+static can_status_t tx_write(can_port_t *port, const can_frame_t *frames, uint8_t count,
+                             uint8_t *sent)
+{
+    /* Store in TX queue and save the newest frame as last TX */
+    uint8_t n = (uint8_t)ring_push_bulk(&port->tx_queue, frames, count);
+    if (n > 0) {
+        port->last_tx = frames[n - 1U];
+        port->last_tx_valid = true;
+    }
+    stats_account(port, frames, n, true);
+    
+    *sent = n;
+    return (n == count) ? CAN_STATUS_OK : CAN_STATUS_BUFFER_FULL;
+}
+
+/**
+ * @brief True if the TX queue has room (can_stub_drain_tx() made some)
+ */
+static bool tx_ready(can_port_t *port)
+{
+    return ring_count(&port->tx_queue) < CAN_TX_QUEUE_SIZE;
+}
+
+can_status_t can_send_fd(const can_fd_frame_t *frame)
+{
+    if (frame == NULL || !can_port()->initialized) {
+        return CAN_STATUS_NOT_INITIALIZED;
     }
     
+    can_port_t *port = tx_port(frame->id);
+    can_status_t status = CAN_STATUS_OK;
+    if (!fd_len_valid(frame->len)) {
+        status = CAN_STATUS_ERROR;
+    } else if (port->tx_fd_count >= CAN_TX_FD_QUEUE_SIZE) {
+        status = CAN_STATUS_BUFFER_FULL;
+    }
+    
+    if (status != CAN_STATUS_OK) {
+        stats_tx_failed(port, 1U, status);
+        return status;
+    }
+    
+    port->tx_fd_frames[port->tx_fd_count++] = *frame;
+    stats_account_fd_tx(port, frame);
     return CAN_STATUS_OK;
 }
 
+can_status_t can_bus_recv_batch(uint8_t bus, can_frame_t *frames, uint8_t max_frames,
+                                uint8_t *count)
+{
+    can_port_t *port = bus_port(bus);
+    
+    if (count != NULL) {
+        *count = 0;
+    }
+    
+    if (port == NULL || !port->initialized || frames == NULL || count == NULL) {
+        return CAN_STATUS_NOT_INITIALIZED;
+    }
+    
+    uint8_t received = (uint8_t)ring_pop_bulk(&port->rx_queue, frames, max_frames);
+    
+    stats_account(port, frames, received, false);
+    *count = received;
+    
+    return (received > 0) ? CAN_STATUS_OK : CAN_STATUS_NO_DATA;
+}
+
+can_status_t can_rx_poll(void)
+{
+    can_backend_t *can = can_backend();
+    
+    if (!can->ports[CAN_BUS_BODY].initialized) {
+        return CAN_STATUS_NOT_INITIALIZED;
+    }
+    
+    for (uint8_t bus = 0; bus < can->bus_count; bus++) {
+        if (ring_count(&can->ports[bus].rx_queue) > 0U) {
+            return CAN_STATUS_OK;
+        }
+    }
+    return CAN_STATUS_NO_DATA;
+}
+
+int can_bus_get_fd(uint8_t bus)
+{
+    (void)bus;
+    return -1; /* In-memory queue, nothing to poll */
+}
+
+int can_bus_get_tx_fd(uint8_t bus)
+{
+    (void)bus;
+    return -1;
+}
+
+can_status_t can_bus_set_rx_filter(uint8_t bus, const uint32_t *ids, uint8_t count)
+{
+    can_port_t *port = bus_port(bus);
+    
+    if (port == NULL || !port->initialized) {
+        return CAN_STATUS_NOT_INITIALIZED;
+    }
+    
+    if (ids == NULL) {
+        port->rx_filter_count = -1;
+        return CAN_STATUS_OK;
+    }
+    
+    if (count > CAN_RX_FILTER_MAX) {
+        return CAN_STATUS_ERROR;
+    }
+    
+    memcpy(port->rx_filter, ids, count * sizeof(uint32_t));
+    port->rx_filter_count = (int)count;
+    return CAN_STATUS_OK;
+}
+
+can_status_t can_stub_inject_rx(const can_frame_t *frame)
+{
+    can_port_t *port = can_port();
+    
+    if (!port->initialized || frame == NULL) {
+        return CAN_STATUS_NOT_INITIALIZED;
+    }
+    
+    if (ring_push_bulk(&port->rx_queue, frame, 1U) == 0U) {
+        stat_add(&port->stats.rx_dropped, 1U);
+        return CAN_STATUS_BUFFER_FULL;
+    }
+    
+    return CAN_STATUS_OK;
+}
+
+can_status_t can_stub_inject_rx_batch(const can_frame_t *frames, uint8_t count,
+                                      uint8_t *injected)
+{
+    return can_stub_bus_inject_rx_batch(CAN_BUS_BODY, frames, count, injected);
+}
+
+can_status_t can_stub_bus_inject_rx_batch(uint8_t bus, const can_frame_t *frames,
+                                          uint8_t count, uint8_t *injected)
+{
+    can_port_t *port = bus_port(bus);
+    
+    if (injected != NULL) {
+        *injected = 0;
+    }
+    
+    if (port == NULL || !port->initialized || frames == NULL) {
+        return CAN_STATUS_NOT_INITIALIZED;
+    }
+    
+    uint8_t n = (uint8_t)ring_push_bulk(&port->rx_queue, frames, count);
+    if (n < count) {
+        stat_add(&port->stats.rx_dropped, (uint32_t)(count - n));
+    }
+    if (injected != NULL) {
+        *injected = n;
+    }
+    
+    return (n == count) ? CAN_STATUS_OK : CAN_STATUS_BUFFER_FULL;
+}
+
 can_status_t can_stub_get_last_tx(can_frame_t *frame)
 {
-    if (!g_initialized || frame == NULL) {
+    can_port_t *port = can_port();
+    
+    if (!port->initialized || frame == NULL) {
         return CAN_STATUS_NOT_INITIALIZED;
     }
     
-    if (!g_last_tx_valid) {
+    if (!port->last_tx_valid) {
         return CAN_STATUS_NO_DATA;
     }
     
-    *frame = g_last_tx;
+    *frame = port->last_tx;
     return CAN_STATUS_OK;
 }
 
+uint8_t can_stub_drain_tx(can_frame_t *frames, uint8_t max_frames)
+{
+    return can_stub_bus_drain_tx(CAN_BUS_BODY, frames, max_frames);
+}
+
+uint8_t can_stub_bus_drain_tx(uint8_t bus, can_frame_t *frames, uint8_t max_frames)
+{
+    can_port_t *port = bus_port(bus);
+    
+    if (port == NULL || !port->initialized || frames == NULL) {
+        return 0;
+    }
+    
+    return (uint8_t)ring_pop_bulk(&port->tx_queue, frames, max_frames);
+}
+
+uint8_t can_stub_drain_tx_fd(can_fd_frame_t *frames, uint8_t max_frames)
+{
+    can_port_t *port = can_port();
+    
+    if (!port->initialized || frames == NULL) {
+        return 0;
+    }
+    
+    uint8_t n = (port->tx_fd_count < max_frames) ? port->tx_fd_count : max_frames;
+    memcpy(frames, port->tx_fd_frames, n * sizeof(can_fd_frame_t));
+    
+    /* Keep the rest in order at the front */
+    port->tx_fd_count = (uint8_t)(port->tx_fd_count - n);
+    memmove(port->tx_fd_frames, &port->tx_fd_frames[n],
+            port->tx_fd_count * sizeof(can_fd_frame_t));
+    return n;
+}
+
+int can_stub_get_rx_filter(uint32_t *ids, uint8_t max_ids)
+{
+    can_port_t *port = can_port();
+    
+    if (ids != NULL && port->rx_filter_count > 0) {
+        uint8_t n = ((uint8_t)port->rx_filter_count < max_ids) ?
+                    (uint8_t)port->rx_filter_count : max_ids;
+        memcpy(ids, port->rx_filter, n * sizeof(uint32_t));
+    }
+    return port->rx_filter_count;
+}
+
 void can_stub_clear(void)
 {
-    queue_init(&g_rx_queue);
-    queue_init(&g_tx_queue);
-    g_last_tx_valid = false;
+    for (uint8_t bus = 0; bus < CAN_BUS_MAX; bus++) {
+        can_port_t *port = bus_port(bus);
+        ring_init(&port->rx_queue, port->rx_frames, CAN_RX_QUEUE_SIZE);
+        ring_init(&port->tx_queue, port->tx_frames, CAN_TX_QUEUE_SIZE);
+        port->last_tx_valid = false;
+        port->tx_fd_count = 0;
+        port->tx_pending_count = 0;
+    }
 }
 
 #endif /* BCM_SIL */
 
+/*******************************************************************************
+ * Buses
+ ******************************************************************************/
+
+can_status_t can_init(const char *ifname)
+{
+    can_backend_t *can = can_backend();
+    
+    if (can->ports[CAN_BUS_BODY].initialized) {
+        return CAN_STATUS_OK;
+    }
+    
+    if (ifname == NULL) {
+        ifname = "vcan0";
+    }
+    
+    /* One bus per comma-separated name, in order */
+    can->bus_count = 0;
+    can->route_count = 0;
+    const char *name = ifname;
+    for (;;) {
+        const char *end = strchr(name, ',');
+        size_t len = (end != NULL) ? (size_t)(end - name) : strlen(name);
+        char buf[CAN_IFNAME_MAX];
+        
+        if (len == 0U || len >= sizeof(buf) || can->bus_count >= CAN_BUS_MAX) {
+            BCM_LOG_NOW(BCM_LOG_LEVEL_ERROR, "[CAN] Invalid interface list: %s\n", ifname);
+            can_deinit();
+            return CAN_STATUS_ERROR;
+        }
+        memcpy(buf, name, len);
+        buf[len] = '\0';
+        
+        if (port_open(&can->ports[can->bus_count], buf) != CAN_STATUS_OK) {
+            can_deinit();
+            return CAN_STATUS_ERROR;
+        }
+        can->bus_count++;
+        
+        if (end == NULL) {
+            break;
+        }
+        name = end + 1;
+    }
+    
+    return CAN_STATUS_OK;
+}
+
+void can_deinit(void)
+{
+    can_backend_t *can = can_backend();
+    
+    for (uint8_t bus = 0; bus < CAN_BUS_MAX; bus++) {
+        port_close(&can->ports[bus]);
+    }
+    can->bus_count = 0;
+}
+
+bool can_is_initialized(void)
+{
+    return can_port()->initialized;
+}
+
+uint8_t can_bus_count(void)
+{
+    return can_port()->initialized ? can_backend()->bus_count : 0U;
+}
+
+can_status_t can_set_tx_route(uint32_t id, uint8_t bus)
+{
+    can_backend_t *can = can_backend();
+    
+    if (id >= CAN_ID_COUNT || bus >= can_bus_count()) {
+        return CAN_STATUS_ERROR;
+    }
+    
+    for (uint8_t i = 0; i < can->route_count; i++) {
+        if (can->routes[i].id != id) {
+            continue;
+        }
+        if (bus == CAN_BUS_BODY) {
+            can->route_count--;
+            can->routes[i] = can->routes[can->route_count];
+        } else {
+            can->routes[i].bus = bus;
+        }
+        return CAN_STATUS_OK;
+    }
+    
+    if (bus == CAN_BUS_BODY) {
+        return CAN_STATUS_OK;
+    }
+    if (can->route_count >= CAN_TX_ROUTE_MAX) {
+        return CAN_STATUS_ERROR;
+    }
+    can->routes[can->route_count].id = (uint16_t)id;
+    can->routes[can->route_count].bus = bus;
+    can->route_count++;
+    return CAN_STATUS_OK;
+}
+
+uint8_t can_get_tx_route(uint32_t id)
+{
+    return route_bus(can_backend(), id);
+}
+
+int can_get_fd(void)
+{
+    return can_bus_get_fd(CAN_BUS_BODY);
+}
+
+can_status_t can_set_rx_filter(const uint32_t *ids, uint8_t count)
+{
+    uint8_t buses = can_bus_count();
+    
+    if (buses == 0U) {
+        return CAN_STATUS_NOT_INITIALIZED;
+    }
+    
+    for (uint8_t bus = 0; bus < buses; bus++) {
+        can_status_t status = can_bus_set_rx_filter(bus, ids, count);
+        if (status != CAN_STATUS_OK) {
+            return status;
+        }
+    }
+    return CAN_STATUS_OK;
+}
+
+/*******************************************************************************
+ * TX Scheduler
+ ******************************************************************************/
+
+/**
+ * @brief True if a newer frame of this ID makes a pending copy obsolete
+ */
+static bool tx_supersedes(uint32_t id)
+{
+    return id >= CAN_ID_STATUS_FIRST && id <= CAN_ID_STATUS_LAST;
+}
+
+/**
+ * @brief Add a frame to the pending set, kept sorted by ID
+ *
+ * A status frame overwrites a pending copy of its ID in place; any other
+ * frame goes behind the pending frames of its ID, so their order is kept.
+ *
+ * @return false if the set is full
+ */
+static bool tx_pending_add(can_port_t *port, const can_frame_t *frame)
+{
+    uint8_t count = port->tx_pending_count;
+    uint8_t pos = 0;
+    
+    while (pos < count && port->tx_pending[pos].id <= frame->id) {
+        pos++;
+    }
+    
+    if (pos > 0U && port->tx_pending[pos - 1U].id == frame->id && tx_supersedes(frame->id)) {
+        port->tx_pending[pos - 1U] = *frame;
+        stat_add(&port->stats.tx_coalesced, 1U);
+        return true;
+    }
+    
+    if (count >= CAN_TX_PENDING_SIZE) {
+        return false;
+    }
+    
+    memmove(&port->tx_pending[pos + 1U], &port->tx_pending[pos],
+            (size_t)(count - pos) * sizeof(can_frame_t));
+    port->tx_pending[pos] = *frame;
+    port->tx_pending_count = (uint8_t)(count + 1U);
+    return true;
+}
+
+/**
+ * @brief Write pending frames, lowest ID first, until the backend is full
+ * @return CAN_STATUS_OK if none are left pending
+ */
+static can_status_t tx_flush(can_port_t *port)
+{
+    uint8_t sent = 0;
+    can_status_t status = tx_write(port, port->tx_pending, port->tx_pending_count, &sent);
+    
+    port->tx_pending_count = (uint8_t)(port->tx_pending_count - sent);
+    memmove(port->tx_pending, &port->tx_pending[sent],
+            port->tx_pending_count * sizeof(can_frame_t));
+    
+    if (status == CAN_STATUS_ERROR) {
+        /* Not a full queue: retrying cannot help */
+        stats_tx_failed(port, port->tx_pending_count, status);
+        port->tx_pending_count = 0;
+    }
+    return status;
+}
+
+/**
+ * @brief Send frames on one bus, scheduling what it cannot take now
+ */
+static can_status_t port_send_batch(can_port_t *port, const can_frame_t *frames,
+                                    uint8_t count, uint8_t *sent)
+{
+    uint8_t accepted = 0;
+    can_status_t status = CAN_STATUS_OK;
+    
+    if (sent != NULL) {
+        *sent = 0;
+    }
+    
+    if (!port->initialized || frames == NULL) {
+        return CAN_STATUS_NOT_INITIALIZED;
+    }
+    
+    /* Older frames go first. While any still wait, new frames join them
+     * and everything leaves in ID order. */
+    if (port->tx_pending_count > 0U) {
+        (void)tx_flush(port);
+    }
+    if (port->tx_pending_count == 0U && count > 0U) {
+        status = tx_write(port, frames, count, &accepted);
+    }
+    
+    if (status == CAN_STATUS_ERROR) {
+        stats_tx_failed(port, (uint32_t)(count - accepted), status);
+    } else {
+        status = CAN_STATUS_OK;
+        while (accepted < count && tx_pending_add(port, &frames[accepted])) {
+            accepted++;
+        }
+        if (accepted < count) {
+            status = CAN_STATUS_BUFFER_FULL;
+            stats_tx_failed(port, (uint32_t)(count - accepted), status);
+        }
+    }
+    
+    if (sent != NULL) {
+        *sent = accepted;
+    }
+    return status;
+}
+
+/**
+ * @brief Send a batch over its TX routes
+ *
+ * Each bus takes a leading part of its run, so acceptance is marked per
+ * run rather than as one leading count.
+ *
+ * @param sent Output: frames taken on all buses (may be NULL)
+ * @param accepted Output: one flag per frame (may be NULL)
+ */
+static can_status_t send_routed(const can_frame_t *frames, uint8_t count, uint8_t *sent,
+                                bool *accepted)
+{
+    can_backend_t *can = can_backend();
+    
+    if (can->route_count == 0U || frames == NULL) {
+        uint8_t n = 0;
+        can_status_t status = port_send_batch(&can->ports[CAN_BUS_BODY], frames, count, &n);
+        if (sent != NULL) {
+            *sent = n;
+        }
+        if (accepted != NULL) {
+            for (uint8_t i = 0; i < count; i++) {
+                accepted[i] = (i < n);
+            }
+        }
+        return status;
+    }
+    
+    /* Runs of consecutive frames with the same bus, one write each */
+    uint8_t total = 0;
+    can_status_t status = CAN_STATUS_OK;
+    uint8_t first = 0;
+    while (first < count) {
+        uint8_t bus = route_bus(can, frames[first].id);
+        uint8_t end = (uint8_t)(first + 1U);
+        while (end < count && route_bus(can, frames[end].id) == bus) {
+            end++;
+        }
+        
+        uint8_t n = 0;
+        can_status_t run = port_send_batch(&can->ports[bus], &frames[first],
+                                           (uint8_t)(end - first), &n);
+        if (run != CAN_STATUS_OK) {
+            status = run;
+        }
+        if (accepted != NULL) {
+            for (uint8_t i = first; i < end; i++) {
+                accepted[i] = (i < first + n);
+            }
+        }
+        total = (uint8_t)(total + n);
+        first = end;
+    }
+    
+    if (sent != NULL) {
+        *sent = total;
+    }
+    return status;
+}
+
+can_status_t can_send_batch(const can_frame_t *frames, uint8_t count, uint8_t *sent)
+{
+    return send_routed(frames, count, sent, NULL);
+}
+
+can_status_t can_send_batch_accepted(const can_frame_t *frames, uint8_t count,
+                                     bool *accepted)
+{
+    if (accepted == NULL) {
+        return CAN_STATUS_ERROR;
+    }
+    return send_routed(frames, count, NULL, accepted);
+}
+
+can_status_t can_tx_service(void)
+{
+    can_backend_t *can = can_backend();
+    can_status_t status = CAN_STATUS_OK;
+    
+    if (!can->ports[CAN_BUS_BODY].initialized) {
+        return CAN_STATUS_NOT_INITIALIZED;
+    }
+    
+    for (uint8_t bus = 0; bus < can->bus_count; bus++) {
+        can_port_t *port = &can->ports[bus];
+        if (port->tx_pending_count == 0U) {
+            continue;
+        }
+        can_status_t flushed = tx_ready(port) ? tx_flush(port) : CAN_STATUS_BUFFER_FULL;
+        if (flushed != CAN_STATUS_OK) {
+            status = flushed;
+        }
+    }
+    return status;
+}
+
+uint8_t can_tx_pending(void)
+{
+    can_backend_t *can = can_backend();
+    uint32_t pending = 0;
+    
+    for (uint8_t bus = 0; bus < can->bus_count; bus++) {
+        pending += can->ports[bus].tx_pending_count;
+    }
+    return (uint8_t)pending;
+}
+
 /*******************************************************************************
  * Common Functions
  ******************************************************************************/
 
+can_status_t can_send(const can_frame_t *frame)
+{
+    return can_send_batch(frame, 1U, NULL);
+}
+
+can_status_t can_recv(can_frame_t *frame)
+{
+    uint8_t count;
+    return can_recv_batch(frame, 1U, &count);
+}
+
+can_status_t can_recv_batch(can_frame_t *frames, uint8_t max_frames, uint8_t *count)
+{
+    return can_bus_recv_batch(CAN_BUS_BODY, frames, max_frames, count);
+}
+
 void can_get_stats(can_stats_t *stats)
 {
-    if (stats != NULL) {
-        *stats = g_stats;
+    can_bus_get_stats(CAN_BUS_BODY, stats);
+}
+
+void can_bus_get_stats(uint8_t bus, can_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    
+    can_port_t *port = bus_port(bus);
+    if (port == NULL) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    
+    can_counters_t *c = &port->stats;
+    stats->tx_count = stat_get(&c->tx_count);
+    stats->rx_count = stat_get(&c->rx_count);
+    stats->tx_errors = stat_get(&c->tx_errors);
+    stats->rx_errors = stat_get(&c->rx_errors);
+    stats->tx_dropped = stat_get(&c->tx_dropped);
+    stats->tx_coalesced = stat_get(&c->tx_coalesced);
+    stats->rx_dropped = stat_get(&c->rx_dropped);
+    stats->rx_unknown_id = stat_get(&c->rx_unknown_id);
+    stats->rx_bad_dlc = stat_get(&c->rx_bad_dlc);
+    stats->rx_rejected = stat_get(&c->rx_rejected);
+    stats->id_overflow = stat_get(&c->id_overflow);
+    stats->bus_bits = stat_get(&c->bus_bits);
+    stats->bus_load_x10 = (uint16_t)stat_get(&c->bus_load_x10);
+}
+
+/**
+ * @brief Copy one per-ID slot
+ */
+static void id_stats_copy(uint32_t id, can_id_counter_t *slot, can_id_stats_t *stats)
+{
+    stats->id = id;
+    stats->rx_count = stat_get(&slot->rx_count);
+    stats->tx_count = stat_get(&slot->tx_count);
+    stats->last_rx_ms = stat_get(&slot->last_rx_ms);
+    stats->last_tx_ms = stat_get(&slot->last_tx_ms);
+}
+
+bool can_get_id_stats(uint32_t id, can_id_stats_t *stats)
+{
+    return can_bus_get_id_stats(CAN_BUS_BODY, id, stats);
+}
+
+bool can_bus_get_id_stats(uint8_t bus, uint32_t id, can_id_stats_t *stats)
+{
+    can_port_t *port = bus_port(bus);
+    
+    if (port == NULL || stats == NULL || id >= CAN_ID_COUNT) {
+        return false;
+    }
+    
+    can_id_counter_t *slot = id_slot(port, id, false);
+    if (slot == NULL) {
+        return false;
+    }
+    
+    id_stats_copy(id, slot, stats);
+    return true;
+}
+
+uint8_t can_get_all_id_stats(can_id_stats_t *stats, uint8_t max_ids)
+{
+    can_port_t *port = can_port();
+    uint8_t n = 0;
+    
+    if (stats == NULL) {
+        return 0;
+    }
+    
+    for (uint32_t i = 0; i < CAN_STATS_ID_SLOTS && n < max_ids; i++) {
+        can_id_counter_t *slot = &port->id_stats[i];
+        uint32_t key = (uint32_t)atomic_load_explicit(&slot->key, memory_order_acquire);
+        if (key != 0U) {
+            id_stats_copy(key - 1U, slot, &stats[n++]);
+        }
+    }
+    return n;
+}
+
+uint32_t can_frame_bits(uint8_t dlc)
+{
+    if (dlc > CAN_FRAME_MAX_DLC) {
+        dlc = CAN_FRAME_MAX_DLC;
+    }
+    
+    uint32_t stuffable = 34U + 8U * dlc;
+    return stuffable + (stuffable - 1U) / 4U + 13U;
+}
+
+uint8_t can_fd_len_round(uint8_t len)
+{
+    if (len <= CAN_FRAME_MAX_DLC) {
+        return len;
+    }
+    if (len <= 24U) {
+        return (uint8_t)((len + 3U) & ~3U); /* 12, 16, 20, 24 */
+    }
+    if (len <= 32U) {
+        return 32U;
+    }
+    return (len <= 48U) ? 48U : CAN_FD_MAX_LEN;
+}
+
+uint32_t can_fd_frame_bits(uint8_t len, uint8_t flags)
+{
+    len = can_fd_len_round(len);
+    
+    /* Nominal rate: SOF to BRS with stuffing, then CRC delimiter to IFS */
+    uint32_t nominal = 17U + (17U - 1U) / 4U + 13U;
+    
+    /* Data phase: dynamic stuffing up to the CRC, fixed stuff bits after */
+    uint32_t crc = (len <= 16U) ? 17U : 21U;
+    uint32_t stuffable = 5U + 8U * len;
+    uint32_t data = stuffable + stuffable / 4U + 4U + crc + (4U + crc) / 4U + 1U;
+    
+    if ((flags & CAN_FD_FLAG_BRS) != 0U) {
+        data = (uint32_t)(((uint64_t)data * CAN_BAUD_RATE + CAN_FD_DATA_BAUD_RATE - 1U) /
+                          CAN_FD_DATA_BAUD_RATE);
+    }
+    return nominal + data;
+}
+
+/**
+ * @brief Close and reopen the bus load window of one bus
+ */
+static void port_sample_load(can_port_t *port, uint32_t now_ms)
+{
+    can_counters_t *c = &port->stats;
+    uint32_t elapsed_ms = now_ms - c->window_start_ms;
+    
+    if (c->window_open) {
+        if (elapsed_ms < CAN_BUS_LOAD_WINDOW_MS) {
+            return; /* Window too short to mean anything yet */
+        }
+        uint32_t bits = stat_get(&c->window_bits);
+        
+        /* bits / (baud * elapsed_s), in 0.1% steps */
+        uint64_t load = ((uint64_t)bits * 1000000U) / ((uint64_t)CAN_BAUD_RATE * elapsed_ms);
+        atomic_store_explicit(&c->bus_bits, bits, memory_order_relaxed);
+        atomic_store_explicit(&c->bus_load_x10, (load > 1000U) ? 1000U : (uint32_t)load,
+                              memory_order_relaxed);
+    }
+    
+    atomic_store_explicit(&c->window_bits, 0U, memory_order_relaxed);
+    c->window_start_ms = now_ms;
+    c->window_open = true;
+}
+
+void can_stats_sample_load(uint32_t now_ms)
+{
+    can_backend_t *can = can_backend();
+    uint8_t buses = (can->bus_count > 0U) ? can->bus_count : 1U;
+    
+    for (uint8_t bus = 0; bus < buses; bus++) {
+        port_sample_load(&can->ports[bus], now_ms);
+    }
+}
+
+void can_stats_rx_discard(can_rx_discard_t reason)
+{
+    can_bus_stats_rx_discard(CAN_BUS_BODY, reason);
+}
+
+void can_bus_stats_rx_discard(uint8_t bus, can_rx_discard_t reason)
+{
+    can_port_t *port = bus_port(bus);
+    if (port == NULL) {
+        return;
+    }
+    
+    can_counters_t *c = &port->stats;
+    
+    switch (reason) {
+        case CAN_RX_UNKNOWN_ID: stat_add(&c->rx_unknown_id, 1U); break;
+        case CAN_RX_BAD_DLC:    stat_add(&c->rx_bad_dlc, 1U);    break;
+        case CAN_RX_REJECTED:   stat_add(&c->rx_rejected, 1U);   break;
+        default:                                                 break;
     }
 }
 
 void can_reset_stats(void)
 {
-    memset(&g_stats, 0, sizeof(g_stats));
+    for (uint8_t bus = 0; bus < CAN_BUS_MAX; bus++) {
+        stats_clear(bus_port(bus));
+    }
 }
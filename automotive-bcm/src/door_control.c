@@ -6,10 +6,11 @@
  */
 
 #include <string.h>
-#include <stdio.h>
 #include "door_control.h"
 #include "fault_manager.h"
+#include "bcm_log.h"
 #include "can_ids.h"
+#include "can_messages.h"
 
 /*******************************************************************************
  * Private Definitions
@@ -21,59 +22,6 @@
  * Private Functions
  ******************************************************************************/
 
-/**
- * @brief Validate door command frame
- * @return cmd_result_t
- */
-static cmd_result_t validate_door_cmd(const can_frame_t *frame)
-{
-    system_state_t *state = sys_state_get_mut();
-    
-    /* Check DLC */
-    if (frame->dlc != DOOR_CMD_DLC) {
-        fault_manager_set(FAULT_CODE_INVALID_LENGTH);
-        return CMD_RESULT_INVALID_CMD;
-    }
-    
-    /* Extract fields */
-    uint8_t cmd = frame->data[DOOR_CMD_BYTE_CMD];
-    uint8_t door_id = frame->data[DOOR_CMD_BYTE_DOOR_ID];
-    uint8_t ver_ctr = frame->data[DOOR_CMD_BYTE_VER_CTR];
-    uint8_t checksum = frame->data[DOOR_CMD_BYTE_CHECKSUM];
-    
-    /* Validate checksum */
-    uint8_t calc_checksum = can_calculate_checksum(frame->data, DOOR_CMD_DLC - 1);
-    if (checksum != calc_checksum) {
-        fault_manager_set(FAULT_CODE_INVALID_CHECKSUM);
-        return CMD_RESULT_CHECKSUM_ERROR;
-    }
-    
-    /* Validate counter */
-    uint8_t counter = CAN_GET_COUNTER(ver_ctr);
-    if (state->door.last_cmd_time_ms > 0) {
-        if (!can_validate_counter(counter, state->door.last_counter)) {
-            fault_manager_set(FAULT_CODE_INVALID_COUNTER);
-            return CMD_RESULT_COUNTER_ERROR;
-        }
-    }
-    state->door.last_counter = counter;
-    
-    /* Validate command value */
-    if (cmd == 0 || cmd > DOOR_CMD_MAX) {
-        fault_manager_set(FAULT_CODE_INVALID_CMD);
-        return CMD_RESULT_INVALID_CMD;
-    }
-    
-    /* Validate door ID for single door commands */
-    if ((cmd == DOOR_CMD_LOCK_SINGLE || cmd == DOOR_CMD_UNLOCK_SINGLE) &&
-        door_id > DOOR_ID_MAX) {
-        fault_manager_set(FAULT_CODE_INVALID_CMD);
-        return CMD_RESULT_INVALID_CMD;
-    }
-    
-    return CMD_RESULT_OK;
-}
-
 /**
  * @brief Log door state change event
  */
@@ -81,6 +29,7 @@ static void log_door_event(uint8_t door_id, door_lock_state_t new_state)
 {
     uint8_t data[4] = { door_id, (uint8_t)new_state, 0, 0 };
     event_log_add(EVENT_DOOR_LOCK_CHANGE, data);
+    sys_state_mark_tx_dirty(SYS_TX_DIRTY_DOOR);
 }
 
 /*******************************************************************************
@@ -97,13 +46,42 @@ void door_control_init(void)
     }
     
     state->door.last_cmd_time_ms = 0;
-    state->door.last_counter = 0;
+    state->door.rx_counter.last = 0;
+    state->door.rx_counter.seen = 0;
     state->door.last_result = CMD_RESULT_OK;
     
-    printf("[DOOR] Initialized\n");
+    BCM_LOG_INFO("[DOOR] Initialized\n");
+}
+
+void door_control_check_cmds(const can_frame_t *frames, uint8_t count, uint8_t *flags)
+{
+    system_state_t *state = sys_state_get_mut();
+    
+    (void)can_check_batch(&can_msg_door_cmd_desc, frames, count,
+                          &state->door.rx_counter, flags);
+    
+    /* Validate door ID for single door commands */
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t cmd = frames[i].data[DOOR_CMD_BYTE_CMD];
+        if (flags[i] == CAN_CHECK_OK &&
+            (cmd == DOOR_CMD_LOCK_SINGLE || cmd == DOOR_CMD_UNLOCK_SINGLE) &&
+            frames[i].data[DOOR_CMD_BYTE_DOOR_ID] > DOOR_ID_MAX) {
+            flags[i] = CAN_CHECK_BAD_FIELD;
+        }
+    }
 }
 
 cmd_result_t door_control_handle_cmd(const can_frame_t *frame)
+{
+    uint8_t flags = CAN_CHECK_OK;
+    
+    if (frame != NULL && frame->id == CAN_ID_DOOR_CMD) {
+        door_control_check_cmds(frame, 1U, &flags);
+    }
+    return door_control_apply_cmd(frame, flags);
+}
+
+cmd_result_t door_control_apply_cmd(const can_frame_t *frame, uint8_t flags)
 {
     if (frame == NULL || frame->id != CAN_ID_DOOR_CMD) {
         return CMD_RESULT_INVALID_CMD;
@@ -111,21 +89,19 @@ cmd_result_t door_control_handle_cmd(const can_frame_t *frame)
     
     system_state_t *state = sys_state_get_mut();
     
-    /* Validate frame */
-    cmd_result_t result = validate_door_cmd(frame);
+    /* Checked by door_control_check_cmds() */
+    cmd_result_t result = fault_manager_report_cmd_check(frame, flags,
+                                                         FAULT_CMD_SOURCE_DOOR);
     if (result != CMD_RESULT_OK) {
-        state->door.last_result = result;
-        
-        uint8_t data[4] = { (uint8_t)result, frame->data[0], 0, 0 };
-        event_log_add(EVENT_CMD_ERROR, data);
-        
-        printf("[DOOR] Command error: %d\n", result);
+        state->door.last_result = (uint8_t)result;
         return result;
     }
     
     /* Process command */
-    uint8_t cmd = frame->data[DOOR_CMD_BYTE_CMD];
-    uint8_t door_id = frame->data[DOOR_CMD_BYTE_DOOR_ID];
+    can_msg_door_cmd_t msg;
+    can_msg_door_cmd_decode(frame, &msg);
+    uint8_t cmd = msg.command;
+    uint8_t door_id = msg.door_id;
     
     state->door.last_cmd_time_ms = state->uptime_ms;
     
@@ -133,25 +109,25 @@ cmd_result_t door_control_handle_cmd(const can_frame_t *frame)
         case DOOR_CMD_LOCK_ALL:
             door_control_lock_all();
             break;
-            
+        
         case DOOR_CMD_UNLOCK_ALL:
             door_control_unlock_all();
             break;
-            
+        
         case DOOR_CMD_LOCK_SINGLE:
             door_control_lock(door_id);
             break;
-            
+        
         case DOOR_CMD_UNLOCK_SINGLE:
             door_control_unlock(door_id);
             break;
-            
+        
         default:
             result = CMD_RESULT_INVALID_CMD;
             break;
     }
     
-    state->door.last_result = result;
+    state->door.last_result = (uint8_t)result;
     
     uint8_t data[4] = { cmd, door_id, 0, 0 };
     event_log_add(EVENT_CMD_RECEIVED, data);
@@ -170,16 +146,16 @@ void door_control_update(uint32_t current_ms)
                 /* Transition to LOCKED after delay */
                 state->door.lock_state[i] = DOOR_STATE_LOCKED;
                 log_door_event(i, DOOR_STATE_LOCKED);
-                printf("[DOOR] Door %d: LOCKED\n", i);
+                BCM_LOG_INFO("[DOOR] Door %d: LOCKED\n", i);
                 break;
-                
+            
             case DOOR_STATE_UNLOCKING:
                 /* Transition to UNLOCKED after delay */
                 state->door.lock_state[i] = DOOR_STATE_UNLOCKED;
                 log_door_event(i, DOOR_STATE_UNLOCKED);
-                printf("[DOOR] Door %d: UNLOCKED\n", i);
+                BCM_LOG_INFO("[DOOR] Door %d: UNLOCKED\n", i);
                 break;
-                
+            
             default:
                 /* No transition needed */
                 break;
@@ -189,45 +165,48 @@ void door_control_update(uint32_t current_ms)
     (void)current_ms;
 }
 
+uint32_t door_control_next_deadline(uint32_t now_ms)
+{
+    const system_state_t *state = sys_state_get();
+    
+    for (uint8_t i = 0; i < NUM_DOORS; i++) {
+        if (state->door.lock_state[i] == DOOR_STATE_LOCKING ||
+            state->door.lock_state[i] == DOOR_STATE_UNLOCKING) {
+            return now_ms;
+        }
+    }
+    return now_ms + SYS_DEADLINE_IDLE_MS;
+}
+
 void door_control_build_status_frame(can_frame_t *frame)
+{
+    can_frame_template_init(frame, CAN_ID_DOOR_STATUS, DOOR_STATUS_DLC,
+                            CAN_CHECKSUM_SEED);
+    door_control_update_status_frame(frame);
+}
+
+void door_control_update_status_frame(can_frame_t *frame)
 {
     const system_state_t *state = sys_state_get();
     system_state_t *mut_state = sys_state_get_mut();
+    can_msg_door_status_t msg = {0};
     
-    memset(frame, 0, sizeof(can_frame_t));
-    frame->id = CAN_ID_DOOR_STATUS;
-    frame->dlc = DOOR_STATUS_DLC;
+    if (state->door.lock_state[0] == DOOR_STATE_LOCKED) msg.locks |= DOOR_LOCK_BIT_FL;
+    if (state->door.lock_state[1] == DOOR_STATE_LOCKED) msg.locks |= DOOR_LOCK_BIT_FR;
+    if (state->door.lock_state[2] == DOOR_STATE_LOCKED) msg.locks |= DOOR_LOCK_BIT_RL;
+    if (state->door.lock_state[3] == DOOR_STATE_LOCKED) msg.locks |= DOOR_LOCK_BIT_RR;
     
-    /* Byte 0: Lock states */
-    uint8_t locks = 0;
-    if (state->door.lock_state[0] == DOOR_STATE_LOCKED) locks |= DOOR_LOCK_BIT_FL;
-    if (state->door.lock_state[1] == DOOR_STATE_LOCKED) locks |= DOOR_LOCK_BIT_FR;
-    if (state->door.lock_state[2] == DOOR_STATE_LOCKED) locks |= DOOR_LOCK_BIT_RL;
-    if (state->door.lock_state[3] == DOOR_STATE_LOCKED) locks |= DOOR_LOCK_BIT_RR;
-    frame->data[DOOR_STATUS_BYTE_LOCKS] = locks;
+    if (state->door.is_open[0]) msg.opens |= DOOR_OPEN_BIT_FL;
+    if (state->door.is_open[1]) msg.opens |= DOOR_OPEN_BIT_FR;
+    if (state->door.is_open[2]) msg.opens |= DOOR_OPEN_BIT_RL;
+    if (state->door.is_open[3]) msg.opens |= DOOR_OPEN_BIT_RR;
     
-    /* Byte 1: Open states */
-    uint8_t opens = 0;
-    if (state->door.is_open[0]) opens |= DOOR_OPEN_BIT_FL;
-    if (state->door.is_open[1]) opens |= DOOR_OPEN_BIT_FR;
-    if (state->door.is_open[2]) opens |= DOOR_OPEN_BIT_RL;
-    if (state->door.is_open[3]) opens |= DOOR_OPEN_BIT_RR;
-    frame->data[DOOR_STATUS_BYTE_OPENS] = opens;
+    msg.result = state->door.last_result;
+    msg.fault_count = fault_manager_get_count();
     
-    /* Byte 2: Last command result */
-    frame->data[DOOR_STATUS_BYTE_RESULT] = (uint8_t)state->door.last_result;
-    
-    /* Byte 3: Active fault count */
-    frame->data[DOOR_STATUS_BYTE_FAULTS] = fault_manager_get_count();
-    
-    /* Byte 4: Version and counter */
-    frame->data[DOOR_STATUS_BYTE_VER_CTR] = CAN_BUILD_VER_CTR(
-        CAN_SCHEMA_VERSION, mut_state->tx_counter_door);
+    /* Only changed bytes are written; the checksum follows can_frame_put() */
+    can_msg_door_status_update(frame, &msg, mut_state->tx_counter_door);
     mut_state->tx_counter_door = (mut_state->tx_counter_door + 1) & CAN_COUNTER_MASK;
-    
-    /* Byte 5: Checksum */
-    frame->data[DOOR_STATUS_BYTE_CHECKSUM] = can_calculate_checksum(
-        frame->data, DOOR_STATUS_DLC - 1);
 }
 
 door_lock_state_t door_control_get_lock_state(uint8_t door_id)
@@ -235,7 +214,7 @@ door_lock_state_t door_control_get_lock_state(uint8_t door_id)
     if (door_id >= NUM_DOORS) {
         return DOOR_STATE_UNLOCKED;
     }
-    return sys_state_get()->door.lock_state[door_id];
+    return (door_lock_state_t)sys_state_get()->door.lock_state[door_id];
 }
 
 bool door_control_all_locked(void)
@@ -269,7 +248,7 @@ void door_control_lock_all(void)
     for (uint8_t i = 0; i < NUM_DOORS; i++) {
         if (state->door.lock_state[i] == DOOR_STATE_UNLOCKED) {
             state->door.lock_state[i] = DOOR_STATE_LOCKING;
-            printf("[DOOR] Door %d: LOCKING\n", i);
+            BCM_LOG_INFO("[DOOR] Door %d: LOCKING\n", i);
         }
     }
 }
@@ -281,7 +260,7 @@ void door_control_unlock_all(void)
     for (uint8_t i = 0; i < NUM_DOORS; i++) {
         if (state->door.lock_state[i] == DOOR_STATE_LOCKED) {
             state->door.lock_state[i] = DOOR_STATE_UNLOCKING;
-            printf("[DOOR] Door %d: UNLOCKING\n", i);
+            BCM_LOG_INFO("[DOOR] Door %d: UNLOCKING\n", i);
         }
     }
 }
@@ -296,7 +275,7 @@ void door_control_lock(uint8_t door_id)
     
     if (state->door.lock_state[door_id] == DOOR_STATE_UNLOCKED) {
         state->door.lock_state[door_id] = DOOR_STATE_LOCKING;
-        printf("[DOOR] Door %d: LOCKING\n", door_id);
+        BCM_LOG_INFO("[DOOR] Door %d: LOCKING\n", door_id);
     }
 }
 
@@ -310,6 +289,6 @@ void door_control_unlock(uint8_t door_id)
     
     if (state->door.lock_state[door_id] == DOOR_STATE_LOCKED) {
         state->door.lock_state[door_id] = DOOR_STATE_UNLOCKING;
-        printf("[DOOR] Door %d: UNLOCKING\n", door_id);
+        BCM_LOG_INFO("[DOOR] Door %d: UNLOCKING\n", door_id);
     }
 }
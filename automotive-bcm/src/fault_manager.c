@@ -3,12 +3,37 @@
  * @brief Fault Manager Implementation
  *
  * Tracks active faults and provides status frame generation.
+ *
+ * Each fault code owns at most one slot, found through slot_of[code];
+ * active_map has one bit per code so queries never touch the slots.
+ * Slots are allocated and walked via 32-bit masks, so set, clear,
+ * query and the periodic update are all O(1) per fault.
+ *
+ * Lifecycle: report(failed) starts a debounce window and the fault goes
+ * active once failures persist for FAULT_DEBOUNCE_TIME_MS (set() goes
+ * active at once). An active fault heals after FAULT_HEALING_TIME_MS
+ * without a failure, unless it became active FAULT_MAX_OCCURRENCES times
+ * and is now permanent. A healed slot keeps its occurrence count until
+ * it is cleared manually or reused for a new code.
+ *
+ * Coalescing: a flood of bad frames reports the same code once per
+ * frame. fault_manager_note() lets the caller log only the first report
+ * of each FAULT_DEBOUNCE_TIME_MS window per code; the rest are counted
+ * in the slot and in a window total that the 100ms update publishes in
+ * the fault status frame.
  */
 
 #include <string.h>
-#include <stdio.h>
 #include "fault_manager.h"
+#include "bcm_log.h"
 #include "can_ids.h"
+#include "can_messages.h"
+
+/* One bit per slot in used_slots/live_slots */
+_Static_assert(MAX_ACTIVE_FAULTS >= 1U && MAX_ACTIVE_FAULTS <= 32U,
+               "fault slots are tracked in a 32-bit mask");
+#define FAULT_SLOT_MASK     ((uint32_t)(0xFFFFFFFFUL >> (32U - MAX_ACTIVE_FAULTS)))
+#define FAULT_BIT(n)        ((uint32_t)1U << (n))
 
 /*******************************************************************************
  * Private Functions
@@ -32,19 +57,83 @@ static uint8_t fault_code_to_flag(fault_code_t code)
 }
 
 /**
- * @brief Find fault in active faults array
- * @return Index if found, -1 if not found
+ * @brief Index of the lowest set bit (x != 0)
+ */
+static uint8_t lowest_bit(uint32_t x)
+{
+#if defined(__GNUC__)
+    return (uint8_t)__builtin_ctz(x);
+#else
+    uint8_t n = 0;
+    while ((x & 1U) == 0U) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/**
+ * @brief Look up the slot holding a fault code
+ * @return Slot entry, NULL if the code has none
+ */
+static fault_entry_t *slot_get(fault_state_t *fault, fault_code_t code)
+{
+    uint8_t slot = fault->slot_of[(uint8_t)code];
+    return (slot != 0U) ? &fault->slots[slot - 1U] : NULL;
+}
+
+/**
+ * @brief Return a slot to the free set
+ */
+static void slot_release(fault_state_t *fault, uint8_t slot)
+{
+    fault->slot_of[(uint8_t)fault->slots[slot].code] = 0U;
+    fault->used_slots &= ~FAULT_BIT(slot);
+    fault->live_slots &= ~FAULT_BIT(slot);
+}
+
+/**
+ * @brief Get the slot for a code, allocating one if needed
+ *
+ * When every slot is taken, one that only holds history (healed, not
+ * pending) is reused.
+ *
+ * @return Slot entry, NULL if all slots hold live faults
  */
-static int find_fault(fault_code_t code)
+static fault_entry_t *slot_acquire(fault_state_t *fault, fault_code_t code)
 {
-    const fault_state_t *fault = &sys_state_get()->fault;
+    fault_entry_t *entry = slot_get(fault, code);
+    if (entry != NULL) {
+        return entry;
+    }
     
-    for (uint8_t i = 0; i < fault->active_count; i++) {
-        if (fault->active_faults[i].code == code) {
-            return (int)i;
+    uint32_t free_slots = ~fault->used_slots & FAULT_SLOT_MASK;
+    if (free_slots == 0U) {
+        uint32_t idle = fault->used_slots & ~fault->live_slots;
+        if (idle == 0U) {
+            return NULL;
         }
+        slot_release(fault, lowest_bit(idle));
+        free_slots = ~fault->used_slots & FAULT_SLOT_MASK;
     }
-    return -1;
+    
+    uint8_t slot = lowest_bit(free_slots);
+    entry = &fault->slots[slot];
+    memset(entry, 0, sizeof(*entry));
+    entry->code = (uint8_t)code;
+    
+    fault->used_slots |= FAULT_BIT(slot);
+    fault->slot_of[(uint8_t)code] = (uint8_t)(slot + 1U);
+    return entry;
+}
+
+/**
+ * @brief Slot number of an entry
+ */
+static uint8_t slot_index(const fault_state_t *fault, const fault_entry_t *entry)
+{
+    return (uint8_t)(entry - fault->slots);
 }
 
 /**
@@ -56,155 +145,382 @@ static void log_fault_event(bool set, fault_code_t code)
     event_log_add(set ? EVENT_FAULT_SET : EVENT_FAULT_CLEAR, data);
 }
 
+/**
+ * @brief Qualify a fault: set its bit, flags and counters
+ */
+static void fault_activate(fault_state_t *fault, fault_entry_t *entry, uint32_t now_ms)
+{
+    uint8_t code = entry->code;
+    
+    entry->flags = (uint8_t)((entry->flags & ~FAULT_ENTRY_PENDING) | FAULT_ENTRY_ACTIVE);
+    entry->timestamp_ms = now_ms;
+    if (entry->occurrences < UINT8_MAX) {
+        entry->occurrences++;
+    }
+    if (entry->occurrences >= FAULT_MAX_OCCURRENCES) {
+        entry->flags |= FAULT_ENTRY_PERMANENT;
+    }
+    
+    fault->active_map[code >> 5] |= FAULT_BIT(code & 31U);
+    fault->live_slots |= FAULT_BIT(slot_index(fault, entry));
+    fault->active_count++;
+    
+    /* Update flags */
+    fault->flags1 |= fault_code_to_flag(entry->code);
+    
+    /* Update most recent */
+    fault->most_recent_code = entry->code;
+    fault->most_recent_time_ms = now_ms;
+    fault->total_count++;
+    
+    log_fault_event(true, entry->code);
+    BCM_LOG_WARN("[FAULT] SET: 0x%02X\n", code);
+}
+
+/**
+ * @brief Drop a fault from the active set (the slot keeps its history)
+ */
+static void fault_deactivate(fault_state_t *fault, fault_entry_t *entry)
+{
+    uint8_t code = entry->code;
+    
+    entry->flags &= (uint8_t)~(FAULT_ENTRY_ACTIVE | FAULT_ENTRY_PENDING);
+    
+    fault->active_map[code >> 5] &= ~FAULT_BIT(code & 31U);
+    fault->live_slots &= ~FAULT_BIT(slot_index(fault, entry));
+    fault->active_count--;
+    
+    /* Update flags */
+    fault->flags1 &= (uint8_t)~fault_code_to_flag(entry->code);
+    
+    log_fault_event(false, entry->code);
+}
+
+/**
+ * @brief Set a fault active, allocating its slot
+ * @return Slot entry, NULL if the fault was dropped
+ */
+static fault_entry_t *fault_set_entry(fault_state_t *fault, fault_code_t code,
+                                      uint32_t now_ms)
+{
+    fault_entry_t *entry = slot_acquire(fault, code);
+    if (entry == NULL) {
+        return NULL; /* Every slot holds a live fault */
+    }
+    
+    /* Restart the healing timer even if already active */
+    entry->last_fail_ms = now_ms;
+    
+    if ((entry->flags & FAULT_ENTRY_ACTIVE) == 0U) {
+        fault_activate(fault, entry, now_ms);
+    }
+    
+    return entry;
+}
+
+/**
+ * @brief Count a repeat report toward the published window total
+ */
+static void fault_count_repeat(fault_state_t *fault)
+{
+    if (fault->repeat_window < UINT16_MAX) {
+        fault->repeat_window++;
+    }
+}
+
 /*******************************************************************************
  * Public Functions
  ******************************************************************************/
 
 void fault_manager_init(void)
 {
-    fault_state_t *fault = &sys_state_get_mut()->fault;
+    fault_state_t *fault = sys_fault_get_mut();
     
     fault->flags1 = 0;
-    fault->flags2 = 0;
+    fault->repeat_rate = 0;
+    fault->repeat_window = 0;
     fault->active_count = 0;
     fault->total_count = 0;
     fault->most_recent_code = FAULT_CODE_NONE;
     fault->most_recent_time_ms = 0;
     
-    memset(fault->active_faults, 0, sizeof(fault->active_faults));
+    memset(fault->active_map, 0, sizeof(fault->active_map));
+    memset(fault->slot_of, 0, sizeof(fault->slot_of));
+    fault->used_slots = 0;
+    fault->live_slots = 0;
     
-    printf("[FAULT] Initialized\n");
+    BCM_LOG_INFO("[FAULT] Initialized\n");
 }
 
 void fault_manager_set(fault_code_t code)
 {
-    fault_state_t *fault = &sys_state_get_mut()->fault;
-    const system_state_t *state = sys_state_get();
+    (void)fault_set_entry(sys_fault_get_mut(), code, sys_state_get()->uptime_ms);
+}
+
+bool fault_manager_note(fault_code_t code)
+{
+    fault_state_t *fault = sys_fault_get_mut();
+    uint32_t now_ms = sys_state_get()->uptime_ms;
     
-    /* Check if already active */
-    if (find_fault(code) >= 0) {
-        return; /* Already active */
+    fault_entry_t *entry = fault_set_entry(fault, code, now_ms);
+    if (entry == NULL) {
+        /* Dropped faults are counted but never logged, so a flood with
+         * full slots cannot log per frame */
+        fault_count_repeat(fault);
+        return false;
     }
     
-    /* Add to active faults if room */
-    if (fault->active_count < MAX_ACTIVE_FAULTS) {
-        fault->active_faults[fault->active_count].code = code;
-        fault->active_faults[fault->active_count].timestamp_ms = state->uptime_ms;
-        fault->active_count++;
+    if ((entry->flags & FAULT_ENTRY_LOGGED) == 0U ||
+        (uint32_t)(now_ms - entry->logged_ms) >= FAULT_DEBOUNCE_TIME_MS) {
+        entry->flags |= FAULT_ENTRY_LOGGED;
+        entry->logged_ms = now_ms;
+        return true;
     }
     
-    /* Update flags */
-    fault->flags1 |= fault_code_to_flag(code);
+    if (entry->repeats < UINT16_MAX) {
+        entry->repeats++;
+    }
+    fault_count_repeat(fault);
+    return false;
+}
+
+void fault_manager_report(fault_code_t code, bool failed)
+{
+    fault_state_t *fault = sys_fault_get_mut();
+    uint32_t now_ms = sys_state_get()->uptime_ms;
+    fault_entry_t *entry;
     
-    /* Update most recent */
-    fault->most_recent_code = code;
-    fault->most_recent_time_ms = state->uptime_ms;
-    fault->total_count++;
+    if (!failed) {
+        /* A passing check restarts debouncing; healing is time based */
+        entry = slot_get(fault, code);
+        if (entry != NULL && (entry->flags & FAULT_ENTRY_PENDING) != 0U) {
+            entry->flags &= (uint8_t)~FAULT_ENTRY_PENDING;
+            fault->live_slots &= ~FAULT_BIT(slot_index(fault, entry));
+        }
+        return;
+    }
     
-    log_fault_event(true, code);
-    printf("[FAULT] SET: 0x%02X\n", code);
+    entry = slot_acquire(fault, code);
+    if (entry == NULL) {
+        return;
+    }
+    
+    entry->last_fail_ms = now_ms;
+    if ((entry->flags & FAULT_ENTRY_ACTIVE) != 0U) {
+        return;
+    }
+    
+    if ((entry->flags & FAULT_ENTRY_PENDING) == 0U) {
+        entry->flags |= FAULT_ENTRY_PENDING;
+        entry->first_fail_ms = now_ms;
+        fault->live_slots |= FAULT_BIT(slot_index(fault, entry));
+    }
+    
+    if ((uint32_t)(now_ms - entry->first_fail_ms) >= FAULT_DEBOUNCE_TIME_MS) {
+        fault_activate(fault, entry, now_ms);
+    }
 }
 
 void fault_manager_clear(fault_code_t code)
 {
-    fault_state_t *fault = &sys_state_get_mut()->fault;
+    fault_state_t *fault = sys_fault_get_mut();
     
-    int idx = find_fault(code);
-    if (idx < 0) {
+    fault_entry_t *entry = slot_get(fault, code);
+    if (entry == NULL) {
         return; /* Not found */
     }
     
-    /* Remove from array by shifting */
-    for (uint8_t i = (uint8_t)idx; i < fault->active_count - 1; i++) {
-        fault->active_faults[i] = fault->active_faults[i + 1];
+    bool was_active = (entry->flags & FAULT_ENTRY_ACTIVE) != 0U;
+    if (was_active) {
+        fault_deactivate(fault, entry);
     }
-    fault->active_count--;
     
-    /* Update flags */
-    fault->flags1 &= ~fault_code_to_flag(code);
+    /* A manual clear also resets the occurrence history */
+    slot_release(fault, slot_index(fault, entry));
     
-    log_fault_event(false, code);
-    printf("[FAULT] CLEAR: 0x%02X\n", code);
+    if (was_active) {
+        BCM_LOG_INFO("[FAULT] CLEAR: 0x%02X\n", code);
+    }
 }
 
 void fault_manager_clear_all(void)
 {
-    fault_state_t *fault = &sys_state_get_mut()->fault;
+    fault_state_t *fault = sys_fault_get_mut();
     
-    for (uint8_t i = 0; i < fault->active_count; i++) {
-        log_fault_event(false, fault->active_faults[i].code);
+    uint32_t used = fault->used_slots;
+    while (used != 0U) {
+        uint8_t slot = lowest_bit(used);
+        used &= used - 1U;
+        
+        if ((fault->slots[slot].flags & FAULT_ENTRY_ACTIVE) != 0U) {
+            log_fault_event(false, fault->slots[slot].code);
+        }
+        fault->slot_of[(uint8_t)fault->slots[slot].code] = 0U;
     }
     
+    memset(fault->active_map, 0, sizeof(fault->active_map));
+    fault->used_slots = 0;
+    fault->live_slots = 0;
+    
     fault->flags1 = 0;
-    fault->flags2 = 0;
     fault->active_count = 0;
     
-    printf("[FAULT] CLEAR ALL\n");
+    BCM_LOG_INFO("[FAULT] CLEAR ALL\n");
 }
 
 bool fault_manager_is_active(fault_code_t code)
 {
-    return (find_fault(code) >= 0);
+    uint8_t c = (uint8_t)code;
+    return (sys_fault_get()->active_map[c >> 5] & FAULT_BIT(c & 31U)) != 0U;
+}
+
+uint8_t fault_manager_get_occurrences(fault_code_t code)
+{
+    const fault_state_t *fault = sys_fault_get();
+    uint8_t slot = fault->slot_of[(uint8_t)code];
+    return (slot != 0U) ? fault->slots[slot - 1U].occurrences : 0U;
+}
+
+uint16_t fault_manager_get_repeats(fault_code_t code)
+{
+    const fault_state_t *fault = sys_fault_get();
+    uint8_t slot = fault->slot_of[(uint8_t)code];
+    return (slot != 0U) ? fault->slots[slot - 1U].repeats : 0U;
+}
+
+bool fault_manager_is_permanent(fault_code_t code)
+{
+    const fault_state_t *fault = sys_fault_get();
+    uint8_t slot = fault->slot_of[(uint8_t)code];
+    return (slot != 0U) && ((fault->slots[slot - 1U].flags & FAULT_ENTRY_PERMANENT) != 0U);
+}
+
+bool fault_manager_report_rx_check(uint8_t flags)
+{
+    if ((flags & CAN_CHECK_BAD_DLC) != 0U) {
+        return fault_manager_note(FAULT_CODE_INVALID_LENGTH);
+    } else if ((flags & CAN_CHECK_BAD_CHECKSUM) != 0U) {
+        return fault_manager_note(FAULT_CODE_INVALID_CHECKSUM);
+    } else if ((flags & CAN_CHECK_BAD_COUNTER) != 0U) {
+        return fault_manager_note(FAULT_CODE_INVALID_COUNTER);
+    } else if ((flags & CAN_CHECK_BAD_FIELD) != 0U) {
+        return fault_manager_note(FAULT_CODE_INVALID_CMD);
+    }
+    return false;
+}
+
+cmd_result_t fault_manager_report_cmd_check(const can_frame_t *frame, uint8_t flags,
+                                            fault_cmd_source_t source)
+{
+    cmd_result_t result = can_check_to_result(flags);
+    
+    if (!fault_manager_report_rx_check(flags)) {
+        return result;
+    }
+    
+    uint8_t data[4] = { (uint8_t)result, frame->data[0], 0, 0 };
+    event_log_add(EVENT_CMD_ERROR, data);
+    
+    /* Deferred log formats must be literals, one per module */
+    switch (source) {
+        case FAULT_CMD_SOURCE_DOOR:
+            BCM_LOG_WARN("[DOOR] Command error: %d\n", result);
+            break;
+        
+        case FAULT_CMD_SOURCE_LIGHTING:
+            BCM_LOG_WARN("[LIGHT] Command error: %d\n", result);
+            break;
+        
+        case FAULT_CMD_SOURCE_TURN:
+        default:
+            BCM_LOG_WARN("[TURN] Command error: %d\n", result);
+            break;
+    }
+    
+    return result;
 }
 
 uint8_t fault_manager_get_count(void)
 {
-    return sys_state_get()->fault.active_count;
+    return sys_fault_get()->active_count;
 }
 
 uint8_t fault_manager_get_flags1(void)
 {
-    return sys_state_get()->fault.flags1;
+    return sys_fault_get()->flags1;
 }
 
-uint8_t fault_manager_get_flags2(void)
+uint8_t fault_manager_get_repeat_rate(void)
 {
-    return sys_state_get()->fault.flags2;
+    return sys_fault_get()->repeat_rate;
 }
 
 fault_code_t fault_manager_get_most_recent(void)
 {
-    return sys_state_get()->fault.most_recent_code;
+    return (fault_code_t)sys_fault_get()->most_recent_code;
 }
 
 void fault_manager_build_status_frame(can_frame_t *frame)
 {
-    const fault_state_t *fault = &sys_state_get()->fault;
+    can_frame_template_init(frame, CAN_ID_FAULT_STATUS, FAULT_STATUS_DLC,
+                            CAN_CHECKSUM_SEED);
+    fault_manager_update_status_frame(frame);
+}
+
+void fault_manager_update_status_frame(can_frame_t *frame)
+{
+    const fault_state_t *fault = sys_fault_get();
     system_state_t *mut_state = sys_state_get_mut();
     
-    memset(frame, 0, sizeof(can_frame_t));
-    frame->id = CAN_ID_FAULT_STATUS;
-    frame->dlc = FAULT_STATUS_DLC;
-    
-    /* Byte 0: Fault flags 1 */
-    frame->data[FAULT_STATUS_BYTE_FLAGS1] = fault->flags1;
-    
-    /* Byte 1: Fault flags 2 */
-    frame->data[FAULT_STATUS_BYTE_FLAGS2] = fault->flags2;
-    
-    /* Byte 2: Total fault count */
-    frame->data[FAULT_STATUS_BYTE_COUNT] = fault->total_count;
-    
-    /* Byte 3: Most recent fault code */
-    frame->data[FAULT_STATUS_BYTE_RECENT_CODE] = (uint8_t)fault->most_recent_code;
-    
-    /* Bytes 4-5: Timestamp (seconds since boot) */
+    /* Timestamp: seconds since boot, high byte first */
     uint16_t timestamp_sec = (uint16_t)(fault->most_recent_time_ms / 1000U);
-    frame->data[FAULT_STATUS_BYTE_TS_HIGH] = (uint8_t)(timestamp_sec >> 8);
-    frame->data[FAULT_STATUS_BYTE_TS_LOW] = (uint8_t)(timestamp_sec & 0xFF);
+    can_msg_fault_status_t msg = {0};
+    msg.flags = fault->flags1;
+    msg.repeats = fault->repeat_rate;
+    msg.count = fault->total_count;
+    msg.recent_code = fault->most_recent_code;
+    msg.timestamp_high = (uint8_t)(timestamp_sec >> 8);
+    msg.timestamp_low = (uint8_t)(timestamp_sec & 0xFF);
     
-    /* Byte 6: Version and counter */
-    frame->data[FAULT_STATUS_BYTE_VER_CTR] = CAN_BUILD_VER_CTR(
-        CAN_SCHEMA_VERSION, mut_state->tx_counter_fault);
+    /* Only changed bytes are written; the checksum follows can_frame_put() */
+    can_msg_fault_status_update(frame, &msg, mut_state->tx_counter_fault);
     mut_state->tx_counter_fault = (mut_state->tx_counter_fault + 1) & CAN_COUNTER_MASK;
-    
-    /* Byte 7: Checksum */
-    frame->data[FAULT_STATUS_BYTE_CHECKSUM] = can_calculate_checksum(
-        frame->data, FAULT_STATUS_DLC - 1);
 }
 
 void fault_manager_update(uint32_t current_ms)
 {
-    /* Future: implement fault aging, auto-clear, etc. */
-    (void)current_ms;
+    fault_state_t *fault = sys_fault_get_mut();
+    
+    /* Publish the coalesced report total of the window that just ended */
+    fault->repeat_rate = (fault->repeat_window > UINT8_MAX) ?
+                         UINT8_MAX : (uint8_t)fault->repeat_window;
+    fault->repeat_window = 0;
+    
+    /* Only slots with an active or pending fault can change state */
+    uint32_t live = fault->live_slots;
+    while (live != 0U) {
+        uint8_t slot = lowest_bit(live);
+        live &= live - 1U;
+        
+        fault_entry_t *entry = &fault->slots[slot];
+        uint32_t quiet_ms = current_ms - entry->last_fail_ms;
+        
+        if ((entry->flags & FAULT_ENTRY_PENDING) != 0U) {
+            /* Failure stopped before it was debounced */
+            if (quiet_ms > FAULT_DEBOUNCE_TIME_MS) {
+                entry->flags &= (uint8_t)~FAULT_ENTRY_PENDING;
+                fault->live_slots &= ~FAULT_BIT(slot);
+            }
+            continue;
+        }
+
+#if FAULT_ENABLE_RECOVERY
+        /* Heal after FAULT_HEALING_TIME_MS without a failure report */
+        if ((entry->flags & FAULT_ENTRY_PERMANENT) == 0U &&
+            quiet_ms >= FAULT_HEALING_TIME_MS) {
+            fault_deactivate(fault, entry);
+            BCM_LOG_INFO("[FAULT] HEALED: 0x%02X\n", entry->code);
+        }
+#endif
+    }
 }
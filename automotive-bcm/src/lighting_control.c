@@ -4,13 +4,21 @@
  *
  * Headlight state machine: OFF <-> ON <-> AUTO
  * AUTO mode turns on when ambient < threshold
+ *
+ * Interior light: every brightness change fades over LIGHT_INTERIOR_FADE_MS.
+ * The ramp steps an 8.8 fixed-point perceptual level once per 10ms run and
+ * looks the PWM duty up in the generated gamma table (light_gamma.h). The
+ * step is worked out once per fade, so a run costs an add, a compare and a
+ * table read, and none at all once the ramp has ended.
  */
 
 #include <string.h>
-#include <stdio.h>
 #include "lighting_control.h"
 #include "fault_manager.h"
+#include "bcm_log.h"
 #include "can_ids.h"
+#include "can_messages.h"
+#include "light_gamma.h"
 
 /*******************************************************************************
  * Private Definitions
@@ -20,65 +28,78 @@
 #define AUTO_OFF_THRESHOLD      120U    /**< Turn off above this */
 #define AUTO_UPDATE_TIMEOUT_MS  10000U  /**< Fault if no ambient update */
 
-/*******************************************************************************
- * Private Data
- ******************************************************************************/
+#define FADE_STEPS              (LIGHT_INTERIOR_FADE_MS / BCM_MAIN_CYCLE_TIME_MS)
+#define FADE_LEVEL_SHIFT        8U      /**< 8.8 fixed-point level */
 
-static uint32_t g_last_ambient_update_ms = 0;
+_Static_assert(FADE_STEPS > 0U, "LIGHT_INTERIOR_FADE_MS must cover a 10ms run");
+_Static_assert(LIGHT_GAMMA_MAX_LEVEL == 0xFFU,
+               "brightness_level() spreads 0-15 over levels 0-255");
 
 /*******************************************************************************
  * Private Functions
  ******************************************************************************/
 
 /**
- * @brief Validate lighting command frame
+ * @brief Perceptual level (0-255) of an interior brightness (0-15)
+ *
+ * b * 17 as a nibble copy: 15 maps to full duty.
  */
-static cmd_result_t validate_lighting_cmd(const can_frame_t *frame)
+static uint8_t brightness_level(uint8_t brightness)
 {
-    system_state_t *state = sys_state_get_mut();
-    
-    /* Check DLC */
-    if (frame->dlc != LIGHTING_CMD_DLC) {
-        fault_manager_set(FAULT_CODE_INVALID_LENGTH);
-        return CMD_RESULT_INVALID_CMD;
-    }
-    
-    /* Extract fields */
-    uint8_t ver_ctr = frame->data[LIGHTING_CMD_BYTE_VER_CTR];
-    uint8_t checksum = frame->data[LIGHTING_CMD_BYTE_CHECKSUM];
+    return (uint8_t)((brightness << 4) | brightness);
+}
+
+/**
+ * @brief Start a fade of the interior light to its commanded brightness
+ *
+ * A repeat of the running fade's target leaves the ramp alone.
+ */
+static void interior_fade_start(lighting_state_t *lighting)
+{
+    lighting_fade_t *fade = &sys_cold_get_mut()->lighting_fade;
+    uint8_t level = lighting->interior_on ? brightness_level(lighting->interior_brightness) : 0U;
+    uint16_t target = (uint16_t)(level << FADE_LEVEL_SHIFT);
     
-    /* Validate checksum */
-    uint8_t calc_checksum = can_calculate_checksum(frame->data, LIGHTING_CMD_DLC - 1);
-    if (checksum != calc_checksum) {
-        fault_manager_set(FAULT_CODE_INVALID_CHECKSUM);
-        return CMD_RESULT_CHECKSUM_ERROR;
+    if (lighting->interior_fading && target == fade->target) {
+        return;
     }
     
-    /* Validate counter */
-    uint8_t counter = CAN_GET_COUNTER(ver_ctr);
-    if (state->lighting.last_cmd_time_ms > 0) {
-        if (!can_validate_counter(counter, state->lighting.last_counter)) {
-            fault_manager_set(FAULT_CODE_INVALID_COUNTER);
-            return CMD_RESULT_COUNTER_ERROR;
-        }
+    uint16_t distance = (target > fade->level) ? (uint16_t)(target - fade->level) :
+                                                 (uint16_t)(fade->level - target);
+    if (distance == 0U) {
+        lighting->interior_fading = false;
+        return;
     }
-    state->lighting.last_counter = counter;
     
-    /* Validate headlight command */
-    uint8_t headlight_cmd = frame->data[LIGHTING_CMD_BYTE_HEADLIGHT];
-    if (headlight_cmd > HEADLIGHT_CMD_MAX) {
-        fault_manager_set(FAULT_CODE_INVALID_CMD);
-        return CMD_RESULT_INVALID_CMD;
+    /* Rounded up, so every fade ends within FADE_STEPS runs */
+    fade->target = target;
+    fade->step = (uint16_t)((distance + FADE_STEPS - 1U) / FADE_STEPS);
+    lighting->interior_fading = true;
+}
+
+/**
+ * @brief Advance the interior fade by one 10ms run
+ */
+static void interior_fade_step(lighting_state_t *lighting)
+{
+    lighting_fade_t *fade = &sys_cold_get_mut()->lighting_fade;
+    uint16_t level = fade->level;
+    
+    if (level < fade->target) {
+        level = ((uint16_t)(fade->target - level) > fade->step) ?
+                (uint16_t)(level + fade->step) : fade->target;
+    } else {
+        level = ((uint16_t)(level - fade->target) > fade->step) ?
+                (uint16_t)(level - fade->step) : fade->target;
     }
+    fade->level = level;
+    lighting->interior_duty = light_gamma_lut[level >> FADE_LEVEL_SHIFT];
     
-    /* Validate interior command */
-    uint8_t interior_cmd = frame->data[LIGHTING_CMD_BYTE_INTERIOR] & INTERIOR_MODE_MASK;
-    if (interior_cmd > INTERIOR_CMD_MAX) {
-        fault_manager_set(FAULT_CODE_INVALID_CMD);
-        return CMD_RESULT_INVALID_CMD;
+    /* Intermediate duties go out with the periodic status frames */
+    if (level == fade->target) {
+        lighting->interior_fading = false;
+        sys_state_mark_tx_dirty(SYS_TX_DIRTY_LIGHTING);
     }
-    
-    return CMD_RESULT_OK;
 }
 
 /**
@@ -88,54 +109,70 @@ static void log_lighting_event(uint8_t type, uint8_t old_state, uint8_t new_stat
 {
     uint8_t data[4] = { type, old_state, new_state, 0 };
     event_log_add(EVENT_HEADLIGHT_CHANGE, data);
+    sys_state_mark_tx_dirty(SYS_TX_DIRTY_LIGHTING);
 }
 
 /**
- * @brief Update headlight output based on mode and ambient
+ * @brief Headlight output the next update_headlight_output() call sets
+ *
+ * AUTO coming from ON takes two calls: the first one only enters AUTO.
  */
-static void update_headlight_output(void)
+static uint8_t headlight_target(const lighting_state_t *lighting)
 {
-    system_state_t *state = sys_state_get_mut();
-    headlight_state_t old_output = state->lighting.headlight_output;
+    uint8_t output = lighting->headlight_output;
     
-    switch (state->lighting.headlight_mode) {
+    switch (lighting->headlight_mode) {
         case LIGHTING_STATE_OFF:
-            state->lighting.headlight_output = HEADLIGHT_STATE_OFF;
-            state->lighting.high_beam_active = false;
+            output = HEADLIGHT_STATE_OFF;
             break;
-            
+        
         case LIGHTING_STATE_ON:
-            if (state->lighting.high_beam_active) {
-                state->lighting.headlight_output = HEADLIGHT_STATE_HIGH_BEAM;
+            if (lighting->high_beam_active) {
+                output = HEADLIGHT_STATE_HIGH_BEAM;
             } else {
-                state->lighting.headlight_output = HEADLIGHT_STATE_ON;
+                output = HEADLIGHT_STATE_ON;
             }
             break;
-            
+        
         case LIGHTING_STATE_AUTO:
             /* Hysteresis for auto mode */
-            if (state->lighting.headlight_output == HEADLIGHT_STATE_OFF ||
-                state->lighting.headlight_output == HEADLIGHT_STATE_AUTO) {
-                if (state->lighting.ambient_light < AUTO_ON_THRESHOLD) {
-                    state->lighting.headlight_output = HEADLIGHT_STATE_AUTO;
-                } else if (state->lighting.ambient_light > AUTO_OFF_THRESHOLD) {
-                    state->lighting.headlight_output = HEADLIGHT_STATE_OFF;
+            if (output == HEADLIGHT_STATE_OFF || output == HEADLIGHT_STATE_AUTO) {
+                if (lighting->ambient_light < AUTO_ON_THRESHOLD) {
+                    output = HEADLIGHT_STATE_AUTO;
+                } else if (lighting->ambient_light > AUTO_OFF_THRESHOLD) {
+                    output = HEADLIGHT_STATE_OFF;
                 }
             } else {
-                state->lighting.headlight_output = HEADLIGHT_STATE_AUTO;
+                output = HEADLIGHT_STATE_AUTO;
             }
             
             /* High beam in auto mode */
-            if (state->lighting.high_beam_active && 
-                state->lighting.headlight_output != HEADLIGHT_STATE_OFF) {
-                state->lighting.headlight_output = HEADLIGHT_STATE_HIGH_BEAM;
+            if (lighting->high_beam_active && output != HEADLIGHT_STATE_OFF) {
+                output = HEADLIGHT_STATE_HIGH_BEAM;
             }
             break;
     }
     
+    return output;
+}
+
+/**
+ * @brief Update headlight output based on mode and ambient
+ */
+static void update_headlight_output(void)
+{
+    system_state_t *state = sys_state_get_mut();
+    headlight_state_t old_output = state->lighting.headlight_output;
+    
+    state->lighting.headlight_output = headlight_target(&state->lighting);
+    if (state->lighting.headlight_mode == LIGHTING_STATE_OFF) {
+        state->lighting.high_beam_active = false;
+    }
+    
     if (old_output != state->lighting.headlight_output) {
-        printf("[LIGHT] Headlight output: %d -> %d\n", 
-               old_output, state->lighting.headlight_output);
+        sys_state_mark_tx_dirty(SYS_TX_DIRTY_LIGHTING);
+        BCM_LOG_INFO("[LIGHT] Headlight output: %d -> %d\n", 
+                     old_output, state->lighting.headlight_output);
     }
 }
 
@@ -153,17 +190,40 @@ void lighting_control_init(void)
     state->lighting.interior_mode = LIGHTING_STATE_OFF;
     state->lighting.interior_brightness = 0;
     state->lighting.interior_on = false;
+    state->lighting.interior_duty = 0;
+    state->lighting.interior_fading = false;
     state->lighting.ambient_light = 128;
     state->lighting.last_cmd_time_ms = 0;
-    state->lighting.last_counter = 0;
+    state->lighting.rx_counter.last = 0;
+    state->lighting.rx_counter.seen = 0;
     state->lighting.last_result = CMD_RESULT_OK;
     
-    g_last_ambient_update_ms = 0;
+    state->lighting.last_ambient_update_ms = 0;
+    
+    memset(&sys_cold_get_mut()->lighting_fade, 0, sizeof(lighting_fade_t));
     
-    printf("[LIGHT] Initialized\n");
+    BCM_LOG_INFO("[LIGHT] Initialized\n");
+}
+
+void lighting_control_check_cmds(const can_frame_t *frames, uint8_t count, uint8_t *flags)
+{
+    system_state_t *state = sys_state_get_mut();
+    
+    (void)can_check_batch(&can_msg_lighting_cmd_desc, frames, count,
+                          &state->lighting.rx_counter, flags);
 }
 
 cmd_result_t lighting_control_handle_cmd(const can_frame_t *frame)
+{
+    uint8_t flags = CAN_CHECK_OK;
+    
+    if (frame != NULL && frame->id == CAN_ID_LIGHTING_CMD) {
+        lighting_control_check_cmds(frame, 1U, &flags);
+    }
+    return lighting_control_apply_cmd(frame, flags);
+}
+
+cmd_result_t lighting_control_apply_cmd(const can_frame_t *frame, uint8_t flags)
 {
     if (frame == NULL || frame->id != CAN_ID_LIGHTING_CMD) {
         return CMD_RESULT_INVALID_CMD;
@@ -171,56 +231,54 @@ cmd_result_t lighting_control_handle_cmd(const can_frame_t *frame)
     
     system_state_t *state = sys_state_get_mut();
     
-    /* Validate frame */
-    cmd_result_t result = validate_lighting_cmd(frame);
+    /* Checked by lighting_control_check_cmds() */
+    cmd_result_t result = fault_manager_report_cmd_check(frame, flags,
+                                                         FAULT_CMD_SOURCE_LIGHTING);
     if (result != CMD_RESULT_OK) {
-        state->lighting.last_result = result;
-        
-        uint8_t data[4] = { (uint8_t)result, frame->data[0], 0, 0 };
-        event_log_add(EVENT_CMD_ERROR, data);
-        
-        printf("[LIGHT] Command error: %d\n", result);
+        state->lighting.last_result = (uint8_t)result;
         return result;
     }
     
+    can_msg_lighting_cmd_t msg;
+    can_msg_lighting_cmd_decode(frame, &msg);
+    
     /* Process headlight command */
-    uint8_t headlight_cmd = frame->data[LIGHTING_CMD_BYTE_HEADLIGHT];
-    lighting_mode_state_t old_mode = state->lighting.headlight_mode;
+    uint8_t headlight_cmd = msg.headlight;
+    lighting_mode_state_t old_mode = (lighting_mode_state_t)state->lighting.headlight_mode;
     
     switch (headlight_cmd) {
         case HEADLIGHT_CMD_OFF:
             state->lighting.headlight_mode = LIGHTING_STATE_OFF;
             state->lighting.high_beam_active = false;
             break;
-            
+        
         case HEADLIGHT_CMD_ON:
             state->lighting.headlight_mode = LIGHTING_STATE_ON;
             break;
-            
+        
         case HEADLIGHT_CMD_AUTO:
             state->lighting.headlight_mode = LIGHTING_STATE_AUTO;
             break;
-            
+        
         case HEADLIGHT_CMD_HIGH_ON:
             state->lighting.high_beam_active = true;
             break;
-            
+        
         case HEADLIGHT_CMD_HIGH_OFF:
             state->lighting.high_beam_active = false;
             break;
     }
     
     if (old_mode != state->lighting.headlight_mode) {
-        log_lighting_event(0, (uint8_t)old_mode, (uint8_t)state->lighting.headlight_mode);
-        printf("[LIGHT] Headlight mode: %d -> %d\n", old_mode, state->lighting.headlight_mode);
+        log_lighting_event(0, (uint8_t)old_mode, state->lighting.headlight_mode);
+        BCM_LOG_INFO("[LIGHT] Headlight mode: %d -> %d\n", old_mode, state->lighting.headlight_mode);
     }
     
     /* Process interior command */
-    uint8_t interior_byte = frame->data[LIGHTING_CMD_BYTE_INTERIOR];
-    uint8_t interior_cmd = interior_byte & INTERIOR_MODE_MASK;
-    uint8_t brightness = (interior_byte >> 4) & 0x0FU;
+    uint8_t interior_cmd = msg.interior_mode;
+    uint8_t brightness = msg.interior_brightness;
     
-    lighting_mode_state_t old_interior = state->lighting.interior_mode;
+    lighting_mode_state_t old_interior = (lighting_mode_state_t)state->lighting.interior_mode;
     
     switch (interior_cmd) {
         case INTERIOR_CMD_OFF:
@@ -228,22 +286,23 @@ cmd_result_t lighting_control_handle_cmd(const can_frame_t *frame)
             state->lighting.interior_on = false;
             state->lighting.interior_brightness = 0;
             break;
-            
+        
         case INTERIOR_CMD_ON:
             state->lighting.interior_mode = LIGHTING_STATE_ON;
             state->lighting.interior_on = true;
             state->lighting.interior_brightness = brightness;
             break;
-            
+        
         case INTERIOR_CMD_AUTO:
             state->lighting.interior_mode = LIGHTING_STATE_AUTO;
             break;
     }
+    interior_fade_start(&state->lighting);
     
     if (old_interior != state->lighting.interior_mode) {
-        log_lighting_event(1, (uint8_t)old_interior, (uint8_t)state->lighting.interior_mode);
-        printf("[LIGHT] Interior mode: %d (brightness %d)\n", 
-               state->lighting.interior_mode, state->lighting.interior_brightness);
+        log_lighting_event(1, (uint8_t)old_interior, state->lighting.interior_mode);
+        BCM_LOG_INFO("[LIGHT] Interior mode: %d (brightness %d)\n", 
+                     state->lighting.interior_mode, state->lighting.interior_brightness);
     }
     
     /* Update output */
@@ -265,58 +324,80 @@ void lighting_control_update(uint32_t current_ms)
     /* Update output based on current mode */
     update_headlight_output();
     
-    /* Check for ambient sensor timeout in AUTO mode */
-    if (state->lighting.headlight_mode == LIGHTING_STATE_AUTO) {
-        if (g_last_ambient_update_ms > 0 &&
-            (current_ms - g_last_ambient_update_ms) > AUTO_UPDATE_TIMEOUT_MS) {
-            fault_manager_set(FAULT_CODE_TIMEOUT);
-            printf("[LIGHT] AUTO mode ambient sensor timeout\n");
+    if (state->lighting.interior_fading) {
+        interior_fade_step(&state->lighting);
+    }
+    
+    /* Check for ambient sensor timeout in AUTO mode (debounced monitor) */
+    if (state->lighting.headlight_mode == LIGHTING_STATE_AUTO &&
+        state->lighting.last_ambient_update_ms > 0) {
+        bool timed_out = (current_ms - state->lighting.last_ambient_update_ms) >
+                         AUTO_UPDATE_TIMEOUT_MS;
+        bool was_active = fault_manager_is_active(FAULT_CODE_TIMEOUT);
+        
+        fault_manager_report(FAULT_CODE_TIMEOUT, timed_out);
+        if (!was_active && fault_manager_is_active(FAULT_CODE_TIMEOUT)) {
+            BCM_LOG_WARN("[LIGHT] AUTO mode ambient sensor timeout\n");
         }
     }
 }
 
-void lighting_control_build_status_frame(can_frame_t *frame)
+uint32_t lighting_control_next_deadline(uint32_t now_ms)
 {
-    const system_state_t *state = sys_state_get();
-    system_state_t *mut_state = sys_state_get_mut();
+    const lighting_state_t *lighting = &sys_state_get()->lighting;
     
-    memset(frame, 0, sizeof(can_frame_t));
-    frame->id = CAN_ID_LIGHTING_STATUS;
-    frame->dlc = LIGHTING_STATUS_DLC;
-    
-    /* Byte 0: Headlight state */
-    frame->data[LIGHTING_STATUS_BYTE_HEADLIGHT] = (uint8_t)state->lighting.headlight_output;
+    /* Output not settled yet, or the interior light fading */
+    if (lighting->interior_fading ||
+        headlight_target(lighting) != lighting->headlight_output ||
+        (lighting->headlight_mode == LIGHTING_STATE_OFF && lighting->high_beam_active)) {
+        return now_ms;
+    }
     
-    /* Byte 1: Interior state */
-    uint8_t interior = (uint8_t)state->lighting.interior_mode;
-    interior |= (state->lighting.interior_brightness << INTERIOR_STATE_BRIGHTNESS_SHIFT) & 
-                INTERIOR_STATE_BRIGHTNESS_MASK;
-    frame->data[LIGHTING_STATUS_BYTE_INTERIOR] = interior;
+    if (lighting->headlight_mode != LIGHTING_STATE_AUTO ||
+        lighting->last_ambient_update_ms == 0U) {
+        return now_ms + SYS_DEADLINE_IDLE_MS;
+    }
     
-    /* Byte 2: Ambient light */
-    frame->data[LIGHTING_STATUS_BYTE_AMBIENT] = state->lighting.ambient_light;
+    /* Sensor monitor: every update once the reading is stale */
+    if ((now_ms - lighting->last_ambient_update_ms) > AUTO_UPDATE_TIMEOUT_MS) {
+        return now_ms;
+    }
+    return lighting->last_ambient_update_ms + AUTO_UPDATE_TIMEOUT_MS + 1U;
+}
+
+void lighting_control_build_status_frame(can_frame_t *frame)
+{
+    can_frame_template_init(frame, CAN_ID_LIGHTING_STATUS, LIGHTING_STATUS_DLC,
+                            CAN_CHECKSUM_SEED);
+    lighting_control_update_status_frame(frame);
+}
+
+void lighting_control_update_status_frame(can_frame_t *frame)
+{
+    const system_state_t *state = sys_state_get();
+    system_state_t *mut_state = sys_state_get_mut();
     
-    /* Byte 3: Last command result */
-    frame->data[LIGHTING_STATUS_BYTE_RESULT] = (uint8_t)state->lighting.last_result;
+    can_msg_lighting_status_t msg = {0};
+    msg.headlight = state->lighting.headlight_output;
+    msg.interior_mode = state->lighting.interior_mode;
+    msg.interior_brightness = state->lighting.interior_brightness;
+    msg.ambient = state->lighting.ambient_light;
+    msg.result = state->lighting.last_result;
+    msg.interior_duty = state->lighting.interior_duty;
     
-    /* Byte 4: Version and counter */
-    frame->data[LIGHTING_STATUS_BYTE_VER_CTR] = CAN_BUILD_VER_CTR(
-        CAN_SCHEMA_VERSION, mut_state->tx_counter_lighting);
+    /* Only changed bytes are written; the checksum follows can_frame_put() */
+    can_msg_lighting_status_update(frame, &msg, mut_state->tx_counter_lighting);
     mut_state->tx_counter_lighting = (mut_state->tx_counter_lighting + 1) & CAN_COUNTER_MASK;
-    
-    /* Byte 5: Checksum */
-    frame->data[LIGHTING_STATUS_BYTE_CHECKSUM] = can_calculate_checksum(
-        frame->data, LIGHTING_STATUS_DLC - 1);
 }
 
 lighting_mode_state_t lighting_control_get_headlight_mode(void)
 {
-    return sys_state_get()->lighting.headlight_mode;
+    return (lighting_mode_state_t)sys_state_get()->lighting.headlight_mode;
 }
 
 headlight_state_t lighting_control_get_headlight_output(void)
 {
-    return sys_state_get()->lighting.headlight_output;
+    return (headlight_state_t)sys_state_get()->lighting.headlight_output;
 }
 
 bool lighting_control_headlights_on(void)
@@ -330,12 +411,17 @@ uint8_t lighting_control_get_interior_brightness(void)
     return sys_state_get()->lighting.interior_brightness;
 }
 
+uint8_t lighting_control_get_interior_duty(void)
+{
+    return sys_state_get()->lighting.interior_duty;
+}
+
 void lighting_control_set_headlight_mode(lighting_mode_state_t mode)
 {
     system_state_t *state = sys_state_get_mut();
-    state->lighting.headlight_mode = mode;
+    state->lighting.headlight_mode = (uint8_t)mode;
     update_headlight_output();
-    printf("[LIGHT] Headlight mode set to: %d\n", mode);
+    BCM_LOG_INFO("[LIGHT] Headlight mode set to: %d\n", mode);
 }
 
 void lighting_control_set_high_beam(bool on)
@@ -343,22 +429,27 @@ void lighting_control_set_high_beam(bool on)
     system_state_t *state = sys_state_get_mut();
     state->lighting.high_beam_active = on;
     update_headlight_output();
-    printf("[LIGHT] High beam: %s\n", on ? "ON" : "OFF");
+    BCM_LOG_INFO(on ? "[LIGHT] High beam: ON\n" : "[LIGHT] High beam: OFF\n");
 }
 
 void lighting_control_set_interior(lighting_mode_state_t mode, uint8_t brightness)
 {
     system_state_t *state = sys_state_get_mut();
-    state->lighting.interior_mode = mode;
+    state->lighting.interior_mode = (uint8_t)mode;
     state->lighting.interior_brightness = brightness & 0x0FU;
     state->lighting.interior_on = (mode == LIGHTING_STATE_ON);
-    printf("[LIGHT] Interior: mode=%d, brightness=%d\n", mode, brightness);
+    interior_fade_start(&state->lighting);
+    BCM_LOG_INFO("[LIGHT] Interior: mode=%d, brightness=%d\n", mode, brightness);
 }
 
 void lighting_control_set_ambient(uint8_t level)
 {
     system_state_t *state = sys_state_get_mut();
     state->lighting.ambient_light = level;
-    g_last_ambient_update_ms = state->uptime_ms;
+    state->lighting.last_ambient_update_ms = state->uptime_ms;
     update_headlight_output();
+    
+    /* A fresh reading passes the timeout check; the monitor in
+     * lighting_control_update() only has to run once it goes stale */
+    fault_manager_report(FAULT_CODE_TIMEOUT, false);
 }
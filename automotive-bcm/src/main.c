@@ -6,6 +6,8 @@
  * Prints state changes to stdout.
  */
 
+#define _DEFAULT_SOURCE     /* clock_gettime/usleep under -std=c11 */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -13,30 +15,44 @@
 #include <signal.h>
 #include <string.h>
 
-#ifdef __linux__
-#include <time.h>
-#include <unistd.h>
-#else
-/* macOS/POSIX fallback */
 #include <time.h>
 #include <unistd.h>
+#include <errno.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#define LOOP_USE_EPOLL      1
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+/* macOS/BSD fallback */
+#include <sys/types.h>
+#include <sys/event.h>
+#define LOOP_USE_KQUEUE     1
 #endif
 
 #include "bcm.h"
 #include "system_state.h"
+#include "fault_manager.h"
+#include "can_interface.h"
+#include "bcm_trace.h"
+#include "bcm_store.h"
+#include "bcm_timing.h"
+#include "bcm_config.h"
 
 /*******************************************************************************
  * Configuration
  ******************************************************************************/
 
 #define DEFAULT_CAN_INTERFACE   "vcan0"
-#define MAIN_LOOP_PERIOD_US     1000    /* 1ms main loop */
+#define MAIN_LOOP_PERIOD_US     1000    /* Poll period without epoll/kqueue */
+#define STATUS_PRINT_PERIOD_MS  1000U
 
 /*******************************************************************************
  * Private Data
  ******************************************************************************/
 
 static volatile bool g_running = true;
+static bcm_flash_t g_flash;     /* Store file (-s), unused otherwise */
 
 /*******************************************************************************
  * Signal Handler
@@ -63,12 +79,260 @@ static uint32_t get_time_ms(void)
     return (uint32_t)((ts.tv_sec * 1000) + (ts.tv_nsec / 1000000));
 }
 
+/*******************************************************************************
+ * Event Loop
+ ******************************************************************************/
+
 /**
- * @brief Sleep for microseconds
+ * Wakes on RX readiness of any CAN bus, the next deadline and, while TX
+ * frames are pending, writability of the bus sockets. Linux uses epoll +
+ * timerfd, macOS/BSD use kqueue, anything else polls.
  */
-static void sleep_us(uint32_t us)
+typedef struct {
+    int     poll_fd;                /**< epoll or kqueue descriptor, -1 if polling */
+    int     timer_fd;               /**< timerfd (epoll only), -1 otherwise */
+    int     rx_fds[CAN_BUS_MAX];    /**< RX descriptors, -1 if none */
+    int     tx_fds[CAN_BUS_MAX];    /**< TX descriptors, -1 if none */
+    uint8_t bus_count;
+    bool    tx_armed;               /**< Write readiness registered */
+} event_loop_t;
+
+#if defined(LOOP_USE_EPOLL)
+
+/**
+ * @brief epoll interest of a TX socket, which may also be the RX descriptor
+ */
+static uint32_t loop_tx_events(const event_loop_t *loop, uint8_t bus, bool armed)
+{
+    uint32_t events = armed ? (uint32_t)EPOLLOUT : 0U;
+    if (loop->tx_fds[bus] == loop->rx_fds[bus]) {
+        events |= (uint32_t)EPOLLIN;
+    }
+    return events;
+}
+
+static int loop_init(event_loop_t *loop, const int *rx_fds, const int *tx_fds, uint8_t count)
+{
+    struct epoll_event ev;
+    
+    loop->bus_count = count;
+    loop->tx_armed = false;
+    loop->poll_fd = epoll_create1(EPOLL_CLOEXEC);
+    loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (loop->poll_fd < 0 || loop->timer_fd < 0) {
+        perror("[MAIN] epoll/timerfd");
+        return -1;
+    }
+    
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = loop->timer_fd;
+    if (epoll_ctl(loop->poll_fd, EPOLL_CTL_ADD, loop->timer_fd, &ev) < 0) {
+        perror("[MAIN] epoll_ctl timer");
+        return -1;
+    }
+    
+    for (uint8_t i = 0; i < count; i++) {
+        loop->rx_fds[i] = rx_fds[i];
+        loop->tx_fds[i] = tx_fds[i];
+        if (rx_fds[i] >= 0 && rx_fds[i] != tx_fds[i]) {
+            ev.events = EPOLLIN;
+            ev.data.fd = rx_fds[i];
+            if (epoll_ctl(loop->poll_fd, EPOLL_CTL_ADD, rx_fds[i], &ev) < 0) {
+                perror("[MAIN] epoll_ctl CAN");
+                return -1;
+            }
+        }
+        if (tx_fds[i] >= 0) {
+            ev.events = loop_tx_events(loop, i, false);
+            ev.data.fd = tx_fds[i];
+            if (epoll_ctl(loop->poll_fd, EPOLL_CTL_ADD, tx_fds[i], &ev) < 0) {
+                perror("[MAIN] epoll_ctl CAN");
+                return -1;
+            }
+        }
+    }
+    
+    return 0;
+}
+
+static void loop_set_tx(event_loop_t *loop, bool armed)
+{
+    struct epoll_event ev;
+    
+    if (armed == loop->tx_armed) {
+        return;
+    }
+    memset(&ev, 0, sizeof(ev));
+    for (uint8_t i = 0; i < loop->bus_count; i++) {
+        if (loop->tx_fds[i] < 0) {
+            continue;
+        }
+        ev.events = loop_tx_events(loop, i, armed);
+        ev.data.fd = loop->tx_fds[i];
+        (void)epoll_ctl(loop->poll_fd, EPOLL_CTL_MOD, loop->tx_fds[i], &ev);
+    }
+    loop->tx_armed = armed;
+}
+
+static bool loop_wait(event_loop_t *loop, uint32_t wait_ms)
+{
+    struct itimerspec its;
+    struct epoll_event events[1 + 2 * CAN_BUS_MAX];
+    bool writable = false;
+    
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = (time_t)(wait_ms / 1000U);
+    its.it_value.tv_nsec = (long)(wait_ms % 1000U) * 1000000L;
+    if (timerfd_settime(loop->timer_fd, 0, &its, NULL) < 0) {
+        return false;
+    }
+    
+    int n = epoll_wait(loop->poll_fd, events, 1 + 2 * CAN_BUS_MAX, -1);
+    for (int i = 0; i < n; i++) {
+        if (events[i].data.fd == loop->timer_fd) {
+            uint64_t expirations;
+            (void)read(loop->timer_fd, &expirations, sizeof(expirations));
+        }
+        if ((events[i].events & EPOLLOUT) != 0U) {
+            writable = true;
+        }
+    }
+    return writable;
+}
+
+static void loop_deinit(event_loop_t *loop)
 {
-    usleep(us);
+    if (loop->timer_fd >= 0) {
+        close(loop->timer_fd);
+    }
+    if (loop->poll_fd >= 0) {
+        close(loop->poll_fd);
+    }
+}
+
+#elif defined(LOOP_USE_KQUEUE)
+
+static int loop_init(event_loop_t *loop, const int *rx_fds, const int *tx_fds, uint8_t count)
+{
+    loop->bus_count = count;
+    loop->tx_armed = false;
+    loop->timer_fd = -1;
+    loop->poll_fd = kqueue();
+    if (loop->poll_fd < 0) {
+        perror("[MAIN] kqueue");
+        return -1;
+    }
+    
+    for (uint8_t i = 0; i < count; i++) {
+        loop->rx_fds[i] = rx_fds[i];
+        loop->tx_fds[i] = tx_fds[i];
+        struct kevent ev;
+        if (rx_fds[i] >= 0) {
+            EV_SET(&ev, (uintptr_t)rx_fds[i], EVFILT_READ, EV_ADD, 0, 0, NULL);
+            if (kevent(loop->poll_fd, &ev, 1, NULL, 0, NULL) < 0) {
+                perror("[MAIN] kevent CAN");
+                return -1;
+            }
+        }
+        if (tx_fds[i] >= 0) {
+            EV_SET(&ev, (uintptr_t)tx_fds[i], EVFILT_WRITE, EV_ADD | EV_DISABLE, 0, 0, NULL);
+            if (kevent(loop->poll_fd, &ev, 1, NULL, 0, NULL) < 0) {
+                perror("[MAIN] kevent CAN");
+                return -1;
+            }
+        }
+    }
+    
+    return 0;
+}
+
+static void loop_set_tx(event_loop_t *loop, bool armed)
+{
+    if (armed == loop->tx_armed) {
+        return;
+    }
+    for (uint8_t i = 0; i < loop->bus_count; i++) {
+        if (loop->tx_fds[i] < 0) {
+            continue;
+        }
+        struct kevent ev;
+        EV_SET(&ev, (uintptr_t)loop->tx_fds[i], EVFILT_WRITE,
+               armed ? EV_ENABLE : EV_DISABLE, 0, 0, NULL);
+        (void)kevent(loop->poll_fd, &ev, 1, NULL, 0, NULL);
+    }
+    loop->tx_armed = armed;
+}
+
+static bool loop_wait(event_loop_t *loop, uint32_t wait_ms)
+{
+    struct kevent events[2 * CAN_BUS_MAX];
+    struct timespec timeout;
+    bool writable = false;
+    
+    timeout.tv_sec = (time_t)(wait_ms / 1000U);
+    timeout.tv_nsec = (long)(wait_ms % 1000U) * 1000000L;
+    int n = kevent(loop->poll_fd, NULL, 0, events, 2 * CAN_BUS_MAX, &timeout);
+    for (int i = 0; i < n; i++) {
+        if (events[i].filter == EVFILT_WRITE) {
+            writable = true;
+        }
+    }
+    return writable;
+}
+
+static void loop_deinit(event_loop_t *loop)
+{
+    if (loop->poll_fd >= 0) {
+        close(loop->poll_fd);
+    }
+}
+
+#else
+
+static int loop_init(event_loop_t *loop, const int *rx_fds, const int *tx_fds, uint8_t count)
+{
+    (void)rx_fds;
+    (void)tx_fds;
+    loop->bus_count = count;
+    loop->tx_armed = false;
+    loop->poll_fd = -1;
+    loop->timer_fd = -1;
+    return 0;
+}
+
+static void loop_set_tx(event_loop_t *loop, bool armed)
+{
+    loop->tx_armed = armed; /* Pending frames are retried every poll period */
+}
+
+static bool loop_wait(event_loop_t *loop, uint32_t wait_ms)
+{
+    (void)loop;
+    /* No readiness API: poll at the old fixed rate, never past the deadline */
+    usleep((wait_ms * 1000U < MAIN_LOOP_PERIOD_US) ? wait_ms * 1000U : MAIN_LOOP_PERIOD_US);
+    return false;
+}
+
+static void loop_deinit(event_loop_t *loop)
+{
+    (void)loop;
+}
+
+#endif
+
+/*******************************************************************************
+ * Output Files
+ ******************************************************************************/
+
+/**
+ * @brief Close the trace and the store (bcm_deinit() already synced it)
+ */
+static void close_files(void)
+{
+    bcm_store_close();
+    bcm_flash_file_close(&g_flash);
+    bcm_trace_close();
 }
 
 /*******************************************************************************
@@ -80,7 +344,10 @@ static void sleep_us(uint32_t us)
  */
 static void print_status(void)
 {
-    const system_state_t *state = sys_state_get();
+    /* Published copy: the same view a telemetry thread would get */
+    system_state_t snapshot;
+    (void)sys_state_snapshot(&snapshot);
+    const system_state_t *state = &snapshot;
     
     /* Build status line */
     char door_status[5] = "----";
@@ -116,14 +383,34 @@ static void print_status(void)
     turn_output[0] = state->turn_signal.left_output ? 'L' : '-';
     turn_output[1] = state->turn_signal.right_output ? 'R' : '-';
     
-    printf("\r[%6u.%03us] Doors:%s | Head:%s | Turn:%s[%s] | Faults:%d    ",
+    can_stats_t can_stats;
+    can_get_stats(&can_stats);
+    
+    printf("\r[%6u.%03us] Doors:%s | Head:%s | Turn:%s[%s] | Faults:%d | Bus:%u.%u%%    ",
            state->uptime_ms / 1000,
            state->uptime_ms % 1000,
            door_status,
            headlight_str,
            turn_str,
            turn_output,
-           fault_manager_get_count());
+           fault_manager_get_count(),
+           can_stats.bus_load_x10 / 10U,
+           can_stats.bus_load_x10 % 10U);
+
+#if BCM_FEATURE_TASK_TIMING
+    /* p99/max in microseconds: 10ms, 100ms, 500ms, 1000ms tasks, RX drain */
+    uint32_t late = 0;
+    printf("| us:");
+    for (uint8_t slot = 0; slot < BCM_TIMING_SLOT_COUNT; slot++) {
+        bcm_timing_stats_t stats;
+        uint32_t max_ns = bcm_timing_get(slot, &stats) ? stats.max_ns : 0U;
+        printf(" %u/%u", bcm_timing_percentile_ns(slot, 99) / 1000U, max_ns / 1000U);
+    }
+    for (uint8_t task = 0; task < BCM_TASK_COUNT; task++) {
+        late += bcm_get_task_late_runs((bcm_task_id_t)task);
+    }
+    printf(" | Late:%u    ", late);
+#endif
     fflush(stdout);
 }
 
@@ -135,11 +422,16 @@ static void print_usage(const char *prog_name)
 {
     printf("Usage: %s [options]\n", prog_name);
     printf("Options:\n");
-    printf("  -i <interface>  CAN interface name (default: %s)\n", DEFAULT_CAN_INTERFACE);
+    printf("  -i <interface>  CAN interface name (default: %s); a comma-separated\n"
+           "                  list opens one bus each, bus 0 first\n", DEFAULT_CAN_INTERFACE);
+    printf("  -t <file>       Write a binary frame/event trace to file\n");
+    printf("  -n <records>    Trace ring capacity (default: %u)\n", BCM_TRACE_DEFAULT_RECORDS);
+    printf("  -s <file>       Keep fault/event history in a flash image file\n");
     printf("  -h              Show this help\n");
     printf("\n");
     printf("Example:\n");
     printf("  %s -i vcan0\n", prog_name);
+    printf("  %s -i vcan0,vcan1    (body bus, gateway bus)\n", prog_name);
     printf("\n");
     printf("To create a virtual CAN interface:\n");
     printf("  sudo modprobe vcan\n");
@@ -154,11 +446,20 @@ static void print_usage(const char *prog_name)
 int main(int argc, char *argv[])
 {
     const char *can_interface = DEFAULT_CAN_INTERFACE;
+    const char *trace_path = NULL;
+    const char *store_path = NULL;
+    uint32_t trace_records = 0;
     
     /* Parse arguments */
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-i") == 0 && (i + 1) < argc) {
             can_interface = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0 && (i + 1) < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "-s") == 0 && (i + 1) < argc) {
+            store_path = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && (i + 1) < argc) {
+            trace_records = (uint32_t)strtoul(argv[++i], NULL, 10);
         } else if (strcmp(argv[i], "-h") == 0) {
             print_usage(argv[0]);
             return 0;
@@ -173,47 +474,111 @@ int main(int argc, char *argv[])
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
+    /* Open the trace first so init-time events are captured */
+    if (trace_path != NULL && bcm_trace_open(trace_path, trace_records) != 0) {
+        fprintf(stderr, "[MAIN] Cannot create trace file %s\n", trace_path);
+        return 1;
+    }
+    
+    /* The store is restored by bcm_init() */
+    if (store_path != NULL &&
+        (bcm_flash_file_open(&g_flash, store_path, 0, 0) != 0 || bcm_store_open(&g_flash) != 0)) {
+        fprintf(stderr, "[MAIN] Cannot open store file %s\n", store_path);
+        close_files();
+        return 1;
+    }
+    
     /* Initialize BCM */
     if (bcm_init(can_interface) != 0) {
         fprintf(stderr, "[MAIN] BCM initialization failed\n");
+        close_files();
         return 1;
     }
     
     printf("[MAIN] BCM running. Press Ctrl+C to exit.\n");
     printf("[MAIN] Status updates every second:\n\n");
+
+#ifdef BCM_SIL
+    /* Several buses: each socket is read on its own thread */
+    if (can_bus_count() > 1U && can_start_rx_threads() != CAN_STATUS_OK) {
+        fprintf(stderr, "[MAIN] Cannot start CAN RX threads\n");
+        bcm_deinit();
+        close_files();
+        return 1;
+    }
+#endif
+    
+    int rx_fds[CAN_BUS_MAX];
+    int tx_fds[CAN_BUS_MAX];
+    uint8_t bus_count = can_bus_count();
+    for (uint8_t bus = 0; bus < bus_count; bus++) {
+        rx_fds[bus] = can_bus_get_fd(bus);
+        tx_fds[bus] = can_bus_get_tx_fd(bus);
+    }
+    
+    event_loop_t loop;
+    if (loop_init(&loop, rx_fds, tx_fds, bus_count) != 0) {
+        loop_deinit(&loop);
+        bcm_deinit();
+        close_files();
+        return 1;
+    }
     
     /* Main loop */
     uint32_t last_status_print = 0;
+    bool tx_woken = false;
     
     while (g_running) {
         uint32_t current_ms = get_time_ms();
+        uint8_t tx_before = can_tx_pending();
         
         /* Process BCM */
         bcm_process(current_ms);
         
         /* Print status every second */
-        if ((current_ms - last_status_print) >= 1000) {
+        if ((current_ms - last_status_print) >= STATUS_PRINT_PERIOD_MS) {
             print_status();
             last_status_print = current_ms;
         }
         
-        /* Sleep to maintain loop rate */
-        sleep_us(MAIN_LOOP_PERIOD_US);
+        /* Sleep until CAN traffic or the earliest task/status deadline */
+        uint32_t wait_ms = bcm_next_deadline_ms() - current_ms;
+        uint32_t print_wait = STATUS_PRINT_PERIOD_MS - (current_ms - last_status_print);
+        if (print_wait < wait_ms) {
+            wait_ms = print_wait;
+        }
+        
+        /*
+         * Pending frames wait for a writable socket. A full device queue
+         * (ENOBUFS) can leave the socket writable, so after a write
+         * wake-up that sent nothing, wait for the next deadline instead.
+         */
+        uint8_t tx_after = can_tx_pending();
+        loop_set_tx(&loop, tx_after > 0U && !(tx_woken && tx_after >= tx_before));
+        
+        tx_woken = false;
+        if (wait_ms > 0 && g_running) {
+            tx_woken = loop_wait(&loop, wait_ms);
+        }
     }
     
     /* Cleanup */
     printf("\n\n");
+    loop_deinit(&loop);
     bcm_deinit();
+    close_files();
     
     /* Print final event log */
-    printf("\n[MAIN] Event Log (%d entries):\n", event_log_count());
-    event_log_entry_t entry;
-    for (uint8_t i = 0; i < event_log_count(); i++) {
-        if (event_log_get(i, &entry)) {
-            printf("  [%8u ms] Type=%d Data=[%02X %02X %02X %02X]\n",
-                   entry.timestamp_ms,
-                   entry.type,
-                   entry.data[0], entry.data[1], entry.data[2], entry.data[3]);
+    printf("\n[MAIN] Event Log (%u entries):\n", event_log_count());
+    event_log_entry_t entries[64];
+    uint32_t seq = 0;
+    uint32_t n;
+    while ((n = event_log_read(seq, entries, 64U, &seq)) > 0U) {
+        for (uint32_t i = 0; i < n; i++) {
+            printf("  [%8u ms] Type=%d Data=[%02X %02X %02X]\n",
+                   entries[i].timestamp_ms,
+                   entries[i].type,
+                   entries[i].data[0], entries[i].data[1], entries[i].data[2]);
         }
     }
     
@@ -1,16 +1,54 @@
 /**
  * @file system_state.c
  * @brief System State Implementation
+ *
+ * The state lives in the BCM instance bound to the calling thread
+ * (bcm_ctx.h); with no explicit binding that is the default instance.
+ * The hot state, cold module state, fault store and event log are
+ * separate blocks of it.
  */
 
 #include <string.h>
 #include "system_state.h"
+#include "bcm_trace.h"
+#include "bcm_store.h"
+#include "bcm_ctx_internal.h"
+
+_Static_assert(sizeof(event_log_entry_t) == 8U, "event_log_entry_t must stay packed");
+_Static_assert(EVENT_LOG_SIZE >= 2U && EVENT_LOG_SIZE <= 65536U &&
+               (EVENT_LOG_SIZE & (EVENT_LOG_SIZE - 1U)) == 0U,
+               "EVENT_LOG_SIZE must be a power of two up to 65536");
+_Static_assert(sizeof(system_state_t) == SYS_SNAPSHOT_WORDS * 4U,
+               "system_state_t must be a whole number of snapshot words");
+
+#define EVENT_LOG_MASK      (EVENT_LOG_SIZE - 1U)
 
 /*******************************************************************************
- * Private Data
+ * Private Functions
  ******************************************************************************/
 
-static system_state_t g_system_state;
+/**
+ * @brief Empty the log and log every type again
+ *
+ * Only the header is reset; entries are never read before being written.
+ */
+static void event_log_reset(event_log_t *log)
+{
+    log->seq = 0;
+    log->first_seq = 0;
+    log->type_mask = EVENT_MASK_ALL;
+    memset(log->sample_every, 0, sizeof(log->sample_every));
+    memset(log->sample_count, 0, sizeof(log->sample_count));
+}
+
+/**
+ * @brief Sequence number of the oldest entry held
+ */
+static uint32_t event_log_oldest(const event_log_t *log)
+{
+    uint32_t held = log->seq - log->first_seq;
+    return (held > EVENT_LOG_SIZE) ? log->seq - EVENT_LOG_SIZE : log->first_seq;
+}
 
 /*******************************************************************************
  * Public Functions
@@ -18,62 +56,137 @@ static system_state_t g_system_state;
 
 const system_state_t* sys_state_get(void)
 {
-    return &g_system_state;
+    return bcm_ctx_current()->state;
 }
 
 system_state_t* sys_state_get_mut(void)
 {
-    return &g_system_state;
+    return bcm_ctx_current()->state;
+}
+
+const fault_state_t* sys_fault_get(void)
+{
+    return bcm_ctx_current()->fault;
+}
+
+fault_state_t* sys_fault_get_mut(void)
+{
+    return bcm_ctx_current()->fault;
+}
+
+const sys_cold_state_t* sys_cold_get(void)
+{
+    return bcm_ctx_current()->cold;
+}
+
+sys_cold_state_t* sys_cold_get_mut(void)
+{
+    return bcm_ctx_current()->cold;
 }
 
 void sys_state_init(void)
 {
-    memset(&g_system_state, 0, sizeof(g_system_state));
+    bcm_ctx_t *ctx = bcm_ctx_current();
+    system_state_t *state = ctx->state;
+    fault_state_t *fault = ctx->fault;
+    
+    memset(state, 0, sizeof(*state));
+    memset(ctx->cold, 0, sizeof(*ctx->cold));
+    memset(fault, 0, sizeof(*fault));
+    event_log_reset(ctx->event_log);
     
-    g_system_state.bcm_state = BCM_STATE_INIT;
+    state->bcm_state = BCM_STATE_INIT;
     
     /* Initialize all doors to unlocked */
     for (uint8_t i = 0; i < NUM_DOORS; i++) {
-        g_system_state.door.lock_state[i] = DOOR_STATE_UNLOCKED;
-        g_system_state.door.is_open[i] = false;
+        state->door.lock_state[i] = DOOR_STATE_UNLOCKED;
+        state->door.is_open[i] = false;
     }
-    g_system_state.door.last_result = CMD_RESULT_OK;
+    state->door.last_result = CMD_RESULT_OK;
     
     /* Initialize lighting to off */
-    g_system_state.lighting.headlight_mode = LIGHTING_STATE_OFF;
-    g_system_state.lighting.headlight_output = HEADLIGHT_STATE_OFF;
-    g_system_state.lighting.high_beam_active = false;
-    g_system_state.lighting.interior_mode = LIGHTING_STATE_OFF;
-    g_system_state.lighting.interior_brightness = 0;
-    g_system_state.lighting.interior_on = false;
-    g_system_state.lighting.ambient_light = 128; /* Mid-range default */
-    g_system_state.lighting.last_result = CMD_RESULT_OK;
+    state->lighting.headlight_mode = LIGHTING_STATE_OFF;
+    state->lighting.headlight_output = HEADLIGHT_STATE_OFF;
+    state->lighting.high_beam_active = false;
+    state->lighting.interior_mode = LIGHTING_STATE_OFF;
+    state->lighting.interior_brightness = 0;
+    state->lighting.interior_on = false;
+    state->lighting.ambient_light = 128; /* Mid-range default */
+    state->lighting.last_result = CMD_RESULT_OK;
     
     /* Initialize turn signals to off */
-    g_system_state.turn_signal.mode = TURN_SIG_STATE_OFF;
-    g_system_state.turn_signal.left_output = false;
-    g_system_state.turn_signal.right_output = false;
-    g_system_state.turn_signal.flash_count = 0;
-    g_system_state.turn_signal.last_result = CMD_RESULT_OK;
+    state->turn_signal.mode = TURN_SIG_STATE_OFF;
+    state->turn_signal.left_output = false;
+    state->turn_signal.right_output = false;
+    state->turn_signal.flash_count = 0;
+    state->turn_signal.last_result = CMD_RESULT_OK;
     
     /* Initialize fault manager */
-    g_system_state.fault.flags1 = 0;
-    g_system_state.fault.flags2 = 0;
-    g_system_state.fault.active_count = 0;
-    g_system_state.fault.total_count = 0;
-    g_system_state.fault.most_recent_code = FAULT_CODE_NONE;
-    
-    /* Initialize event log */
-    g_system_state.event_log.head = 0;
-    g_system_state.event_log.count = 0;
+    fault->flags1 = 0;
+    fault->repeat_rate = 0;
+    fault->repeat_window = 0;
+    fault->active_count = 0;
+    fault->total_count = 0;
+    fault->most_recent_code = FAULT_CODE_NONE;
 }
 
 void sys_state_update_time(uint32_t current_ms)
 {
-    g_system_state.uptime_ms = current_ms;
+    system_state_t *state = sys_state_get_mut();
+    state->uptime_ms = current_ms;
     
     /* Update minutes counter (wrapping) */
-    g_system_state.uptime_minutes = (uint8_t)((current_ms / 60000U) & 0xFFU);
+    state->uptime_minutes = (uint8_t)((current_ms / 60000U) & 0xFFU);
+}
+
+void sys_state_mark_tx_dirty(uint8_t bits)
+{
+    sys_state_get_mut()->tx_dirty |= bits;
+}
+
+void sys_state_publish(void)
+{
+    bcm_ctx_t *ctx = bcm_ctx_current();
+    sys_snapshot_t *snap = &ctx->core->snapshot;
+    uint32_t words[SYS_SNAPSHOT_WORDS];
+    memcpy(words, ctx->state, sizeof(words));
+    
+    /* Odd: copy in progress. The fence keeps the word stores after it. */
+    uint32_t seq = (uint32_t)atomic_load_explicit(&snap->seq, memory_order_relaxed);
+    atomic_store_explicit(&snap->seq, seq + 1U, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    
+    for (uint32_t i = 0; i < SYS_SNAPSHOT_WORDS; i++) {
+        atomic_store_explicit(&snap->words[i], words[i], memory_order_relaxed);
+    }
+    
+    /* Even again: the copy is complete */
+    atomic_store_explicit(&snap->seq, seq + 2U, memory_order_release);
+}
+
+uint32_t sys_state_snapshot(system_state_t *out)
+{
+    sys_snapshot_t *snap = &bcm_ctx_current()->core->snapshot;
+    uint32_t words[SYS_SNAPSHOT_WORDS];
+    uint32_t before;
+    uint32_t after;
+    
+    do {
+        before = (uint32_t)atomic_load_explicit(&snap->seq, memory_order_acquire);
+        for (uint32_t i = 0; i < SYS_SNAPSHOT_WORDS; i++) {
+            words[i] = (uint32_t)atomic_load_explicit(&snap->words[i],
+                                                      memory_order_relaxed);
+        }
+        
+        /* Keeps the word loads before the second sequence read */
+        atomic_thread_fence(memory_order_acquire);
+        after = (uint32_t)atomic_load_explicit(&snap->seq, memory_order_relaxed);
+    } while ((before & 1U) != 0U || before != after);
+    
+    if (out != NULL) {
+        memcpy(out, words, sizeof(*out));
+    }
+    return before / 2U;
 }
 
 /*******************************************************************************
@@ -82,55 +195,136 @@ void sys_state_update_time(uint32_t current_ms)
 
 void event_log_add(event_type_t type, const uint8_t *data)
 {
-    event_log_t *log = &g_system_state.event_log;
-    event_log_entry_t *entry = &log->entries[log->head];
+    bcm_ctx_t *ctx = bcm_ctx_current();
+    event_log_t *log = ctx->event_log;
+    
+    if ((unsigned)type >= EVENT_TYPE_COUNT) {
+        return;
+    }
+    
+    /* Flash history has its own selection, whatever this log filters */
+    bcm_store_event((uint8_t)type, data);
+    
+    if ((log->type_mask & EVENT_MASK(type)) == 0U) {
+        return;
+    }
+    
+    /* Sampled types keep the first of every sample_every events */
+    uint16_t every = log->sample_every[type];
+    if (every > 1U) {
+        uint16_t n = log->sample_count[type];
+        log->sample_count[type] = (uint16_t)((n + 1U < every) ? n + 1U : 0U);
+        if (n != 0U) {
+            return;
+        }
+    }
     
-    entry->timestamp_ms = g_system_state.uptime_ms;
-    entry->type = type;
+    event_log_entry_t *entry = &log->entries[log->seq & EVENT_LOG_MASK];
+    entry->timestamp_ms = ctx->state->uptime_ms;
+    entry->type = (uint8_t)type;
     
     if (data != NULL) {
-        memcpy(entry->data, data, 4);
+        memcpy(entry->data, data, sizeof(entry->data));
     } else {
-        memset(entry->data, 0, 4);
+        memset(entry->data, 0, sizeof(entry->data));
     }
+    log->seq++;
     
-    /* Advance head (ring buffer) */
-    log->head = (log->head + 1U) % EVENT_LOG_SIZE;
+    /* The ring above keeps the recent past; the trace file keeps the history */
+    static const uint8_t no_data[4] = { 0, 0, 0, 0 };
+    bcm_trace_event((uint8_t)type, (data != NULL) ? data : no_data);
+}
+
+void event_log_restore(const event_log_entry_t *entries, uint32_t count)
+{
+    event_log_t *log = bcm_ctx_current()->event_log;
     
-    if (log->count < EVENT_LOG_SIZE) {
-        log->count++;
+    for (uint32_t i = 0; i < count; i++) {
+        log->entries[log->seq & EVENT_LOG_MASK] = entries[i];
+        log->seq++;
     }
 }
 
-bool event_log_get(uint8_t index, event_log_entry_t *entry)
+bool event_log_get(uint32_t index, event_log_entry_t *entry)
 {
-    const event_log_t *log = &g_system_state.event_log;
+    const event_log_t *log = bcm_ctx_current()->event_log;
     
-    if (entry == NULL || index >= log->count) {
+    if (entry == NULL || index >= event_log_count()) {
         return false;
     }
     
-    /* Calculate actual index (oldest first) */
-    uint8_t start;
-    if (log->count < EVENT_LOG_SIZE) {
-        start = 0;
-    } else {
-        start = log->head; /* head points to oldest when full */
+    *entry = log->entries[(event_log_oldest(log) + index) & EVENT_LOG_MASK];
+    return true;
+}
+
+uint32_t event_log_count(void)
+{
+    const event_log_t *log = bcm_ctx_current()->event_log;
+    return log->seq - event_log_oldest(log);
+}
+
+uint32_t event_log_seq(void)
+{
+    return bcm_ctx_current()->event_log->seq;
+}
+
+uint32_t event_log_read(uint32_t since_seq, event_log_entry_t *buf,
+                        uint32_t max_entries, uint32_t *next_seq)
+{
+    const event_log_t *log = bcm_ctx_current()->event_log;
+    uint32_t oldest = event_log_oldest(log);
+    
+    /* Wrap-safe: anything before the oldest entry starts at the oldest */
+    uint32_t start = ((int32_t)(since_seq - oldest) < 0) ? oldest : since_seq;
+    uint32_t count = ((int32_t)(log->seq - start) > 0) ? log->seq - start : 0U;
+    
+    if (buf == NULL) {
+        count = 0;
+    }
+    if (count > max_entries) {
+        count = max_entries;
     }
     
-    uint8_t actual_index = (start + index) % EVENT_LOG_SIZE;
-    *entry = log->entries[actual_index];
+    /* At most two spans: up to the end of the ring, then from slot 0 */
+    if (count > 0U) {
+        uint32_t slot = start & EVENT_LOG_MASK;
+        uint32_t first = EVENT_LOG_SIZE - slot;
+        if (first > count) {
+            first = count;
+        }
+        memcpy(buf, &log->entries[slot], first * sizeof(event_log_entry_t));
+        memcpy(buf + first, log->entries, (count - first) * sizeof(event_log_entry_t));
+    }
     
-    return true;
+    if (next_seq != NULL) {
+        *next_seq = start + count;
+    }
+    return count;
 }
 
-uint8_t event_log_count(void)
+void event_log_set_mask(uint16_t mask)
 {
-    return g_system_state.event_log.count;
+    bcm_ctx_current()->event_log->type_mask = (uint16_t)(mask & EVENT_MASK_ALL);
+}
+
+uint16_t event_log_get_mask(void)
+{
+    return bcm_ctx_current()->event_log->type_mask;
+}
+
+void event_log_set_sampling(event_type_t type, uint16_t keep_one_in)
+{
+    event_log_t *log = bcm_ctx_current()->event_log;
+    
+    if ((unsigned)type >= EVENT_TYPE_COUNT) {
+        return;
+    }
+    log->sample_every[type] = keep_one_in;
+    log->sample_count[type] = 0;
 }
 
 void event_log_clear(void)
 {
-    g_system_state.event_log.head = 0;
-    g_system_state.event_log.count = 0;
+    event_log_t *log = bcm_ctx_current()->event_log;
+    log->first_seq = log->seq;
 }
@@ -7,59 +7,16 @@
  */
 
 #include <string.h>
-#include <stdio.h>
 #include "turn_signal.h"
 #include "fault_manager.h"
+#include "bcm_log.h"
 #include "can_ids.h"
+#include "can_messages.h"
 
 /*******************************************************************************
  * Private Functions
  ******************************************************************************/
 
-/**
- * @brief Validate turn signal command frame
- */
-static cmd_result_t validate_turn_cmd(const can_frame_t *frame)
-{
-    system_state_t *state = sys_state_get_mut();
-    
-    /* Check DLC */
-    if (frame->dlc != TURN_SIGNAL_CMD_DLC) {
-        fault_manager_set(FAULT_CODE_INVALID_LENGTH);
-        return CMD_RESULT_INVALID_CMD;
-    }
-    
-    /* Extract fields */
-    uint8_t ver_ctr = frame->data[TURN_CMD_BYTE_VER_CTR];
-    uint8_t checksum = frame->data[TURN_CMD_BYTE_CHECKSUM];
-    
-    /* Validate checksum */
-    uint8_t calc_checksum = can_calculate_checksum(frame->data, TURN_SIGNAL_CMD_DLC - 1);
-    if (checksum != calc_checksum) {
-        fault_manager_set(FAULT_CODE_INVALID_CHECKSUM);
-        return CMD_RESULT_CHECKSUM_ERROR;
-    }
-    
-    /* Validate counter */
-    uint8_t counter = CAN_GET_COUNTER(ver_ctr);
-    if (state->turn_signal.last_cmd_time_ms > 0) {
-        if (!can_validate_counter(counter, state->turn_signal.last_counter)) {
-            fault_manager_set(FAULT_CODE_INVALID_COUNTER);
-            return CMD_RESULT_COUNTER_ERROR;
-        }
-    }
-    state->turn_signal.last_counter = counter;
-    
-    /* Validate command value */
-    uint8_t cmd = frame->data[TURN_CMD_BYTE_CMD];
-    if (cmd > TURN_CMD_MAX) {
-        fault_manager_set(FAULT_CODE_INVALID_CMD);
-        return CMD_RESULT_INVALID_CMD;
-    }
-    
-    return CMD_RESULT_OK;
-}
-
 /**
  * @brief Log turn signal state change event
  */
@@ -67,6 +24,7 @@ static void log_turn_event(turn_signal_mode_t old_mode, turn_signal_mode_t new_m
 {
     uint8_t data[4] = { (uint8_t)old_mode, (uint8_t)new_mode, 0, 0 };
     event_log_add(EVENT_TURN_SIGNAL_CHANGE, data);
+    sys_state_mark_tx_dirty(SYS_TX_DIRTY_TURN);
 }
 
 /**
@@ -97,13 +55,32 @@ void turn_signal_init(void)
     state->turn_signal.flash_count = 0;
     state->turn_signal.last_toggle_ms = 0;
     state->turn_signal.last_cmd_time_ms = 0;
-    state->turn_signal.last_counter = 0;
+    state->turn_signal.rx_counter.last = 0;
+    state->turn_signal.rx_counter.seen = 0;
     state->turn_signal.last_result = CMD_RESULT_OK;
     
-    printf("[TURN] Initialized\n");
+    BCM_LOG_INFO("[TURN] Initialized\n");
+}
+
+void turn_signal_check_cmds(const can_frame_t *frames, uint8_t count, uint8_t *flags)
+{
+    system_state_t *state = sys_state_get_mut();
+    
+    (void)can_check_batch(&can_msg_turn_signal_cmd_desc, frames, count,
+                          &state->turn_signal.rx_counter, flags);
 }
 
 cmd_result_t turn_signal_handle_cmd(const can_frame_t *frame)
+{
+    uint8_t flags = CAN_CHECK_OK;
+    
+    if (frame != NULL && frame->id == CAN_ID_TURN_SIGNAL_CMD) {
+        turn_signal_check_cmds(frame, 1U, &flags);
+    }
+    return turn_signal_apply_cmd(frame, flags);
+}
+
+cmd_result_t turn_signal_apply_cmd(const can_frame_t *frame, uint8_t flags)
 {
     if (frame == NULL || frame->id != CAN_ID_TURN_SIGNAL_CMD) {
         return CMD_RESULT_INVALID_CMD;
@@ -111,39 +88,37 @@ cmd_result_t turn_signal_handle_cmd(const can_frame_t *frame)
     
     system_state_t *state = sys_state_get_mut();
     
-    /* Validate frame */
-    cmd_result_t result = validate_turn_cmd(frame);
+    /* Checked by turn_signal_check_cmds() */
+    cmd_result_t result = fault_manager_report_cmd_check(frame, flags,
+                                                         FAULT_CMD_SOURCE_TURN);
     if (result != CMD_RESULT_OK) {
-        state->turn_signal.last_result = result;
-        
-        uint8_t data[4] = { (uint8_t)result, frame->data[0], 0, 0 };
-        event_log_add(EVENT_CMD_ERROR, data);
-        
-        printf("[TURN] Command error: %d\n", result);
+        state->turn_signal.last_result = (uint8_t)result;
         return result;
     }
     
     /* Process command */
-    uint8_t cmd = frame->data[TURN_CMD_BYTE_CMD];
-    turn_signal_mode_t old_mode = state->turn_signal.mode;
+    can_msg_turn_signal_cmd_t msg;
+    can_msg_turn_signal_cmd_decode(frame, &msg);
+    uint8_t cmd = msg.command;
+    turn_signal_mode_t old_mode = (turn_signal_mode_t)state->turn_signal.mode;
     
     switch (cmd) {
         case TURN_CMD_OFF:
             turn_signal_off();
             break;
-            
+        
         case TURN_CMD_LEFT_ON:
             turn_signal_left_on();
             break;
-            
+        
         case TURN_CMD_RIGHT_ON:
             turn_signal_right_on();
             break;
-            
+        
         case TURN_CMD_HAZARD_ON:
             turn_signal_hazard_on();
             break;
-            
+        
         case TURN_CMD_HAZARD_OFF:
             if (state->turn_signal.mode == TURN_SIG_STATE_HAZARD) {
                 turn_signal_off();
@@ -196,17 +171,17 @@ void turn_signal_update(uint32_t current_ms)
                 state->turn_signal.left_output = currently_on;
                 state->turn_signal.right_output = false;
                 break;
-                
+            
             case TURN_SIG_STATE_RIGHT:
                 state->turn_signal.left_output = false;
                 state->turn_signal.right_output = currently_on;
                 break;
-                
+            
             case TURN_SIG_STATE_HAZARD:
                 state->turn_signal.left_output = currently_on;
                 state->turn_signal.right_output = currently_on;
                 break;
-                
+            
             default:
                 state->turn_signal.left_output = false;
                 state->turn_signal.right_output = false;
@@ -220,6 +195,26 @@ void turn_signal_update(uint32_t current_ms)
     }
 }
 
+uint32_t turn_signal_next_deadline(uint32_t now_ms)
+{
+    const turn_signal_state_t *signal = &sys_state_get()->turn_signal;
+    bool currently_on = signal->left_output || signal->right_output;
+    
+    /* Off: only outputs left on need an update to clear them */
+    if (signal->mode == TURN_SIG_STATE_OFF) {
+        return currently_on ? now_ms : now_ms + SYS_DEADLINE_IDLE_MS;
+    }
+    
+    uint16_t on_ms, off_ms;
+    get_flash_timing(signal->mode, &on_ms, &off_ms);
+    uint16_t phase_duration = currently_on ? on_ms : off_ms;
+    
+    if ((now_ms - signal->last_toggle_ms) >= phase_duration) {
+        return now_ms;
+    }
+    return signal->last_toggle_ms + phase_duration;
+}
+
 void turn_signal_check_timeout(uint32_t current_ms)
 {
     system_state_t *state = sys_state_get_mut();
@@ -232,7 +227,7 @@ void turn_signal_check_timeout(uint32_t current_ms)
             uint32_t elapsed = current_ms - state->turn_signal.last_cmd_time_ms;
             
             if (elapsed > TURN_SIGNAL_TIMEOUT_MS) {
-                printf("[TURN] Timeout - auto off\n");
+                BCM_LOG_WARN("[TURN] Timeout - auto off\n");
                 turn_signal_off();
                 fault_manager_set(FAULT_CODE_TIMEOUT);
             }
@@ -241,42 +236,33 @@ void turn_signal_check_timeout(uint32_t current_ms)
 }
 
 void turn_signal_build_status_frame(can_frame_t *frame)
+{
+    can_frame_template_init(frame, CAN_ID_TURN_SIGNAL_STATUS, TURN_SIGNAL_STATUS_DLC,
+                            CAN_CHECKSUM_SEED);
+    turn_signal_update_status_frame(frame);
+}
+
+void turn_signal_update_status_frame(can_frame_t *frame)
 {
     const system_state_t *state = sys_state_get();
     system_state_t *mut_state = sys_state_get_mut();
     
-    memset(frame, 0, sizeof(can_frame_t));
-    frame->id = CAN_ID_TURN_SIGNAL_STATUS;
-    frame->dlc = TURN_SIGNAL_STATUS_DLC;
-    
-    /* Byte 0: Turn signal state */
-    frame->data[TURN_STATUS_BYTE_STATE] = (uint8_t)state->turn_signal.mode;
+    can_msg_turn_signal_status_t msg = {0};
+    msg.state = state->turn_signal.mode;
+    msg.flash_count = state->turn_signal.flash_count;
+    msg.result = state->turn_signal.last_result;
     
-    /* Byte 1: Output state */
-    uint8_t output = 0;
-    if (state->turn_signal.left_output) output |= TURN_OUTPUT_LEFT_BIT;
-    if (state->turn_signal.right_output) output |= TURN_OUTPUT_RIGHT_BIT;
-    frame->data[TURN_STATUS_BYTE_OUTPUT] = output;
+    if (state->turn_signal.left_output) msg.output |= TURN_OUTPUT_LEFT_BIT;
+    if (state->turn_signal.right_output) msg.output |= TURN_OUTPUT_RIGHT_BIT;
     
-    /* Byte 2: Flash count */
-    frame->data[TURN_STATUS_BYTE_FLASH_CNT] = state->turn_signal.flash_count;
-    
-    /* Byte 3: Last command result */
-    frame->data[TURN_STATUS_BYTE_RESULT] = (uint8_t)state->turn_signal.last_result;
-    
-    /* Byte 4: Version and counter */
-    frame->data[TURN_STATUS_BYTE_VER_CTR] = CAN_BUILD_VER_CTR(
-        CAN_SCHEMA_VERSION, mut_state->tx_counter_turn);
+    /* Only changed bytes are written; the checksum follows can_frame_put() */
+    can_msg_turn_signal_status_update(frame, &msg, mut_state->tx_counter_turn);
     mut_state->tx_counter_turn = (mut_state->tx_counter_turn + 1) & CAN_COUNTER_MASK;
-    
-    /* Byte 5: Checksum */
-    frame->data[TURN_STATUS_BYTE_CHECKSUM] = can_calculate_checksum(
-        frame->data, TURN_SIGNAL_STATUS_DLC - 1);
 }
 
 turn_signal_mode_t turn_signal_get_mode(void)
 {
-    return sys_state_get()->turn_signal.mode;
+    return (turn_signal_mode_t)sys_state_get()->turn_signal.mode;
 }
 
 void turn_signal_get_output_state(bool *left_on, bool *right_on)
@@ -301,7 +287,7 @@ void turn_signal_off(void)
     system_state_t *state = sys_state_get_mut();
     
     if (state->turn_signal.mode != TURN_SIG_STATE_OFF) {
-        printf("[TURN] OFF\n");
+        BCM_LOG_INFO("[TURN] OFF\n");
     }
     
     state->turn_signal.mode = TURN_SIG_STATE_OFF;
@@ -320,7 +306,7 @@ void turn_signal_left_on(void)
     state->turn_signal.flash_count = 0;
     state->turn_signal.last_toggle_ms = state->uptime_ms;
     
-    printf("[TURN] LEFT ON\n");
+    BCM_LOG_INFO("[TURN] LEFT ON\n");
 }
 
 void turn_signal_right_on(void)
@@ -333,7 +319,7 @@ void turn_signal_right_on(void)
     state->turn_signal.flash_count = 0;
     state->turn_signal.last_toggle_ms = state->uptime_ms;
     
-    printf("[TURN] RIGHT ON\n");
+    BCM_LOG_INFO("[TURN] RIGHT ON\n");
 }
 
 void turn_signal_hazard_on(void)
@@ -346,5 +332,5 @@ void turn_signal_hazard_on(void)
     state->turn_signal.flash_count = 0;
     state->turn_signal.last_toggle_ms = state->uptime_ms;
     
-    printf("[TURN] HAZARD ON\n");
+    BCM_LOG_INFO("[TURN] HAZARD ON\n");
 }
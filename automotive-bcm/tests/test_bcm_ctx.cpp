@@ -0,0 +1,269 @@
+/**
+ * @file test_bcm_ctx.cpp
+ * @brief Unit tests for BCM instance handles
+ *
+ * Tests:
+ * - Instances keep separate state, queues and schedulers
+ * - Binding redirects the classic API
+ * - Instances processed concurrently on separate threads
+ * - Pool members with contiguous hot state
+ * - Seqlock state snapshots read from another thread
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <atomic>
+#include <thread>
+
+extern "C" {
+#include "bcm.h"
+#include "bcm_ctx.h"
+#include "door_control.h"
+#include "fault_manager.h"
+#include "system_state.h"
+#include "can_interface.h"
+#include "can_ids.h"
+}
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static can_frame_t build_door_cmd(uint8_t cmd, uint8_t counter)
+{
+    can_frame_t frame;
+    can_frame_template_init(&frame, CAN_ID_DOOR_CMD, DOOR_CMD_DLC, CAN_CHECKSUM_SEED);
+    can_frame_put(&frame, 0, cmd);
+    can_frame_put(&frame, 1, DOOR_ID_ALL);
+    can_frame_put(&frame, 2, CAN_BUILD_VER_CTR(CAN_SCHEMA_VERSION, counter));
+    return frame;
+}
+
+/* With CAN FD the door status and heartbeat share the 100ms aggregate frame */
+#if BCM_FEATURE_CAN_FD
+#define DOOR_STATUS_TX_ID       CAN_ID_BCM_AGGREGATE_STATUS
+#define HEARTBEAT_TX_ID         CAN_ID_BCM_AGGREGATE_STATUS
+#if BCM_FEATURE_SEND_ON_CHANGE
+#define HEARTBEAT_TX_PERIOD_MS  CAN_STATUS_KEEPALIVE_PERIOD_MS
+#else
+#define HEARTBEAT_TX_PERIOD_MS  BCM_AGGREGATE_PERIOD_MS
+#endif
+#else
+#define DOOR_STATUS_TX_ID       CAN_ID_DOOR_STATUS
+#define HEARTBEAT_TX_ID         CAN_ID_BCM_HEARTBEAT
+#define HEARTBEAT_TX_PERIOD_MS  CAN_HEARTBEAT_PERIOD_MS
+#endif
+
+/** Count TX frames (classic or CAN FD) with the given ID left in an instance's queues */
+static int count_tx(bcm_ctx_t *ctx, uint32_t id)
+{
+    can_frame_t frames[CAN_TX_QUEUE_SIZE];
+    uint8_t n = bcm_ctx_drain_tx(ctx, frames, CAN_TX_QUEUE_SIZE);
+    int matches = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        if (frames[i].id == id) {
+            matches++;
+        }
+    }
+    
+    can_fd_frame_t fd_frames[CAN_TX_FD_QUEUE_SIZE];
+    n = bcm_ctx_drain_tx_fd(ctx, fd_frames, CAN_TX_FD_QUEUE_SIZE);
+    for (uint8_t i = 0; i < n; i++) {
+        if (fd_frames[i].id == id) {
+            matches++;
+        }
+    }
+    return matches;
+}
+
+/*******************************************************************************
+ * Test Group: Instances
+ ******************************************************************************/
+
+TEST_GROUP(BcmCtx)
+{
+    bcm_ctx_t *a;
+    bcm_ctx_t *b;
+
+    void setup() override
+    {
+        a = bcm_ctx_create();
+        b = bcm_ctx_create();
+    }
+
+    void teardown() override
+    {
+        bcm_ctx_destroy(a);
+        bcm_ctx_destroy(b);
+        (void)bcm_ctx_bind(NULL);
+    }
+};
+
+TEST(BcmCtx, InstancesAreIndependent)
+{
+    CHECK_TRUE(a != NULL && b != NULL);
+    CHECK_EQUAL(-1, bcm_ctx_process(a, 0));
+    CHECK_EQUAL(0, bcm_ctx_init(a, NULL));
+    CHECK_EQUAL(0, bcm_ctx_init(b, NULL));
+    
+    can_frame_t lock = build_door_cmd(DOOR_CMD_LOCK_ALL, 0);
+    CHECK_EQUAL(CAN_STATUS_OK, bcm_ctx_inject_rx(a, &lock));
+    CHECK_EQUAL(0, bcm_ctx_process(a, 0));
+    CHECK_EQUAL(0, bcm_ctx_process(b, 500));
+    
+    CHECK_EQUAL(DOOR_STATE_LOCKED, bcm_ctx_state(a)->door.lock_state[0]);
+    CHECK_EQUAL(DOOR_STATE_UNLOCKED, bcm_ctx_state(b)->door.lock_state[0]);
+    CHECK_EQUAL(0U, bcm_ctx_state(a)->uptime_ms);
+    CHECK_EQUAL(500U, bcm_ctx_state(b)->uptime_ms);
+    
+    /* Schedulers are anchored to each instance's own first tick */
+    CHECK_EQUAL(SCHED_OFFSET_STATUS_MS, bcm_ctx_next_deadline_ms(a));
+    CHECK_EQUAL(500U + SCHED_OFFSET_STATUS_MS, bcm_ctx_next_deadline_ms(b));
+    
+    /* The default instance never saw any of it */
+    CHECK_TRUE(bcm_ctx_current() == bcm_ctx_default());
+    CHECK_EQUAL(-1, bcm_process(0));
+}
+
+TEST(BcmCtx, BindRedirectsClassicApi)
+{
+    CHECK_EQUAL(0, bcm_ctx_init(a, NULL));
+    CHECK_EQUAL(0, bcm_ctx_init(b, NULL));
+    
+    bcm_ctx_t *prev = bcm_ctx_bind(b);
+    CHECK_TRUE(prev == bcm_ctx_default());
+    
+    can_frame_t lock = build_door_cmd(DOOR_CMD_LOCK_ALL, 0);
+    CHECK_EQUAL(CMD_RESULT_OK, door_control_handle_cmd(&lock));
+    CHECK_EQUAL(DOOR_STATE_LOCKING, door_control_get_lock_state(DOOR_ID_FRONT_LEFT));
+    
+    (void)bcm_ctx_bind(a);
+    CHECK_EQUAL(DOOR_STATE_UNLOCKED, door_control_get_lock_state(DOOR_ID_FRONT_LEFT));
+    
+    /* Status frames go out on the bound instance's queue only */
+    CHECK_EQUAL(0, bcm_process(0));
+    CHECK_EQUAL(0, bcm_process(BCM_MAIN_CYCLE_TIME_MS));
+    (void)bcm_ctx_bind(prev);
+    CHECK_EQUAL(1, count_tx(a, DOOR_STATUS_TX_ID));
+    CHECK_EQUAL(0, count_tx(b, DOOR_STATUS_TX_ID));
+}
+
+TEST(BcmCtx, InstancesRunOnSeparateThreads)
+{
+    bcm_ctx_t *ctx[2] = { a, b };
+    int heartbeats[2] = { 0, 0 };
+    
+    std::thread workers[2];
+    for (int w = 0; w < 2; w++) {
+        workers[w] = std::thread([&ctx, &heartbeats, w]() {
+            (void)bcm_ctx_init(ctx[w], NULL);
+            for (uint32_t t = 0; t < 10U * CAN_HEARTBEAT_PERIOD_MS; t += 10U) {
+                (void)bcm_ctx_process(ctx[w], t);
+                heartbeats[w] += count_tx(ctx[w], HEARTBEAT_TX_ID);
+            }
+        });
+    }
+    for (int w = 0; w < 2; w++) {
+        workers[w].join();
+    }
+    
+    CHECK_EQUAL(10 * CAN_HEARTBEAT_PERIOD_MS / HEARTBEAT_TX_PERIOD_MS, heartbeats[0]);
+    CHECK_EQUAL(10 * CAN_HEARTBEAT_PERIOD_MS / HEARTBEAT_TX_PERIOD_MS, heartbeats[1]);
+}
+
+TEST(BcmCtx, PoolKeepsHotStateContiguous)
+{
+    bcm_ctx_pool_t *pool = bcm_ctx_pool_create(3);
+    CHECK_TRUE(pool != NULL);
+    CHECK_TRUE(bcm_ctx_pool_get(pool, 3) == NULL);
+    
+    bcm_ctx_t *m[3];
+    for (uint32_t i = 0; i < 3; i++) {
+        m[i] = bcm_ctx_pool_get(pool, i);
+        CHECK_EQUAL(0, bcm_ctx_init(m[i], NULL));
+    }
+    
+    /* Struct-of-arrays: hot blocks back to back */
+    CHECK_TRUE(bcm_ctx_state(m[1]) == bcm_ctx_state(m[0]) + 1);
+    CHECK_TRUE(bcm_ctx_state(m[2]) == bcm_ctx_state(m[1]) + 1);
+    
+    can_frame_t lock = build_door_cmd(DOOR_CMD_LOCK_ALL, 0);
+    CHECK_EQUAL(CAN_STATUS_OK, bcm_ctx_inject_rx(m[1], &lock));
+    for (uint32_t i = 0; i < 3; i++) {
+        CHECK_EQUAL(0, bcm_ctx_process(m[i], 0));
+    }
+    CHECK_EQUAL(DOOR_STATE_UNLOCKED, bcm_ctx_state(m[0])->door.lock_state[0]);
+    CHECK_EQUAL(DOOR_STATE_LOCKED, bcm_ctx_state(m[1])->door.lock_state[0]);
+    
+    /* Cold blocks are per member too */
+    bcm_ctx_t *prev = bcm_ctx_bind(m[2]);
+    fault_manager_set(FAULT_CODE_INVALID_CMD);
+    CHECK_TRUE(fault_manager_is_active(FAULT_CODE_INVALID_CMD));
+    (void)bcm_ctx_bind(m[0]);
+    CHECK_FALSE(fault_manager_is_active(FAULT_CODE_INVALID_CMD));
+    (void)bcm_ctx_bind(prev);
+    
+    bcm_ctx_destroy(m[0]); /* Pool members are freed with the pool */
+    bcm_ctx_pool_destroy(pool);
+}
+
+TEST(BcmCtx, SnapshotPublishedEachTaskTick)
+{
+    system_state_t snap;
+    CHECK_EQUAL(0U, bcm_ctx_snapshot(a, &snap));
+    CHECK_EQUAL(0, bcm_ctx_init(a, NULL));
+    CHECK_EQUAL(1U, bcm_ctx_snapshot(a, &snap));
+    CHECK_EQUAL(BCM_STATE_NORMAL, snap.bcm_state);
+    
+    can_frame_t lock = build_door_cmd(DOOR_CMD_LOCK_ALL, 0);
+    CHECK_EQUAL(CAN_STATUS_OK, bcm_ctx_inject_rx(a, &lock));
+    CHECK_EQUAL(0, bcm_ctx_process(a, 0));
+    CHECK_EQUAL(2U, bcm_ctx_snapshot(a, &snap));
+    CHECK_EQUAL(DOOR_STATE_LOCKED, snap.door.lock_state[0]);
+    
+    /* No task due: the live state moves on, the snapshot does not */
+    CHECK_EQUAL(0, bcm_ctx_process(a, 1));
+    CHECK_EQUAL(2U, bcm_ctx_snapshot(a, &snap));
+    CHECK_EQUAL(0U, snap.uptime_ms);
+    CHECK_EQUAL(1U, bcm_ctx_state(a)->uptime_ms);
+    
+    CHECK_EQUAL(0, bcm_ctx_process(a, SCHED_OFFSET_STATUS_MS));
+    CHECK_EQUAL(3U, bcm_ctx_snapshot(a, &snap));
+    CHECK_EQUAL(SCHED_OFFSET_STATUS_MS, snap.uptime_ms);
+    CHECK_EQUAL(0U, bcm_ctx_snapshot(NULL, &snap));
+}
+
+TEST(BcmCtx, SnapshotIsNeverTorn)
+{
+    CHECK_EQUAL(0, bcm_ctx_init(a, NULL));
+    std::atomic<bool> done(false);
+    
+    /* One minute per tick: uptime_ms and uptime_minutes change together */
+    std::thread writer([this, &done]() {
+        for (uint32_t i = 1; i <= 20000U; i++) {
+            (void)bcm_ctx_process(a, i * 60000U);
+            (void)count_tx(a, CAN_ID_BCM_HEARTBEAT);
+        }
+        done = true;
+    });
+    
+    uint32_t torn = 0;
+    uint32_t last_count = 0;
+    uint32_t last_ms = 0;
+    while (!done) {
+        system_state_t snap;
+        uint32_t count = bcm_ctx_snapshot(a, &snap);
+        if (snap.uptime_minutes != (uint8_t)(snap.uptime_ms / 60000U) ||
+            count < last_count || snap.uptime_ms < last_ms) {
+            torn++;
+        }
+        last_count = count;
+        last_ms = snap.uptime_ms;
+    }
+    writer.join();
+    
+    CHECK_EQUAL(0U, torn);
+    system_state_t snap;
+    CHECK_TRUE(bcm_ctx_snapshot(a, &snap) >= 20000U); /* First tick may run no task */
+    CHECK_EQUAL(20000U * 60000U, snap.uptime_ms);
+}
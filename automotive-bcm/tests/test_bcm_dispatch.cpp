@@ -0,0 +1,272 @@
+/**
+ * @file test_bcm_dispatch.cpp
+ * @brief Unit tests for BCM RX message dispatch
+ *
+ * Tests:
+ * - Built-in command routing
+ * - DLC rejection before the handler runs
+ * - Unknown ID accounting
+ * - Batch validation keeps per-ID counter order
+ * - Handler registration
+ * - Malformed-frame floods logged once per window
+ * - RX acceptance filter derived from registered IDs
+ * - Commands and discards on a second bus
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C" {
+#include "bcm.h"
+#include "door_control.h"
+#include "fault_manager.h"
+#include "can_interface.h"
+#include "can_ids.h"
+}
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static int g_custom_calls = 0;
+
+static cmd_result_t custom_handler(const can_frame_t *frame)
+{
+    (void)frame;
+    g_custom_calls++;
+    return CMD_RESULT_OK;
+}
+
+static can_frame_t build_frame(uint32_t id, uint8_t dlc, uint8_t cmd)
+{
+    can_frame_t frame;
+    frame.id = id;
+    frame.dlc = dlc;
+    
+    for (uint8_t i = 0; i < CAN_FRAME_MAX_DLC; i++) {
+        frame.data[i] = 0;
+    }
+    frame.data[0] = cmd;
+    frame.data[1] = DOOR_ID_ALL;
+    frame.data[2] = CAN_BUILD_VER_CTR(CAN_SCHEMA_VERSION, 0);
+    frame.data[3] = can_calculate_checksum(frame.data, 3);
+    
+    return frame;
+}
+
+static void deliver(const can_frame_t *frame)
+{
+    can_stub_inject_rx(frame);
+    bcm_process(1);
+}
+
+/*******************************************************************************
+ * Test Group: Dispatch
+ ******************************************************************************/
+
+TEST_GROUP(BcmDispatch)
+{
+    void setup() override
+    {
+        bcm_init(NULL);
+        bcm_process(0);
+        can_reset_stats();
+        g_custom_calls = 0;
+    }
+
+    void teardown() override
+    {
+        bcm_deinit();
+    }
+};
+
+TEST(BcmDispatch, RoutesDoorCommand)
+{
+    can_frame_t frame = build_frame(CAN_ID_DOOR_CMD, DOOR_CMD_DLC, DOOR_CMD_LOCK_ALL);
+    deliver(&frame);
+    
+    CHECK_EQUAL(DOOR_STATE_LOCKING, door_control_get_lock_state(DOOR_ID_FRONT_LEFT));
+}
+
+TEST(BcmDispatch, UnknownIdCounted)
+{
+    can_frame_t frame = build_frame(0x7FF, 4, 0);
+    deliver(&frame);
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    CHECK_EQUAL(1, stats.rx_unknown_id);
+}
+
+TEST(BcmDispatch, OutOfRangeIdCounted)
+{
+    can_frame_t frame = build_frame(CAN_ID_COUNT + CAN_ID_DOOR_CMD, DOOR_CMD_DLC,
+                                    DOOR_CMD_LOCK_ALL);
+    deliver(&frame);
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    CHECK_EQUAL(1, stats.rx_unknown_id);
+    CHECK_EQUAL(DOOR_STATE_UNLOCKED, door_control_get_lock_state(DOOR_ID_FRONT_LEFT));
+}
+
+TEST(BcmDispatch, WrongDlcRejectedBeforeHandler)
+{
+    can_frame_t frame = build_frame(CAN_ID_DOOR_CMD, 3, DOOR_CMD_LOCK_ALL);
+    deliver(&frame);
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    CHECK_EQUAL(1, stats.rx_bad_dlc);
+    CHECK_TRUE(fault_manager_is_active(FAULT_CODE_INVALID_LENGTH));
+    CHECK_EQUAL(DOOR_STATE_UNLOCKED, door_control_get_lock_state(DOOR_ID_FRONT_LEFT));
+}
+
+TEST(BcmDispatch, HandlerErrorCounted)
+{
+    can_frame_t frame = build_frame(CAN_ID_DOOR_CMD, DOOR_CMD_DLC, DOOR_CMD_LOCK_ALL);
+    frame.data[3] ^= 0xFF; /* Bad checksum */
+    deliver(&frame);
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    CHECK_EQUAL(1, stats.rx_rejected);
+}
+
+TEST(BcmDispatch, BatchChecksCountersPerIdInOrder)
+{
+    can_frame_t frames[5];
+    frames[0] = build_frame(CAN_ID_DOOR_CMD, DOOR_CMD_DLC, DOOR_CMD_LOCK_ALL);
+    frames[1] = build_frame(0x7FF, 4, 0);
+    frames[2] = build_frame(CAN_ID_DOOR_CMD, 3, DOOR_CMD_LOCK_ALL);     /* Counter untouched */
+    frames[3] = build_frame(CAN_ID_DOOR_CMD, DOOR_CMD_DLC, DOOR_CMD_LOCK_ALL);
+    frames[3].data[2] = CAN_BUILD_VER_CTR(CAN_SCHEMA_VERSION, 1);
+    frames[3].data[3] = can_calculate_checksum(frames[3].data, 3);
+    frames[4] = frames[3];                                              /* Repeated counter */
+    
+    CHECK_EQUAL(CAN_STATUS_OK, can_stub_inject_rx_batch(frames, 5, NULL));
+    bcm_process(1);
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    CHECK_EQUAL(5U, stats.rx_count);
+    CHECK_EQUAL(1U, stats.rx_unknown_id);
+    CHECK_EQUAL(1U, stats.rx_bad_dlc);
+    CHECK_EQUAL(1U, stats.rx_rejected);
+    CHECK_TRUE(fault_manager_is_active(FAULT_CODE_INVALID_COUNTER));
+    CHECK_EQUAL(DOOR_STATE_LOCKING, door_control_get_lock_state(DOOR_ID_FRONT_LEFT));
+}
+
+TEST(BcmDispatch, MalformedFloodLoggedOnce)
+{
+    event_log_clear();
+    
+    can_frame_t frame = build_frame(CAN_ID_DOOR_CMD, DOOR_CMD_DLC, DOOR_CMD_LOCK_ALL);
+    frame.data[3] ^= 0xFF; /* Bad checksum */
+    for (int i = 0; i < 50; i++) {
+        deliver(&frame);
+    }
+    
+    uint8_t errors = 0;
+    event_log_entry_t entry;
+    for (uint8_t i = 0; i < event_log_count(); i++) {
+        if (event_log_get(i, &entry) && entry.type == EVENT_CMD_ERROR) {
+            errors++;
+        }
+    }
+    CHECK_EQUAL(1, errors);
+    CHECK_EQUAL(49, fault_manager_get_repeats(FAULT_CODE_INVALID_CHECKSUM));
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    CHECK_EQUAL(50, stats.rx_rejected);
+}
+
+TEST(BcmDispatch, RegisterCustomHandler)
+{
+    CHECK_EQUAL(0, bcm_register_rx_handler(CAN_ID_BCM_CONFIG, 2, custom_handler));
+    
+    can_frame_t frame = build_frame(CAN_ID_BCM_CONFIG, 2, 0);
+    deliver(&frame);
+    CHECK_EQUAL(1, g_custom_calls);
+}
+
+TEST(BcmDispatch, RegisterRejectsInvalidId)
+{
+    CHECK_EQUAL(-1, bcm_register_rx_handler(CAN_ID_COUNT, 4, custom_handler));
+    CHECK_EQUAL(-1, bcm_register_rx_handler(CAN_ID_BCM_CONFIG, 4, NULL));
+}
+
+TEST(BcmDispatch, ReRegisterReplacesHandler)
+{
+    CHECK_EQUAL(0, bcm_register_rx_handler(CAN_ID_DOOR_CMD, DOOR_CMD_DLC, custom_handler));
+    
+    can_frame_t frame = build_frame(CAN_ID_DOOR_CMD, DOOR_CMD_DLC, DOOR_CMD_LOCK_ALL);
+    deliver(&frame);
+    CHECK_EQUAL(1, g_custom_calls);
+    CHECK_EQUAL(DOOR_STATE_UNLOCKED, door_control_get_lock_state(DOOR_ID_FRONT_LEFT));
+}
+
+TEST(BcmDispatch, RxFilterMatchesBuiltInIds)
+{
+    uint32_t ids[CAN_RX_FILTER_MAX];
+    
+    CHECK_EQUAL(3, can_stub_get_rx_filter(ids, CAN_RX_FILTER_MAX));
+    CHECK_EQUAL(CAN_ID_DOOR_CMD, ids[0]);
+    CHECK_EQUAL(CAN_ID_LIGHTING_CMD, ids[1]);
+    CHECK_EQUAL(CAN_ID_TURN_SIGNAL_CMD, ids[2]);
+}
+
+TEST(BcmDispatch, RxFilterFollowsRegistration)
+{
+    uint32_t ids[CAN_RX_FILTER_MAX];
+    
+    bcm_register_rx_handler(CAN_ID_BCM_CONFIG, 2, custom_handler);
+    CHECK_EQUAL(4, can_stub_get_rx_filter(ids, CAN_RX_FILTER_MAX));
+    CHECK_EQUAL(CAN_ID_BCM_CONFIG, ids[3]);
+    
+    /* Replacing a handler leaves the filter unchanged */
+    bcm_register_rx_handler(CAN_ID_DOOR_CMD, DOOR_CMD_DLC, custom_handler);
+    CHECK_EQUAL(4, can_stub_get_rx_filter(ids, CAN_RX_FILTER_MAX));
+}
+
+/*******************************************************************************
+ * Test Group: Dispatch on Two Buses
+ ******************************************************************************/
+
+TEST_GROUP(BcmDispatchMultiBus)
+{
+    void setup() override
+    {
+        bcm_init("body,gw");
+        bcm_process(0);
+        can_reset_stats();
+    }
+
+    void teardown() override
+    {
+        bcm_deinit();
+    }
+};
+
+TEST(BcmDispatchMultiBus, FullGatewayQueueDoesNotBlockBodyCommand)
+{
+    can_frame_t flood[CAN_RX_QUEUE_SIZE];
+    for (uint32_t i = 0; i < CAN_RX_QUEUE_SIZE; i++) {
+        flood[i] = build_frame(0x7FF, 4, 0);
+    }
+    CHECK_EQUAL(CAN_STATUS_OK,
+                can_stub_bus_inject_rx_batch(1, flood, CAN_RX_QUEUE_SIZE, NULL));
+    
+    can_frame_t cmd = build_frame(CAN_ID_DOOR_CMD, DOOR_CMD_DLC, DOOR_CMD_LOCK_ALL);
+    deliver(&cmd);
+    CHECK_EQUAL(DOOR_STATE_LOCKING, door_control_get_lock_state(DOOR_ID_FRONT_LEFT));
+    
+    /* Discards are counted on the bus that carried them */
+    can_stats_t stats;
+    can_bus_get_stats(1, &stats);
+    CHECK_EQUAL(CAN_RX_QUEUE_SIZE, stats.rx_unknown_id);
+    can_get_stats(&stats);
+    CHECK_EQUAL(0U, stats.rx_unknown_id);
+    CHECK_EQUAL(1U, stats.rx_count);
+    CHECK_EQUAL(CAN_STATUS_NO_DATA, can_rx_poll());
+}
@@ -0,0 +1,460 @@
+/**
+ * @file test_bcm_scheduler.cpp
+ * @brief Unit tests for the BCM periodic task scheduler
+ *
+ * Tests:
+ * - Task periods (100ms status, 500ms fault status, 1000ms heartbeat)
+ * - Phase offsets keep TX tasks in separate milliseconds
+ * - Next deadline reporting
+ * - Overrun and late-run counting
+ * - Undrained TX held back by the TX scheduler
+ * - Module deadlines and idle modules skipped by the 10ms task
+ * - Send-on-change status (BCM_SEND_ON_CHANGE builds)
+ * - Deferred 10ms task (BCM_TICKLESS builds)
+ * - Aggregate status frame (BCM_CAN_FD builds)
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C" {
+#include "bcm.h"
+#include "door_control.h"
+#include "lighting_control.h"
+#include "turn_signal.h"
+#include "fault_manager.h"
+#include "system_state.h"
+#include "can_interface.h"
+#include "can_ids.h"
+#include "bcm_config.h"
+}
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+/* Unchanged status is only sent at the keep-alive floor with send-on-change */
+#if BCM_FEATURE_SEND_ON_CHANGE
+#define STATUS_TX_PERIOD_MS     CAN_STATUS_KEEPALIVE_PERIOD_MS
+#else
+#define STATUS_TX_PERIOD_MS     CAN_BCM_STATUS_PERIOD_MS
+#endif
+
+typedef struct {
+    uint32_t    status_frames;      /**< Batches ending in TURN_SIGNAL_STATUS, or aggregates */
+    uint32_t    fault_frames;
+    uint32_t    heartbeat_frames;
+    uint32_t    timing_frames;      /**< Batches ending in BCM_TIMING (no heartbeat with CAN FD) */
+    uint32_t    tx_slots;           /**< Milliseconds with any TX */
+} tx_tally_t;
+
+/**
+ * @brief Step bcm_process() one ms at a time, tallying the last TX frame
+ */
+static tx_tally_t run_for(uint32_t start_ms, uint32_t duration_ms)
+{
+    tx_tally_t tally = { 0, 0, 0, 0, 0 };
+    
+    for (uint32_t i = 0; i < duration_ms; i++) {
+        can_stub_clear();
+        bcm_process(start_ms + i);
+        
+        can_fd_frame_t fd_frame;
+        if (can_stub_drain_tx_fd(&fd_frame, 1) > 0U &&
+            fd_frame.id == CAN_ID_BCM_AGGREGATE_STATUS) {
+            tally.tx_slots++;
+            tally.status_frames++;
+            continue;
+        }
+        
+        can_frame_t frame;
+        if (can_stub_get_last_tx(&frame) != CAN_STATUS_OK) {
+            continue;
+        }
+        
+        tally.tx_slots++;
+        if (frame.id == CAN_ID_TURN_SIGNAL_STATUS) tally.status_frames++;
+        if (frame.id == CAN_ID_FAULT_STATUS) tally.fault_frames++;
+        if (frame.id == CAN_ID_BCM_HEARTBEAT) tally.heartbeat_frames++;
+        if (frame.id == CAN_ID_BCM_TIMING) tally.timing_frames++;
+    }
+    
+    return tally;
+}
+
+/*******************************************************************************
+ * Test Group: Scheduler Periods
+ ******************************************************************************/
+
+TEST_GROUP(SchedulerPeriods)
+{
+    void setup() override
+    {
+        bcm_init(NULL);
+    }
+
+    void teardown() override
+    {
+        bcm_deinit();
+    }
+};
+
+TEST(SchedulerPeriods, StatusEvery100ms)
+{
+    tx_tally_t tally = run_for(0, 2000);
+    CHECK_EQUAL(2000 / STATUS_TX_PERIOD_MS, tally.status_frames);
+}
+
+TEST(SchedulerPeriods, FaultStatusEvery500ms)
+{
+    tx_tally_t tally = run_for(0, 2000);
+    CHECK_EQUAL(BCM_FEATURE_CAN_FD ? 0 : 4, tally.fault_frames); /* FD: a section */
+}
+
+TEST(SchedulerPeriods, HeartbeatEvery1000ms)
+{
+    tx_tally_t tally = run_for(0, 2000);
+    CHECK_EQUAL(BCM_FEATURE_CAN_FD ? 0 : 2, tally.heartbeat_frames);
+}
+
+TEST(SchedulerPeriods, TxTasksUseSeparateSlots)
+{
+    /* One slot per status/fault/heartbeat run: none share a millisecond */
+    tx_tally_t tally = run_for(0, 2000);
+    CHECK_EQUAL(tally.status_frames + tally.fault_frames + tally.heartbeat_frames +
+                tally.timing_frames, tally.tx_slots);
+}
+
+TEST(SchedulerPeriods, StartsAtArbitraryTime)
+{
+    tx_tally_t tally = run_for(0xFFFFFF00U, 1000);
+    CHECK_EQUAL(1000 / STATUS_TX_PERIOD_MS, tally.status_frames);
+    CHECK_EQUAL(BCM_FEATURE_CAN_FD ? 0 : 2, tally.fault_frames);
+    CHECK_EQUAL(BCM_FEATURE_CAN_FD ? 0 : 1, tally.heartbeat_frames);
+}
+
+TEST(SchedulerPeriods, UndrainedTxNeverDropsStatus)
+{
+    /* Nobody drains classic TX for 10s: the queue fills, pending status
+     * coalesces. The aggregate frame has its own FD queue. */
+    for (uint32_t ms = 0; ms < 10000U; ms++) {
+        bcm_process(ms);
+        can_fd_frame_t fd_frame;
+        (void)can_stub_drain_tx_fd(&fd_frame, 1);
+    }
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    CHECK_EQUAL(0U, stats.tx_errors);
+    CHECK_EQUAL(0U, stats.tx_dropped);
+    
+    can_frame_t frames[CAN_TX_QUEUE_SIZE];
+    (void)can_stub_drain_tx(frames, CAN_TX_QUEUE_SIZE);
+    bcm_process(10000);
+    CHECK_EQUAL(0, can_tx_pending());
+}
+
+/*******************************************************************************
+ * Test Group: Scheduler Deadlines
+ ******************************************************************************/
+
+TEST_GROUP(SchedulerDeadlines)
+{
+    void setup() override
+    {
+        bcm_init(NULL);
+    }
+
+    void teardown() override
+    {
+        bcm_deinit();
+    }
+};
+
+TEST(SchedulerDeadlines, NextDeadlineIsEarliestTask)
+{
+    bcm_process(1000);
+    CHECK_EQUAL(1000 + SCHED_OFFSET_STATUS_MS, bcm_next_deadline_ms());
+    
+    bcm_process(1000 + SCHED_OFFSET_STATUS_MS);
+    CHECK_EQUAL(1000 + SCHED_OFFSET_FAULT_STATUS_MS, bcm_next_deadline_ms());
+}
+
+TEST(SchedulerDeadlines, NoOverrunsOnTime)
+{
+    run_for(0, 1000);
+    for (int i = 0; i < BCM_TASK_COUNT; i++) {
+        CHECK_EQUAL(0, bcm_get_task_overruns((bcm_task_id_t)i));
+    }
+}
+
+/* A tickless build defers the idle 10ms task instead of running it late */
+#if !BCM_FEATURE_TICKLESS
+
+TEST(SchedulerDeadlines, LateTickCountsOverruns)
+{
+    bcm_process(0);
+    bcm_process(55); /* 10ms task due at 10, four whole periods missed */
+    CHECK_EQUAL(4, bcm_get_task_overruns(BCM_TASK_10MS));
+    CHECK_EQUAL(0, bcm_get_task_overruns(BCM_TASK_100MS));
+}
+
+TEST(SchedulerDeadlines, LateWithinPeriodCountsLateRun)
+{
+    bcm_process(0);
+    bcm_process(SCHED_OFFSET_STATUS_MS);
+    bcm_process(SCHED_OFFSET_FAULT_STATUS_MS);
+    bcm_process(SCHED_OFFSET_HEARTBEAT_MS);
+    bcm_process(13); /* 10ms task due at 10, 3ms late */
+    CHECK_EQUAL(0, bcm_get_task_overruns(BCM_TASK_10MS));
+    CHECK_EQUAL(1, bcm_get_task_late_runs(BCM_TASK_10MS));
+    
+    bcm_process(20); /* Phase kept, next run on time */
+    CHECK_EQUAL(1, bcm_get_task_late_runs(BCM_TASK_10MS));
+    CHECK_EQUAL(0, bcm_get_task_late_runs(BCM_TASK_100MS));
+}
+
+#endif /* !BCM_FEATURE_TICKLESS */
+
+TEST(SchedulerDeadlines, TurnSignalDeadlineIsNextToggle)
+{
+    bcm_process(0);
+    CHECK_EQUAL(SYS_DEADLINE_IDLE_MS, turn_signal_next_deadline(0));
+    
+    turn_signal_hazard_on();
+    CHECK_EQUAL(HAZARD_FLASH_ON_MS, turn_signal_next_deadline(0));
+    CHECK_EQUAL(HAZARD_FLASH_ON_MS, turn_signal_next_deadline(HAZARD_FLASH_ON_MS));
+    
+    turn_signal_update(HAZARD_FLASH_ON_MS); /* Off phase */
+    CHECK_EQUAL(HAZARD_FLASH_ON_MS + HAZARD_FLASH_OFF_MS,
+                turn_signal_next_deadline(HAZARD_FLASH_ON_MS));
+    
+    turn_signal_off();
+    CHECK_EQUAL(1U + SYS_DEADLINE_IDLE_MS, turn_signal_next_deadline(1));
+}
+
+TEST(SchedulerDeadlines, FastTaskTogglesTurnSignalOnTime)
+{
+    turn_signal_hazard_on();
+    uint8_t flashes = 0;
+    
+    /* Skipped updates must not shift the flash timing */
+    for (uint32_t t = 0; t <= 2U * (HAZARD_FLASH_ON_MS + HAZARD_FLASH_OFF_MS); t++) {
+        bcm_process(t);
+        if (turn_signal_get_flash_count() != flashes) {
+            flashes = turn_signal_get_flash_count();
+            CHECK_EQUAL(0U, t % (HAZARD_FLASH_ON_MS + HAZARD_FLASH_OFF_MS));
+        }
+    }
+    CHECK_EQUAL(2, flashes);
+}
+
+#if BCM_FEATURE_SEND_ON_CHANGE
+
+/*******************************************************************************
+ * Test Group: Send-On-Change Status
+ ******************************************************************************/
+
+TEST_GROUP(SendOnChange)
+{
+    void setup() override
+    {
+        bcm_init(NULL);
+        run_for(0, 50); /* Past the first keep-alive */
+    }
+
+    void teardown() override
+    {
+        bcm_deinit();
+    }
+};
+
+TEST(SendOnChange, NoStatusWithoutChange)
+{
+    tx_tally_t tally = run_for(50, 900);
+    CHECK_EQUAL(0, tally.status_frames);
+}
+
+TEST(SendOnChange, DoorChangeSentSameTick)
+{
+    can_frame_t frame;
+    
+    door_control_lock_all();
+    can_stub_clear();
+    bcm_process(60); /* 10ms task completes the lock */
+    
+#if BCM_FEATURE_CAN_FD
+    can_fd_frame_t fd_frame;
+    CHECK_EQUAL(1, can_stub_drain_tx_fd(&fd_frame, 1));
+    CHECK_EQUAL(CAN_ID_BCM_AGGREGATE_STATUS, fd_frame.id);
+    memcpy(frame.data, &fd_frame.data[AGG_BYTE_DOOR], DOOR_STATUS_DLC);
+#else
+    CHECK_EQUAL(CAN_STATUS_OK, can_stub_get_last_tx(&frame));
+    CHECK_EQUAL(CAN_ID_DOOR_STATUS, frame.id);
+#endif
+    CHECK_EQUAL(DOOR_LOCK_BIT_FL | DOOR_LOCK_BIT_FR | DOOR_LOCK_BIT_RL | DOOR_LOCK_BIT_RR,
+                frame.data[DOOR_STATUS_BYTE_LOCKS]);
+}
+
+TEST(SendOnChange, KeepAliveStillSent)
+{
+    tx_tally_t tally = run_for(50, 2 * CAN_STATUS_KEEPALIVE_PERIOD_MS);
+    CHECK_EQUAL(2, tally.status_frames);
+}
+
+#endif /* BCM_FEATURE_SEND_ON_CHANGE */
+
+#if BCM_FEATURE_TICKLESS
+
+/*******************************************************************************
+ * Test Group: Tickless 10ms Task
+ ******************************************************************************/
+
+TEST_GROUP(Tickless)
+{
+    void setup() override
+    {
+        bcm_init(NULL);
+        bcm_process(0);
+        bcm_process(SCHED_OFFSET_STATUS_MS);
+        bcm_process(SCHED_OFFSET_FAULT_STATUS_MS);
+        bcm_process(SCHED_OFFSET_HEARTBEAT_MS);
+    }
+
+    void teardown() override
+    {
+        bcm_deinit();
+    }
+};
+
+TEST(Tickless, IdleSleepsUntilStatusTask)
+{
+    CHECK_EQUAL(CAN_BCM_STATUS_PERIOD_MS + SCHED_OFFSET_STATUS_MS, bcm_next_deadline_ms());
+    
+    bcm_process(CAN_BCM_STATUS_PERIOD_MS + SCHED_OFFSET_STATUS_MS);
+    CHECK_EQUAL(0, bcm_get_task_late_runs(BCM_TASK_10MS));
+    CHECK_EQUAL(0, bcm_get_task_overruns(BCM_TASK_10MS));
+}
+
+TEST(Tickless, CommandRunsFastTaskInItsSlot)
+{
+    door_control_lock_all();
+    bcm_process(50);
+    CHECK_EQUAL(DOOR_STATE_LOCKED, door_control_get_lock_state(DOOR_ID_FRONT_LEFT));
+    CHECK_EQUAL(0, bcm_get_task_late_runs(BCM_TASK_10MS));
+    
+    /* Off the 10ms grid: completes in the next slot */
+    door_control_unlock_all();
+    bcm_process(53);
+    CHECK_EQUAL(60U, bcm_next_deadline_ms());
+    bcm_process(60);
+    CHECK_EQUAL(DOOR_STATE_UNLOCKED, door_control_get_lock_state(DOOR_ID_FRONT_LEFT));
+    CHECK_EQUAL(CAN_BCM_STATUS_PERIOD_MS + SCHED_OFFSET_STATUS_MS, bcm_next_deadline_ms());
+}
+
+TEST(Tickless, WakesForTurnSignalToggle)
+{
+    turn_signal_hazard_on(); /* First toggle due at 6 + 400 */
+    for (uint32_t t = CAN_BCM_STATUS_PERIOD_MS; t <= 400U; t += CAN_BCM_STATUS_PERIOD_MS) {
+        bcm_process(t + SCHED_OFFSET_STATUS_MS);
+    }
+    CHECK_EQUAL(410U, bcm_next_deadline_ms());
+}
+
+#endif /* BCM_FEATURE_TICKLESS */
+
+#if BCM_FEATURE_CAN_FD
+
+/*******************************************************************************
+ * Test Group: Aggregate Status
+ ******************************************************************************/
+
+/** XOR of len bytes with the checksum seed */
+static uint8_t xor_bytes(const uint8_t *data, uint8_t len)
+{
+    uint8_t checksum = CAN_CHECKSUM_SEED;
+    for (uint8_t i = 0; i < len; i++) {
+        checksum ^= data[i];
+    }
+    return checksum;
+}
+
+TEST_GROUP(AggregateStatus)
+{
+    can_fd_frame_t agg;
+    
+    void setup() override
+    {
+        bcm_init(NULL);
+        bcm_process(0);
+        door_control_lock_all();
+        can_stub_clear();
+        bcm_process(CAN_BCM_STATUS_PERIOD_MS); /* Lock done, status due */
+        
+        uint8_t n = can_stub_drain_tx_fd(&agg, 1);
+        CHECK_EQUAL(1, n);
+    }
+
+    void teardown() override
+    {
+        bcm_deinit();
+    }
+};
+
+TEST(AggregateStatus, ReplacesClassicStatusFrames)
+{
+    can_frame_t frames[CAN_TX_QUEUE_SIZE];
+    uint8_t n = can_stub_drain_tx(frames, CAN_TX_QUEUE_SIZE);
+    for (uint8_t i = 0; i < n; i++) {
+        CHECK_TRUE(frames[i].id < CAN_ID_DOOR_STATUS || frames[i].id > CAN_ID_BCM_HEARTBEAT);
+    }
+    
+    CHECK_EQUAL(CAN_ID_BCM_AGGREGATE_STATUS, agg.id);
+    CHECK_EQUAL(BCM_AGGREGATE_LEN, agg.len);
+    CHECK_EQUAL(CAN_FD_FLAG_BRS, agg.flags);
+    CHECK_EQUAL(CAN_SCHEMA_VERSION, CAN_GET_VERSION(agg.data[AGG_BYTE_VER_CTR]));
+    CHECK_EQUAL(xor_bytes(agg.data, AGG_BYTE_CHECKSUM), agg.data[AGG_BYTE_CHECKSUM]);
+    CHECK_EQUAL(BCM_STATE_NORMAL, agg.data[AGG_BYTE_HEARTBEAT + HEARTBEAT_BYTE_STATE]);
+}
+
+TEST(AggregateStatus, SectionsAreClassicPayloads)
+{
+    static void (*const builders[])(can_frame_t *) = {
+        door_control_build_status_frame,
+        lighting_control_build_status_frame,
+        turn_signal_build_status_frame,
+        fault_manager_build_status_frame,
+    };
+    const uint8_t offsets[] = { AGG_BYTE_DOOR, AGG_BYTE_LIGHTING, AGG_BYTE_TURN,
+                                AGG_BYTE_FAULT, AGG_BYTE_HEARTBEAT, AGG_BYTE_CHECKSUM };
+    
+    for (uint8_t s = 0; s < 4U; s++) {
+        can_frame_t frame;
+        builders[s](&frame);
+        const uint8_t *section = &agg.data[offsets[s]];
+        CHECK_EQUAL(offsets[s + 1U] - offsets[s], frame.dlc);
+        
+        /* Same data bytes; own ver/ctr and a checksum over the section */
+        MEMCMP_EQUAL(frame.data, section, frame.dlc - 2U);
+        CHECK_EQUAL(CAN_SCHEMA_VERSION, CAN_GET_VERSION(section[frame.dlc - 2U]));
+        CHECK_EQUAL(xor_bytes(section, (uint8_t)(frame.dlc - 1U)), section[frame.dlc - 1U]);
+    }
+    CHECK_EQUAL(DOOR_LOCK_BIT_FL | DOOR_LOCK_BIT_FR | DOOR_LOCK_BIT_RL | DOOR_LOCK_BIT_RR,
+                agg.data[AGG_BYTE_DOOR + DOOR_STATUS_BYTE_LOCKS]);
+}
+
+TEST(AggregateStatus, CountersAdvancePerFrame)
+{
+    door_control_unlock_all(); /* A change, for send-on-change builds */
+    bcm_process(2U * CAN_BCM_STATUS_PERIOD_MS);
+    bcm_process(2U * CAN_BCM_STATUS_PERIOD_MS + SCHED_OFFSET_STATUS_MS);
+    
+    can_fd_frame_t next;
+    CHECK_EQUAL(1, can_stub_drain_tx_fd(&next, 1));
+    CHECK_EQUAL((CAN_GET_COUNTER(agg.data[AGG_BYTE_VER_CTR]) + 1U) & CAN_COUNTER_MASK,
+                CAN_GET_COUNTER(next.data[AGG_BYTE_VER_CTR]));
+    CHECK_EQUAL((CAN_GET_COUNTER(agg.data[AGG_BYTE_HEARTBEAT + HEARTBEAT_BYTE_VER_CTR]) + 1U) &
+                CAN_COUNTER_MASK,
+                CAN_GET_COUNTER(next.data[AGG_BYTE_HEARTBEAT + HEARTBEAT_BYTE_VER_CTR]));
+}
+
+#endif /* BCM_FEATURE_CAN_FD */
@@ -0,0 +1,461 @@
+/**
+ * @file test_bcm_store.cpp
+ * @brief Unit tests for the persistent fault/event store
+ *
+ * Tests:
+ * - Fault counters and recent events survive a restart
+ * - Writes are whole pages from the 1000ms task, partial pages after the flush age
+ * - Every page is erased once per lap
+ * - Mount reads O(log pages), the newest page is found after wraparound
+ * - Torn pages are skipped
+ * - Only the instance that claimed the store stages and restores
+ * - File backend round trip
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+extern "C" {
+#include "bcm.h"
+#include "bcm_ctx.h"
+#include "bcm_store.h"
+#include "fault_manager.h"
+#include "system_state.h"
+#include "bcm_config.h"
+}
+
+/*******************************************************************************
+ * RAM Flash
+ ******************************************************************************/
+
+#define TEST_PAGE_SIZE      128U
+#define TEST_PER_PAGE       ((TEST_PAGE_SIZE - sizeof(bcm_store_page_header_t)) / 8U)
+
+/** Flash in memory that counts operations and rejects reprogramming */
+typedef struct {
+    std::vector<uint8_t>    data;
+    std::vector<uint32_t>   erases;
+    std::vector<bool>       programmed;
+    uint32_t                programs;
+    uint32_t                misuse;     /**< Programs of a page not erased */
+} ram_flash_t;
+
+static ram_flash_t *ram(const bcm_flash_t *flash)
+{
+    return static_cast<ram_flash_t *>(flash->dev);
+}
+
+static int ram_read(const bcm_flash_t *flash, uint32_t page, void *buf)
+{
+    memcpy(buf, &ram(flash)->data[page * flash->page_size], flash->page_size);
+    return 0;
+}
+
+static int ram_program(const bcm_flash_t *flash, uint32_t page, const void *data)
+{
+    ram_flash_t *r = ram(flash);
+    if (r->programmed[page]) {
+        r->misuse++;
+    }
+    memcpy(&r->data[page * flash->page_size], data, flash->page_size);
+    r->programmed[page] = true;
+    r->programs++;
+    return 0;
+}
+
+static int ram_erase(const bcm_flash_t *flash, uint32_t page)
+{
+    ram_flash_t *r = ram(flash);
+    memset(&r->data[page * flash->page_size], 0xFF, flash->page_size);
+    r->programmed[page] = false;
+    r->erases[page]++;
+    return 0;
+}
+
+static void ram_init(bcm_flash_t *flash, ram_flash_t *r, uint32_t page_count)
+{
+    r->data.assign(TEST_PAGE_SIZE * page_count, 0xFF);
+    r->erases.assign(page_count, 0);
+    r->programmed.assign(page_count, false);
+    r->programs = 0;
+    r->misuse = 0;
+    
+    flash->page_size = TEST_PAGE_SIZE;
+    flash->page_count = page_count;
+    flash->read = ram_read;
+    flash->program = ram_program;
+    flash->erase = ram_erase;
+    flash->dev = r;
+}
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static void add_events(uint32_t count, uint32_t first)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t n = first + i;
+        uint8_t data[4] = { (uint8_t)n, (uint8_t)(n >> 8), (uint8_t)(n >> 16), 0 };
+        event_log_add(EVENT_DOOR_LOCK_CHANGE, data);
+    }
+}
+
+static uint32_t event_number(const event_log_entry_t *entry)
+{
+    return (uint32_t)entry->data[0] | ((uint32_t)entry->data[1] << 8) |
+           ((uint32_t)entry->data[2] << 16);
+}
+
+/** Newest restored door event, or 0xFFFFFFFF if none */
+static uint32_t newest_door_event(void)
+{
+    for (uint32_t i = event_log_count(); i-- > 0U; ) {
+        event_log_entry_t entry;
+        if (event_log_get(i, &entry) && entry.type == EVENT_DOOR_LOCK_CHANGE) {
+            return event_number(&entry);
+        }
+    }
+    return 0xFFFFFFFFU;
+}
+
+/** Power cycle: shut down, reattach the same flash and boot again */
+static void restart(const bcm_flash_t *flash)
+{
+    bcm_deinit();
+    bcm_store_close();
+    CHECK_EQUAL(0, bcm_store_open(flash));
+    CHECK_EQUAL(0, bcm_init(NULL));
+}
+
+/** Run the 1000ms task once, 1000ms after the last one */
+static void run_1000ms(uint32_t *now_ms)
+{
+    *now_ms += 1000U;
+    sys_state_update_time(*now_ms);
+    bcm_process_1000ms(*now_ms);
+}
+
+/*******************************************************************************
+ * Test Group: Store
+ ******************************************************************************/
+
+TEST_GROUP(BcmStore)
+{
+    bcm_flash_t flash;
+    ram_flash_t ram_dev;
+    
+    void setup() override
+    {
+        ram_init(&flash, &ram_dev, 16U);
+        CHECK_EQUAL(0, bcm_store_open(&flash));
+        bcm_init(NULL);
+    }
+    
+    void teardown() override
+    {
+        bcm_deinit();
+        bcm_store_close();
+        CHECK_EQUAL(0U, ram_dev.misuse);
+    }
+};
+
+TEST(BcmStore, RejectsBadGeometryAndSecondOpen)
+{
+    CHECK_EQUAL(-1, bcm_store_open(&flash));
+    
+    bcm_flash_t bad = flash;
+    bcm_store_close();
+    bad.page_size = 100U;
+    CHECK_EQUAL(-1, bcm_store_open(&bad));
+    bad.page_size = TEST_PAGE_SIZE;
+    bad.page_count = 1U;
+    CHECK_EQUAL(-1, bcm_store_open(&bad));
+    CHECK_FALSE(bcm_store_is_open());
+    CHECK_EQUAL(0, bcm_store_open(&flash));
+}
+
+TEST(BcmStore, EmptyFlashRestoresNothing)
+{
+    CHECK_EQUAL(0U, fault_manager_get_count());
+    CHECK_EQUAL(1U, event_log_count()); /* Only this boot's state change */
+}
+
+TEST(BcmStore, FaultHistorySurvivesRestart)
+{
+    sys_state_update_time(4200);
+    fault_manager_set(FAULT_CODE_DOOR_MOTOR);
+    fault_manager_set(FAULT_CODE_TIMEOUT);
+    restart(&flash);
+    
+    const fault_state_t *fault = sys_fault_get();
+    CHECK_EQUAL(2, fault->total_count);
+    CHECK_EQUAL(FAULT_CODE_TIMEOUT, fault_manager_get_most_recent());
+    CHECK_EQUAL(4200U, fault->most_recent_time_ms);
+    CHECK_FALSE(fault_manager_is_active(FAULT_CODE_TIMEOUT)); /* Only history */
+    
+    bool found = false;
+    for (uint32_t i = 0; i < event_log_count(); i++) {
+        event_log_entry_t entry;
+        event_log_get(i, &entry);
+        found = found || (entry.type == EVENT_FAULT_SET &&
+                          entry.data[1] == FAULT_CODE_DOOR_MOTOR);
+    }
+    CHECK_TRUE(found);
+}
+
+TEST(BcmStore, WritesWholePagesFromTheSlowTask)
+{
+    uint32_t now_ms = 0;
+    ram_dev.programs = 0;
+    
+    add_events(TEST_PER_PAGE - 2U, 0); /* + the boot event */
+    run_1000ms(&now_ms);
+    CHECK_EQUAL(0U, ram_dev.programs); /* Partial page waits */
+    
+    add_events(TEST_PER_PAGE + 2U, 100);
+    CHECK_EQUAL(0U, ram_dev.programs); /* Not per event */
+    run_1000ms(&now_ms);
+    CHECK_EQUAL(2U, ram_dev.programs);
+    
+    bcm_store_stats_t stats;
+    bcm_store_get_stats(&stats);
+    CHECK_EQUAL(1U, stats.staged); /* Two full pages went out */
+    CHECK_EQUAL(0U, stats.records_dropped);
+}
+
+TEST(BcmStore, PartialPageWrittenAfterFlushAge)
+{
+    uint32_t now_ms = 0;
+    ram_dev.programs = 0;
+    add_events(3, 0);
+    
+    while (now_ms < BCM_STORE_FLUSH_AGE_MS - 1000U) {
+        run_1000ms(&now_ms);
+    }
+    CHECK_EQUAL(0U, ram_dev.programs);
+    run_1000ms(&now_ms);
+    CHECK_EQUAL(1U, ram_dev.programs);
+    
+    bcm_store_stats_t stats;
+    bcm_store_get_stats(&stats);
+    CHECK_EQUAL(0U, stats.staged);
+}
+
+TEST(BcmStore, CommandEventsAreNotStored)
+{
+    uint8_t data[4] = { 0, 0, 0, 0 };
+    bcm_store_stats_t before;
+    bcm_store_get_stats(&before);
+    event_log_add(EVENT_CMD_RECEIVED, data);
+    
+    bcm_store_stats_t after;
+    bcm_store_get_stats(&after);
+    CHECK_EQUAL(before.staged, after.staged);
+}
+
+TEST(BcmStore, RestoresNewestEventsOnly)
+{
+    add_events(200, 0);
+    restart(&flash);
+    
+    CHECK_EQUAL(199U, newest_door_event());
+    CHECK_EQUAL(BCM_STORE_RESTORE_EVENTS + 1U, event_log_count()); /* + this boot */
+}
+
+TEST(BcmStore, WearIsEvenAcrossLaps)
+{
+    for (uint32_t i = 0; i < 3U * 16U; i++) {
+        add_events(TEST_PER_PAGE, i * TEST_PER_PAGE);
+        CHECK_EQUAL(0, bcm_store_sync());
+    }
+    
+    uint32_t lo = 0xFFFFFFFFU;
+    uint32_t hi = 0;
+    for (uint32_t erases : ram_dev.erases) {
+        lo = (erases < lo) ? erases : lo;
+        hi = (erases > hi) ? erases : hi;
+    }
+    CHECK_TRUE(hi - lo <= 1U);
+    CHECK_TRUE(lo >= 3U);
+}
+
+TEST(BcmStore, TornNewestPageIsSkipped)
+{
+    add_events(TEST_PER_PAGE, 0);
+    CHECK_EQUAL(0, bcm_store_sync());
+    sys_state_update_time(900);
+    fault_manager_set(FAULT_CODE_HEADLIGHT_BULB);
+    add_events(3, 500);
+    bcm_deinit();
+    bcm_store_close();
+    
+    /* Power lost mid-program: the newest page reads back damaged */
+    size_t newest = 0;
+    for (size_t page = 0; page < ram_dev.programmed.size(); page++) {
+        if (ram_dev.programmed[page]) {
+            newest = page;
+        }
+    }
+    ram_dev.data[newest * TEST_PAGE_SIZE + TEST_PAGE_SIZE - 1U] ^= 0x5AU;
+    
+    CHECK_EQUAL(0, bcm_store_open(&flash));
+    bcm_init(NULL);
+    CHECK_EQUAL(TEST_PER_PAGE - 1U, newest_door_event());
+    CHECK_EQUAL(0, sys_fault_get()->total_count);
+}
+
+TEST(BcmStore, OtherInstancesAreIgnored)
+{
+    fault_manager_set(FAULT_CODE_DOOR_MOTOR);
+    bcm_store_stats_t before;
+    bcm_store_get_stats(&before);
+    
+    /* The default instance owns the store: b restores and stages nothing */
+    bcm_ctx_t *b = bcm_ctx_create();
+    CHECK_TRUE(b != NULL);
+    CHECK_EQUAL(0, bcm_ctx_init(b, NULL));
+    bcm_ctx_t *prev = bcm_ctx_bind(b);
+    CHECK_EQUAL(1U, event_log_count()); /* Only b's own boot event */
+    add_events(10, 0);
+    fault_manager_set(FAULT_CODE_TIMEOUT);
+    (void)bcm_ctx_bind(prev);
+    bcm_ctx_destroy(b);
+    
+    bcm_store_stats_t after;
+    bcm_store_get_stats(&after);
+    CHECK_EQUAL(before.staged, after.staged);
+    
+    /* b's shutdown left the store with its owner */
+    add_events(1, 7);
+    bcm_store_get_stats(&after);
+    CHECK_EQUAL(before.staged + 1U, after.staged);
+    
+    restart(&flash);
+    CHECK_EQUAL(1, sys_fault_get()->total_count);
+    CHECK_EQUAL(FAULT_CODE_DOOR_MOTOR, fault_manager_get_most_recent());
+    CHECK_EQUAL(7U, newest_door_event());
+}
+
+/*******************************************************************************
+ * Test Group: Mount
+ ******************************************************************************/
+
+TEST_GROUP(BcmStoreMount)
+{
+    bcm_flash_t flash;
+    ram_flash_t ram_dev;
+    
+    void teardown() override
+    {
+        bcm_deinit();
+        bcm_store_close();
+    }
+    
+    /** Fill pages_written pages (one event each) on a fresh store of page_count pages */
+    void fill(uint32_t page_count, uint32_t pages_written)
+    {
+        ram_init(&flash, &ram_dev, page_count);
+        CHECK_EQUAL(0, bcm_store_open(&flash));
+        bcm_init(NULL);
+        for (uint32_t i = 0; i < pages_written; i++) {
+            add_events(1, i);
+            CHECK_EQUAL(0, bcm_store_sync());
+        }
+        bcm_deinit();
+        bcm_store_close();
+    }
+};
+
+TEST(BcmStoreMount, BootReadsLogarithmicPages)
+{
+    fill(1024U, 700U);
+    
+    CHECK_EQUAL(0, bcm_store_open(&flash));
+    
+    bcm_store_stats_t stats;
+    bcm_store_get_stats(&stats);
+    CHECK_TRUE(stats.pages_read <= 10U + 2U); /* log2(1024) + first and newest */
+    
+    bcm_init(NULL);
+    CHECK_EQUAL(699U, newest_door_event());
+}
+
+TEST(BcmStoreMount, FindsNewestPageAfterWraparound)
+{
+    for (uint32_t written = 60U; written <= 70U; written++) {
+        fill(32U, written);
+        CHECK_EQUAL(0, bcm_store_open(&flash));
+        bcm_init(NULL);
+        CHECK_EQUAL(written - 1U, newest_door_event());
+        bcm_deinit();
+        bcm_store_close();
+    }
+}
+
+TEST(BcmStoreMount, ErasedFirstPageAfterFullLap)
+{
+    fill(8U, 8U);
+    
+    /* Power lost between erasing page 0 and programming it */
+    memset(ram_dev.data.data(), 0xFF, TEST_PAGE_SIZE);
+    CHECK_EQUAL(0, bcm_store_open(&flash));
+    bcm_init(NULL);
+    CHECK_EQUAL(7U, newest_door_event());
+}
+
+#if BCM_FEATURE_FLASH_FILE
+
+/*******************************************************************************
+ * Test Group: File Backend
+ ******************************************************************************/
+
+TEST_GROUP(BcmStoreFile)
+{
+    char path[64];
+    bcm_flash_t flash;
+    
+    void setup() override
+    {
+        snprintf(path, sizeof(path), "/tmp/bcm_store_test_XXXXXX");
+        int fd = mkstemp(path);
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    
+    void teardown() override
+    {
+        bcm_deinit();
+        bcm_store_close();
+        bcm_flash_file_close(&flash);
+        unlink(path);
+    }
+};
+
+TEST(BcmStoreFile, HistorySurvivesReopen)
+{
+    CHECK_EQUAL(0, bcm_flash_file_open(&flash, path, 0, 0));
+    CHECK_EQUAL(BCM_STORE_FILE_PAGE_SIZE, flash.page_size);
+    CHECK_EQUAL(0, bcm_store_open(&flash));
+    bcm_init(NULL);
+    fault_manager_set(FAULT_CODE_TURN_BULB);
+    add_events(10, 40);
+    bcm_deinit();
+    bcm_store_close();
+    bcm_flash_file_close(&flash);
+    
+    CHECK_EQUAL(0, bcm_flash_file_open(&flash, path, 0, 0));
+    CHECK_EQUAL(0, bcm_store_open(&flash));
+    bcm_init(NULL);
+    CHECK_EQUAL(1, sys_fault_get()->total_count);
+    CHECK_EQUAL(FAULT_CODE_TURN_BULB, fault_manager_get_most_recent());
+    CHECK_EQUAL(49U, newest_door_event());
+}
+
+#endif /* BCM_FEATURE_FLASH_FILE */
@@ -0,0 +1,162 @@
+/**
+ * @file test_bcm_timing.cpp
+ * @brief Unit tests for task execution time instrumentation
+ *
+ * Tests:
+ * - Time code encoding and bucket floors
+ * - Statistics and percentiles (BCM_TASK_TIMING builds)
+ * - BCM_TIMING frames from the 1000ms task (BCM_TASK_TIMING builds)
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C" {
+#include "bcm.h"
+#include "bcm_timing.h"
+#include "door_control.h"
+#include "can_interface.h"
+#include "can_ids.h"
+#include "bcm_config.h"
+}
+
+/*******************************************************************************
+ * Test Group: Time Codes
+ ******************************************************************************/
+
+TEST_GROUP(TimingCodes)
+{
+};
+
+TEST(TimingCodes, SmallValuesAreExact)
+{
+    for (uint8_t ns = 0; ns < 8U; ns++) {
+        CHECK_EQUAL(ns, bcm_timing_decode(bcm_timing_encode(ns)));
+    }
+}
+
+TEST(TimingCodes, FloorWithinQuarter)
+{
+    const uint32_t values[] = { 9U, 1000U, 12345U, 999999U, 50000000U, UINT32_MAX };
+    for (uint32_t v : values) {
+        uint32_t floor = bcm_timing_decode(bcm_timing_encode(v));
+        CHECK_TRUE(floor <= v);
+        CHECK_TRUE(v - floor <= v / 4U);
+    }
+}
+
+TEST(TimingCodes, CodesAreMonotonic)
+{
+    for (uint8_t c = 1; c < 124U; c++) {
+        CHECK_TRUE(bcm_timing_decode(c) > bcm_timing_decode((uint8_t)(c - 1U)));
+        CHECK_EQUAL(c, bcm_timing_encode(bcm_timing_decode(c)));
+    }
+    CHECK_EQUAL(UINT32_MAX, bcm_timing_decode(124));
+}
+
+#if BCM_FEATURE_TASK_TIMING
+
+/*******************************************************************************
+ * Test Group: Statistics
+ ******************************************************************************/
+
+TEST_GROUP(TimingStats)
+{
+    void setup() override
+    {
+        bcm_init(NULL);
+    }
+    
+    void teardown() override
+    {
+        bcm_deinit();
+    }
+};
+
+TEST(TimingStats, RecordsMinMaxMean)
+{
+    bcm_timing_record(BCM_TASK_100MS, 1000);
+    bcm_timing_record(BCM_TASK_100MS, 3000);
+    
+    bcm_timing_stats_t stats;
+    CHECK_TRUE(bcm_timing_get(BCM_TASK_100MS, &stats));
+    CHECK_EQUAL(2U, stats.runs);
+    CHECK_EQUAL(1000U, stats.min_ns);
+    CHECK_EQUAL(3000U, stats.max_ns);
+    CHECK_EQUAL(2000U, bcm_timing_mean_ns(BCM_TASK_100MS));
+    CHECK_FALSE(bcm_timing_get(BCM_TIMING_SLOT_COUNT, &stats));
+}
+
+TEST(TimingStats, PercentilesFromHistogram)
+{
+    for (int i = 0; i < 99; i++) {
+        bcm_timing_record(BCM_TIMING_RX_DRAIN, 100);
+    }
+    bcm_timing_record(BCM_TIMING_RX_DRAIN, 100000);
+    
+    uint32_t p50 = bcm_timing_percentile_ns(BCM_TIMING_RX_DRAIN, 50);
+    uint32_t p100 = bcm_timing_percentile_ns(BCM_TIMING_RX_DRAIN, 100);
+    CHECK_TRUE(p50 <= 100U && p50 > 75U);
+    CHECK_TRUE(p100 <= 100000U && p100 > 75000U);
+    CHECK_EQUAL(p50, bcm_timing_percentile_ns(BCM_TIMING_RX_DRAIN, 99));
+}
+
+TEST(TimingStats, ProcessTimesTasksAndRxDrain)
+{
+    /* Door transitions keep the 10ms task due in tickless builds too */
+    door_control_lock_all();
+    bcm_process(0);
+    door_control_unlock_all();
+    bcm_process(BCM_MAIN_CYCLE_TIME_MS);
+    
+    bcm_timing_stats_t stats;
+    CHECK_TRUE(bcm_timing_get(BCM_TASK_10MS, &stats));
+    CHECK_EQUAL(2U, stats.runs);
+    CHECK_TRUE(bcm_timing_get(BCM_TIMING_RX_DRAIN, &stats));
+    CHECK_EQUAL(2U, stats.runs);
+    CHECK_TRUE(bcm_timing_get(BCM_TASK_1000MS, &stats));
+    CHECK_EQUAL(1U, stats.runs); /* First run due at SCHED_OFFSET_HEARTBEAT_MS */
+}
+
+TEST(TimingStats, HeartbeatTaskSendsOneFramePerSlot)
+{
+    can_frame_t frames[CAN_TX_QUEUE_SIZE];
+    for (uint32_t t = 0; t < 1000U; t++) {
+        bcm_process(t);
+        (void)can_stub_drain_tx(frames, CAN_TX_QUEUE_SIZE);
+    }
+    
+    /* Tick 1000 skipped: only the 10ms task runs late (unless tickless
+     * deferred it), second report at 1006 */
+    for (uint32_t t = 1001; t < 1000U + SCHED_OFFSET_HEARTBEAT_MS; t++) {
+        bcm_process(t);
+    }
+    (void)can_stub_drain_tx(frames, CAN_TX_QUEUE_SIZE);
+    bcm_process(1000U + SCHED_OFFSET_HEARTBEAT_MS);
+    
+    uint8_t n = can_stub_drain_tx(frames, CAN_TX_QUEUE_SIZE);
+    uint8_t slot = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        const can_frame_t *f = &frames[i];
+        if (f->id != CAN_ID_BCM_TIMING) {
+            continue;
+        }
+        
+        uint8_t checksum = CAN_CHECKSUM_SEED;
+        for (uint8_t b = 0; b < TIMING_BYTE_CHECKSUM; b++) {
+            checksum ^= f->data[b];
+        }
+        CHECK_EQUAL(BCM_TIMING_DLC, f->dlc);
+        CHECK_EQUAL(checksum, f->data[TIMING_BYTE_CHECKSUM]);
+        CHECK_EQUAL(slot, f->data[TIMING_BYTE_SLOT]);
+        CHECK_EQUAL(BCM_TIMING_SLOT_COUNT + slot,
+                    CAN_GET_COUNTER(f->data[TIMING_BYTE_VER_CTR]));
+        CHECK_EQUAL((slot == BCM_TASK_10MS && !BCM_FEATURE_TICKLESS) ? 1 : 0,
+                    f->data[TIMING_BYTE_LATE]);
+        CHECK_TRUE(f->data[TIMING_BYTE_P50] <= f->data[TIMING_BYTE_P99]);
+        CHECK_TRUE(f->data[TIMING_BYTE_P99] <= f->data[TIMING_BYTE_MAX]);
+        slot++;
+    }
+    CHECK_EQUAL(BCM_TIMING_SLOT_COUNT, slot);
+}
+
+#endif /* BCM_FEATURE_TASK_TIMING */
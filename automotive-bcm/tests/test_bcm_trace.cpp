@@ -0,0 +1,269 @@
+/**
+ * @file test_bcm_trace.cpp
+ * @brief Unit tests for the binary trace ring
+ *
+ * Tests:
+ * - File header and capacity rounding
+ * - RX records carry the handler result
+ * - TX and event records
+ * - TX records only for frames that left the scheduler
+ * - Ring wraparound keeps the newest records
+ * (file tests in BCM_TRACE builds; otherwise the calls are no-ops)
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+extern "C" {
+#include "bcm.h"
+#include "bcm_trace.h"
+#include "door_control.h"
+#include "system_state.h"
+#include "can_interface.h"
+#include "can_ids.h"
+#include "bcm_config.h"
+}
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static can_frame_t build_door_cmd(uint8_t cmd, uint8_t counter)
+{
+    can_frame_t frame;
+    can_frame_template_init(&frame, CAN_ID_DOOR_CMD, DOOR_CMD_DLC, CAN_CHECKSUM_SEED);
+    can_frame_put(&frame, 0, cmd);
+    can_frame_put(&frame, 1, DOOR_ID_ALL);
+    can_frame_put(&frame, 2, CAN_BUILD_VER_CTR(CAN_SCHEMA_VERSION, counter));
+    return frame;
+}
+
+#if BCM_FEATURE_TRACE
+
+/** Read back the whole file: header plus every record slot */
+static bool load_trace(const char *path, bcm_trace_header_t *header,
+                       std::vector<bcm_trace_record_t> *records)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    
+    bool ok = fread(header, sizeof(*header), 1, f) == 1;
+    if (ok) {
+        records->resize(header->capacity);
+        ok = fread(records->data(), sizeof(bcm_trace_record_t), header->capacity, f) ==
+             header->capacity;
+    }
+    fclose(f);
+    return ok;
+}
+
+/** Find the first record of a kind/id, oldest first (ring not wrapped) */
+static const bcm_trace_record_t *find_record(const std::vector<bcm_trace_record_t> &records,
+                                             uint64_t written, uint8_t kind, uint32_t id)
+{
+    for (uint64_t i = 0; i < written && i < records.size(); i++) {
+        if (records[i].kind == kind && records[i].id == id) {
+            return &records[i];
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ * Test Group: Trace
+ ******************************************************************************/
+
+TEST_GROUP(BcmTrace)
+{
+    char path[64];
+    
+    void setup()
+    {
+        snprintf(path, sizeof(path), "/tmp/bcm_trace_test_XXXXXX");
+        int fd = mkstemp(path);
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    
+    void teardown()
+    {
+        bcm_trace_close();
+        bcm_deinit();
+        unlink(path);
+    }
+};
+
+TEST(BcmTrace, HeaderDescribesRing)
+{
+    CHECK_EQUAL(0, bcm_trace_open(path, 100));
+    CHECK_TRUE(bcm_trace_is_open());
+    CHECK_EQUAL(-1, bcm_trace_open(path, 100));
+    bcm_trace_close();
+    CHECK_FALSE(bcm_trace_is_open());
+    
+    bcm_trace_header_t header;
+    std::vector<bcm_trace_record_t> records;
+    CHECK_TRUE(load_trace(path, &header, &records));
+    CHECK_EQUAL(BCM_TRACE_MAGIC, header.magic);
+    CHECK_EQUAL(BCM_TRACE_VERSION, header.version);
+    CHECK_EQUAL(sizeof(bcm_trace_record_t), header.record_size);
+    CHECK_EQUAL(128U, header.capacity);
+    CHECK_EQUAL(0U, header.written);
+}
+
+TEST(BcmTrace, RecordsRxResultTxAndEvents)
+{
+    CHECK_EQUAL(0, bcm_trace_open(path, 1024));
+    bcm_init(NULL);
+    
+    can_frame_t good = build_door_cmd(DOOR_CMD_LOCK_ALL, 0);
+    can_frame_t bad = build_door_cmd(DOOR_CMD_UNLOCK_ALL, 1);
+    bad.data[3] ^= 0x5A; /* Corrupt the checksum */
+    can_stub_inject_rx(&good);
+    can_stub_inject_rx(&bad);
+    
+    /* Run past the first status and heartbeat deadlines */
+    for (uint32_t t = 0; t <= BCM_HEARTBEAT_PERIOD_MS; t += 10U) {
+        bcm_process(t);
+    }
+    bcm_trace_close();
+    
+    bcm_trace_header_t header;
+    std::vector<bcm_trace_record_t> records;
+    CHECK_TRUE(load_trace(path, &header, &records));
+    CHECK_TRUE(header.written > 4U);
+    
+    /* Both commands, each with the result its handler returned */
+    const bcm_trace_record_t *rx = NULL;
+    int rx_seen = 0;
+    for (uint64_t i = 0; i < header.written; i++) {
+        if (records[i].kind == BCM_TRACE_RX) {
+            rx = &records[i];
+            CHECK_EQUAL(CAN_ID_DOOR_CMD, rx->id);
+            CHECK_EQUAL(DOOR_CMD_DLC, rx->dlc);
+            CHECK_EQUAL(rx_seen == 0 ? CMD_RESULT_OK : CMD_RESULT_CHECKSUM_ERROR, rx->result);
+            rx_seen++;
+        }
+    }
+    CHECK_EQUAL(2, rx_seen);
+    
+#if !BCM_FEATURE_CAN_FD /* The CAN FD aggregate frame is not traced */
+    const bcm_trace_record_t *tx = find_record(records, header.written,
+                                               BCM_TRACE_TX, CAN_ID_BCM_HEARTBEAT);
+    CHECK_TRUE(tx != NULL);
+    CHECK_EQUAL(BCM_TRACE_RESULT_NONE, tx->result);
+    CHECK_EQUAL(BCM_HEARTBEAT_DLC, tx->dlc);
+#endif
+    
+    const bcm_trace_record_t *ev = find_record(records, header.written,
+                                               BCM_TRACE_EVENT, EVENT_CMD_ERROR);
+    CHECK_TRUE(ev != NULL);
+    CHECK_EQUAL(CMD_RESULT_CHECKSUM_ERROR, ev->data[0]);
+    
+    /* Sequence numbers are dense and 1-based */
+    for (uint64_t i = 0; i < header.written; i++) {
+        CHECK_EQUAL(i + 1U, records[i].seq);
+    }
+}
+
+TEST(BcmTrace, TxRecordsMatchFramesSent)
+{
+    CHECK_EQUAL(0, bcm_trace_open(path, 1024));
+    bcm_init(NULL);
+    can_stub_clear();
+    can_reset_stats();
+    
+    /* Fill the TX queue so the status frames below wait in the scheduler */
+    can_frame_t fill[CAN_TX_QUEUE_SIZE];
+    for (uint32_t i = 0; i < CAN_TX_QUEUE_SIZE; i++) {
+        can_frame_template_init(&fill[i], 0x100U + i, 1, 0);
+    }
+    CHECK_EQUAL(CAN_STATUS_OK, can_send_batch(fill, CAN_TX_QUEUE_SIZE, NULL));
+    
+    /* The second copy replaces the first before either goes out */
+    can_frame_t status;
+    can_frame_template_init(&status, CAN_ID_LIGHTING_STATUS, 2, 0);
+    can_frame_put(&status, 0, 1);
+    CHECK_EQUAL(CAN_STATUS_OK, can_send(&status));
+    can_frame_put(&status, 0, 2);
+    CHECK_EQUAL(CAN_STATUS_OK, can_send(&status));
+    CHECK_EQUAL(1, can_tx_pending());
+    
+    can_frame_t out[CAN_TX_QUEUE_SIZE];
+    can_stub_drain_tx(out, CAN_TX_QUEUE_SIZE);
+    CHECK_EQUAL(CAN_STATUS_OK, can_tx_service());
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    bcm_trace_close();
+    
+    bcm_trace_header_t header;
+    std::vector<bcm_trace_record_t> records;
+    CHECK_TRUE(load_trace(path, &header, &records));
+    
+    uint32_t tx_seen = 0;
+    uint32_t status_seen = 0;
+    for (uint64_t i = 0; i < header.written; i++) {
+        if (records[i].kind != BCM_TRACE_TX) {
+            continue;
+        }
+        tx_seen++;
+        if (records[i].id == CAN_ID_LIGHTING_STATUS) {
+            CHECK_EQUAL(2, records[i].data[0]);
+            status_seen++;
+        }
+    }
+    CHECK_EQUAL(1U, status_seen);
+    CHECK_EQUAL(CAN_TX_QUEUE_SIZE + 1U, tx_seen);
+    CHECK_EQUAL(stats.tx_count, tx_seen);
+}
+
+TEST(BcmTrace, WrapKeepsNewestRecords)
+{
+    CHECK_EQUAL(0, bcm_trace_open(path, 16));
+    
+    uint8_t data[4] = { 0, 0, 0, 0 };
+    for (uint8_t i = 0; i < 40U; i++) {
+        data[0] = i;
+        bcm_trace_event((uint8_t)EVENT_STATE_CHANGE, data);
+    }
+    bcm_trace_close();
+    
+    bcm_trace_header_t header;
+    std::vector<bcm_trace_record_t> records;
+    CHECK_TRUE(load_trace(path, &header, &records));
+    CHECK_EQUAL(16U, header.capacity);
+    CHECK_EQUAL(40U, header.written);
+    
+    /* Oldest survivor is record 24 at slot 40 % 16 */
+    for (uint32_t n = 0; n < 16U; n++) {
+        const bcm_trace_record_t &rec = records[(40U + n) % 16U];
+        CHECK_EQUAL(25U + n, rec.seq);
+        CHECK_EQUAL(24U + n, rec.data[0]);
+    }
+}
+
+#endif /* BCM_FEATURE_TRACE */
+
+/*******************************************************************************
+ * Test Group: Trace Disabled
+ ******************************************************************************/
+
+TEST_GROUP(BcmTraceOff)
+{
+};
+
+TEST(BcmTraceOff, ClosedTraceIgnoresRecords)
+{
+    can_frame_t frame = build_door_cmd(DOOR_CMD_LOCK_ALL, 0);
+    bcm_trace_frame(BCM_TRACE_TX, &frame, BCM_TRACE_RESULT_NONE);
+    bcm_trace_event((uint8_t)EVENT_STATE_CHANGE, NULL);
+    CHECK_FALSE(bcm_trace_is_open());
+}
@@ -0,0 +1,145 @@
+/**
+ * @file test_can_check.cpp
+ * @brief Unit tests for the shared RX frame validation kernel
+ *
+ * Tests:
+ * - Word-wide checksum matches the byte-wise checksum
+ * - Per-frame batch result bitmask
+ * - Counter sequencing across a batch
+ * - Descriptor field rules
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C" {
+#include "can_check.h"
+#include "can_ids.h"
+}
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static const can_field_rule_t g_test_fields[] = {
+    { 0, 0xFFU, 1U, 4U },
+};
+
+static const can_msg_desc_t g_test_desc = { 4U, 2U, 1U, g_test_fields };
+
+static can_frame_t build_frame(uint8_t value, uint8_t counter)
+{
+    can_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.id = 0x100;
+    frame.dlc = 4;
+    frame.data[0] = value;
+    frame.data[2] = CAN_BUILD_VER_CTR(CAN_SCHEMA_VERSION, counter);
+    frame.data[3] = can_calculate_checksum(frame.data, 3);
+    return frame;
+}
+
+/*******************************************************************************
+ * Test Group: Checksums
+ ******************************************************************************/
+
+TEST_GROUP(CanCheckChecksum)
+{
+};
+
+TEST(CanCheckChecksum, MatchesBytewiseForEveryDlc)
+{
+    for (uint8_t dlc = 1; dlc <= CAN_FRAME_MAX_DLC; dlc++) {
+        can_frame_t frame;
+        memset(&frame, 0, sizeof(frame));
+        frame.dlc = dlc;
+        for (uint8_t i = 0; i < CAN_FRAME_MAX_DLC; i++) {
+            frame.data[i] = (uint8_t)(0x37U * (i + 1U) + dlc);
+        }
+        frame.data[dlc - 1] = can_calculate_checksum(frame.data, (uint8_t)(dlc - 1));
+        
+        CHECK_EQUAL(0, can_check_checksums(&frame, 1));
+        
+        frame.data[0] ^= 0x01U;
+        CHECK_EQUAL(1, can_check_checksums(&frame, 1));
+    }
+}
+
+TEST(CanCheckChecksum, BatchMaskMarksBadFrames)
+{
+    can_frame_t frames[CAN_BATCH_MAX];
+    for (uint8_t i = 0; i < CAN_BATCH_MAX; i++) {
+        frames[i] = build_frame(1, i);
+    }
+    frames[3].data[3] ^= 0x55U;
+    frames[15].data[1] = 0x01U;
+    
+    CHECK_EQUAL((1U << 3) | (1U << 15), can_check_checksums(frames, CAN_BATCH_MAX));
+}
+
+/*******************************************************************************
+ * Test Group: Batch Validation
+ ******************************************************************************/
+
+TEST_GROUP(CanCheckBatch)
+{
+    can_rx_counter_t counter;
+    
+    void setup() override
+    {
+        counter.last = 0;
+        counter.seen = 0;
+    }
+};
+
+TEST(CanCheckBatch, FirstCounterAccepted)
+{
+    can_frame_t frame = build_frame(1, 9);
+    CHECK_EQUAL(CAN_CHECK_OK, can_check_frame(&g_test_desc, &frame, &counter));
+    CHECK_EQUAL(9, counter.last);
+}
+
+TEST(CanCheckBatch, CounterAdvancesAcrossBatch)
+{
+    can_frame_t frames[4] = {
+        build_frame(1, 14), build_frame(2, 15), build_frame(3, 0), build_frame(4, 2)
+    };
+    uint8_t flags[4];
+    
+    CHECK_EQUAL(1U << 3, can_check_batch(&g_test_desc, frames, 4, &counter, flags));
+    CHECK_EQUAL(CAN_CHECK_OK, flags[2]);
+    CHECK_EQUAL(CAN_CHECK_BAD_COUNTER, flags[3]);
+    CHECK_EQUAL(0, counter.last);
+}
+
+TEST(CanCheckBatch, BadChecksumDoesNotAdvanceCounter)
+{
+    can_frame_t frames[2] = { build_frame(1, 5), build_frame(1, 6) };
+    frames[1].data[3] ^= 0xFFU;
+    uint8_t flags[2];
+    
+    can_check_batch(&g_test_desc, frames, 2, &counter, flags);
+    CHECK_EQUAL(CAN_CHECK_BAD_CHECKSUM, flags[1]);
+    CHECK_EQUAL(5, counter.last);
+}
+
+TEST(CanCheckBatch, DlcAndFieldFlags)
+{
+    can_frame_t frames[3] = { build_frame(0, 1), build_frame(5, 2), build_frame(2, 3) };
+    frames[2].dlc = 3;
+    uint8_t flags[3];
+    
+    CHECK_EQUAL(0x7U, can_check_batch(&g_test_desc, frames, 3, NULL, flags));
+    CHECK_EQUAL(CAN_CHECK_BAD_FIELD, flags[0]);
+    CHECK_EQUAL(CAN_CHECK_BAD_FIELD, flags[1]);
+    CHECK_EQUAL(CAN_CHECK_BAD_DLC, flags[2]);
+}
+
+TEST(CanCheckBatch, ResultMappingFollowsCheckOrder)
+{
+    CHECK_EQUAL(CMD_RESULT_OK, can_check_to_result(CAN_CHECK_OK));
+    CHECK_EQUAL(CMD_RESULT_INVALID_CMD, can_check_to_result(CAN_CHECK_BAD_DLC));
+    CHECK_EQUAL(CMD_RESULT_CHECKSUM_ERROR, can_check_to_result(CAN_CHECK_BAD_CHECKSUM));
+    CHECK_EQUAL(CMD_RESULT_COUNTER_ERROR,
+                can_check_to_result(CAN_CHECK_BAD_COUNTER | CAN_CHECK_BAD_FIELD));
+    CHECK_EQUAL(CMD_RESULT_INVALID_CMD, can_check_to_result(CAN_CHECK_BAD_FIELD));
+}
@@ -0,0 +1,683 @@
+/**
+ * @file test_can_interface.cpp
+ * @brief Unit tests for the stub CAN interface queues
+ *
+ * Tests:
+ * - FIFO order across ring wraparound
+ * - Full queue behavior (single and bulk inject)
+ * - Batched receive
+ * - Concurrent producer thread
+ * - TX scheduler: backpressure, ID priority, status coalescing
+ * - Drop, per-ID and bus load statistics
+ * - CAN FD lengths, bit estimate and stub FD TX queue
+ * - Multiple buses: interface list, TX routing, per-bus queues and stats
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <thread>
+
+extern "C" {
+#include "can_interface.h"
+#include "can_ids.h"
+#include "system_state.h"
+#include "bcm_config.h"
+}
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static can_frame_t make_frame(uint32_t seq)
+{
+    can_frame_t frame;
+    frame.id = seq & 0x7FFU;
+    frame.dlc = 4;
+    frame.data[0] = (uint8_t)(seq >> 24);
+    frame.data[1] = (uint8_t)(seq >> 16);
+    frame.data[2] = (uint8_t)(seq >> 8);
+    frame.data[3] = (uint8_t)seq;
+    for (uint8_t i = 4; i < CAN_FRAME_MAX_DLC; i++) {
+        frame.data[i] = 0;
+    }
+    return frame;
+}
+
+static uint32_t frame_seq(const can_frame_t *frame)
+{
+    return ((uint32_t)frame->data[0] << 24) | ((uint32_t)frame->data[1] << 16) |
+           ((uint32_t)frame->data[2] << 8) | (uint32_t)frame->data[3];
+}
+
+/*******************************************************************************
+ * Test Group: Stub Queues
+ ******************************************************************************/
+
+TEST_GROUP(CanStubQueue)
+{
+    void setup() override
+    {
+        can_init(NULL);
+        can_stub_clear();
+    }
+    
+    void teardown() override
+    {
+        can_deinit();
+    }
+};
+
+TEST(CanStubQueue, FifoAcrossWraparound)
+{
+    can_frame_t frame;
+    uint32_t next_in = 0;
+    uint32_t next_out = 0;
+    
+    /* Keep the ring half full long enough to wrap several times */
+    for (uint32_t round = 0; round < 4U * CAN_RX_QUEUE_SIZE; round++) {
+        while (next_in - next_out < CAN_RX_QUEUE_SIZE / 2U) {
+            can_frame_t in = make_frame(next_in++);
+            CHECK_EQUAL(CAN_STATUS_OK, can_stub_inject_rx(&in));
+        }
+        CHECK_EQUAL(CAN_STATUS_OK, can_recv(&frame));
+        CHECK_EQUAL(next_out++, frame_seq(&frame));
+    }
+}
+
+TEST(CanStubQueue, InjectFailsWhenFull)
+{
+    for (uint32_t i = 0; i < CAN_RX_QUEUE_SIZE; i++) {
+        can_frame_t in = make_frame(i);
+        CHECK_EQUAL(CAN_STATUS_OK, can_stub_inject_rx(&in));
+    }
+    
+    can_frame_t extra = make_frame(CAN_RX_QUEUE_SIZE);
+    CHECK_EQUAL(CAN_STATUS_BUFFER_FULL, can_stub_inject_rx(&extra));
+    CHECK_EQUAL(CAN_STATUS_OK, can_rx_poll());
+}
+
+TEST(CanStubQueue, BulkInjectIsPartialWhenFull)
+{
+    can_frame_t frames[CAN_RX_QUEUE_SIZE];
+    for (uint32_t i = 0; i < CAN_RX_QUEUE_SIZE; i++) {
+        frames[i] = make_frame(i);
+    }
+    
+    uint8_t injected = 0;
+    CHECK_EQUAL(CAN_STATUS_OK, can_stub_inject_rx_batch(frames, 10, &injected));
+    CHECK_EQUAL(10, injected);
+    
+    CHECK_EQUAL(CAN_STATUS_BUFFER_FULL,
+                can_stub_inject_rx_batch(frames, CAN_RX_QUEUE_SIZE, &injected));
+    CHECK_EQUAL(CAN_RX_QUEUE_SIZE - 10U, injected);
+}
+
+TEST(CanStubQueue, RecvBatchDrainsInOrder)
+{
+    can_frame_t frames[CAN_BATCH_MAX];
+    for (uint32_t i = 0; i < 5U; i++) {
+        frames[i] = make_frame(100U + i);
+    }
+    can_stub_inject_rx_batch(frames, 5, NULL);
+    
+    uint8_t count = 0;
+    CHECK_EQUAL(CAN_STATUS_OK, can_recv_batch(frames, CAN_BATCH_MAX, &count));
+    CHECK_EQUAL(5, count);
+    for (uint32_t i = 0; i < 5U; i++) {
+        CHECK_EQUAL(100U + i, frame_seq(&frames[i]));
+    }
+    
+    CHECK_EQUAL(CAN_STATUS_NO_DATA, can_recv_batch(frames, CAN_BATCH_MAX, &count));
+    CHECK_EQUAL(0, count);
+}
+
+TEST(CanStubQueue, DrainTxReturnsSentFramesInOrder)
+{
+    for (uint32_t i = 0; i < 3U; i++) {
+        can_frame_t frame = make_frame(200U + i);
+        CHECK_EQUAL(CAN_STATUS_OK, can_send(&frame));
+    }
+    
+    can_frame_t frames[CAN_BATCH_MAX];
+    CHECK_EQUAL(2, can_stub_drain_tx(frames, 2));
+    CHECK_EQUAL(200U, frame_seq(&frames[0]));
+    CHECK_EQUAL(201U, frame_seq(&frames[1]));
+    CHECK_EQUAL(1, can_stub_drain_tx(frames, CAN_BATCH_MAX));
+    CHECK_EQUAL(202U, frame_seq(&frames[0]));
+    CHECK_EQUAL(0, can_stub_drain_tx(frames, CAN_BATCH_MAX));
+}
+
+TEST(CanStubQueue, ConcurrentProducerKeepsOrder)
+{
+    const uint32_t total = 20000U;
+    
+    std::thread producer([total]() {
+        for (uint32_t seq = 0; seq < total; ) {
+            can_frame_t frame = make_frame(seq);
+            if (can_stub_inject_rx(&frame) == CAN_STATUS_OK) {
+                seq++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    
+    can_frame_t frames[CAN_BATCH_MAX];
+    uint32_t expected = 0;
+    bool in_order = true;
+    while (expected < total) {
+        uint8_t count = 0;
+        if (can_recv_batch(frames, CAN_BATCH_MAX, &count) != CAN_STATUS_OK) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (uint8_t i = 0; i < count; i++) {
+            in_order = in_order && (frame_seq(&frames[i]) == expected);
+            expected++;
+        }
+    }
+    producer.join();
+    
+    CHECK_TRUE(in_order);
+    CHECK_EQUAL(total, expected);
+}
+
+/*******************************************************************************
+ * Test Group: TX Scheduler
+ ******************************************************************************/
+
+TEST_GROUP(CanTxScheduler)
+{
+    void setup() override
+    {
+        can_init(NULL);
+        can_stub_clear();
+        can_reset_stats();
+        
+        /* Nobody drains yet: the next sends have to wait */
+        for (uint32_t i = 0; i < CAN_TX_QUEUE_SIZE; i++) {
+            can_frame_t frame = make_frame(0x700U + i);
+            can_send(&frame);
+        }
+    }
+    
+    void teardown() override
+    {
+        can_deinit();
+    }
+    
+    /** Empty the TX queue, let the scheduler refill it, return what it sent */
+    uint8_t release(can_frame_t *frames)
+    {
+        can_frame_t old[CAN_TX_QUEUE_SIZE];
+        (void)can_stub_drain_tx(old, CAN_TX_QUEUE_SIZE);
+        (void)can_tx_service();
+        return can_stub_drain_tx(frames, CAN_TX_QUEUE_SIZE);
+    }
+};
+
+TEST(CanTxScheduler, FullQueueHoldsFramesInsteadOfDropping)
+{
+    can_frame_t frame = make_frame(0x300U);
+    CHECK_EQUAL(CAN_STATUS_OK, can_send(&frame));
+    CHECK_EQUAL(1, can_tx_pending());
+    CHECK_EQUAL(CAN_STATUS_BUFFER_FULL, can_tx_service()); /* Still no room */
+    
+    can_frame_t frames[CAN_TX_QUEUE_SIZE];
+    CHECK_EQUAL(1, release(frames));
+    CHECK_EQUAL(0x300U, frames[0].id);
+    CHECK_EQUAL(0, can_tx_pending());
+    CHECK_EQUAL(CAN_STATUS_OK, can_tx_service());
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    CHECK_EQUAL(0U, stats.tx_errors);
+    CHECK_EQUAL(CAN_TX_QUEUE_SIZE + 1U, stats.tx_count);
+}
+
+TEST(CanTxScheduler, PendingFramesLeaveLowestIdFirst)
+{
+    const uint32_t ids[] = { 0x320U, 0x120U, 0x050U, 0x210U };
+    for (uint32_t id : ids) {
+        can_frame_t frame = make_frame(id);
+        can_send(&frame);
+    }
+    
+    can_frame_t frames[CAN_TX_QUEUE_SIZE];
+    CHECK_EQUAL(4, release(frames));
+    CHECK_EQUAL(0x050U, frames[0].id);
+    CHECK_EQUAL(0x120U, frames[1].id);
+    CHECK_EQUAL(0x210U, frames[2].id);
+    CHECK_EQUAL(0x320U, frames[3].id);
+}
+
+TEST(CanTxScheduler, NewestStatusFrameSupersedesPendingCopy)
+{
+    for (uint8_t i = 1; i <= 3U; i++) {
+        can_frame_t frame = make_frame(CAN_ID_DOOR_STATUS);
+        frame.data[0] = i;
+        CHECK_EQUAL(CAN_STATUS_OK, can_send(&frame));
+    }
+    CHECK_EQUAL(1, can_tx_pending());
+    
+    can_frame_t frames[CAN_TX_QUEUE_SIZE];
+    CHECK_EQUAL(1, release(frames));
+    CHECK_EQUAL(CAN_ID_DOOR_STATUS, frames[0].id);
+    CHECK_EQUAL(3, frames[0].data[0]);
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    CHECK_EQUAL(2U, stats.tx_coalesced);
+    CHECK_EQUAL(0U, stats.tx_dropped);
+}
+
+TEST(CanTxScheduler, OtherFramesOfOneIdKeepOrder)
+{
+    can_frame_t first = make_frame(0x150U);
+    can_frame_t second = make_frame(0x150U);
+    second.data[0] = 0xEE;
+    can_send(&first);
+    can_send(&second);
+    CHECK_EQUAL(2, can_tx_pending());
+    
+    can_frame_t frames[CAN_TX_QUEUE_SIZE];
+    CHECK_EQUAL(2, release(frames));
+    BYTES_EQUAL(0x00, frames[0].data[0]);
+    BYTES_EQUAL(0xEE, frames[1].data[0]);
+}
+
+TEST(CanTxScheduler, OlderPendingFrameIsReleasedFirst)
+{
+    can_frame_t low = make_frame(0x400U);
+    can_send(&low);
+    
+    /* Room for one: the pending frame goes first, the new one waits */
+    can_frame_t one;
+    CHECK_EQUAL(1, can_stub_drain_tx(&one, 1));
+    can_frame_t high = make_frame(0x080U);
+    CHECK_EQUAL(CAN_STATUS_OK, can_send(&high));
+    CHECK_EQUAL(1, can_tx_pending());
+    
+    can_frame_t frames[CAN_TX_QUEUE_SIZE];
+    CHECK_EQUAL(CAN_TX_QUEUE_SIZE, can_stub_drain_tx(frames, CAN_TX_QUEUE_SIZE));
+    CHECK_EQUAL(0x400U, frames[CAN_TX_QUEUE_SIZE - 1U].id);
+    (void)can_tx_service();
+    CHECK_EQUAL(1, can_stub_drain_tx(frames, CAN_TX_QUEUE_SIZE));
+    CHECK_EQUAL(0x080U, frames[0].id);
+}
+
+TEST(CanTxScheduler, ClearDropsPendingFrames)
+{
+    can_frame_t frame = make_frame(0x300U);
+    can_send(&frame);
+    can_stub_clear();
+    CHECK_EQUAL(0, can_tx_pending());
+}
+
+/*******************************************************************************
+ * Test Group: Statistics
+ ******************************************************************************/
+
+TEST_GROUP(CanStats)
+{
+    void setup() override
+    {
+        sys_state_init();
+        can_init(NULL);
+        can_stub_clear();
+        can_reset_stats();
+    }
+    
+    void teardown() override
+    {
+        can_deinit();
+    }
+};
+
+TEST(CanStats, FullQueuesCountDrops)
+{
+    const uint32_t tx_capacity = CAN_TX_QUEUE_SIZE + CAN_TX_PENDING_SIZE;
+    can_frame_t frames[CAN_RX_QUEUE_SIZE + CAN_TX_QUEUE_SIZE + CAN_TX_PENDING_SIZE];
+    for (uint32_t i = 0; i < CAN_RX_QUEUE_SIZE + tx_capacity; i++) {
+        frames[i] = make_frame(i);
+    }
+    can_stub_inject_rx_batch(frames, CAN_RX_QUEUE_SIZE, NULL);
+    CHECK_EQUAL(CAN_STATUS_BUFFER_FULL, can_stub_inject_rx(&frames[0]));
+    CHECK_EQUAL(CAN_STATUS_BUFFER_FULL, can_stub_inject_rx_batch(frames, 3, NULL));
+    
+    /* Sent frames fill the TX queue, then the scheduler */
+    uint8_t sent = 0;
+    CHECK_EQUAL(CAN_STATUS_BUFFER_FULL,
+                can_send_batch(frames, (uint8_t)(tx_capacity + 2U), &sent));
+    CHECK_EQUAL(tx_capacity, sent);
+    CHECK_EQUAL(CAN_TX_PENDING_SIZE, can_tx_pending());
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    CHECK_EQUAL(4U, stats.rx_dropped);
+    CHECK_EQUAL(2U, stats.tx_dropped);
+    CHECK_EQUAL(2U, stats.tx_errors);
+    CHECK_EQUAL(CAN_TX_QUEUE_SIZE, stats.tx_count);
+}
+
+TEST(CanStats, CountsPerIdWithTimestamps)
+{
+    can_frame_t frame = make_frame(CAN_ID_DOOR_STATUS);
+    sys_state_update_time(1000);
+    can_send(&frame);
+    sys_state_update_time(1010);
+    can_send(&frame);
+    
+    can_frame_t cmd = make_frame(CAN_ID_DOOR_CMD);
+    can_stub_inject_rx(&cmd);
+    can_recv(&frame);
+    
+    can_id_stats_t id_stats;
+    CHECK_TRUE(can_get_id_stats(CAN_ID_DOOR_STATUS, &id_stats));
+    CHECK_EQUAL(2U, id_stats.tx_count);
+    CHECK_EQUAL(0U, id_stats.rx_count);
+    CHECK_EQUAL(1010U, id_stats.last_tx_ms);
+    CHECK_TRUE(can_get_id_stats(CAN_ID_DOOR_CMD, &id_stats));
+    CHECK_EQUAL(1U, id_stats.rx_count);
+    CHECK_EQUAL(1010U, id_stats.last_rx_ms);
+    CHECK_FALSE(can_get_id_stats(CAN_ID_LIGHTING_CMD, &id_stats));
+    
+    can_id_stats_t all[CAN_STATS_ID_SLOTS];
+    CHECK_EQUAL(2, can_get_all_id_stats(all, CAN_STATS_ID_SLOTS));
+    
+    can_reset_stats();
+    CHECK_FALSE(can_get_id_stats(CAN_ID_DOOR_STATUS, &id_stats));
+}
+
+TEST(CanStats, IdTableOverflowIsCounted)
+{
+    for (uint32_t id = 0; id < CAN_STATS_ID_SLOTS + 3U; id++) {
+        can_frame_t frame = make_frame(id);
+        can_send(&frame);
+        can_stub_drain_tx(&frame, 1);
+    }
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    CHECK_EQUAL(3U, stats.id_overflow);
+    CHECK_EQUAL(CAN_STATS_ID_SLOTS + 3U, stats.tx_count);
+}
+
+TEST(CanStats, FrameBitsWorstCaseStuffing)
+{
+    CHECK_EQUAL(55U, can_frame_bits(0));
+    CHECK_EQUAL(95U, can_frame_bits(4));
+    CHECK_EQUAL(135U, can_frame_bits(8));
+    CHECK_EQUAL(135U, can_frame_bits(15));
+}
+
+TEST(CanStats, BusLoadOverWindow)
+{
+    can_frame_t frames[CAN_TX_QUEUE_SIZE];
+    for (uint32_t i = 0; i < CAN_TX_QUEUE_SIZE; i++) {
+        frames[i] = make_frame(i);
+        frames[i].dlc = 8;
+    }
+    
+    can_stats_sample_load(0);
+    can_send_batch(frames, CAN_TX_QUEUE_SIZE, NULL);
+    can_stats_sample_load(CAN_BUS_LOAD_WINDOW_MS / 2U); /* Window stays open */
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    CHECK_EQUAL(0, stats.bus_load_x10);
+    
+    can_stats_sample_load(CAN_BUS_LOAD_WINDOW_MS);
+    can_get_stats(&stats);
+    CHECK_EQUAL(CAN_TX_QUEUE_SIZE * 135U, stats.bus_bits);
+    CHECK_EQUAL((CAN_TX_QUEUE_SIZE * 135U * 1000U) / CAN_BAUD_RATE, stats.bus_load_x10);
+}
+
+/*******************************************************************************
+ * Test Group: CAN FD
+ ******************************************************************************/
+
+TEST_GROUP(CanFd)
+{
+    void setup() override
+    {
+        sys_state_init();
+        can_init(NULL);
+        can_stub_clear();
+        can_reset_stats();
+    }
+    
+    void teardown() override
+    {
+        can_deinit();
+    }
+};
+
+TEST(CanFd, LengthsRoundUpToValidSizes)
+{
+    for (uint8_t len = 0; len <= CAN_FRAME_MAX_DLC; len++) {
+        CHECK_EQUAL(len, can_fd_len_round(len));
+    }
+    CHECK_EQUAL(12, can_fd_len_round(9));
+    CHECK_EQUAL(16, can_fd_len_round(13));
+    CHECK_EQUAL(24, can_fd_len_round(24));
+    CHECK_EQUAL(32, can_fd_len_round(25));
+    CHECK_EQUAL(48, can_fd_len_round(33));
+    CHECK_EQUAL(64, can_fd_len_round(49));
+    CHECK_EQUAL(64, can_fd_len_round(200));
+}
+
+TEST(CanFd, FrameBitsScaleDataPhase)
+{
+    /* 500k nominal, 2M data: the data phase costs a quarter */
+    CHECK_EQUAL(124U, can_fd_frame_bits(32, CAN_FD_FLAG_BRS));
+    CHECK_EQUAL(392U, can_fd_frame_bits(32, 0));
+    CHECK_EQUAL(63U, can_fd_frame_bits(8, CAN_FD_FLAG_BRS));
+    CHECK_EQUAL(can_fd_frame_bits(32, 0), can_fd_frame_bits(25, 0));
+}
+
+TEST(CanFd, TemplateKeepsChecksum)
+{
+    can_fd_frame_t frame;
+    can_fd_frame_template_init(&frame, CAN_ID_BCM_AGGREGATE_STATUS, 32,
+                               CAN_FD_FLAG_BRS, CAN_CHECKSUM_SEED);
+    can_fd_frame_put(&frame, 0, 0x12);
+    can_fd_frame_put(&frame, 20, 0x34);
+    can_fd_frame_put(&frame, 20, 0x56);
+    
+    uint8_t checksum = CAN_CHECKSUM_SEED;
+    for (uint8_t i = 0; i < 31U; i++) {
+        checksum ^= frame.data[i];
+    }
+    CHECK_EQUAL(checksum, frame.data[31]);
+    CHECK_EQUAL(CAN_FD_FLAG_BRS, frame.flags);
+}
+
+TEST(CanFd, StubQueueKeepsOrderAndCounts)
+{
+    can_fd_frame_t frame;
+    can_fd_frame_template_init(&frame, CAN_ID_BCM_AGGREGATE_STATUS, 32,
+                               CAN_FD_FLAG_BRS, CAN_CHECKSUM_SEED);
+    for (uint8_t i = 0; i < CAN_TX_FD_QUEUE_SIZE; i++) {
+        can_fd_frame_put(&frame, 0, i);
+        CHECK_EQUAL(CAN_STATUS_OK, can_send_fd(&frame));
+    }
+    CHECK_EQUAL(CAN_STATUS_BUFFER_FULL, can_send_fd(&frame));
+    
+    can_fd_frame_t out[CAN_TX_FD_QUEUE_SIZE];
+    CHECK_EQUAL(1, can_stub_drain_tx_fd(out, 1));
+    CHECK_EQUAL(0, out[0].data[0]);
+    CHECK_EQUAL(CAN_TX_FD_QUEUE_SIZE - 1U, can_stub_drain_tx_fd(out, CAN_TX_FD_QUEUE_SIZE));
+    CHECK_EQUAL(1, out[0].data[0]);
+    CHECK_EQUAL(0, can_stub_drain_tx_fd(out, CAN_TX_FD_QUEUE_SIZE));
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    CHECK_EQUAL(CAN_TX_FD_QUEUE_SIZE, stats.tx_count);
+    CHECK_EQUAL(1U, stats.tx_dropped);
+    
+    can_id_stats_t id_stats;
+    CHECK_TRUE(can_get_id_stats(CAN_ID_BCM_AGGREGATE_STATUS, &id_stats));
+    CHECK_EQUAL(CAN_TX_FD_QUEUE_SIZE, id_stats.tx_count);
+    
+    can_stats_sample_load(0);
+    can_send_fd(&frame);
+    can_stats_sample_load(CAN_BUS_LOAD_WINDOW_MS);
+    can_get_stats(&stats);
+    CHECK_EQUAL(124U, stats.bus_bits);
+}
+
+TEST(CanFd, InvalidLengthIsRejected)
+{
+    can_fd_frame_t frame;
+    can_fd_frame_template_init(&frame, CAN_ID_BCM_AGGREGATE_STATUS, 9, 0, CAN_CHECKSUM_SEED);
+    CHECK_EQUAL(CAN_STATUS_ERROR, can_send_fd(&frame));
+    
+    can_fd_frame_t out;
+    CHECK_EQUAL(0, can_stub_drain_tx_fd(&out, 1));
+    
+    can_stats_t stats;
+    can_get_stats(&stats);
+    CHECK_EQUAL(1U, stats.tx_errors);
+    CHECK_EQUAL(0U, stats.tx_dropped);
+    CHECK_EQUAL(0U, stats.tx_count);
+}
+
+/*******************************************************************************
+ * Test Group: Multiple Buses
+ ******************************************************************************/
+
+TEST_GROUP(CanMultiBus)
+{
+    void setup() override
+    {
+        sys_state_init();
+        CHECK_EQUAL(CAN_STATUS_OK, can_init("body,gw"));
+        can_stub_clear();
+        can_reset_stats();
+    }
+    
+    void teardown() override
+    {
+        can_deinit();
+    }
+};
+
+TEST(CanMultiBus, InterfaceListOpensOneBusEach)
+{
+    CHECK_EQUAL(2, can_bus_count());
+    CHECK_TRUE(can_is_initialized());
+    
+    can_deinit();
+    CHECK_EQUAL(CAN_STATUS_ERROR, can_init("a,b,c"));   /* More than CAN_BUS_MAX */
+    CHECK_FALSE(can_is_initialized());
+    CHECK_EQUAL(CAN_STATUS_ERROR, can_init("body,"));
+    CHECK_FALSE(can_is_initialized());
+    
+    CHECK_EQUAL(CAN_STATUS_OK, can_init(NULL));
+    CHECK_EQUAL(1, can_bus_count());
+}
+
+TEST(CanMultiBus, RoutedFramesLeaveOnTheirBus)
+{
+    CHECK_EQUAL(CAN_STATUS_ERROR, can_set_tx_route(0x400U, 2));
+    CHECK_EQUAL(CAN_STATUS_OK, can_set_tx_route(0x400U, 1));
+    CHECK_EQUAL(1, can_get_tx_route(0x400U));
+    CHECK_EQUAL(CAN_BUS_BODY, can_get_tx_route(0x401U));
+    
+    can_frame_t frames[3] = { make_frame(0x400U), make_frame(0x401U), make_frame(0x400U) };
+    uint8_t sent = 0;
+    CHECK_EQUAL(CAN_STATUS_OK, can_send_batch(frames, 3, &sent));
+    CHECK_EQUAL(3, sent);
+    
+    can_frame_t out[CAN_TX_QUEUE_SIZE];
+    CHECK_EQUAL(1, can_stub_bus_drain_tx(CAN_BUS_BODY, out, CAN_TX_QUEUE_SIZE));
+    CHECK_EQUAL(0x401U, out[0].id);
+    CHECK_EQUAL(2, can_stub_bus_drain_tx(1, out, CAN_TX_QUEUE_SIZE));
+    CHECK_EQUAL(0x400U, out[0].id);
+    CHECK_EQUAL(0x400U, out[1].id);
+    
+    /* Routing back to the body bus removes the entry */
+    CHECK_EQUAL(CAN_STATUS_OK, can_set_tx_route(0x400U, CAN_BUS_BODY));
+    can_send(&frames[0]);
+    CHECK_EQUAL(1, can_stub_drain_tx(out, CAN_TX_QUEUE_SIZE));
+    CHECK_EQUAL(0, can_stub_bus_drain_tx(1, out, CAN_TX_QUEUE_SIZE));
+}
+
+TEST(CanMultiBus, FullBusOnlyRefusesItsOwnFrames)
+{
+    const uint32_t tx_capacity = CAN_TX_QUEUE_SIZE + CAN_TX_PENDING_SIZE;
+    can_frame_t fill[CAN_TX_QUEUE_SIZE + CAN_TX_PENDING_SIZE];
+    for (uint32_t i = 0; i < tx_capacity; i++) {
+        fill[i] = make_frame(i);
+    }
+    CHECK_EQUAL(CAN_STATUS_OK, can_send_batch(fill, (uint8_t)tx_capacity, NULL));
+    CHECK_EQUAL(CAN_STATUS_OK, can_set_tx_route(0x400U, 1));
+    
+    /* The body bus is full, so only the routed frame is taken */
+    can_frame_t frames[3] = { make_frame(0x401U), make_frame(0x400U), make_frame(0x402U) };
+    bool accepted[3] = { true, false, true };
+    CHECK_EQUAL(CAN_STATUS_BUFFER_FULL, can_send_batch_accepted(frames, 3, accepted));
+    CHECK_FALSE(accepted[0]);
+    CHECK_TRUE(accepted[1]);
+    CHECK_FALSE(accepted[2]);
+    
+    uint8_t sent = 0;
+    CHECK_EQUAL(CAN_STATUS_BUFFER_FULL, can_send_batch(frames, 3, &sent));
+    CHECK_EQUAL(1, sent);
+    CHECK_EQUAL(CAN_STATUS_ERROR, can_send_batch_accepted(frames, 3, NULL));
+    
+    can_frame_t out[CAN_TX_QUEUE_SIZE];
+    CHECK_EQUAL(2, can_stub_bus_drain_tx(1, out, CAN_TX_QUEUE_SIZE));
+    CHECK_EQUAL(0x400U, out[0].id);
+}
+
+TEST(CanMultiBus, QueuesAndStatsArePerBus)
+{
+    can_frame_t frames[2] = { make_frame(1), make_frame(2) };
+    CHECK_EQUAL(CAN_STATUS_OK, can_stub_bus_inject_rx_batch(1, frames, 2, NULL));
+    CHECK_EQUAL(CAN_STATUS_NOT_INITIALIZED, can_stub_bus_inject_rx_batch(2, frames, 2, NULL));
+    CHECK_EQUAL(CAN_STATUS_OK, can_rx_poll());
+    
+    can_frame_t out[CAN_BATCH_MAX];
+    uint8_t count = 0;
+    CHECK_EQUAL(CAN_STATUS_NO_DATA, can_recv_batch(out, CAN_BATCH_MAX, &count));
+    CHECK_EQUAL(CAN_STATUS_OK, can_bus_recv_batch(1, out, CAN_BATCH_MAX, &count));
+    CHECK_EQUAL(2, count);
+    CHECK_EQUAL(2U, frame_seq(&out[1]));
+    can_bus_stats_rx_discard(1, CAN_RX_UNKNOWN_ID);
+    
+    can_stats_t stats;
+    can_bus_get_stats(1, &stats);
+    CHECK_EQUAL(2U, stats.rx_count);
+    CHECK_EQUAL(1U, stats.rx_unknown_id);
+    can_get_stats(&stats);
+    CHECK_EQUAL(0U, stats.rx_count);
+    CHECK_EQUAL(0U, stats.rx_unknown_id);
+    can_bus_get_stats(2, &stats);
+    CHECK_EQUAL(0U, stats.rx_count);
+    
+    can_id_stats_t id_stats;
+    CHECK_TRUE(can_bus_get_id_stats(1, 2, &id_stats));
+    CHECK_FALSE(can_get_id_stats(2, &id_stats));
+}
+
+TEST(CanMultiBus, PendingCountCoversAllBuses)
+{
+    can_set_tx_route(0x500U, 1);
+    for (uint32_t i = 0; i < CAN_TX_QUEUE_SIZE + 1U; i++) {
+        can_frame_t body = make_frame(0x300U);
+        can_frame_t gw = make_frame(0x500U);
+        body.data[3] = gw.data[3] = (uint8_t)i;
+        can_send(&body);
+        can_send(&gw);
+    }
+    CHECK_EQUAL(2, can_tx_pending());
+    
+    can_frame_t out[CAN_TX_QUEUE_SIZE];
+    (void)can_stub_bus_drain_tx(1, out, CAN_TX_QUEUE_SIZE);
+    CHECK_EQUAL(CAN_STATUS_BUFFER_FULL, can_tx_service());  /* Body bus still full */
+    CHECK_EQUAL(1, can_tx_pending());
+    CHECK_EQUAL(1, can_stub_bus_drain_tx(1, out, CAN_TX_QUEUE_SIZE));
+    CHECK_EQUAL(0x500U, out[0].id);
+}
@@ -0,0 +1,188 @@
+/**
+ * @file test_can_messages.cpp
+ * @brief Unit tests for the generated CAN pack/unpack code (bcm.dbc)
+ *
+ * Tests:
+ * - Encode matches hand-built frames and passes validation
+ * - Decode round trip, including packed nibbles
+ * - Status update keeps the template checksum current
+ * - Generated descriptors reject out-of-range fields
+ * - Module status frames follow the schema layout
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C" {
+#include "can_messages.h"
+#include "can_ids.h"
+#include "bcm.h"
+#include "door_control.h"
+#include "lighting_control.h"
+#include "turn_signal.h"
+}
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+/** Command frame the way the existing tests and the bench build them */
+static can_frame_t build_cmd(uint32_t id, uint8_t byte0, uint8_t byte1, uint8_t counter)
+{
+    can_frame_t frame;
+    can_frame_template_init(&frame, id, 4U, CAN_CHECKSUM_SEED);
+    can_frame_put(&frame, 0, byte0);
+    can_frame_put(&frame, 1, byte1);
+    can_frame_put(&frame, 2, CAN_BUILD_VER_CTR(CAN_SCHEMA_VERSION, counter));
+    return frame;
+}
+
+/*******************************************************************************
+ * Test Group: Encode/Decode
+ ******************************************************************************/
+
+TEST_GROUP(CanMessages)
+{
+};
+
+TEST(CanMessages, EncodeMatchesHandBuiltFrames)
+{
+    can_msg_door_cmd_t door = { DOOR_CMD_LOCK_SINGLE, DOOR_ID_REAR_LEFT };
+    can_frame_t frame;
+    can_frame_t expected = build_cmd(CAN_ID_DOOR_CMD, DOOR_CMD_LOCK_SINGLE,
+                                     DOOR_ID_REAR_LEFT, 5);
+    can_msg_door_cmd_encode(&frame, &door, 5);
+    MEMCMP_EQUAL(&expected, &frame, sizeof(frame));
+    CHECK_EQUAL(CAN_CHECK_OK, can_check_frame(&can_msg_door_cmd_desc, &frame, NULL));
+    
+    can_msg_turn_signal_cmd_t turn = { TURN_CMD_HAZARD_ON };
+    expected = build_cmd(CAN_ID_TURN_SIGNAL_CMD, TURN_CMD_HAZARD_ON, 0, 15);
+    can_msg_turn_signal_cmd_encode(&frame, &turn, 15);
+    MEMCMP_EQUAL(&expected, &frame, sizeof(frame));
+    CHECK_EQUAL(CAN_CHECK_OK, can_check_frame(&can_msg_turn_signal_cmd_desc, &frame, NULL));
+}
+
+TEST(CanMessages, CounterIsMaskedToNibble)
+{
+    can_msg_turn_signal_cmd_t turn = { TURN_CMD_OFF };
+    can_frame_t frame;
+    can_msg_turn_signal_cmd_encode(&frame, &turn, 0x13);
+    
+    CHECK_EQUAL(3, CAN_GET_COUNTER(frame.data[TURN_CMD_BYTE_VER_CTR]));
+    CHECK_EQUAL(CAN_SCHEMA_VERSION, CAN_GET_VERSION(frame.data[TURN_CMD_BYTE_VER_CTR]));
+}
+
+TEST(CanMessages, DecodeRoundTripsPackedNibbles)
+{
+    can_msg_lighting_cmd_t in = { HEADLIGHT_CMD_AUTO, INTERIOR_CMD_ON, 9 };
+    can_frame_t frame;
+    can_msg_lighting_cmd_encode(&frame, &in, 0);
+    
+    CHECK_EQUAL(0x91, frame.data[LIGHTING_CMD_BYTE_INTERIOR]);
+    
+    can_msg_lighting_cmd_t out;
+    can_msg_lighting_cmd_decode(&frame, &out);
+    CHECK_EQUAL(HEADLIGHT_CMD_AUTO, out.headlight);
+    CHECK_EQUAL(INTERIOR_CMD_ON, out.interior_mode);
+    CHECK_EQUAL(9, out.interior_brightness);
+}
+
+TEST(CanMessages, UpdateKeepsTemplateChecksum)
+{
+    can_frame_t frame;
+    can_frame_template_init(&frame, CAN_MSG_LIGHTING_STATUS_ID, CAN_MSG_LIGHTING_STATUS_DLC,
+                            CAN_CHECKSUM_SEED);
+    
+    can_msg_lighting_status_t in = { HEADLIGHT_STATE_ON, INTERIOR_CMD_ON, 9, 42, 0, 128 };
+    can_msg_lighting_status_update(&frame, &in, 0x13);
+    CHECK_EQUAL(CAN_CHECK_OK, can_check_frame(&can_msg_lighting_status_desc, &frame, NULL));
+    CHECK_EQUAL(0x25, frame.data[LIGHTING_STATUS_BYTE_INTERIOR]);
+    CHECK_EQUAL(3, CAN_GET_COUNTER(frame.data[LIGHTING_STATUS_BYTE_VER_CTR]));
+    
+    in.ambient = 43;
+    in.interior_duty = 0;
+    can_msg_lighting_status_update(&frame, &in, 4);
+    CHECK_EQUAL(CAN_CHECK_OK, can_check_frame(&can_msg_lighting_status_desc, &frame, NULL));
+    
+    can_msg_lighting_status_t out;
+    can_msg_lighting_status_decode(&frame, &out);
+    MEMCMP_EQUAL(&in, &out, sizeof(in));
+}
+
+TEST(CanMessages, DescriptorsRejectOutOfRangeFields)
+{
+    can_frame_t frame;
+    
+    can_msg_door_cmd_t door = { 0, DOOR_ID_ALL };
+    can_msg_door_cmd_encode(&frame, &door, 0);
+    CHECK_EQUAL(CAN_CHECK_BAD_FIELD, can_check_frame(&can_msg_door_cmd_desc, &frame, NULL));
+    door.command = DOOR_CMD_MAX + 1;
+    can_msg_door_cmd_encode(&frame, &door, 0);
+    CHECK_EQUAL(CAN_CHECK_BAD_FIELD, can_check_frame(&can_msg_door_cmd_desc, &frame, NULL));
+    
+    can_msg_lighting_cmd_t light = { HEADLIGHT_CMD_MAX + 1, INTERIOR_CMD_OFF, 0 };
+    can_msg_lighting_cmd_encode(&frame, &light, 0);
+    CHECK_EQUAL(CAN_CHECK_BAD_FIELD, can_check_frame(&can_msg_lighting_cmd_desc, &frame, NULL));
+    light.headlight = HEADLIGHT_CMD_MAX;
+    light.interior_mode = INTERIOR_CMD_MAX + 1;
+    can_msg_lighting_cmd_encode(&frame, &light, 0);
+    CHECK_EQUAL(CAN_CHECK_BAD_FIELD, can_check_frame(&can_msg_lighting_cmd_desc, &frame, NULL));
+    
+    can_msg_turn_signal_cmd_t turn = { TURN_CMD_MAX + 1 };
+    can_msg_turn_signal_cmd_encode(&frame, &turn, 0);
+    CHECK_EQUAL(CAN_CHECK_BAD_FIELD, can_check_frame(&can_msg_turn_signal_cmd_desc, &frame, NULL));
+}
+
+/*******************************************************************************
+ * Test Group: Modules
+ ******************************************************************************/
+
+TEST_GROUP(CanMessagesModules)
+{
+    void setup() override
+    {
+        bcm_init(NULL);
+    }
+    
+    void teardown() override
+    {
+        bcm_deinit();
+    }
+};
+
+TEST(CanMessagesModules, EncodedCommandsAreAccepted)
+{
+    can_msg_door_cmd_t door = { DOOR_CMD_LOCK_SINGLE, DOOR_ID_FRONT_RIGHT };
+    can_frame_t frame;
+    can_msg_door_cmd_encode(&frame, &door, 0);
+    
+    CHECK_EQUAL(CMD_RESULT_OK, door_control_handle_cmd(&frame));
+    CHECK_EQUAL(DOOR_STATE_LOCKING, door_control_get_lock_state(DOOR_ID_FRONT_RIGHT));
+    CHECK_EQUAL(DOOR_STATE_UNLOCKED, door_control_get_lock_state(DOOR_ID_FRONT_LEFT));
+    
+    can_msg_lighting_cmd_t light = { HEADLIGHT_CMD_ON, INTERIOR_CMD_ON, 12 };
+    can_msg_lighting_cmd_encode(&frame, &light, 0);
+    CHECK_EQUAL(CMD_RESULT_OK, lighting_control_handle_cmd(&frame));
+    CHECK_EQUAL(12, lighting_control_get_interior_brightness());
+}
+
+TEST(CanMessagesModules, StatusFramesFollowSchema)
+{
+    lighting_control_set_interior(LIGHTING_STATE_ON, 7);
+    lighting_control_set_ambient(200);
+    
+    can_frame_t frame;
+    lighting_control_build_status_frame(&frame);
+    CHECK_EQUAL(CAN_MSG_LIGHTING_STATUS_ID, frame.id);
+    CHECK_EQUAL(CAN_CHECK_OK, can_check_frame(&can_msg_lighting_status_desc, &frame, NULL));
+    
+    can_msg_lighting_status_t status;
+    can_msg_lighting_status_decode(&frame, &status);
+    CHECK_EQUAL(LIGHTING_STATE_ON, status.interior_mode);
+    CHECK_EQUAL(7, status.interior_brightness);
+    CHECK_EQUAL(200, status.ambient);
+    
+    door_control_build_status_frame(&frame);
+    CHECK_EQUAL(CAN_CHECK_OK, can_check_frame(&can_msg_door_status_desc, &frame, NULL));
+    turn_signal_build_status_frame(&frame);
+    CHECK_EQUAL(CAN_CHECK_OK, can_check_frame(&can_msg_turn_signal_status_desc, &frame, NULL));
+}
@@ -0,0 +1,131 @@
+/**
+ * @file test_can_sil.cpp
+ * @brief SocketCAN tests on virtual CAN interfaces (BCM_SIL builds)
+ *
+ * Needs vcan0 and vcan1; each test returns early without them:
+ *     sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+ *     sudo ip link add dev vcan1 type vcan && sudo ip link set up vcan1
+ *
+ * Tests:
+ * - can_start_rx_threads() switches a bus to its eventfd and back at deinit
+ * - A command sent on the gateway bus goes through the RX thread to the BCM
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <net/if.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/can.h>
+#undef CAN_MAX_DLC      /* can_ids.h defines the same limit */
+
+extern "C" {
+#include "bcm.h"
+#include "can_interface.h"
+#include "can_messages.h"
+#include "door_control.h"
+}
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static bool vcan_present(void)
+{
+    return if_nametoindex("vcan0") != 0U && if_nametoindex("vcan1") != 0U;
+}
+
+/** Raw socket of a test node on one interface, -1 on error */
+static int node_open(const char *ifname)
+{
+    int fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = (int)if_nametoindex(ifname);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*******************************************************************************
+ * Test Group: RX Threads
+ ******************************************************************************/
+
+TEST_GROUP(CanSilRxThreads)
+{
+    bool present;
+    
+    void setup() override
+    {
+        present = vcan_present();
+        if (present) {
+            CHECK_EQUAL(0, bcm_init("vcan0,vcan1"));
+            CHECK_EQUAL(CAN_STATUS_OK, can_start_rx_threads());
+        }
+    }
+    
+    void teardown() override
+    {
+        if (present) {
+            bcm_deinit();
+        }
+    }
+};
+
+TEST(CanSilRxThreads, ThreadedBusWaitsOnEventfd)
+{
+    if (!present) {
+        UT_PRINT("vcan0/vcan1 missing, skipped");
+        return;
+    }
+    
+    CHECK_EQUAL(2U, can_bus_count());
+    CHECK_TRUE(can_bus_get_fd(1) >= 0);
+    CHECK_TRUE(can_bus_get_tx_fd(1) >= 0);
+    CHECK_TRUE(can_bus_get_fd(1) != can_bus_get_tx_fd(1));
+    
+    bcm_deinit();
+    present = false;
+    CHECK_EQUAL(-1, can_bus_get_fd(1));
+}
+
+TEST(CanSilRxThreads, GatewayCommandReachesBcm)
+{
+    if (!present) {
+        UT_PRINT("vcan0/vcan1 missing, skipped");
+        return;
+    }
+    
+    int node = node_open("vcan1");
+    CHECK_TRUE(node >= 0);
+    
+    can_msg_door_cmd_t cmd = { DOOR_CMD_LOCK_ALL, DOOR_ID_ALL };
+    can_frame_t frame;
+    can_msg_door_cmd_encode(&frame, &cmd, 0);
+    CHECK_EQUAL((ssize_t)sizeof(frame), write(node, &frame, sizeof(frame)));
+    
+    /* The RX thread signals the eventfd; bcm_process() drains its queue */
+    uint32_t now_ms = 0;
+    for (int i = 0; i < 50 &&
+         door_control_get_lock_state(DOOR_ID_FRONT_LEFT) == DOOR_STATE_UNLOCKED; i++) {
+        struct pollfd pfd = { can_bus_get_fd(1), POLLIN, 0 };
+        (void)poll(&pfd, 1, 20);
+        now_ms += 10U;
+        bcm_process(now_ms);
+    }
+    close(node);
+    
+    CHECK_TRUE(door_control_get_lock_state(DOOR_ID_FRONT_LEFT) != DOOR_STATE_UNLOCKED);
+    can_stats_t stats;
+    can_bus_get_stats(1, &stats);
+    CHECK_EQUAL(1U, stats.rx_count);
+}
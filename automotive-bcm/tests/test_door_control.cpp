@@ -8,6 +8,7 @@
  * - Checksum validation
  * - Rolling counter validation
  * - State machine transitions
+ * - Next deadline while a transition is pending
  */
 
 #include "CppUTest/TestHarness.h"
@@ -305,6 +306,17 @@ TEST(DoorStateMachine, LockingAlreadyLockedNoChange)
     CHECK_EQUAL(DOOR_STATE_LOCKED, door_control_get_lock_state(0));
 }
 
+TEST(DoorStateMachine, NextDeadlineOnlyWhileTransitioning)
+{
+    CHECK_EQUAL(100U + SYS_DEADLINE_IDLE_MS, door_control_next_deadline(100));
+    
+    door_control_lock(2);
+    CHECK_EQUAL(100U, door_control_next_deadline(100));
+    
+    door_control_update(100);
+    CHECK_EQUAL(200U + SYS_DEADLINE_IDLE_MS, door_control_next_deadline(200));
+}
+
 /*******************************************************************************
  * Test Group: Door Status Frame
  ******************************************************************************/
@@ -372,3 +384,26 @@ TEST(DoorStatusFrame, CounterIncrements)
     
     CHECK_EQUAL((counter1 + 1) & CAN_COUNTER_MASK, counter2);
 }
+
+TEST(DoorStatusFrame, InPlaceUpdateKeepsChecksumValid)
+{
+    can_frame_t frame;
+    door_control_build_status_frame(&frame);
+    
+    door_control_lock_all();
+    door_control_update(100);
+    door_control_update_status_frame(&frame);
+    
+    CHECK_EQUAL(DOOR_LOCK_BIT_FL | DOOR_LOCK_BIT_FR | DOOR_LOCK_BIT_RL | DOOR_LOCK_BIT_RR,
+                frame.data[DOOR_STATUS_BYTE_LOCKS]);
+    uint8_t calc = can_calculate_checksum(frame.data, DOOR_STATUS_DLC - 1);
+    CHECK_EQUAL(calc, frame.data[DOOR_STATUS_BYTE_CHECKSUM]);
+    
+    door_control_unlock_all();
+    door_control_update(110);
+    door_control_update_status_frame(&frame);
+    
+    CHECK_EQUAL(0, frame.data[DOOR_STATUS_BYTE_LOCKS]);
+    calc = can_calculate_checksum(frame.data, DOOR_STATUS_DLC - 1);
+    CHECK_EQUAL(calc, frame.data[DOOR_STATUS_BYTE_CHECKSUM]);
+}
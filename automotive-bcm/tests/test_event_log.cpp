@@ -0,0 +1,138 @@
+/**
+ * @file test_event_log.cpp
+ * @brief Unit tests for the event log
+ *
+ * Tests:
+ * - Ring keeps the newest EVENT_LOG_SIZE entries
+ * - Bulk read across the ring end, resume and gaps
+ * - Type masks and sampling
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <vector>
+
+extern "C" {
+#include "system_state.h"
+}
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+/** Log count events whose data bytes carry their index */
+static void add_events(event_type_t type, uint32_t first, uint32_t count)
+{
+    for (uint32_t i = first; i < first + count; i++) {
+        uint8_t data[4] = { (uint8_t)i, (uint8_t)(i >> 8), (uint8_t)(i >> 16), 0 };
+        event_log_add(type, data);
+    }
+}
+
+static uint32_t entry_index(const event_log_entry_t *entry)
+{
+    return (uint32_t)entry->data[0] | ((uint32_t)entry->data[1] << 8) |
+           ((uint32_t)entry->data[2] << 16);
+}
+
+/*******************************************************************************
+ * Test Group: Event Log
+ ******************************************************************************/
+
+TEST_GROUP(EventLog)
+{
+    void setup() override
+    {
+        sys_state_init();
+    }
+};
+
+TEST(EventLog, KeepsNewestWhenFull)
+{
+    add_events(EVENT_STATE_CHANGE, 0, EVENT_LOG_SIZE + 5U);
+    
+    CHECK_EQUAL(EVENT_LOG_SIZE, event_log_count());
+    CHECK_EQUAL(EVENT_LOG_SIZE + 5U, event_log_seq());
+    
+    event_log_entry_t entry;
+    CHECK_TRUE(event_log_get(0, &entry));
+    CHECK_EQUAL(5U, entry_index(&entry));
+    CHECK_TRUE(event_log_get(EVENT_LOG_SIZE - 1U, &entry));
+    CHECK_EQUAL(EVENT_LOG_SIZE + 4U, entry_index(&entry));
+    CHECK_FALSE(event_log_get(EVENT_LOG_SIZE, &entry));
+}
+
+TEST(EventLog, BulkReadSpansRingEnd)
+{
+    add_events(EVENT_STATE_CHANGE, 0, EVENT_LOG_SIZE + EVENT_LOG_SIZE / 2U);
+    
+    std::vector<event_log_entry_t> buf(EVENT_LOG_SIZE);
+    uint32_t next = 0;
+    uint32_t n = event_log_read(0, buf.data(), EVENT_LOG_SIZE, &next);
+    
+    /* Older entries were overwritten: the read starts at the oldest held */
+    CHECK_EQUAL(EVENT_LOG_SIZE, n);
+    CHECK_EQUAL(event_log_seq(), next);
+    CHECK_TRUE(next - n > 0U);
+    for (uint32_t i = 0; i < n; i++) {
+        CHECK_EQUAL(EVENT_LOG_SIZE / 2U + i, entry_index(&buf[i]));
+    }
+}
+
+TEST(EventLog, ReadResumesFromCursor)
+{
+    add_events(EVENT_STATE_CHANGE, 0, 10);
+    
+    event_log_entry_t buf[4];
+    uint32_t next = 0;
+    CHECK_EQUAL(4U, event_log_read(0, buf, 4, &next));
+    CHECK_EQUAL(4U, next);
+    CHECK_EQUAL(4U, event_log_read(next, buf, 4, &next));
+    CHECK_EQUAL(4U, entry_index(&buf[0]));
+    CHECK_EQUAL(2U, event_log_read(next, buf, 4, &next));
+    CHECK_EQUAL(9U, entry_index(&buf[1]));
+    CHECK_EQUAL(0U, event_log_read(next, buf, 4, &next));
+    CHECK_EQUAL(10U, next);
+}
+
+TEST(EventLog, MaskDropsTypes)
+{
+    event_log_set_mask((uint16_t)(EVENT_MASK_ALL & ~EVENT_MASK(EVENT_CMD_RECEIVED)));
+    add_events(EVENT_CMD_RECEIVED, 0, 5);
+    add_events(EVENT_FAULT_SET, 0, 2);
+    
+    CHECK_EQUAL(2U, event_log_count());
+    event_log_entry_t entry;
+    CHECK_TRUE(event_log_get(0, &entry));
+    CHECK_EQUAL(EVENT_FAULT_SET, entry.type);
+    
+    /* bcm_init() logs everything again */
+    sys_state_init();
+    CHECK_EQUAL(EVENT_MASK_ALL, event_log_get_mask());
+}
+
+TEST(EventLog, SamplingKeepsOneInN)
+{
+    event_log_set_sampling(EVENT_CMD_RECEIVED, 4);
+    add_events(EVENT_CMD_RECEIVED, 0, 10);
+    
+    event_log_entry_t buf[4];
+    CHECK_EQUAL(3U, event_log_read(0, buf, 4, NULL));
+    CHECK_EQUAL(0U, entry_index(&buf[0]));
+    CHECK_EQUAL(4U, entry_index(&buf[1]));
+    CHECK_EQUAL(8U, entry_index(&buf[2]));
+}
+
+TEST(EventLog, ClearKeepsSequence)
+{
+    add_events(EVENT_STATE_CHANGE, 0, 3);
+    event_log_clear();
+    CHECK_EQUAL(0U, event_log_count());
+    
+    add_events(EVENT_STATE_CHANGE, 3, 1);
+    event_log_entry_t entry;
+    uint32_t next = 0;
+    CHECK_EQUAL(1U, event_log_read(0, &entry, 1, &next));
+    CHECK_EQUAL(3U, entry_index(&entry));
+    CHECK_EQUAL(4U, next);
+}
@@ -7,6 +7,8 @@
  * - Fault flags correctness
  * - Status frame payload
  * - Multiple faults handling
+ * - Debounce, healing and permanent faults
+ * - Coalescing of repeated reports
  */
 
 #include "CppUTest/TestHarness.h"
@@ -44,7 +46,7 @@ TEST(FaultInit, NoFaultsInitially)
 TEST(FaultInit, FlagsZeroInitially)
 {
     CHECK_EQUAL(0, fault_manager_get_flags1());
-    CHECK_EQUAL(0, fault_manager_get_flags2());
+    CHECK_EQUAL(0, fault_manager_get_repeat_rate());
 }
 
 TEST(FaultInit, MostRecentNoneInitially)
@@ -358,3 +360,181 @@ TEST(FaultEdgeCases, UnknownFaultCodeNoFlag)
     CHECK_TRUE(fault_manager_is_active((fault_code_t)0x99));
     CHECK_EQUAL(0, fault_manager_get_flags1()); /* No flag mapped */
 }
+
+/*******************************************************************************
+ * Test Group: Fault Lifecycle
+ ******************************************************************************/
+
+TEST_GROUP(FaultLifecycle)
+{
+    void setup() override
+    {
+        sys_state_init();
+        can_init(NULL);
+        fault_manager_init();
+    }
+
+    void teardown() override
+    {
+        can_deinit();
+    }
+
+    void at(uint32_t ms)
+    {
+        sys_state_update_time(ms);
+        fault_manager_update(ms);
+    }
+};
+
+TEST(FaultLifecycle, TracksMoreThanEightFaults)
+{
+    for (uint8_t i = 0; i < 20U; i++) {
+        fault_manager_set((fault_code_t)(0x40U + i));
+    }
+    CHECK_EQUAL(20, fault_manager_get_count());
+    CHECK_TRUE(fault_manager_is_active((fault_code_t)0x53));
+    
+    fault_manager_clear((fault_code_t)0x45);
+    CHECK_EQUAL(19, fault_manager_get_count());
+    CHECK_FALSE(fault_manager_is_active((fault_code_t)0x45));
+    CHECK_TRUE(fault_manager_is_active((fault_code_t)0x46));
+}
+
+TEST(FaultLifecycle, ReportActivatesAfterDebounce)
+{
+    at(1000);
+    fault_manager_report(FAULT_CODE_DOOR_MOTOR, true);
+    CHECK_FALSE(fault_manager_is_active(FAULT_CODE_DOOR_MOTOR));
+    
+    at(1000 + FAULT_DEBOUNCE_TIME_MS - 10U);
+    fault_manager_report(FAULT_CODE_DOOR_MOTOR, true);
+    CHECK_FALSE(fault_manager_is_active(FAULT_CODE_DOOR_MOTOR));
+    
+    at(1000 + FAULT_DEBOUNCE_TIME_MS);
+    fault_manager_report(FAULT_CODE_DOOR_MOTOR, true);
+    CHECK_TRUE(fault_manager_is_active(FAULT_CODE_DOOR_MOTOR));
+    CHECK_EQUAL(1, fault_manager_get_occurrences(FAULT_CODE_DOOR_MOTOR));
+}
+
+TEST(FaultLifecycle, PassingReportRestartsDebounce)
+{
+    at(1000);
+    fault_manager_report(FAULT_CODE_DOOR_MOTOR, true);
+    at(1050);
+    fault_manager_report(FAULT_CODE_DOOR_MOTOR, false);
+    at(1000 + FAULT_DEBOUNCE_TIME_MS);
+    fault_manager_report(FAULT_CODE_DOOR_MOTOR, true);
+    CHECK_FALSE(fault_manager_is_active(FAULT_CODE_DOOR_MOTOR));
+    
+    at(1000 + 2U * FAULT_DEBOUNCE_TIME_MS);
+    fault_manager_report(FAULT_CODE_DOOR_MOTOR, true);
+    CHECK_TRUE(fault_manager_is_active(FAULT_CODE_DOOR_MOTOR));
+}
+
+TEST(FaultLifecycle, HealsAfterQuietPeriod)
+{
+    at(500);
+    fault_manager_set(FAULT_CODE_INVALID_CHECKSUM);
+    
+    at(500 + FAULT_HEALING_TIME_MS - 100U);
+    CHECK_TRUE(fault_manager_is_active(FAULT_CODE_INVALID_CHECKSUM));
+    
+    /* A repeat failure restarts the healing timer */
+    fault_manager_set(FAULT_CODE_INVALID_CHECKSUM);
+    at(500 + FAULT_HEALING_TIME_MS);
+    CHECK_TRUE(fault_manager_is_active(FAULT_CODE_INVALID_CHECKSUM));
+    
+    at(400 + 2U * FAULT_HEALING_TIME_MS);
+    CHECK_FALSE(fault_manager_is_active(FAULT_CODE_INVALID_CHECKSUM));
+    CHECK_EQUAL(0, fault_manager_get_flags1() & FAULT_BIT_CMD_CHECKSUM);
+    CHECK_EQUAL(0, fault_manager_get_count());
+    
+    /* History survives healing */
+    CHECK_EQUAL(1, fault_manager_get_occurrences(FAULT_CODE_INVALID_CHECKSUM));
+}
+
+TEST(FaultLifecycle, PermanentAfterMaxOccurrences)
+{
+    uint32_t t = 0;
+    for (uint32_t i = 0; i < FAULT_MAX_OCCURRENCES; i++) {
+        at(t);
+        fault_manager_set(FAULT_CODE_TURN_BULB);
+        t += FAULT_HEALING_TIME_MS;
+        at(t);
+    }
+    
+    CHECK_EQUAL(FAULT_MAX_OCCURRENCES, fault_manager_get_occurrences(FAULT_CODE_TURN_BULB));
+    CHECK_TRUE(fault_manager_is_permanent(FAULT_CODE_TURN_BULB));
+    CHECK_TRUE(fault_manager_is_active(FAULT_CODE_TURN_BULB));
+    
+    at(t + 10U * FAULT_HEALING_TIME_MS);
+    CHECK_TRUE(fault_manager_is_active(FAULT_CODE_TURN_BULB));
+    
+    /* Only a manual clear releases it, history included */
+    fault_manager_clear(FAULT_CODE_TURN_BULB);
+    CHECK_FALSE(fault_manager_is_active(FAULT_CODE_TURN_BULB));
+    CHECK_FALSE(fault_manager_is_permanent(FAULT_CODE_TURN_BULB));
+    CHECK_EQUAL(0, fault_manager_get_occurrences(FAULT_CODE_TURN_BULB));
+}
+
+TEST(FaultLifecycle, FullTableReusesHealedSlots)
+{
+    at(0);
+    for (uint8_t i = 0; i < MAX_ACTIVE_FAULTS; i++) {
+        fault_manager_set((fault_code_t)(0x40U + i));
+    }
+    fault_manager_set(FAULT_CODE_TIMEOUT);
+    CHECK_FALSE(fault_manager_is_active(FAULT_CODE_TIMEOUT));
+    
+    /* Everything heals; the slots now only hold history */
+    at(FAULT_HEALING_TIME_MS);
+    CHECK_EQUAL(0, fault_manager_get_count());
+    
+    fault_manager_set(FAULT_CODE_TIMEOUT);
+    CHECK_TRUE(fault_manager_is_active(FAULT_CODE_TIMEOUT));
+    CHECK_EQUAL(1, fault_manager_get_count());
+}
+
+TEST(FaultLifecycle, NoteLogsOncePerWindow)
+{
+    at(0);
+    CHECK_TRUE(fault_manager_note(FAULT_CODE_INVALID_CHECKSUM));
+    for (int i = 0; i < 9; i++) {
+        CHECK_FALSE(fault_manager_note(FAULT_CODE_INVALID_CHECKSUM));
+    }
+    
+    /* Each code has its own window */
+    CHECK_TRUE(fault_manager_report_rx_check(CAN_CHECK_BAD_COUNTER));
+    CHECK_FALSE(fault_manager_report_rx_check(CAN_CHECK_OK));
+    
+    CHECK_TRUE(fault_manager_is_active(FAULT_CODE_INVALID_CHECKSUM));
+    CHECK_EQUAL(1, fault_manager_get_occurrences(FAULT_CODE_INVALID_CHECKSUM));
+    CHECK_EQUAL(9, fault_manager_get_repeats(FAULT_CODE_INVALID_CHECKSUM));
+    
+    /* The 100ms update publishes the window total and starts a new one */
+    at(FAULT_DEBOUNCE_TIME_MS);
+    CHECK_EQUAL(9, fault_manager_get_repeat_rate());
+    CHECK_TRUE(fault_manager_note(FAULT_CODE_INVALID_CHECKSUM));
+    
+    can_frame_t frame;
+    fault_manager_build_status_frame(&frame);
+    CHECK_EQUAL(9, frame.data[FAULT_STATUS_BYTE_REPEATS]);
+    
+    at(2U * FAULT_DEBOUNCE_TIME_MS);
+    CHECK_EQUAL(0, fault_manager_get_repeat_rate());
+    CHECK_EQUAL(9, fault_manager_get_repeats(FAULT_CODE_INVALID_CHECKSUM));
+}
+
+TEST(FaultLifecycle, RepeatRateSaturates)
+{
+    at(0);
+    for (int i = 0; i < 300; i++) {
+        (void)fault_manager_note(FAULT_CODE_INVALID_CMD);
+    }
+    at(100);
+    CHECK_EQUAL(255, fault_manager_get_repeat_rate());
+    CHECK_EQUAL(299, fault_manager_get_repeats(FAULT_CODE_INVALID_CMD));
+    
+    fault_manager_clear(FAULT_CODE_INVALID_CMD);
+    CHECK_EQUAL(0, fault_manager_get_repeats(FAULT_CODE_INVALID_CMD));
+}
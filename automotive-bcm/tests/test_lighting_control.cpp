@@ -6,7 +6,8 @@
  * - Off/On/Auto mode transitions
  * - Invalid mode rejection
  * - High beam control
- * - Interior light control
+ * - Interior light control and fade
+ * - Next deadline: output settling and ambient sensor timeout
  */
 
 #include "CppUTest/TestHarness.h"
@@ -16,6 +17,7 @@ extern "C" {
 #include "fault_manager.h"
 #include "can_interface.h"
 #include "can_ids.h"
+#include "bcm_config.h"
 }
 
 /*******************************************************************************
@@ -36,6 +38,20 @@ static can_frame_t build_lighting_cmd(uint8_t headlight, uint8_t interior, uint8
     return frame;
 }
 
+/** 10ms runs a fade takes */
+#define FADE_RUNS   (LIGHT_INTERIOR_FADE_MS / BCM_MAIN_CYCLE_TIME_MS)
+
+/** Run the 10ms lighting update n times, returning the time after the last */
+static uint32_t run_updates(uint32_t start_ms, uint32_t n)
+{
+    uint32_t now = start_ms;
+    for (uint32_t i = 0; i < n; i++) {
+        now += BCM_MAIN_CYCLE_TIME_MS;
+        lighting_control_update(now);
+    }
+    return now;
+}
+
 /*******************************************************************************
  * Test Group: Lighting Initialization
  ******************************************************************************/
@@ -190,6 +206,34 @@ TEST(AutoModeBehavior, StaysOffWhenBright)
     CHECK_EQUAL(HEADLIGHT_STATE_OFF, lighting_control_get_headlight_output());
 }
 
+TEST(AutoModeBehavior, NextDeadlineSettlesHysteresis)
+{
+    lighting_control_set_headlight_mode(LIGHTING_STATE_ON);
+    CHECK_EQUAL(100U + SYS_DEADLINE_IDLE_MS, lighting_control_next_deadline(100));
+    
+    /* ON -> AUTO in bright light: first AUTO, OFF on the next update */
+    lighting_control_set_ambient(200);
+    lighting_control_set_headlight_mode(LIGHTING_STATE_AUTO);
+    CHECK_EQUAL(HEADLIGHT_STATE_AUTO, lighting_control_get_headlight_output());
+    CHECK_EQUAL(100U, lighting_control_next_deadline(100));
+    
+    lighting_control_update(100);
+    CHECK_EQUAL(HEADLIGHT_STATE_OFF, lighting_control_get_headlight_output());
+}
+
+TEST(AutoModeBehavior, NextDeadlineIsSensorTimeout)
+{
+    sys_state_update_time(1000);
+    lighting_control_set_headlight_mode(LIGHTING_STATE_AUTO);
+    lighting_control_set_ambient(50);
+    lighting_control_update(1000);
+    
+    uint32_t timeout_ms = 1000U + 10000U + 1U;
+    CHECK_EQUAL(timeout_ms, lighting_control_next_deadline(1010));
+    CHECK_EQUAL(timeout_ms, lighting_control_next_deadline(timeout_ms));
+    CHECK_EQUAL(timeout_ms + 10U, lighting_control_next_deadline(timeout_ms + 10U));
+}
+
 /*******************************************************************************
  * Test Group: Interior Light Control
  ******************************************************************************/
@@ -233,6 +277,95 @@ TEST(InteriorControl, TurnOff)
     CHECK_EQUAL(0, lighting_control_get_interior_brightness());
 }
 
+TEST(InteriorControl, FadesToFullDutyInFadeTime)
+{
+    lighting_control_set_interior(LIGHTING_STATE_ON, 15);
+    CHECK_EQUAL(0, lighting_control_get_interior_duty());
+    CHECK_EQUAL(1000U, lighting_control_next_deadline(1000U));
+    
+    uint32_t now = run_updates(1000U, FADE_RUNS - 1U);
+    CHECK_TRUE(lighting_control_get_interior_duty() < LIGHT_PWM_MAX_DUTY);
+    CHECK_EQUAL(now, lighting_control_next_deadline(now));
+    
+    now = run_updates(now, 1U);
+    CHECK_EQUAL(LIGHT_PWM_MAX_DUTY, lighting_control_get_interior_duty());
+    CHECK_EQUAL(now + SYS_DEADLINE_IDLE_MS, lighting_control_next_deadline(now));
+}
+
+TEST(InteriorControl, FadeIsMonotonicAndGammaCorrected)
+{
+    lighting_control_set_interior(LIGHTING_STATE_ON, 15);
+    
+    uint8_t last = 0;
+    uint8_t halfway = 0;
+    for (uint32_t i = 1; i <= FADE_RUNS; i++) {
+        (void)run_updates(i * BCM_MAIN_CYCLE_TIME_MS, 1U);
+        uint8_t duty = lighting_control_get_interior_duty();
+        CHECK_TRUE(duty >= last);
+        last = duty;
+        if (i == FADE_RUNS / 2U) {
+            halfway = duty;
+        }
+    }
+    
+    /* Half the perceived brightness is well under half the duty */
+    CHECK_TRUE(halfway > 0U);
+    CHECK_TRUE(halfway < LIGHT_PWM_MAX_DUTY / 4U);
+}
+
+TEST(InteriorControl, SmallChangeFadesOverFadeTime)
+{
+    lighting_control_set_interior(LIGHTING_STATE_ON, 15);
+    uint32_t now = run_updates(0U, FADE_RUNS);
+    
+    lighting_control_set_interior(LIGHTING_STATE_ON, 14);
+    now = run_updates(now, FADE_RUNS / 2U);
+    uint8_t duty = lighting_control_get_interior_duty();
+    CHECK_TRUE(duty < LIGHT_PWM_MAX_DUTY);
+    CHECK_EQUAL(now, lighting_control_next_deadline(now));
+    
+    now = run_updates(now, FADE_RUNS / 2U);
+    CHECK_TRUE(lighting_control_get_interior_duty() < duty);
+    CHECK_EQUAL(now + SYS_DEADLINE_IDLE_MS, lighting_control_next_deadline(now));
+}
+
+TEST(InteriorControl, RepeatedCommandKeepsRamp)
+{
+    uint8_t interior_byte = INTERIOR_CMD_ON | (15 << 4);
+    can_frame_t frame = build_lighting_cmd(HEADLIGHT_CMD_OFF, interior_byte, 0);
+    CHECK_EQUAL(CMD_RESULT_OK, lighting_control_handle_cmd(&frame));
+    
+    uint32_t now = run_updates(0U, FADE_RUNS / 2U);
+    frame = build_lighting_cmd(HEADLIGHT_CMD_OFF, interior_byte, 1);
+    CHECK_EQUAL(CMD_RESULT_OK, lighting_control_handle_cmd(&frame));
+    
+    (void)run_updates(now, FADE_RUNS - FADE_RUNS / 2U);
+    CHECK_EQUAL(LIGHT_PWM_MAX_DUTY, lighting_control_get_interior_duty());
+}
+
+TEST(InteriorControl, OffFadesOutAndStatusCarriesDuty)
+{
+    lighting_control_set_interior(LIGHTING_STATE_ON, 15);
+    uint32_t now = run_updates(0U, FADE_RUNS);
+    
+    can_frame_t status;
+    lighting_control_build_status_frame(&status);
+    CHECK_EQUAL(LIGHT_PWM_MAX_DUTY, status.data[LIGHTING_STATUS_BYTE_DUTY]);
+    
+    can_frame_t frame = build_lighting_cmd(HEADLIGHT_CMD_OFF, INTERIOR_CMD_OFF, 0);
+    CHECK_EQUAL(CMD_RESULT_OK, lighting_control_handle_cmd(&frame));
+    now = run_updates(now, FADE_RUNS / 2U);
+    lighting_control_build_status_frame(&status);
+    CHECK_TRUE(status.data[LIGHTING_STATUS_BYTE_DUTY] > 0U);
+    CHECK_TRUE(status.data[LIGHTING_STATUS_BYTE_DUTY] < LIGHT_PWM_MAX_DUTY);
+    
+    (void)run_updates(now, FADE_RUNS - FADE_RUNS / 2U);
+    lighting_control_build_status_frame(&status);
+    CHECK_EQUAL(0, status.data[LIGHTING_STATUS_BYTE_DUTY]);
+    CHECK_EQUAL(can_calculate_checksum(status.data, LIGHTING_STATUS_DLC - 1),
+                status.data[LIGHTING_STATUS_BYTE_CHECKSUM]);
+}
+
 /*******************************************************************************
  * Test Group: Lighting Command Validation
  ******************************************************************************/
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""
+BCM Trace Decoder
+
+Decodes the binary trace ring written by bcm_app / bcm_replay with -t
+(see include/bcm_trace.h for the file layout) and prints the records
+oldest first.
+
+Usage:
+    python bcm_trace_decode.py [options] <trace.bin>
+
+Options:
+    --kind, -k      Only show rx, tx or event records (repeatable)
+    --id            Only show frames with this CAN ID (hex)
+    --candump       Print frames in candump log format (for bcm_replay)
+
+Examples:
+    python bcm_trace_decode.py bcm.trc                  # Everything
+    python bcm_trace_decode.py -k event bcm.trc         # Events only
+    python bcm_trace_decode.py -k rx --candump bcm.trc > rx.log
+"""
+
+import argparse
+import struct
+import sys
+
+# =============================================================================
+# File Format (must match bcm_trace.h)
+# =============================================================================
+
+TRACE_MAGIC         = 0x43525442
+TRACE_VERSION       = 1
+
+HEADER_FORMAT       = '<IHHIIQ40x'
+HEADER_SIZE         = struct.calcsize(HEADER_FORMAT)    # 64
+RECORD_FORMAT       = '<IIIBBBx8s'
+RECORD_SIZE         = struct.calcsize(RECORD_FORMAT)    # 24
+
+KIND_RX             = 0
+KIND_TX             = 1
+KIND_EVENT          = 2
+
+KIND_NAMES = {KIND_RX: 'RX', KIND_TX: 'TX', KIND_EVENT: 'EV'}
+KIND_ARGS = {'rx': KIND_RX, 'tx': KIND_TX, 'event': KIND_EVENT}
+
+RESULT_NONE         = 0xFF
+
+# cmd_result_t (can_ids.h)
+RESULT_NAMES = {
+    0x00: 'OK',
+    0x01: 'INVALID_CMD',
+    0x02: 'CHECKSUM_ERROR',
+    0x03: 'COUNTER_ERROR',
+    0x04: 'TIMEOUT',
+}
+
+# event_type_t (system_state.h)
+EVENT_NAMES = [
+    'NONE',
+    'DOOR_LOCK_CHANGE',
+    'DOOR_OPEN_CHANGE',
+    'HEADLIGHT_CHANGE',
+    'INTERIOR_CHANGE',
+    'TURN_SIGNAL_CHANGE',
+    'FAULT_SET',
+    'FAULT_CLEAR',
+    'CMD_RECEIVED',
+    'CMD_ERROR',
+    'STATE_CHANGE',
+]
+
+# =============================================================================
+# Decoding
+# =============================================================================
+
+def read_trace(path):
+    """Return (header dict, records oldest first)"""
+    with open(path, 'rb') as f:
+        blob = f.read()
+    
+    if len(blob) < HEADER_SIZE:
+        raise ValueError('file too short for a trace header')
+    
+    magic, version, record_size, capacity, _, written = \
+        struct.unpack_from(HEADER_FORMAT, blob, 0)
+    if magic != TRACE_MAGIC:
+        raise ValueError('bad magic 0x%08X' % magic)
+    if version != TRACE_VERSION or record_size != RECORD_SIZE:
+        raise ValueError('unsupported version %d / record size %d' % (version, record_size))
+    if len(blob) < HEADER_SIZE + capacity * RECORD_SIZE:
+        raise ValueError('file truncated')
+    
+    header = {'capacity': capacity, 'written': written}
+    
+    # Once wrapped, the oldest surviving record sits at written % capacity
+    count = min(written, capacity)
+    first = (written - count) % capacity if capacity else 0
+    
+    records = []
+    for n in range(count):
+        slot = (first + n) % capacity
+        seq, ts, can_id, kind, dlc, result, data = \
+            struct.unpack_from(RECORD_FORMAT, blob, HEADER_SIZE + slot * RECORD_SIZE)
+        if seq == 0:
+            continue    # Never written (process died between claim and fill)
+        records.append({
+            'seq': seq, 'ts': ts, 'id': can_id, 'kind': kind,
+            'dlc': min(dlc, 8), 'result': result, 'data': data,
+        })
+    
+    return header, records
+
+def format_record(rec):
+    payload = rec['data'][:rec['dlc']]
+    ts = '%6u.%03u' % (rec['ts'] // 1000, rec['ts'] % 1000)
+    kind = KIND_NAMES.get(rec['kind'], '??')
+    
+    if rec['kind'] == KIND_EVENT:
+        name = EVENT_NAMES[rec['id']] if rec['id'] < len(EVENT_NAMES) else str(rec['id'])
+        return '%8u %s %s %-18s [%s]' % (rec['seq'], ts, kind, name,
+                                         ' '.join('%02X' % b for b in payload))
+    
+    line = '%8u %s %s %03X [%d] %-24s' % (rec['seq'], ts, kind, rec['id'], rec['dlc'],
+                                          ' '.join('%02X' % b for b in payload))
+    if rec['result'] != RESULT_NONE:
+        line += ' ' + RESULT_NAMES.get(rec['result'], '0x%02X' % rec['result'])
+    elif rec['kind'] == KIND_RX:
+        line += ' (no handler)'
+    return line.rstrip()
+
+def format_candump(rec):
+    payload = rec['data'][:rec['dlc']]
+    return '(%u.%06u) %s %03X#%s' % (rec['ts'] // 1000, (rec['ts'] % 1000) * 1000,
+                                     'bcm' if rec['kind'] == KIND_TX else 'can0',
+                                     rec['id'],
+                                     ''.join('%02X' % b for b in payload))
+
+# =============================================================================
+# Main
+# =============================================================================
+
+def main():
+    parser = argparse.ArgumentParser(description='BCM Trace Decoder')
+    parser.add_argument('trace', help='Trace file written with -t')
+    parser.add_argument('-k', '--kind', action='append', choices=sorted(KIND_ARGS),
+                        help='Only show this record kind (repeatable)')
+    parser.add_argument('--id', type=lambda s: int(s, 16),
+                        help='Only show frames with this CAN ID (hex)')
+    parser.add_argument('--candump', action='store_true',
+                        help='Print frames in candump log format')
+    
+    args = parser.parse_args()
+    
+    try:
+        header, records = read_trace(args.trace)
+    except (OSError, ValueError) as e:
+        print(f"Error: {e}", file=sys.stderr)
+        sys.exit(1)
+    
+    kinds = {KIND_ARGS[k] for k in args.kind} if args.kind else None
+    if args.candump:
+        kinds = (kinds or {KIND_RX, KIND_TX}) - {KIND_EVENT}
+    
+    shown = 0
+    for rec in records:
+        if kinds is not None and rec['kind'] not in kinds:
+            continue
+        if args.id is not None and (rec['kind'] == KIND_EVENT or rec['id'] != args.id):
+            continue
+        print(format_candump(rec) if args.candump else format_record(rec))
+        shown += 1
+    
+    lost = max(header['written'] - header['capacity'], 0)
+    print(f"# {header['written']} records written, {lost} overwritten, {shown} shown",
+          file=sys.stderr)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,629 @@
+#!/usr/bin/env python3
+"""
+BCM CAN Code Generator
+
+Reads the CAN schema (config/bcm.dbc) and generates the C pack/unpack
+code and validation descriptors used by the BCM:
+    
+    can_messages.h  Per-message struct, static inline encode (received
+                    messages) or incremental update (sent messages) and
+                    decode functions, and descriptor declarations
+    can_messages.c  can_msg_desc_t/can_field_rule_t tables for can_check.h
+                    and compile-time checks against can_ids.h
+
+The build runs this from a CMake custom command. The module is also the
+schema loader for the Python tools (can_simulator.py), so both sides
+derive IDs, layouts and command values from the same file.
+
+Supported DBC subset: BO_, SG_ (unsigned Intel order, @1+), CM_, BA_ and
+VAL_. Signals named Counter, Version and Checksum are the rolling counter
+nibble, schema version nibble and XOR checksum byte every BCM message
+carries. A signal whose [min|max] is narrower than its raw width becomes
+a field range rule; it must then sit within one byte.
+
+Usage:
+    python can_codegen.py [options] <schema.dbc>
+
+Options:
+    --out-dir, -o   Directory for can_messages.h/.c (default: .)
+    --list          Print the parsed messages instead of generating
+
+Examples:
+    python can_codegen.py -o build/generated config/bcm.dbc
+    python can_codegen.py --list config/bcm.dbc
+"""
+
+import argparse
+import os
+import re
+import sys
+
+# =============================================================================
+# Schema Model
+# =============================================================================
+
+SIGNAL_COUNTER      = 'Counter'
+SIGNAL_VERSION      = 'Version'
+SIGNAL_CHECKSUM     = 'Checksum'
+SPECIAL_SIGNALS     = (SIGNAL_COUNTER, SIGNAL_VERSION, SIGNAL_CHECKSUM)
+
+CAN_MAX_DLC         = 8
+
+class SchemaError(Exception):
+    """Invalid or unsupported schema content"""
+
+def snake_case(name):
+    """DoorId -> door_id, P50 -> p50"""
+    return re.sub(r'(?<=[a-z0-9])(?=[A-Z])', '_', name).lower()
+
+class Signal:
+    def __init__(self, name, start, length, factor, offset, minimum, maximum, unit):
+        self.name = name
+        self.start = start
+        self.length = length
+        self.factor = factor
+        self.offset = offset
+        self.minimum = minimum
+        self.maximum = maximum
+        self.unit = unit
+        self.comment = ''
+        self.values = {}
+    
+    @property
+    def c_name(self):
+        return snake_case(self.name)
+    
+    @property
+    def raw_max(self):
+        return (1 << self.length) - 1
+    
+    def raw_range(self):
+        """[min|max] converted to raw values"""
+        lo = round((self.minimum - self.offset) / self.factor)
+        hi = round((self.maximum - self.offset) / self.factor)
+        return max(lo, 0), min(hi, self.raw_max)
+    
+    def has_rule(self):
+        lo, hi = self.raw_range()
+        return self.name not in SPECIAL_SIGNALS and (lo > 0 or hi < self.raw_max)
+    
+    def parts(self):
+        """(byte, shift in byte, value shift, width) pieces, low bits first"""
+        pieces = []
+        bit = self.start
+        done = 0
+        while done < self.length:
+            shift = bit % 8
+            width = min(8 - shift, self.length - done)
+            pieces.append((bit // 8, shift, done, width))
+            bit += width
+            done += width
+        return pieces
+    
+    def byte_mask(self):
+        """(byte, mask) of a signal within one byte"""
+        (byte, shift, _, width), = self.parts()
+        return byte, ((1 << width) - 1) << shift
+
+class Message:
+    def __init__(self, frame_id, name, dlc, sender):
+        self.frame_id = frame_id
+        self.name = name
+        self.dlc = dlc
+        self.sender = sender
+        self.comment = ''
+        self.signals = []
+        self.version = 0
+        self.seed = 0
+    
+    @property
+    def c_name(self):
+        return self.name.lower()
+    
+    def signal(self, name):
+        for sig in self.signals:
+            if sig.name == name:
+                return sig
+        raise KeyError(f'{self.name} has no signal {name}')
+    
+    def fields(self):
+        """Payload signals, without counter, version and checksum"""
+        return [s for s in self.signals if s.name not in SPECIAL_SIGNALS]
+    
+    def ver_ctr_byte(self):
+        return self.signal(SIGNAL_COUNTER).start // 8
+    
+    def value(self, signal, label):
+        """Raw value of a VAL_ label, e.g. value('Command', 'LOCK_ALL')"""
+        for raw, text in self.signal(signal).values.items():
+            if text == label:
+                return raw
+        raise KeyError(f'{self.name}.{signal} has no value {label}')
+    
+    def encode(self, counter, **fields):
+        """Payload bytes with version, counter and checksum filled in"""
+        data = [0] * self.dlc
+        raw = dict(fields)
+        raw[SIGNAL_COUNTER] = counter
+        raw[SIGNAL_VERSION] = self.version
+        for sig in self.signals:
+            if sig.name == SIGNAL_CHECKSUM:
+                continue
+            value = raw.pop(sig.name, 0) & sig.raw_max
+            for byte, shift, vshift, width in sig.parts():
+                data[byte] |= ((value >> vshift) & ((1 << width) - 1)) << shift
+        if raw:
+            raise KeyError(f'{self.name} has no signal {", ".join(sorted(raw))}')
+        
+        checksum = self.seed
+        for byte in data[:-1]:
+            checksum ^= byte
+        data[-1] = checksum
+        return bytes(data)
+    
+    def decode(self, data):
+        """Signal values by name, including counter and version"""
+        values = {}
+        for sig in self.signals:
+            value = 0
+            for byte, shift, vshift, width in sig.parts():
+                value |= ((data[byte] >> shift) & ((1 << width) - 1)) << vshift
+            values[sig.name] = value
+        return values
+
+class Schema:
+    def __init__(self):
+        self.messages = []
+        self.attributes = {}
+        self.comment = ''
+    
+    @property
+    def version(self):
+        return int(self.attributes.get('BcmSchemaVersion', 0))
+    
+    @property
+    def seed(self):
+        return int(self.attributes.get('BcmChecksumSeed', 0))
+    
+    def message(self, name):
+        for msg in self.messages:
+            if msg.name == name:
+                return msg
+        raise KeyError(f'schema has no message {name}')
+    
+    def by_id(self, frame_id):
+        for msg in self.messages:
+            if msg.frame_id == frame_id:
+                return msg
+        return None
+
+# =============================================================================
+# DBC Parsing
+# =============================================================================
+
+RE_MESSAGE = re.compile(r'BO_\s+(\d+)\s+(\w+)\s*:\s*(\d+)\s+(\w+)')
+RE_SIGNAL = re.compile(r'SG_\s+(\w+)\s*:\s*(\d+)\|(\d+)@([01])([+-])\s*'
+                       r'\(([^,]+),([^)]+)\)\s*\[([^|]+)\|([^\]]+)\]\s*"([^"]*)"')
+RE_COMMENT = re.compile(r'CM_\s+(?:(BO_|SG_)\s+(\d+)\s+(?:(\w+)\s+)?)?"((?:[^"\\]|\\.)*)"\s*;',
+                        re.S)
+RE_ATTRIBUTE = re.compile(r'BA_\s+"(\w+)"\s+([^;]+);')
+RE_VALUES = re.compile(r'VAL_\s+(\d+)\s+(\w+)\s+((?:-?\d+\s+"[^"]*"\s*)*);')
+RE_VALUE_PAIR = re.compile(r'(-?\d+)\s+"([^"]*)"')
+
+def number(text):
+    value = float(text)
+    return int(value) if value.is_integer() else value
+
+def parse_dbc(text):
+    """Parse DBC text into a Schema"""
+    schema = Schema()
+    msg = None
+    
+    for lineno, line in enumerate(text.splitlines(), 1):
+        stripped = line.strip()
+        if stripped.startswith('BO_ '):
+            m = RE_MESSAGE.match(stripped)
+            if not m:
+                raise SchemaError(f'line {lineno}: bad message definition')
+            msg = Message(int(m.group(1)), m.group(2), int(m.group(3)), m.group(4))
+            schema.messages.append(msg)
+        elif stripped.startswith('SG_ '):
+            m = RE_SIGNAL.match(stripped)
+            if not m or msg is None:
+                raise SchemaError(f'line {lineno}: bad signal definition')
+            if m.group(4) != '1' or m.group(5) != '+':
+                raise SchemaError(f'line {lineno}: only unsigned Intel (@1+) signals are supported')
+            msg.signals.append(Signal(m.group(1), int(m.group(2)), int(m.group(3)),
+                                      number(m.group(6)), number(m.group(7)),
+                                      number(m.group(8)), number(m.group(9)), m.group(10)))
+        elif stripped and not stripped.startswith('SG_'):
+            msg = None
+    
+    for m in RE_COMMENT.finditer(text):
+        kind, frame_id, signal, comment = m.groups()
+        comment = ' '.join(comment.split())
+        if kind is None:
+            schema.comment = comment
+            continue
+        target = schema.by_id(int(frame_id))
+        if target is None:
+            raise SchemaError(f'comment for unknown message {frame_id}')
+        if kind == 'BO_':
+            target.comment = comment
+        else:
+            target.signal(signal).comment = comment
+    
+    for m in RE_ATTRIBUTE.finditer(text):
+        schema.attributes[m.group(1)] = m.group(2).strip().strip('"')
+    
+    for m in RE_VALUES.finditer(text):
+        target = schema.by_id(int(m.group(1)))
+        if target is None:
+            raise SchemaError(f'value table for unknown message {m.group(1)}')
+        target.signal(m.group(2)).values = {
+            int(raw): label for raw, label in RE_VALUE_PAIR.findall(m.group(3))
+        }
+    
+    for msg in schema.messages:
+        msg.version = schema.version
+        msg.seed = schema.seed
+        check_message(msg)
+    return schema
+
+def check_message(msg):
+    """Layout rules the C side relies on"""
+    if not 1 < msg.dlc <= CAN_MAX_DLC:
+        raise SchemaError(f'{msg.name}: DLC {msg.dlc} not in 2..{CAN_MAX_DLC}')
+    
+    used = 0
+    for sig in msg.signals:
+        if sig.length < 1 or sig.start + sig.length > msg.dlc * 8:
+            raise SchemaError(f'{msg.name}.{sig.name}: outside the {msg.dlc} byte payload')
+        bits = ((1 << sig.length) - 1) << sig.start
+        if used & bits:
+            raise SchemaError(f'{msg.name}.{sig.name}: overlaps another signal')
+        used |= bits
+        if sig.has_rule() and len(sig.parts()) != 1:
+            raise SchemaError(f'{msg.name}.{sig.name}: ranged signals must sit within one byte')
+    
+    try:
+        counter = msg.signal(SIGNAL_COUNTER)
+        version = msg.signal(SIGNAL_VERSION)
+        checksum = msg.signal(SIGNAL_CHECKSUM)
+    except KeyError as e:
+        raise SchemaError(str(e).strip("'")) from None
+    
+    # CAN_BUILD_VER_CTR(): version in the high nibble, counter in the low one
+    if counter.length != 4 or counter.start % 8 != 0 or \
+       version.length != 4 or version.start != counter.start + 4:
+        raise SchemaError(f'{msg.name}: Counter/Version must be the low/high nibble of one byte')
+    if checksum.start != (msg.dlc - 1) * 8 or checksum.length != 8:
+        raise SchemaError(f'{msg.name}: Checksum must be the last byte')
+
+def load_dbc(path):
+    """Load and validate a DBC schema file"""
+    with open(path, encoding='utf-8') as f:
+        return parse_dbc(f.read())
+
+# =============================================================================
+# C Generation
+# =============================================================================
+
+HEADER_GUARD        = 'CAN_MESSAGES_H'
+
+def c_type(sig):
+    if sig.length <= 8:
+        return 'uint8_t'
+    return 'uint16_t' if sig.length <= 16 else 'uint32_t'
+
+def hex_u(value):
+    return f'0x{value:02X}U'
+
+def byte_terms(msg, byte, value_of):
+    """OR terms of every signal piece that lands in one byte"""
+    terms = []
+    for sig in msg.signals:
+        if sig.name == SIGNAL_CHECKSUM:
+            continue
+        for b, shift, vshift, width in sig.parts():
+            if b != byte:
+                continue
+            term = value_of(sig)
+            if vshift:
+                term = f'({term} >> {vshift})'
+            if width < 8:
+                term = f'({term} & {hex_u((1 << width) - 1)})'
+            if shift:
+                term = f'({term} << {shift})'
+            terms.append(term)
+    return terms
+
+def gen_struct(msg):
+    out = [f'/** {msg.comment or msg.name} (0x{msg.frame_id:03X}) */', 'typedef struct {']
+    for sig in msg.fields():
+        doc = sig.comment
+        if sig.values:
+            doc = doc or ', '.join(f'{v} {k}' for k, v in sorted(sig.values.items()))
+        if sig.unit:
+            doc = f'{doc}, {sig.unit}' if doc else sig.unit
+        line = f'    {c_type(sig):<12}{sig.c_name};'
+        out.append(f'{line:<40}/**< {doc} */' if doc else line)
+    if not msg.fields():
+        out.append('    uint8_t     reserved;')
+    out.append(f'}} can_msg_{msg.c_name}_t;')
+    return out
+
+def gen_encode(msg):
+    name = msg.c_name
+    upper = msg.name
+    cs = msg.dlc - 1
+    out = [
+        '/**',
+        f' * @brief Pack {msg.name}: all {CAN_MAX_DLC} payload bytes, version, counter and checksum',
+        ' */',
+        f'static inline void can_msg_{name}_encode(can_frame_t *frame,',
+        f'{"":>{len(name) + 35}}const can_msg_{name}_t *msg, uint8_t counter)',
+        '{',
+        f'    frame->id = CAN_MSG_{upper}_ID;',
+        f'    frame->dlc = CAN_MSG_{upper}_DLC;',
+        '    frame->reserved[0] = 0;',
+        '    frame->reserved[1] = 0;',
+        '    frame->reserved[2] = 0;',
+    ]
+    
+    def value_of(sig):
+        if sig.name == SIGNAL_COUNTER:
+            return 'counter'
+        if sig.name == SIGNAL_VERSION:
+            return 'CAN_MSG_SCHEMA_VERSION'
+        return f'msg->{sig.c_name}'
+    
+    for byte in range(CAN_MAX_DLC):
+        if byte == cs:
+            chain = ' ^ '.join(f'frame->data[{b}]' for b in range(cs))
+            out.append(f'    frame->data[{cs}] = (uint8_t)(CAN_MSG_CHECKSUM_SEED ^')
+            out.append(f'                              {chain});')
+            continue
+        terms = byte_terms(msg, byte, value_of) if byte < cs else []
+        if not terms:
+            expr = '0'
+        elif len(terms) == 1 and not terms[0].startswith('(('):
+            expr = f'(uint8_t){terms[0]}'
+        else:
+            expr = f'(uint8_t)({" | ".join(terms)})'
+        out.append(f'    frame->data[{byte}] = {expr};')
+    out.append('}')
+    return out
+
+def gen_update(msg):
+    name = msg.c_name
+    upper = msg.name
+    out = [
+        '/**',
+        f' * @brief Bring a {msg.name} TX template up to date',
+        ' *',
+        ' * Goes through can_frame_put() byte by byte, so unchanged bytes are not',
+        ' * written and the checksum follows each change.',
+        ' *',
+        f' * @param frame Frame from can_frame_template_init() with CAN_MSG_{upper}_ID',
+        ' * @param msg Payload fields',
+        ' * @param counter Rolling counter (low nibble used)',
+        ' */',
+        f'static inline void can_msg_{name}_update(can_frame_t *frame,',
+        f'{"":>{len(name) + 35}}const can_msg_{name}_t *msg, uint8_t counter)',
+        '{',
+    ]
+    
+    def value_of(sig):
+        if sig.name == SIGNAL_COUNTER:
+            return 'counter'
+        if sig.name == SIGNAL_VERSION:
+            return 'CAN_MSG_SCHEMA_VERSION'
+        return f'msg->{sig.c_name}'
+    
+    for byte in range(msg.dlc - 1):
+        terms = byte_terms(msg, byte, value_of)
+        if not terms:
+            continue
+        if len(terms) == 1 and not terms[0].startswith('(('):
+            expr = f'(uint8_t){terms[0]}'
+        else:
+            expr = f'(uint8_t)({" | ".join(terms)})'
+        out.append(f'    can_frame_put(frame, {byte}U, {expr});')
+    out.append('}')
+    return out
+
+def is_tx(msg):
+    """Sent by the BCM: built from TX pool templates, never packed whole"""
+    return msg.sender == 'BCM'
+
+def gen_decode(msg):
+    name = msg.c_name
+    out = [
+        '/**',
+        f' * @brief Unpack the {msg.name} payload fields (validate with can_msg_{name}_desc first)',
+        ' */',
+        f'static inline void can_msg_{name}_decode(const can_frame_t *frame,',
+        f'{"":>{len(name) + 35}}can_msg_{name}_t *msg)',
+        '{',
+    ]
+    for sig in msg.fields():
+        terms = []
+        for byte, shift, vshift, width in sig.parts():
+            term = f'frame->data[{byte}]'
+            if shift:
+                term = f'({term} >> {shift})'
+            if width < 8:
+                term = f'({term} & {hex_u((1 << width) - 1)})'
+            if vshift:
+                term = f'((uint32_t){term} << {vshift})'
+            terms.append(term)
+        expr = terms[0] if len(terms) == 1 else f'({" | ".join(terms)})'
+        out.append(f'    msg->{sig.c_name} = ({c_type(sig)}){expr};')
+    if not msg.fields():
+        out.append('    (void)frame;')
+        out.append('    msg->reserved = 0;')
+    out.append('}')
+    return out
+
+def banner(title):
+    return ['/' + '*' * 79, f' * {title}', ' ' + '*' * 78 + '/']
+
+def generate_header(schema, source):
+    out = [
+        '/**',
+        ' * @file can_messages.h',
+        ' * @brief CAN Message Pack/Unpack (generated)',
+        ' *',
+        f' * Generated by tools/can_codegen.py from {source}. Do not edit.',
+        ' *',
+        ' * Messages the BCM receives get encode, which writes every payload byte',
+        ' * with straight-line shifts and masks and folds the XOR checksum in the',
+        ' * same pass. Messages the BCM sends get update instead, which refreshes',
+        ' * a TX template through can_frame_put(). Decode extracts the payload',
+        ' * fields. None of them validates: run can_check_frame() with the',
+        ' * message descriptor before decoding received frames.',
+        ' */',
+        '',
+        f'#ifndef {HEADER_GUARD}',
+        f'#define {HEADER_GUARD}',
+        '',
+        '#ifdef __cplusplus',
+        'extern "C" {',
+        '#endif',
+        '',
+        '#include <stdint.h>',
+        '#include "can_interface.h"',
+        '#include "can_check.h"',
+        '',
+    ]
+    out += banner('Schema')
+    out += [
+        '',
+        f'#define CAN_MSG_SCHEMA_VERSION  {hex_u(schema.version)}',
+        f'#define CAN_MSG_CHECKSUM_SEED   {hex_u(schema.seed)}',
+        '',
+    ]
+    for msg in schema.messages:
+        out.append(f'#define CAN_MSG_{msg.name + "_ID":<24}0x{msg.frame_id:03X}U')
+        out.append(f'#define CAN_MSG_{msg.name + "_DLC":<24}{msg.dlc}U')
+    out.append('')
+    
+    for msg in schema.messages:
+        out += banner(msg.name)
+        out.append('')
+        out += gen_struct(msg)
+        out.append('')
+        out.append(f'/** Validation descriptor for can_check_frame()/can_check_batch() */')
+        out.append(f'extern const can_msg_desc_t can_msg_{msg.c_name}_desc;')
+        out.append('')
+        out += gen_update(msg) if is_tx(msg) else gen_encode(msg)
+        out.append('')
+        out += gen_decode(msg)
+        out.append('')
+    
+    out += [
+        '#ifdef __cplusplus',
+        '}',
+        '#endif',
+        '',
+        f'#endif /* {HEADER_GUARD} */',
+        '',
+    ]
+    return '\n'.join(out)
+
+def generate_source(schema, source):
+    out = [
+        '/**',
+        ' * @file can_messages.c',
+        ' * @brief CAN Message Validation Descriptors (generated)',
+        ' *',
+        f' * Generated by tools/can_codegen.py from {source}. Do not edit.',
+        ' * The static assertions fail the build when the schema and can_ids.h',
+        ' * disagree on an ID, DLC, schema version or checksum seed.',
+        ' */',
+        '',
+        '#include "can_messages.h"',
+        '#include "can_ids.h"',
+        '',
+    ]
+    out += banner('Schema Checks')
+    out += [
+        '',
+        '_Static_assert(CAN_MSG_SCHEMA_VERSION == CAN_SCHEMA_VERSION, "schema version differs from can_ids.h");',
+        '_Static_assert(CAN_MSG_CHECKSUM_SEED == CAN_CHECKSUM_SEED, "checksum seed differs from can_ids.h");',
+    ]
+    for msg in schema.messages:
+        out.append(f'_Static_assert(CAN_MSG_{msg.name}_ID == CAN_ID_{msg.name}, '
+                   f'"{msg.name} ID differs from can_ids.h");')
+        out.append(f'_Static_assert(CAN_MSG_{msg.name}_DLC == {msg.name}_DLC, '
+                   f'"{msg.name} DLC differs from can_ids.h");')
+    out.append('')
+    
+    out += banner('Descriptors')
+    for msg in schema.messages:
+        rules = [s for s in msg.fields() if s.has_rule()]
+        out.append('')
+        if rules:
+            out.append(f'static const can_field_rule_t g_{msg.c_name}_fields[] = {{')
+            for sig in rules:
+                byte, mask = sig.byte_mask()
+                lo, hi = sig.raw_range()
+                shift = sig.parts()[0][1]
+                out.append(f'    {{ {byte}U, {hex_u(mask)}, {hex_u(lo << shift)}, '
+                           f'{hex_u(hi << shift)} }},   /* {sig.name} {lo}..{hi} */')
+            out.append('};')
+            out.append('')
+        fields = f'g_{msg.c_name}_fields' if rules else 'NULL'
+        out.append(f'const can_msg_desc_t can_msg_{msg.c_name}_desc = {{')
+        out.append(f'    CAN_MSG_{msg.name}_DLC, {msg.ver_ctr_byte()}U, {len(rules)}U, {fields}')
+        out.append('};')
+    out.append('')
+    return '\n'.join(out)
+
+def write_if_changed(path, text):
+    """Keep the timestamp when nothing changed, so dependents don't rebuild"""
+    try:
+        with open(path, encoding='utf-8') as f:
+            if f.read() == text:
+                return
+    except OSError:
+        pass
+    with open(path, 'w', encoding='utf-8') as f:
+        f.write(text)
+
+# =============================================================================
+# Main
+# =============================================================================
+
+def main():
+    parser = argparse.ArgumentParser(description='BCM CAN Code Generator')
+    parser.add_argument('schema', help='DBC schema file')
+    parser.add_argument('-o', '--out-dir', default='.',
+                        help='Directory for can_messages.h/.c (default: .)')
+    parser.add_argument('--list', action='store_true',
+                        help='Print the parsed messages instead of generating')
+    
+    args = parser.parse_args()
+    
+    try:
+        schema = load_dbc(args.schema)
+    except (OSError, SchemaError, KeyError) as e:
+        print(f"Error: {args.schema}: {e}", file=sys.stderr)
+        sys.exit(1)
+    
+    if args.list:
+        for msg in schema.messages:
+            print(f'0x{msg.frame_id:03X} {msg.name:<20} [{msg.dlc}] '
+                  + ' '.join(s.name for s in msg.signals))
+        return
+    
+    source = os.path.basename(args.schema)
+    os.makedirs(args.out_dir, exist_ok=True)
+    write_if_changed(os.path.join(args.out_dir, 'can_messages.h'),
+                     generate_header(schema, source))
+    write_if_changed(os.path.join(args.out_dir, 'can_messages.c'),
+                     generate_source(schema, source))
+
+if __name__ == '__main__':
+    main()
@@ -7,6 +7,7 @@ Includes predefined scenarios and manual command mode.
 
 Requirements:
     pip install python-can
+    can_codegen.py next to this script (reads config/bcm.dbc)
 
 Usage:
     python can_simulator.py [options]
@@ -23,10 +24,12 @@ Examples:
 """
 
 import argparse
+import os
 import time
-import struct
 import sys
 
+from can_codegen import load_dbc, SchemaError
+
 # Try to import python-can, fallback to socket
 try:
     import can
@@ -37,61 +40,56 @@ except ImportError:
     import socket
 
 # =============================================================================
-# CAN IDs and Constants (must match can_ids.h)
+# CAN IDs and Constants (from config/bcm.dbc, the schema can_messages.h is
+# generated from)
 # =============================================================================
 
-CAN_ID_DOOR_CMD         = 0x100
-CAN_ID_LIGHTING_CMD     = 0x110
-CAN_ID_TURN_SIGNAL_CMD  = 0x120
+SCHEMA_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                           '..', 'config', 'bcm.dbc')
+
+try:
+    SCHEMA = load_dbc(SCHEMA_PATH)
+except (OSError, SchemaError, KeyError) as e:
+    print(f"Error: {SCHEMA_PATH}: {e}", file=sys.stderr)
+    sys.exit(1)
 
-CAN_ID_DOOR_STATUS      = 0x200
-CAN_ID_LIGHTING_STATUS  = 0x210
-CAN_ID_TURN_STATUS      = 0x220
-CAN_ID_FAULT_STATUS     = 0x230
-CAN_ID_BCM_HEARTBEAT    = 0x240
+DOOR_CMD                = SCHEMA.message('DOOR_CMD')
+LIGHTING_CMD            = SCHEMA.message('LIGHTING_CMD')
+TURN_SIGNAL_CMD         = SCHEMA.message('TURN_SIGNAL_CMD')
 
-CAN_SCHEMA_VERSION      = 0x01
-CAN_CHECKSUM_SEED       = 0xAA
+CAN_ID_DOOR_CMD         = DOOR_CMD.frame_id
+CAN_ID_LIGHTING_CMD     = LIGHTING_CMD.frame_id
+CAN_ID_TURN_SIGNAL_CMD  = TURN_SIGNAL_CMD.frame_id
 
 # Door commands
-DOOR_CMD_LOCK_ALL       = 0x01
-DOOR_CMD_UNLOCK_ALL     = 0x02
-DOOR_CMD_LOCK_SINGLE    = 0x03
-DOOR_CMD_UNLOCK_SINGLE  = 0x04
+DOOR_CMD_LOCK_ALL       = DOOR_CMD.value('Command', 'LOCK_ALL')
+DOOR_CMD_UNLOCK_ALL     = DOOR_CMD.value('Command', 'UNLOCK_ALL')
+DOOR_CMD_LOCK_SINGLE    = DOOR_CMD.value('Command', 'LOCK_SINGLE')
+DOOR_CMD_UNLOCK_SINGLE  = DOOR_CMD.value('Command', 'UNLOCK_SINGLE')
+DOOR_ID_ALL             = DOOR_CMD.value('DoorId', 'ALL')
 
 # Lighting commands
-HEADLIGHT_CMD_OFF       = 0x00
-HEADLIGHT_CMD_ON        = 0x01
-HEADLIGHT_CMD_AUTO      = 0x02
-HEADLIGHT_CMD_HIGH_ON   = 0x03
-HEADLIGHT_CMD_HIGH_OFF  = 0x04
+HEADLIGHT_CMD_OFF       = LIGHTING_CMD.value('Headlight', 'OFF')
+HEADLIGHT_CMD_ON        = LIGHTING_CMD.value('Headlight', 'ON')
+HEADLIGHT_CMD_AUTO      = LIGHTING_CMD.value('Headlight', 'AUTO')
+HEADLIGHT_CMD_HIGH_ON   = LIGHTING_CMD.value('Headlight', 'HIGH_ON')
+HEADLIGHT_CMD_HIGH_OFF  = LIGHTING_CMD.value('Headlight', 'HIGH_OFF')
 
-INTERIOR_CMD_OFF        = 0x00
-INTERIOR_CMD_ON         = 0x01
-INTERIOR_CMD_AUTO       = 0x02
+INTERIOR_CMD_OFF        = LIGHTING_CMD.value('InteriorMode', 'OFF')
+INTERIOR_CMD_ON         = LIGHTING_CMD.value('InteriorMode', 'ON')
+INTERIOR_CMD_AUTO       = LIGHTING_CMD.value('InteriorMode', 'AUTO')
 
 # Turn signal commands
-TURN_CMD_OFF            = 0x00
-TURN_CMD_LEFT_ON        = 0x01
-TURN_CMD_RIGHT_ON       = 0x02
-TURN_CMD_HAZARD_ON      = 0x03
-TURN_CMD_HAZARD_OFF     = 0x04
+TURN_CMD_OFF            = TURN_SIGNAL_CMD.value('Command', 'OFF')
+TURN_CMD_LEFT_ON        = TURN_SIGNAL_CMD.value('Command', 'LEFT_ON')
+TURN_CMD_RIGHT_ON       = TURN_SIGNAL_CMD.value('Command', 'RIGHT_ON')
+TURN_CMD_HAZARD_ON      = TURN_SIGNAL_CMD.value('Command', 'HAZARD_ON')
+TURN_CMD_HAZARD_OFF     = TURN_SIGNAL_CMD.value('Command', 'HAZARD_OFF')
 
 # =============================================================================
 # Helper Functions
 # =============================================================================
 
-def calculate_checksum(data):
-    """Calculate XOR checksum with seed"""
-    checksum = CAN_CHECKSUM_SEED
-    for byte in data:
-        checksum ^= byte
-    return checksum
-
-def build_ver_ctr(version, counter):
-    """Build version/counter byte"""
-    return ((version & 0x0F) << 4) | (counter & 0x0F)
-
 class Counter:
     """Rolling counter manager"""
     def __init__(self):
@@ -110,39 +108,34 @@ counter = Counter()
 # Frame Builders
 # =============================================================================
 
-def build_door_cmd(cmd, door_id=0xFF):
+def build_frame(msg, **fields):
+    """Encode a schema message with the next rolling counter value"""
+    return (msg.frame_id, msg.encode(counter.get(msg.frame_id), **fields))
+
+def build_door_cmd(cmd, door_id=DOOR_ID_ALL):
     """Build door command frame"""
-    ctr = counter.get(CAN_ID_DOOR_CMD)
-    data = [cmd, door_id, build_ver_ctr(CAN_SCHEMA_VERSION, ctr), 0]
-    data[3] = calculate_checksum(data[:3])
-    return (CAN_ID_DOOR_CMD, bytes(data))
+    return build_frame(DOOR_CMD, Command=cmd, DoorId=door_id)
 
-def build_lighting_cmd(headlight, interior=0):
+def build_lighting_cmd(headlight, interior=INTERIOR_CMD_OFF, brightness=0):
     """Build lighting command frame"""
-    ctr = counter.get(CAN_ID_LIGHTING_CMD)
-    data = [headlight, interior, build_ver_ctr(CAN_SCHEMA_VERSION, ctr), 0]
-    data[3] = calculate_checksum(data[:3])
-    return (CAN_ID_LIGHTING_CMD, bytes(data))
+    return build_frame(LIGHTING_CMD, Headlight=headlight, InteriorMode=interior,
+                       InteriorBrightness=brightness)
 
 def build_turn_cmd(cmd):
     """Build turn signal command frame"""
-    ctr = counter.get(CAN_ID_TURN_SIGNAL_CMD)
-    data = [cmd, 0, build_ver_ctr(CAN_SCHEMA_VERSION, ctr), 0]
-    data[3] = calculate_checksum(data[:3])
-    return (CAN_ID_TURN_SIGNAL_CMD, bytes(data))
+    return build_frame(TURN_SIGNAL_CMD, Command=cmd)
 
 def build_malformed_frame(can_id, error_type):
     """Build intentionally malformed frame for testing"""
+    msg = SCHEMA.by_id(can_id)
     if error_type == "wrong_dlc":
         return (can_id, bytes([0x01, 0x02]))  # Too short
     elif error_type == "bad_checksum":
-        data = [0x01, 0x00, build_ver_ctr(CAN_SCHEMA_VERSION, 0), 0xFF]
+        data = bytearray(msg.encode(0, **{msg.fields()[0].name: 0x01}))
+        data[-1] ^= 0xFF
         return (can_id, bytes(data))
     elif error_type == "bad_command":
-        ctr = counter.get(can_id)
-        data = [0xFF, 0x00, build_ver_ctr(CAN_SCHEMA_VERSION, ctr), 0]
-        data[3] = calculate_checksum(data[:3])
-        return (can_id, bytes(data))
+        return build_frame(msg, **{msg.fields()[0].name: 0xFF})
     return (can_id, bytes([0]))
 
 # =============================================================================
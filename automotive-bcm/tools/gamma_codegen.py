@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+"""
+BCM Gamma LUT Generator
+
+Reads the PWM settings of config/bcm_config.h and generates the interior
+light gamma table used by the fade engine in lighting_control.c:
+    
+    light_gamma.h   Table size and settings, table declaration
+    light_gamma.c   The table and compile-time checks against bcm_config.h
+
+Entry n is the PWM duty of perceptual level n (0-255):
+    
+    duty(n) = round(LIGHT_PWM_MAX_DUTY * (n / 255) ^ (LIGHT_PWM_GAMMA_X10 / 10))
+
+The target never evaluates the curve: a fade steps a fixed-point level
+and reads the duty from the table. The build runs this from a CMake
+custom command, like can_codegen.py.
+
+Usage:
+    python gamma_codegen.py [options] <bcm_config.h>
+
+Options:
+    --out-dir, -o   Directory for light_gamma.h/.c (default: .)
+    --list          Print the table instead of generating
+
+Examples:
+    python gamma_codegen.py -o build/generated config/bcm_config.h
+    python gamma_codegen.py --list config/bcm_config.h
+"""
+
+import argparse
+import os
+import re
+import sys
+
+# =============================================================================
+# Configuration
+# =============================================================================
+
+LEVELS = 256
+HEADER_GUARD = 'LIGHT_GAMMA_H'
+ROW = 16
+
+# =============================================================================
+# Config Parsing
+# =============================================================================
+
+class ConfigError(Exception):
+    """Missing or out-of-range setting"""
+
+def load_config(path):
+    """Integer #defines of a C header, e.g. {'LIGHT_PWM_MAX_DUTY': 255}"""
+    with open(path, encoding='utf-8') as f:
+        text = f.read()
+    
+    defines = {}
+    for m in re.finditer(r'^\s*#define\s+(\w+)\s+(0x[0-9A-Fa-f]+|\d+)U?L?\b', text, re.M):
+        defines[m.group(1)] = int(m.group(2), 0)
+    return defines
+
+def setting(defines, name, lo, hi):
+    if name not in defines:
+        raise ConfigError(f'{name} not defined')
+    value = defines[name]
+    if not lo <= value <= hi:
+        raise ConfigError(f'{name} = {value} outside {lo}..{hi}')
+    return value
+
+def build_table(max_duty, gamma_x10):
+    gamma = gamma_x10 / 10.0
+    return [int(max_duty * (n / (LEVELS - 1)) ** gamma + 0.5) for n in range(LEVELS)]
+
+# =============================================================================
+# Code Generation
+# =============================================================================
+
+def banner(title):
+    return ['/' + '*' * 79, f' * {title}', ' ' + '*' * 78 + '/']
+
+def generate_header(max_duty, gamma_x10, source):
+    out = [
+        '/**',
+        ' * @file light_gamma.h',
+        ' * @brief Interior Light Gamma LUT (generated)',
+        ' *',
+        f' * Generated by tools/gamma_codegen.py from {source}. Do not edit.',
+        ' *',
+        ' * light_gamma_lut[n] is the PWM duty of perceptual level n, so equal',
+        ' * level steps look like equal brightness steps.',
+        ' */',
+        '',
+        f'#ifndef {HEADER_GUARD}',
+        f'#define {HEADER_GUARD}',
+        '',
+        '#ifdef __cplusplus',
+        'extern "C" {',
+        '#endif',
+        '',
+        '#include <stdint.h>',
+        '',
+    ]
+    out += banner('Table')
+    out += [
+        '',
+        f'#define LIGHT_GAMMA_LEVELS      {LEVELS}U',
+        f'#define LIGHT_GAMMA_MAX_LEVEL   {LEVELS - 1}U',
+        f'#define LIGHT_GAMMA_MAX_DUTY    {max_duty}U',
+        f'#define LIGHT_GAMMA_X10         {gamma_x10}U',
+        '',
+        '/** Perceptual level (0-LIGHT_GAMMA_MAX_LEVEL) -> PWM duty */',
+        'extern const uint8_t light_gamma_lut[LIGHT_GAMMA_LEVELS];',
+        '',
+        '#ifdef __cplusplus',
+        '}',
+        '#endif',
+        '',
+        f'#endif /* {HEADER_GUARD} */',
+        '',
+    ]
+    return '\n'.join(out)
+
+def generate_source(table, source):
+    out = [
+        '/**',
+        ' * @file light_gamma.c',
+        ' * @brief Interior Light Gamma LUT (generated)',
+        ' *',
+        f' * Generated by tools/gamma_codegen.py from {source}. Do not edit.',
+        ' * The static assertions fail the build when bcm_config.h was changed',
+        ' * (or overridden) after the table was generated.',
+        ' */',
+        '',
+        '#include "light_gamma.h"',
+        '#include "bcm_config.h"',
+        '',
+    ]
+    out += banner('Config Checks')
+    out += [
+        '',
+        '_Static_assert(LIGHT_GAMMA_MAX_DUTY == LIGHT_PWM_MAX_DUTY, '
+        '"LIGHT_PWM_MAX_DUTY differs from the generated table");',
+        '_Static_assert(LIGHT_GAMMA_X10 == LIGHT_PWM_GAMMA_X10, '
+        '"LIGHT_PWM_GAMMA_X10 differs from the generated table");',
+        '',
+    ]
+    out += banner('Table')
+    out += ['', 'const uint8_t light_gamma_lut[LIGHT_GAMMA_LEVELS] = {']
+    for start in range(0, LEVELS, ROW):
+        row = ', '.join(f'{v:3d}' for v in table[start:start + ROW])
+        out.append(f'    {row},   /* {start:3d}-{start + ROW - 1:3d} */')
+    out += ['};', '']
+    return '\n'.join(out)
+
+def write_if_changed(path, text):
+    """Keep the timestamp when nothing changed, so dependents don't rebuild"""
+    try:
+        with open(path, encoding='utf-8') as f:
+            if f.read() == text:
+                return
+    except OSError:
+        pass
+    with open(path, 'w', encoding='utf-8') as f:
+        f.write(text)
+
+# =============================================================================
+# Main
+# =============================================================================
+
+def main():
+    parser = argparse.ArgumentParser(description='BCM Gamma LUT Generator')
+    parser.add_argument('config', help='bcm_config.h')
+    parser.add_argument('-o', '--out-dir', default='.',
+                        help='Directory for light_gamma.h/.c (default: .)')
+    parser.add_argument('--list', action='store_true',
+                        help='Print the table instead of generating')
+    
+    args = parser.parse_args()
+    
+    try:
+        defines = load_config(args.config)
+        max_duty = setting(defines, 'LIGHT_PWM_MAX_DUTY', 1, 255)
+        gamma_x10 = setting(defines, 'LIGHT_PWM_GAMMA_X10', 10, 30)
+    except (OSError, ConfigError) as e:
+        print(f"Error: {args.config}: {e}", file=sys.stderr)
+        sys.exit(1)
+    
+    table = build_table(max_duty, gamma_x10)
+    
+    if args.list:
+        for start in range(0, LEVELS, ROW):
+            print(f'{start:3d}: ' + ' '.join(f'{v:3d}' for v in table[start:start + ROW]))
+        return
+    
+    source = os.path.basename(args.config)
+    os.makedirs(args.out_dir, exist_ok=True)
+    write_if_changed(os.path.join(args.out_dir, 'light_gamma.h'),
+                     generate_header(max_duty, gamma_x10, source))
+    write_if_changed(os.path.join(args.out_dir, 'light_gamma.c'),
+                     generate_source(table, source))
+
+if __name__ == '__main__':
+    main()